@@ -102,6 +102,15 @@ int board_uart_write(void const * buf, int len);
     return (((uint64_t)rt_tick_get()) * 1000 / RT_TICK_PER_SECOND);
   }
 
+#elif CFG_TUSB_OS == OPT_OS_POSIX
+  #include <time.h>
+  static inline uint32_t board_millis(void)
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) (((uint64_t) ts.tv_sec) * 1000 + ((uint64_t) ts.tv_nsec) / 1000000);
+  }
+
 #else
   #error "board_millis() is not implemented for this OS"
 #endif
@@ -59,6 +59,7 @@
 #include "device/usbd_pvt.h"
 
 #include "audio_device.h"
+#include "audio_interleave.h"
 
 //--------------------------------------------------------------------+
 // MACRO CONSTANT TYPEDEF
@@ -104,7 +105,8 @@
     CFG_TUSB_MCU == OPT_MCU_LPC43XX                               || \
     CFG_TUSB_MCU == OPT_MCU_MIMXRT                                || \
     CFG_TUSB_MCU == OPT_MCU_MSP432E4
-#if TUD_AUDIO_PREFER_RING_BUFFER
+// DWC2 in DMA mode only moves the linear part of a fifo (and a single packet for OUT) per transfer
+#if TUD_AUDIO_PREFER_RING_BUFFER && !(defined(TUP_USBIP_DWC2) && CFG_TUD_DWC2_DMA)
 #define  USE_LINEAR_BUFFER     0
 #else
 #define  USE_LINEAR_BUFFER     1
@@ -322,12 +324,13 @@ typedef struct
         uint32_t mclk_freq;
       }fixed;
 
-#if 0 // implement later
       struct {
-        uint32_t nominal_value;
-        uint32_t threshold_bytes;
+        uint32_t nominal_value; // in 16.16 format
+        uint32_t target_bytes;  // FIFO level to settle at
+        uint32_t gain;          // proportional gain, 16.16 feedback per byte of level error
+        uint32_t level_avg;     // filtered FIFO level in 16.16 bytes
+        int32_t  integral;      // integral term in 16.16 format
       }fifo_count;
-#endif
     }compute;
 
   } feedback;
@@ -449,6 +452,8 @@ static inline uint8_t tu_desc_subtype(void const* desc)
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
 static bool set_fb_params_freq(audiod_function_t* audio, uint32_t sample_freq, uint32_t mclk_freq);
+static void set_fb_params_fifo_count(uint8_t func_id, audiod_function_t* audio, uint32_t sample_freq, uint32_t frame_div, uint32_t target_bytes);
+static void audiod_fb_fifo_count_update(uint8_t func_id, audiod_function_t* audio);
 #endif
 
 bool tud_audio_n_mounted(uint8_t func_id)
@@ -481,13 +486,13 @@ bool tud_audio_n_mounted(uint8_t func_id)
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && !CFG_TUD_AUDIO_ENABLE_DECODING
 
-uint16_t tud_audio_n_available(uint8_t func_id)
+tu_fifo_idx_t tud_audio_n_available(uint8_t func_id)
 {
   TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
   return tu_fifo_count(&_audiod_fct[func_id].ep_out_ff);
 }
 
-uint16_t tud_audio_n_read(uint8_t func_id, void* buffer, uint16_t bufsize)
+tu_fifo_idx_t tud_audio_n_read(uint8_t func_id, void* buffer, tu_fifo_idx_t bufsize)
 {
   TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
   return tu_fifo_read_n(&_audiod_fct[func_id].ep_out_ff, buffer, bufsize);
@@ -515,13 +520,13 @@ bool tud_audio_n_clear_rx_support_ff(uint8_t func_id, uint8_t ff_idx)
   return tu_fifo_clear(&_audiod_fct[func_id].rx_supp_ff[ff_idx]);
 }
 
-uint16_t tud_audio_n_available_support_ff(uint8_t func_id, uint8_t ff_idx)
+tu_fifo_idx_t tud_audio_n_available_support_ff(uint8_t func_id, uint8_t ff_idx)
 {
   TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL && ff_idx < _audiod_fct[func_id].n_rx_supp_ff);
   return tu_fifo_count(&_audiod_fct[func_id].rx_supp_ff[ff_idx]);
 }
 
-uint16_t tud_audio_n_read_support_ff(uint8_t func_id, uint8_t ff_idx, void* buffer, uint16_t bufsize)
+tu_fifo_idx_t tud_audio_n_read_support_ff(uint8_t func_id, uint8_t ff_idx, void* buffer, tu_fifo_idx_t bufsize)
 {
   TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL && ff_idx < _audiod_fct[func_id].n_rx_supp_ff);
   return tu_fifo_read_n(&_audiod_fct[func_id].rx_supp_ff[ff_idx], buffer, bufsize);
@@ -606,6 +611,14 @@ static bool audiod_rx_done_cb(uint8_t rhport, audiod_function_t* audio, uint16_t
   TU_VERIFY(usbd_edpt_xfer_fifo(rhport, audio->ep_out, &audio->ep_out_ff, audio->ep_out_sz), false);
 #endif
 
+#endif
+
+#if CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
+  // Received data is in FIFO now, adjust feedback value to its level
+  if (audio->feedback.compute_method == AUDIO_FEEDBACK_METHOD_FIFO_COUNT)
+  {
+    audiod_fb_fifo_count_update(audiod_get_audio_fct_idx(audio), audio);
+  }
 #endif
 
   // Call a weak callback here - a possibility for user to get informed decoding was completed
@@ -624,76 +637,6 @@ static bool audiod_rx_done_cb(uint8_t rhport, audiod_function_t* audio, uint16_t
 
 // Decoding according to 2.3.1.5 Audio Streams
 
-// Helper function
-static inline uint8_t * audiod_interleaved_copy_bytes_fast_decode(uint16_t const nBytesToCopy, void * dst, uint8_t * dst_end, uint8_t * src, uint8_t const n_ff_used)
-{
-
-  // This function is an optimized version of
-  //  while((uint8_t *)dst < dst_end)
-  //  {
-  //    memcpy(dst, src, nBytesToCopy);
-  //    dst = (uint8_t *)dst + nBytesToCopy;
-  //    src += nBytesToCopy * n_ff_used;
-  //  }
-
-  // Optimize for fast half word copies
-  typedef struct{
-    uint16_t val;
-  } __attribute((__packed__)) unaligned_uint16_t;
-
-  // Optimize for fast word copies
-  typedef struct{
-    uint32_t val;
-  } __attribute((__packed__)) unaligned_uint32_t;
-
-  switch (nBytesToCopy)
-  {
-    case 1:
-      while((uint8_t *)dst < dst_end)
-      {
-        *(uint8_t *)dst++ = *src;
-        src += n_ff_used;
-      }
-      break;
-
-    case 2:
-      while((uint8_t *)dst < dst_end)
-      {
-        *(unaligned_uint16_t*)dst = *(unaligned_uint16_t*)src;
-        dst += 2;
-        src += 2 * n_ff_used;
-      }
-      break;
-
-    case 3:
-      while((uint8_t *)dst < dst_end)
-      {
-        //        memcpy(dst, src, 3);
-        //        dst = (uint8_t *)dst + 3;
-        //        src += 3 * n_ff_used;
-
-        // TODO: Is there a faster way to copy 3 bytes?
-        *(uint8_t *)dst++ = *src++;
-        *(uint8_t *)dst++ = *src++;
-        *(uint8_t *)dst++ = *src++;
-
-        src += 3 * (n_ff_used - 1);
-      }
-      break;
-
-    case 4:
-      while((uint8_t *)dst < dst_end)
-      {
-        *(unaligned_uint32_t*)dst = *(unaligned_uint32_t*)src;
-        dst += 4;
-        src += 4 * n_ff_used;
-      }
-      break;
-  }
-
-  return src;
-}
-
 static bool audiod_decode_type_I_pcm(uint8_t rhport, audiod_function_t* audio, uint16_t n_bytes_received)
 {
   (void) rhport;
@@ -715,13 +658,13 @@ static bool audiod_decode_type_I_pcm(uint8_t rhport, audiod_function_t* audio, u
 
     if (info.len_lin != 0)
     {
-      info.len_lin = tu_min16(nBytesPerFFToRead, info.len_lin);
+      info.len_lin = (tu_fifo_idx_t) tu_min32(nBytesPerFFToRead, info.len_lin);
       src = &audio->lin_buf_out[cnt_ff*audio->n_channels_per_ff_rx * audio->n_bytes_per_sampe_rx];
       dst_end = info.ptr_lin + info.len_lin;
       src = audiod_interleaved_copy_bytes_fast_decode(audio->n_bytes_per_sampe_rx, info.ptr_lin, dst_end, src, n_ff_used);
 
       // Handle wrapped part of FIFO
-      info.len_wrap = tu_min16(nBytesPerFFToRead - info.len_lin, info.len_wrap);
+      info.len_wrap = (tu_fifo_idx_t) tu_min32(nBytesPerFFToRead - info.len_lin, info.len_wrap);
       if (info.len_wrap != 0)
       {
         dst_end = info.ptr_wrap + info.len_wrap;
@@ -755,7 +698,7 @@ static bool audiod_decode_type_I_pcm(uint8_t rhport, audiod_function_t* audio, u
  * \param[in]       len: # of array elements to copy
  * \return          Number of bytes actually written
  */
-uint16_t tud_audio_n_write(uint8_t func_id, const void * data, uint16_t len)
+tu_fifo_idx_t tud_audio_n_write(uint8_t func_id, const void * data, tu_fifo_idx_t len)
 {
   TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
   return tu_fifo_write_n(&_audiod_fct[func_id].ep_in_ff, data, len);
@@ -782,14 +725,14 @@ uint16_t tud_audio_n_flush_tx_support_ff(uint8_t func_id)                 // For
   TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
   audiod_function_t* audio = &_audiod_fct[func_id];
 
-  uint16_t n_bytes_copied = tu_fifo_count(&audio->tx_supp_ff[0]);
+  tu_fifo_idx_t n_bytes_copied = tu_fifo_count(&audio->tx_supp_ff[0]);
 
   TU_VERIFY(audiod_tx_done_cb(audio->rhport, audio));
 
   n_bytes_copied -= tu_fifo_count(&audio->tx_supp_ff[0]);
   n_bytes_copied = n_bytes_copied*audio->tx_supp_ff[0].item_size;
 
-  return n_bytes_copied;
+  return (uint16_t) n_bytes_copied;
 }
 
 bool tud_audio_n_clear_tx_support_ff(uint8_t func_id, uint8_t ff_idx)
@@ -798,7 +741,7 @@ bool tud_audio_n_clear_tx_support_ff(uint8_t func_id, uint8_t ff_idx)
   return tu_fifo_clear(&_audiod_fct[func_id].tx_supp_ff[ff_idx]);
 }
 
-uint16_t tud_audio_n_write_support_ff(uint8_t func_id, uint8_t ff_idx, const void * data, uint16_t len)
+tu_fifo_idx_t tud_audio_n_write_support_ff(uint8_t func_id, uint8_t ff_idx, const void * data, tu_fifo_idx_t len)
 {
   TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL && ff_idx < _audiod_fct[func_id].n_tx_supp_ff);
   return tu_fifo_write_n(&_audiod_fct[func_id].tx_supp_ff[ff_idx], data, len);
@@ -902,7 +845,7 @@ static bool audiod_tx_done_cb(uint8_t rhport, audiod_function_t * audio)
 #else
   // No support FIFOs, if no linear buffer required schedule transmit, else put data into linear buffer and schedule
 
-  n_bytes_tx = tu_min16(tu_fifo_count(&audio->ep_in_ff), audio->ep_in_sz);      // Limit up to max packet size, more can not be done for ISO
+  n_bytes_tx = (uint16_t) tu_min32(tu_fifo_count(&audio->ep_in_ff), audio->ep_in_sz);      // Limit up to max packet size, more can not be done for ISO
 
 #if USE_LINEAR_BUFFER_TX
   tu_fifo_read_n(&audio->ep_in_ff, audio->lin_buf_in, n_bytes_tx);
@@ -940,67 +883,6 @@ range [-1, +1)
  * does not change the number of bytes per sample.
  * */
 
-// Helper function
-static inline uint8_t * audiod_interleaved_copy_bytes_fast_encode(uint16_t const nBytesToCopy, uint8_t * src, uint8_t * src_end, uint8_t * dst, uint8_t const n_ff_used)
-{
-  // Optimize for fast half word copies
-  typedef struct{
-    uint16_t val;
-  } __attribute((__packed__)) unaligned_uint16_t;
-
-  // Optimize for fast word copies
-  typedef struct{
-    uint32_t val;
-  } __attribute((__packed__)) unaligned_uint32_t;
-
-  switch (nBytesToCopy)
-  {
-    case 1:
-      while(src < src_end)
-      {
-        *dst = *src++;
-        dst += n_ff_used;
-      }
-      break;
-
-    case 2:
-      while(src < src_end)
-      {
-        *(unaligned_uint16_t*)dst = *(unaligned_uint16_t*)src;
-        src += 2;
-        dst += 2 * n_ff_used;
-      }
-      break;
-
-    case 3:
-      while(src < src_end)
-      {
-        //        memcpy(dst, src, 3);
-        //        src = (uint8_t *)src + 3;
-        //        dst += 3 * n_ff_used;
-
-        // TODO: Is there a faster way to copy 3 bytes?
-        *dst++ = *src++;
-        *dst++ = *src++;
-        *dst++ = *src++;
-
-        dst += 3 * (n_ff_used - 1);
-      }
-      break;
-
-    case 4:
-      while(src < src_end)
-      {
-        *(unaligned_uint32_t*)dst = *(unaligned_uint32_t*)src;
-        src += 4;
-        dst += 4 * n_ff_used;
-      }
-      break;
-  }
-
-  return dst;
-}
-
 static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t* audio)
 {
   // This function relies on the fact that the length of the support FIFOs was configured to be a multiple of the active sample size in bytes s.t. no sample is split within a wrap
@@ -1013,23 +895,23 @@ static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t* audi
   uint8_t const n_ff_used               = audio->n_ff_used_tx;
   uint16_t const nBytesToCopy           = audio->n_channels_per_ff_tx * audio->n_bytes_per_sampe_tx;
   uint16_t const capPerFF               = audio->ep_in_sz / n_ff_used;                                        // Sample capacity per FIFO in bytes
-  uint16_t nBytesPerFFToSend            = tu_fifo_count(&audio->tx_supp_ff[0]);
+  tu_fifo_idx_t nBytesAvailPerFF        = tu_fifo_count(&audio->tx_supp_ff[0]);
   uint8_t cnt_ff;
 
   for (cnt_ff = 1; cnt_ff < n_ff_used; cnt_ff++)
   {
-    uint16_t const count = tu_fifo_count(&audio->tx_supp_ff[cnt_ff]);
-    if (count < nBytesPerFFToSend)
+    tu_fifo_idx_t const count = tu_fifo_count(&audio->tx_supp_ff[cnt_ff]);
+    if (count < nBytesAvailPerFF)
     {
-      nBytesPerFFToSend = count;
+      nBytesAvailPerFF = count;
     }
   }
 
   // Check if there is enough
-  if (nBytesPerFFToSend == 0)    return 0;
+  if (nBytesAvailPerFF == 0)    return 0;
 
   // Limit to maximum sample number - THIS IS A POSSIBLE ERROR SOURCE IF TOO MANY SAMPLE WOULD NEED TO BE SENT BUT CAN NOT!
-  nBytesPerFFToSend = tu_min16(nBytesPerFFToSend, capPerFF);
+  uint16_t nBytesPerFFToSend = (uint16_t) tu_min32(nBytesAvailPerFF, capPerFF);
 
   // Round to full number of samples (flooring)
   nBytesPerFFToSend = (nBytesPerFFToSend / nBytesToCopy) * nBytesToCopy;
@@ -1048,12 +930,12 @@ static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t* audi
 
     if (info.len_lin != 0)
     {
-      info.len_lin = tu_min16(nBytesPerFFToSend, info.len_lin);       // Limit up to desired length
+      info.len_lin = (tu_fifo_idx_t) tu_min32(nBytesPerFFToSend, info.len_lin);       // Limit up to desired length
       src_end = (uint8_t *)info.ptr_lin + info.len_lin;
       dst = audiod_interleaved_copy_bytes_fast_encode(audio->n_bytes_per_sampe_tx, info.ptr_lin, src_end, dst, n_ff_used);
 
       // Limit up to desired length
-      info.len_wrap = tu_min16(nBytesPerFFToSend - info.len_lin, info.len_wrap);
+      info.len_wrap = (tu_fifo_idx_t) tu_min32(nBytesPerFFToSend - info.len_lin, info.len_wrap);
 
       // Handle wrapped part of FIFO
       if (info.len_wrap != 0)
@@ -1722,17 +1604,9 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
             set_fb_params_freq(audio, fb_param.sample_freq, fb_param.frequency.mclk_freq);
           break;
 
-          #if 0 // implement later
           case AUDIO_FEEDBACK_METHOD_FIFO_COUNT:
-          {
-            uint64_t fb64 = ((uint64_t) fb_param.sample_freq) << 16;
-            audio->feedback.compute.fifo_count.nominal_value = (uint32_t) (fb64 / frame_div);
-            audio->feedback.compute.fifo_count.threshold_bytes = fb_param.fifo_count.threshold_bytes;
-
-            tud_audio_fb_set(audio->feedback.compute.fifo_count.nominal_value);
-          }
+            set_fb_params_fifo_count(func_id, audio, fb_param.sample_freq, frame_div, fb_param.fifo_count.target_bytes);
           break;
-          #endif
 
           // nothing to do
           default: break;
@@ -2086,6 +1960,77 @@ static bool set_fb_params_freq(audiod_function_t* audio, uint32_t sample_freq, u
   return true;
 }
 
+// Sum up fill level and depth of the FIFOs receiving OUT data
+static uint32_t audiod_fb_fifo_level(audiod_function_t* audio, uint32_t* depth)
+{
+#if CFG_TUD_AUDIO_ENABLE_DECODING
+  uint32_t level = 0;
+  *depth = 0;
+  for (uint8_t cnt_ff = 0; cnt_ff < audio->n_ff_used_rx; cnt_ff++)
+  {
+    level  += tu_fifo_count(&audio->rx_supp_ff[cnt_ff]);
+    *depth += tu_fifo_depth(&audio->rx_supp_ff[cnt_ff]);
+  }
+  return level;
+#else
+  *depth = tu_fifo_depth(&audio->ep_out_ff);
+  return tu_fifo_count(&audio->ep_out_ff);
+#endif
+}
+
+static void set_fb_params_fifo_count(uint8_t func_id, audiod_function_t* audio, uint32_t sample_freq, uint32_t frame_div, uint32_t target_bytes)
+{
+  uint32_t depth;
+  (void) audiod_fb_fifo_level(audio, &depth);
+
+  if ( target_bytes == 0 || target_bytes >= depth ) target_bytes = depth / 2;
+  if ( target_bytes == 0 ) target_bytes = 1;
+
+  uint64_t fb64 = ((uint64_t) sample_freq) << 16;
+  uint32_t const nominal = (uint32_t) (fb64 / frame_div);
+
+  audio->feedback.compute.fifo_count.nominal_value = nominal;
+  audio->feedback.compute.fifo_count.target_bytes  = target_bytes;
+
+  // An empty (or twice the target) FIFO drives feedback to max (min) value by the proportional term alone
+  audio->feedback.compute.fifo_count.gain      = (audio->feedback.max_value - nominal) / target_bytes;
+  audio->feedback.compute.fifo_count.level_avg = target_bytes << 16;
+  audio->feedback.compute.fifo_count.integral  = 0;
+
+  tud_audio_n_fb_set(func_id, nominal);
+}
+
+// PI controller on the filtered FIFO level: host sends more samples while FIFO is below target, less while above
+static void audiod_fb_fifo_count_update(uint8_t func_id, audiod_function_t* audio)
+{
+  uint32_t depth;
+  uint32_t const level = audiod_fb_fifo_level(audio, &depth);
+
+  // Low-pass filter the level, it jitters by a packet with each receive/read
+  uint32_t avg = audio->feedback.compute.fifo_count.level_avg;
+  avg = (uint32_t) ((int64_t) avg + ((((int64_t) level << 16) - (int64_t) avg) >> CFG_TUD_AUDIO_FEEDBACK_FIFO_FILTER_SHIFT));
+  audio->feedback.compute.fifo_count.level_avg = avg;
+
+  int64_t const error = ((int64_t) audio->feedback.compute.fifo_count.target_bytes << 16) - (int64_t) avg;
+  int32_t const prop  = (int32_t) ((error * audio->feedback.compute.fifo_count.gain) >> 16);
+
+  // Integral term is bounded to feedback range so that it does not wind up while the output is clamped
+  int32_t const nominal   = (int32_t) audio->feedback.compute.fifo_count.nominal_value;
+  int32_t const range_max = (int32_t) audio->feedback.max_value - nominal;
+  int32_t const range_min = (int32_t) audio->feedback.min_value - nominal;
+
+  int32_t integral = audio->feedback.compute.fifo_count.integral + (prop >> CFG_TUD_AUDIO_FEEDBACK_FIFO_INTEGRAL_SHIFT);
+  if ( integral > range_max ) integral = range_max;
+  if ( integral < range_min ) integral = range_min;
+  audio->feedback.compute.fifo_count.integral = integral;
+
+  int32_t feedback = nominal + prop + integral;
+  if ( feedback > (int32_t) audio->feedback.max_value ) feedback = (int32_t) audio->feedback.max_value;
+  if ( feedback < (int32_t) audio->feedback.min_value ) feedback = (int32_t) audio->feedback.min_value;
+
+  tud_audio_n_fb_set(func_id, (uint32_t) feedback);
+}
+
 uint32_t tud_audio_feedback_update(uint8_t func_id, uint32_t cycles)
 {
   audiod_function_t* audio = &_audiod_fct[func_id];
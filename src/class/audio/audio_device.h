@@ -191,6 +191,15 @@
 #define CFG_TUD_AUDIO_ENABLE_FEEDBACK_FORMAT_CORRECTION     0                             // 0 or 1
 #endif
 
+// AUDIO_FEEDBACK_METHOD_FIFO_COUNT: averaging of the FIFO level and integral time constant, as power of 2 of received packets
+#ifndef CFG_TUD_AUDIO_FEEDBACK_FIFO_FILTER_SHIFT
+#define CFG_TUD_AUDIO_FEEDBACK_FIFO_FILTER_SHIFT            4
+#endif
+
+#ifndef CFG_TUD_AUDIO_FEEDBACK_FIFO_INTEGRAL_SHIFT
+#define CFG_TUD_AUDIO_FEEDBACK_FIFO_INTEGRAL_SHIFT          8
+#endif
+
 // Audio interrupt control EP size - disabled if 0
 #ifndef CFG_TUD_AUDIO_INT_CTR_EPSIZE_IN
 #define CFG_TUD_AUDIO_INT_CTR_EPSIZE_IN                     0                             // Audio interrupt control - if required - 6 Bytes according to UAC 2 specification (p. 74)
@@ -362,21 +371,21 @@ extern "C" {
 bool     tud_audio_n_mounted    (uint8_t func_id);
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && !CFG_TUD_AUDIO_ENABLE_DECODING
-uint16_t tud_audio_n_available                    (uint8_t func_id);
-uint16_t tud_audio_n_read                         (uint8_t func_id, void* buffer, uint16_t bufsize);
+tu_fifo_idx_t tud_audio_n_available               (uint8_t func_id);
+tu_fifo_idx_t tud_audio_n_read                    (uint8_t func_id, void* buffer, tu_fifo_idx_t bufsize);
 bool     tud_audio_n_clear_ep_out_ff              (uint8_t func_id);                          // Delete all content in the EP OUT FIFO
 tu_fifo_t*   tud_audio_n_get_ep_out_ff            (uint8_t func_id);
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_DECODING
 bool     tud_audio_n_clear_rx_support_ff          (uint8_t func_id, uint8_t ff_idx);       // Delete all content in the support RX FIFOs
-uint16_t tud_audio_n_available_support_ff         (uint8_t func_id, uint8_t ff_idx);
-uint16_t tud_audio_n_read_support_ff              (uint8_t func_id, uint8_t ff_idx, void* buffer, uint16_t bufsize);
+tu_fifo_idx_t tud_audio_n_available_support_ff    (uint8_t func_id, uint8_t ff_idx);
+tu_fifo_idx_t tud_audio_n_read_support_ff         (uint8_t func_id, uint8_t ff_idx, void* buffer, tu_fifo_idx_t bufsize);
 tu_fifo_t* tud_audio_n_get_rx_support_ff          (uint8_t func_id, uint8_t ff_idx);
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && !CFG_TUD_AUDIO_ENABLE_ENCODING
-uint16_t tud_audio_n_write                        (uint8_t func_id, const void * data, uint16_t len);
+tu_fifo_idx_t tud_audio_n_write                   (uint8_t func_id, const void * data, tu_fifo_idx_t len);
 bool     tud_audio_n_clear_ep_in_ff               (uint8_t func_id);                          // Delete all content in the EP IN FIFO
 tu_fifo_t*   tud_audio_n_get_ep_in_ff             (uint8_t func_id);
 #endif
@@ -384,7 +393,7 @@ tu_fifo_t*   tud_audio_n_get_ep_in_ff             (uint8_t func_id);
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_ENABLE_ENCODING
 uint16_t tud_audio_n_flush_tx_support_ff          (uint8_t func_id);      // Force all content in the support TX FIFOs to be written into EP SW FIFO
 bool     tud_audio_n_clear_tx_support_ff          (uint8_t func_id, uint8_t ff_idx);
-uint16_t tud_audio_n_write_support_ff             (uint8_t func_id, uint8_t ff_idx, const void * data, uint16_t len);
+tu_fifo_idx_t tud_audio_n_write_support_ff        (uint8_t func_id, uint8_t ff_idx, const void * data, tu_fifo_idx_t len);
 tu_fifo_t* tud_audio_n_get_tx_support_ff          (uint8_t func_id, uint8_t ff_idx);
 #endif
 
@@ -401,23 +410,23 @@ static inline bool         tud_audio_mounted                (void);
 // RX API
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && !CFG_TUD_AUDIO_ENABLE_DECODING
-static inline uint16_t     tud_audio_available              (void);
+static inline tu_fifo_idx_t tud_audio_available              (void);
 static inline bool         tud_audio_clear_ep_out_ff        (void);                       // Delete all content in the EP OUT FIFO
-static inline uint16_t     tud_audio_read                   (void* buffer, uint16_t bufsize);
+static inline tu_fifo_idx_t tud_audio_read                   (void* buffer, tu_fifo_idx_t bufsize);
 static inline tu_fifo_t*   tud_audio_get_ep_out_ff          (void);
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_DECODING
 static inline bool     tud_audio_clear_rx_support_ff        (uint8_t ff_idx);
-static inline uint16_t tud_audio_available_support_ff       (uint8_t ff_idx);
-static inline uint16_t tud_audio_read_support_ff            (uint8_t ff_idx, void* buffer, uint16_t bufsize);
+static inline tu_fifo_idx_t tud_audio_available_support_ff  (uint8_t ff_idx);
+static inline tu_fifo_idx_t tud_audio_read_support_ff       (uint8_t ff_idx, void* buffer, tu_fifo_idx_t bufsize);
 static inline tu_fifo_t* tud_audio_get_rx_support_ff        (uint8_t ff_idx);
 #endif
 
 // TX API
 
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && !CFG_TUD_AUDIO_ENABLE_ENCODING
-static inline uint16_t tud_audio_write                      (const void * data, uint16_t len);
+static inline tu_fifo_idx_t tud_audio_write                 (const void * data, tu_fifo_idx_t len);
 static inline bool 	   tud_audio_clear_ep_in_ff             (void);
 static inline tu_fifo_t* tud_audio_get_ep_in_ff             (void);
 #endif
@@ -425,7 +434,7 @@ static inline tu_fifo_t* tud_audio_get_ep_in_ff             (void);
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_ENABLE_ENCODING
 static inline uint16_t tud_audio_flush_tx_support_ff        (void);
 static inline uint16_t tud_audio_clear_tx_support_ff        (uint8_t ff_idx);
-static inline uint16_t tud_audio_write_support_ff           (uint8_t ff_idx, const void * data, uint16_t len);
+static inline tu_fifo_idx_t tud_audio_write_support_ff      (uint8_t ff_idx, const void * data, tu_fifo_idx_t len);
 static inline tu_fifo_t* tud_audio_get_tx_support_ff        (uint8_t ff_idx);
 #endif
 
@@ -499,8 +508,9 @@ enum {
   AUDIO_FEEDBACK_METHOD_FREQUENCY_FLOAT,
   AUDIO_FEEDBACK_METHOD_FREQUENCY_POWER_OF_2,
 
-  // impelemnt later
-  // AUDIO_FEEDBACK_METHOD_FIFO_COUNT
+  // Feedback value is computed by the driver from the fill level of the OUT FIFO, no clock capture is needed.
+  // A PI controller moves the level towards fifo_count.target_bytes within min/max feedback value.
+  AUDIO_FEEDBACK_METHOD_FIFO_COUNT
 };
 
 typedef struct {
@@ -512,11 +522,9 @@ typedef struct {
       uint32_t mclk_freq; // Main clock frequency in Hz i.e. master clock to which sample clock is based on
     }frequency;
 
-#if 0 // implement later
     struct {
-      uint32_t threshold_bytes; // minimum number of bytes received to be considered as filled/ready
+      uint32_t target_bytes; // FIFO level to settle at, 0 for half of the FIFO
     }fifo_count;
-#endif
   };
 }audio_feedback_params_t;
 
@@ -572,12 +580,12 @@ static inline bool tud_audio_mounted(void)
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && !CFG_TUD_AUDIO_ENABLE_DECODING
 
-static inline uint16_t tud_audio_available(void)
+static inline tu_fifo_idx_t tud_audio_available(void)
 {
   return tud_audio_n_available(0);
 }
 
-static inline uint16_t tud_audio_read(void* buffer, uint16_t bufsize)
+static inline tu_fifo_idx_t tud_audio_read(void* buffer, tu_fifo_idx_t bufsize)
 {
   return tud_audio_n_read(0, buffer, bufsize);
 }
@@ -601,12 +609,12 @@ static inline bool tud_audio_clear_rx_support_ff(uint8_t ff_idx)
   return tud_audio_n_clear_rx_support_ff(0, ff_idx);
 }
 
-static inline uint16_t tud_audio_available_support_ff(uint8_t ff_idx)
+static inline tu_fifo_idx_t tud_audio_available_support_ff(uint8_t ff_idx)
 {
   return tud_audio_n_available_support_ff(0, ff_idx);
 }
 
-static inline uint16_t tud_audio_read_support_ff(uint8_t ff_idx, void* buffer, uint16_t bufsize)
+static inline tu_fifo_idx_t tud_audio_read_support_ff(uint8_t ff_idx, void* buffer, tu_fifo_idx_t bufsize)
 {
   return tud_audio_n_read_support_ff(0, ff_idx, buffer, bufsize);
 }
@@ -622,7 +630,7 @@ static inline tu_fifo_t* tud_audio_get_rx_support_ff(uint8_t ff_idx)
 
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && !CFG_TUD_AUDIO_ENABLE_ENCODING
 
-static inline uint16_t tud_audio_write(const void * data, uint16_t len)
+static inline tu_fifo_idx_t tud_audio_write(const void * data, tu_fifo_idx_t len)
 {
   return tud_audio_n_write(0, data, len);
 }
@@ -651,7 +659,7 @@ static inline uint16_t tud_audio_clear_tx_support_ff(uint8_t ff_idx)
   return tud_audio_n_clear_tx_support_ff(0, ff_idx);
 }
 
-static inline uint16_t tud_audio_write_support_ff(uint8_t ff_idx, const void * data, uint16_t len)
+static inline tu_fifo_idx_t tud_audio_write_support_ff(uint8_t ff_idx, const void * data, tu_fifo_idx_t len)
 {
   return tud_audio_n_write_support_ff(0, ff_idx, data, len);
 }
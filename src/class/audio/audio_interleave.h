@@ -0,0 +1,247 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Reinhard Panhuber, Jerzy Kasenberg
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Private helper for audio driver, should only be included by audio_device.c.
+// Copy PCM samples between the support FIFOs and the interleaved stream of 2.3.1.5 Audio Streams.
+// Each support FIFO holds n_bytes_per_sample bytes out of every n_ff_used * n_bytes_per_sample bytes of the
+// stream. Samples are gathered/scattered per word on little-endian targets where it is measured faster than the
+// per-sample copy (test/vbus/bench): 1 and 2-byte decode, 1 to 3-byte encode.
+
+#ifndef _TUSB_AUDIO_INTERLEAVE_H_
+#define _TUSB_AUDIO_INTERLEAVE_H_
+
+#include "common/tusb_common.h"
+
+// De-interleave samples of one support FIFO from the received stream, dst is filled up to dst_end.
+// Return pointer to the next sample of this FIFO in the stream.
+static inline uint8_t * audiod_interleaved_copy_bytes_fast_decode(uint16_t const nBytesToCopy, void * dst, uint8_t * dst_end, uint8_t * src, uint8_t const n_ff_used)
+{
+
+  // This function is an optimized version of
+  //  while((uint8_t *)dst < dst_end)
+  //  {
+  //    memcpy(dst, src, nBytesToCopy);
+  //    dst = (uint8_t *)dst + nBytesToCopy;
+  //    src += nBytesToCopy * n_ff_used;
+  //  }
+
+  // Optimize for fast half word copies
+  typedef struct{
+    uint16_t val;
+  } __attribute((__packed__)) unaligned_uint16_t;
+
+  // Optimize for fast word copies
+  typedef struct{
+    uint32_t val;
+  } __attribute((__packed__)) unaligned_uint32_t;
+
+  // Nothing to de-interleave
+  if (n_ff_used == 1)
+  {
+    uint16_t const len = (uint16_t) (dst_end - (uint8_t *) dst);
+    memcpy(dst, src, len);
+    return src + len;
+  }
+
+  uint16_t const stride = (uint16_t) (nBytesToCopy * n_ff_used);
+
+  switch (nBytesToCopy)
+  {
+    case 1:
+#if TU_BYTE_ORDER == TU_LITTLE_ENDIAN
+      // Gather 4 samples into a word
+      while((uint8_t *)dst + 4 <= dst_end)
+      {
+        ((unaligned_uint32_t*)dst)->val = (uint32_t) src[0] | ((uint32_t) src[stride] << 8) |
+                                          ((uint32_t) src[2*stride] << 16) | ((uint32_t) src[3*stride] << 24);
+        dst += 4;
+        src += 4 * stride;
+      }
+#endif
+      while((uint8_t *)dst < dst_end)
+      {
+        *(uint8_t *)dst++ = *src;
+        src += n_ff_used;
+      }
+      break;
+
+    case 2:
+#if TU_BYTE_ORDER == TU_LITTLE_ENDIAN
+      // Gather 2 samples into a word
+      while((uint8_t *)dst + 4 <= dst_end)
+      {
+        ((unaligned_uint32_t*)dst)->val = (uint32_t) ((unaligned_uint16_t*)src)->val |
+                                          ((uint32_t) ((unaligned_uint16_t*)(src + stride))->val << 16);
+        dst += 4;
+        src += 2 * stride;
+      }
+#endif
+      while((uint8_t *)dst < dst_end)
+      {
+        *(unaligned_uint16_t*)dst = *(unaligned_uint16_t*)src;
+        dst += 2;
+        src += 2 * n_ff_used;
+      }
+      break;
+
+    case 3:
+      // Gathering into words does not beat byte copy here: loads are the same 3 bytes per sample
+      while((uint8_t *)dst < dst_end)
+      {
+        *(uint8_t *)dst++ = src[0];
+        *(uint8_t *)dst++ = src[1];
+        *(uint8_t *)dst++ = src[2];
+        src += stride;
+      }
+      break;
+
+    case 4:
+      while((uint8_t *)dst < dst_end)
+      {
+        *(unaligned_uint32_t*)dst = *(unaligned_uint32_t*)src;
+        dst += 4;
+        src += 4 * n_ff_used;
+      }
+      break;
+  }
+
+  return src;
+}
+
+// Interleave samples of one support FIFO from src to src_end into the stream to be sent.
+// Return pointer to the next sample of this FIFO in the stream.
+static inline uint8_t * audiod_interleaved_copy_bytes_fast_encode(uint16_t const nBytesToCopy, uint8_t * src, uint8_t * src_end, uint8_t * dst, uint8_t const n_ff_used)
+{
+  // Optimize for fast half word copies
+  typedef struct{
+    uint16_t val;
+  } __attribute((__packed__)) unaligned_uint16_t;
+
+  // Optimize for fast word copies
+  typedef struct{
+    uint32_t val;
+  } __attribute((__packed__)) unaligned_uint32_t;
+
+  // Nothing to interleave
+  if (n_ff_used == 1)
+  {
+    uint16_t const len = (uint16_t) (src_end - src);
+    memcpy(dst, src, len);
+    return dst + len;
+  }
+
+  uint16_t const stride = (uint16_t) (nBytesToCopy * n_ff_used);
+
+  switch (nBytesToCopy)
+  {
+    case 1:
+#if TU_BYTE_ORDER == TU_LITTLE_ENDIAN
+      // Scatter 4 samples from a word
+      while(src + 4 <= src_end)
+      {
+        uint32_t const w = ((unaligned_uint32_t*)src)->val;
+        dst[0]        = (uint8_t) w;
+        dst[stride]   = (uint8_t) (w >> 8);
+        dst[2*stride] = (uint8_t) (w >> 16);
+        dst[3*stride] = (uint8_t) (w >> 24);
+        src += 4;
+        dst += 4 * stride;
+      }
+#endif
+      while(src < src_end)
+      {
+        *dst = *src++;
+        dst += n_ff_used;
+      }
+      break;
+
+    case 2:
+#if TU_BYTE_ORDER == TU_LITTLE_ENDIAN
+      // Scatter 2 samples from a word
+      while(src + 4 <= src_end)
+      {
+        uint32_t const w = ((unaligned_uint32_t*)src)->val;
+        ((unaligned_uint16_t*)dst)->val            = (uint16_t) w;
+        ((unaligned_uint16_t*)(dst + stride))->val = (uint16_t) (w >> 16);
+        src += 4;
+        dst += 2 * stride;
+      }
+#endif
+      while(src < src_end)
+      {
+        *(unaligned_uint16_t*)dst = *(unaligned_uint16_t*)src;
+        src += 2;
+        dst += 2 * n_ff_used;
+      }
+      break;
+
+    case 3:
+#if TU_BYTE_ORDER == TU_LITTLE_ENDIAN
+      // Scatter 4 samples from 3 words
+      while(src + 12 <= src_end)
+      {
+        uint32_t const w0 = ((unaligned_uint32_t*)src)->val;
+        uint32_t const w1 = ((unaligned_uint32_t*)(src + 4))->val;
+        uint32_t const w2 = ((unaligned_uint32_t*)(src + 8))->val;
+        src += 12;
+
+        ((unaligned_uint16_t*)dst)->val = (uint16_t) w0;
+        dst[2] = (uint8_t) (w0 >> 16);
+        dst += stride;
+        ((unaligned_uint16_t*)dst)->val = (uint16_t) ((w0 >> 24) | (w1 << 8));
+        dst[2] = (uint8_t) (w1 >> 8);
+        dst += stride;
+        ((unaligned_uint16_t*)dst)->val = (uint16_t) (w1 >> 16);
+        dst[2] = (uint8_t) w2;
+        dst += stride;
+        ((unaligned_uint16_t*)dst)->val = (uint16_t) (w2 >> 8);
+        dst[2] = (uint8_t) (w2 >> 24);
+        dst += stride;
+      }
+#endif
+      while(src < src_end)
+      {
+        dst[0] = *src++;
+        dst[1] = *src++;
+        dst[2] = *src++;
+        dst += stride;
+      }
+      break;
+
+    case 4:
+      while(src < src_end)
+      {
+        *(unaligned_uint32_t*)dst = *(unaligned_uint32_t*)src;
+        src += 4;
+        dst += 4 * n_ff_used;
+      }
+      break;
+  }
+
+  return dst;
+}
+
+#endif
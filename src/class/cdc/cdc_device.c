@@ -63,11 +63,18 @@ typedef struct
   uint8_t tx_ff_buf[CFG_TUD_CDC_TX_BUFSIZE];
 
   OSAL_MUTEX_DEF(rx_ff_mutex);
+#if !CFG_TUSB_FIFO_MP_WRITE
   OSAL_MUTEX_DEF(tx_ff_mutex);
+#endif
 
+#if CFG_TUD_CDC_EDPT_XFER_FIFO
+  // rx fifo write position of current OUT transfer, used to scan for wanted char
+  tu_fifo_buffer_info_t rx_info;
+#else
   // Endpoint Transfer buffer
   CFG_TUSB_MEM_ALIGN uint8_t epout_buf[CFG_TUD_CDC_EP_BUFSIZE];
   CFG_TUSB_MEM_ALIGN uint8_t epin_buf[CFG_TUD_CDC_EP_BUFSIZE];
+#endif
 
 }cdcd_interface_t;
 
@@ -81,13 +88,13 @@ CFG_TUSB_MEM_SECTION static cdcd_interface_t _cdcd_itf[CFG_TUD_CDC];
 static bool _prep_out_transaction (cdcd_interface_t* p_cdc)
 {
   uint8_t const rhport = 0;
-  uint16_t available = tu_fifo_remaining(&p_cdc->rx_ff);
+  tu_fifo_idx_t available = tu_fifo_remaining(&p_cdc->rx_ff);
 
   // Prepare for incoming data but only allow what we can store in the ring buffer.
   // TODO Actually we can still carry out the transfer, keeping count of received bytes
   // and slowly move it to the FIFO when read().
   // This pre-check reduces endpoint claiming
-  TU_VERIFY(available >= sizeof(p_cdc->epout_buf));
+  TU_VERIFY(available >= CFG_TUD_CDC_EP_BUFSIZE);
 
   // claim endpoint
   TU_VERIFY(usbd_edpt_claim(rhport, p_cdc->ep_out));
@@ -95,9 +102,14 @@ static bool _prep_out_transaction (cdcd_interface_t* p_cdc)
   // fifo can be changed before endpoint is claimed
   available = tu_fifo_remaining(&p_cdc->rx_ff);
 
-  if ( available >= sizeof(p_cdc->epout_buf) )
+  if ( available >= CFG_TUD_CDC_EP_BUFSIZE )
   {
+#if CFG_TUD_CDC_EDPT_XFER_FIFO
+    tu_fifo_get_write_info(&p_cdc->rx_ff, &p_cdc->rx_info);
+    return usbd_edpt_xfer_fifo(rhport, p_cdc->ep_out, &p_cdc->rx_ff, CFG_TUD_CDC_EP_BUFSIZE);
+#else
     return usbd_edpt_xfer(rhport, p_cdc->ep_out, p_cdc->epout_buf, sizeof(p_cdc->epout_buf));
+#endif
   }else
   {
     // Release endpoint since we don't make any transfer
@@ -107,6 +119,17 @@ static bool _prep_out_transaction (cdcd_interface_t* p_cdc)
   }
 }
 
+// Get i-th byte of the completed OUT transfer
+TU_ATTR_ALWAYS_INLINE static inline uint8_t _rx_byte(cdcd_interface_t const* p_cdc, uint32_t i)
+{
+#if CFG_TUD_CDC_EDPT_XFER_FIFO
+  tu_fifo_buffer_info_t const* info = &p_cdc->rx_info;
+  return (i < info->len_lin) ? ((uint8_t const*) info->ptr_lin)[i] : ((uint8_t const*) info->ptr_wrap)[i - info->len_lin];
+#else
+  return p_cdc->epout_buf[i];
+#endif
+}
+
 //--------------------------------------------------------------------+
 // APPLICATION API
 //--------------------------------------------------------------------+
@@ -143,7 +166,7 @@ uint32_t tud_cdc_n_available(uint8_t itf)
 uint32_t tud_cdc_n_read(uint8_t itf, void* buffer, uint32_t bufsize)
 {
   cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
-  uint32_t num_read = tu_fifo_read_n(&p_cdc->rx_ff, buffer, (uint16_t) bufsize);
+  uint32_t num_read = tu_fifo_read_n(&p_cdc->rx_ff, buffer, (tu_fifo_idx_t) bufsize);
   _prep_out_transaction(p_cdc);
   return num_read;
 }
@@ -166,7 +189,11 @@ void tud_cdc_n_read_flush (uint8_t itf)
 uint32_t tud_cdc_n_write(uint8_t itf, void const* buffer, uint32_t bufsize)
 {
   cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
-  uint16_t ret = tu_fifo_write_n(&p_cdc->tx_ff, buffer, (uint16_t) bufsize);
+#if CFG_TUSB_FIFO_MP_WRITE
+  tu_fifo_idx_t ret = tu_fifo_write_n_mp(&p_cdc->tx_ff, buffer, (tu_fifo_idx_t) bufsize);
+#else
+  tu_fifo_idx_t ret = tu_fifo_write_n(&p_cdc->tx_ff, buffer, (tu_fifo_idx_t) bufsize);
+#endif
 
   // flush if queue more than packet size
   // may need to suppress -Wunreachable-code since most of the time CFG_TUD_CDC_TX_BUFSIZE < BULK_PACKET_SIZE
@@ -193,12 +220,21 @@ uint32_t tud_cdc_n_write_flush (uint8_t itf)
   // Claim the endpoint
   TU_VERIFY( usbd_edpt_claim(rhport, p_cdc->ep_in), 0 );
 
+#if CFG_TUD_CDC_EDPT_XFER_FIFO
+  // DCD pulls data from FIFO
+  uint16_t const count = (uint16_t) tu_min32(tu_fifo_count(&p_cdc->tx_ff), CFG_TUD_CDC_EP_BUFSIZE);
+#else
   // Pull data from FIFO
-  uint16_t const count = tu_fifo_read_n(&p_cdc->tx_ff, p_cdc->epin_buf, sizeof(p_cdc->epin_buf));
+  uint16_t const count = (uint16_t) tu_fifo_read_n(&p_cdc->tx_ff, p_cdc->epin_buf, sizeof(p_cdc->epin_buf));
+#endif
 
   if ( count )
   {
+#if CFG_TUD_CDC_EDPT_XFER_FIFO
+    TU_ASSERT( usbd_edpt_xfer_fifo(rhport, p_cdc->ep_in, &p_cdc->tx_ff, count), 0 );
+#else
     TU_ASSERT( usbd_edpt_xfer(rhport, p_cdc->ep_in, p_cdc->epin_buf, count), 0 );
+#endif
     return count;
   }else
   {
@@ -244,10 +280,15 @@ void cdcd_init(void)
     // Config TX fifo as overwritable at initialization and will be changed to non-overwritable
     // if terminal supports DTR bit. Without DTR we do not know if data is actually polled by terminal.
     // In this way, the most current data is prioritized.
-    tu_fifo_config(&p_cdc->tx_ff, p_cdc->tx_ff_buf, TU_ARRAY_SIZE(p_cdc->tx_ff_buf), 1, true);
+    // With CFG_TUD_CDC_EDPT_XFER_FIFO, DCD reads TX fifo in place: it is never overwritable since that would
+    // corrupt data of an on-going IN transfer.
+    tu_fifo_config(&p_cdc->tx_ff, p_cdc->tx_ff_buf, TU_ARRAY_SIZE(p_cdc->tx_ff_buf), 1, !CFG_TUD_CDC_EDPT_XFER_FIFO);
 
     tu_fifo_config_mutex(&p_cdc->rx_ff, NULL, osal_mutex_create(&p_cdc->rx_ff_mutex));
+#if !CFG_TUSB_FIFO_MP_WRITE
+    // tx fifo is written lock-free with tu_fifo_write_n_mp()
     tu_fifo_config_mutex(&p_cdc->tx_ff, osal_mutex_create(&p_cdc->tx_ff_mutex), NULL);
+#endif
   }
 }
 
@@ -262,7 +303,7 @@ void cdcd_reset(uint8_t rhport)
     tu_memclr(p_cdc, ITF_MEM_RESET_SIZE);
     tu_fifo_clear(&p_cdc->rx_ff);
     tu_fifo_clear(&p_cdc->tx_ff);
-    tu_fifo_set_overwritable(&p_cdc->tx_ff, true);
+    tu_fifo_set_overwritable(&p_cdc->tx_ff, !CFG_TUD_CDC_EDPT_XFER_FIFO);
   }
 }
 
@@ -319,6 +360,9 @@ uint16_t cdcd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint1
 
     // Open endpoint pair
     TU_ASSERT( usbd_open_edpt_pair(rhport, p_desc, 2, TUSB_XFER_BULK, &p_cdc->ep_out, &p_cdc->ep_in), 0 );
+    uint8_t const cdc_id = (uint8_t) (p_cdc - _cdcd_itf);
+    usbd_edpt_bind_instance(rhport, p_cdc->ep_out, cdc_id);
+    usbd_edpt_bind_instance(rhport, p_cdc->ep_in , cdc_id);
 
     drv_len += 2*sizeof(tusb_desc_endpoint_t);
   }
@@ -387,8 +431,8 @@ bool cdcd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
 
         p_cdc->line_state = (uint8_t) request->wValue;
         
-        // Disable fifo overwriting if DTR bit is set
-        tu_fifo_set_overwritable(&p_cdc->tx_ff, !dtr);
+        // Disable fifo overwriting if DTR bit is set, TX fifo is never overwritable with CFG_TUD_CDC_EDPT_XFER_FIFO
+        tu_fifo_set_overwritable(&p_cdc->tx_ff, !dtr && !CFG_TUD_CDC_EDPT_XFER_FIFO);
 
         TU_LOG2("  Set Control Line State: DTR = %d, RTS = %d\r\n", dtr, rts);
 
@@ -418,28 +462,26 @@ bool cdcd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
 {
   (void) result;
 
-  uint8_t itf;
-  cdcd_interface_t* p_cdc;
-
   // Identify which interface to use
-  for (itf = 0; itf < CFG_TUD_CDC; itf++)
-  {
-    p_cdc = &_cdcd_itf[itf];
-    if ( ( ep_addr == p_cdc->ep_out ) || ( ep_addr == p_cdc->ep_in ) ) break;
-  }
+  uint8_t const itf = usbd_edpt_instance(rhport, ep_addr);
   TU_ASSERT(itf < CFG_TUD_CDC);
 
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+
   // Received new data
   if ( ep_addr == p_cdc->ep_out )
   {
+#if !CFG_TUD_CDC_EDPT_XFER_FIFO
+    // with CFG_TUD_CDC_EDPT_XFER_FIFO data is already written to rx fifo by DCD
     tu_fifo_write_n(&p_cdc->rx_ff, p_cdc->epout_buf, (uint16_t) xferred_bytes);
+#endif
     
     // Check for wanted char and invoke callback if needed
     if ( tud_cdc_rx_wanted_cb && (((signed char) p_cdc->wanted_char) != -1) )
     {
       for ( uint32_t i = 0; i < xferred_bytes; i++ )
       {
-        if ( (p_cdc->wanted_char == p_cdc->epout_buf[i]) && !tu_fifo_empty(&p_cdc->rx_ff) )
+        if ( (p_cdc->wanted_char == (char) _rx_byte(p_cdc, i)) && !tu_fifo_empty(&p_cdc->rx_ff) )
         {
           tud_cdc_rx_wanted_cb(itf, p_cdc->wanted_char);
         }
@@ -41,6 +41,13 @@
   #define CFG_TUD_CDC_EP_BUFSIZE    (TUD_OPT_HIGH_SPEED ? 512 : 64)
 #endif
 
+// Transfer directly between endpoints and rx/tx fifo with usbd_edpt_xfer_fifo() instead of copying through
+// endpoint buffers, which are then not allocated. CFG_TUD_CDC_EP_BUFSIZE is still the max size of each transfer.
+// TX fifo is then never overwritable: without DTR, data which does not fit is dropped instead of the oldest one.
+#ifndef CFG_TUD_CDC_EDPT_XFER_FIFO
+  #define CFG_TUD_CDC_EDPT_XFER_FIFO  0
+#endif
+
 #ifdef __cplusplus
  extern "C" {
 #endif
@@ -214,6 +214,8 @@ uint16_t hidd_open(uint8_t rhport, tusb_desc_interface_t const * desc_itf, uint1
   //------------- Endpoint Descriptor -------------//
   p_desc = tu_desc_next(p_desc);
   TU_ASSERT(usbd_open_edpt_pair(rhport, p_desc, desc_itf->bNumEndpoints, TUSB_XFER_INTERRUPT, &p_hid->ep_out, &p_hid->ep_in), 0);
+  usbd_edpt_bind_instance(rhport, p_hid->ep_out, (uint8_t) (p_hid - _hidd_itf));
+  usbd_edpt_bind_instance(rhport, p_hid->ep_in , (uint8_t) (p_hid - _hidd_itf));
 
   if ( desc_itf->bInterfaceSubClass == HID_SUBCLASS_BOOT ) p_hid->itf_protocol = desc_itf->bInterfaceProtocol;
 
@@ -387,17 +389,12 @@ bool hidd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
 {
   (void) result;
 
-  uint8_t instance = 0;
-  hidd_interface_t * p_hid = _hidd_itf;
-
   // Identify which interface to use
-  for (instance = 0; instance < CFG_TUD_HID; instance++)
-  {
-    p_hid = &_hidd_itf[instance];
-    if ( (ep_addr == p_hid->ep_out) || (ep_addr == p_hid->ep_in) ) break;
-  }
+  uint8_t const instance = usbd_edpt_instance(rhport, ep_addr);
   TU_ASSERT(instance < CFG_TUD_HID);
 
+  hidd_interface_t * p_hid = &_hidd_itf[instance];
+
   // Sent report successfully
   if (ep_addr == p_hid->ep_in)
   {
@@ -93,7 +93,7 @@ bool tud_midi_n_mounted (uint8_t itf)
 static void _prep_out_transaction (midid_interface_t* p_midi)
 {
   uint8_t const rhport = 0;
-  uint16_t available = tu_fifo_remaining(&p_midi->rx_ff);
+  tu_fifo_idx_t available = tu_fifo_remaining(&p_midi->rx_ff);
 
   // Prepare for incoming data but only allow what we can store in the ring buffer.
   // TODO Actually we can still carry out the transfer, keeping count of received bytes
@@ -224,7 +224,7 @@ static uint32_t write_flush(midid_interface_t* midi)
   // skip if previous transfer not complete
   TU_VERIFY( usbd_edpt_claim(rhport, midi->ep_in), 0 );
 
-  uint16_t count = tu_fifo_read_n(&midi->tx_ff, midi->epin_buf, CFG_TUD_MIDI_EP_BUFSIZE);
+  uint16_t count = (uint16_t) tu_fifo_read_n(&midi->tx_ff, midi->epin_buf, CFG_TUD_MIDI_EP_BUFSIZE);
 
   if (count)
   {
@@ -341,7 +341,7 @@ uint32_t tud_midi_n_stream_write(uint8_t itf, uint8_t cable_num, uint8_t const*
       // zeroes unused bytes
       for(uint8_t idx = stream->total; idx < 4; idx++) stream->buffer[idx] = 0;
 
-      uint16_t const count = tu_fifo_write_n(&midi->tx_ff, stream->buffer, 4);
+      uint16_t const count = (uint16_t) tu_fifo_write_n(&midi->tx_ff, stream->buffer, 4);
 
       // complete current event packet, reset stream
       stream->index = stream->total = 0;
@@ -456,6 +456,7 @@ uint16_t midid_open(uint8_t rhport, tusb_desc_interface_t const * desc_itf, uint
     {
       TU_ASSERT(usbd_edpt_open(rhport, (tusb_desc_endpoint_t const *) p_desc), 0);
       uint8_t ep_addr = ((tusb_desc_endpoint_t const *) p_desc)->bEndpointAddress;
+      usbd_edpt_bind_instance(rhport, ep_addr, (uint8_t) (p_midi - _midid_itf));
 
       if (tu_edpt_dir(ep_addr) == TUSB_DIR_IN)
       {
@@ -497,19 +498,13 @@ bool midid_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
 bool midid_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
 {
   (void) result;
-  (void) rhport;
-
-  uint8_t itf;
-  midid_interface_t* p_midi;
 
   // Identify which interface to use
-  for (itf = 0; itf < CFG_TUD_MIDI; itf++)
-  {
-    p_midi = &_midid_itf[itf];
-    if ( ( ep_addr == p_midi->ep_out ) || ( ep_addr == p_midi->ep_in ) ) break;
-  }
+  uint8_t const itf = usbd_edpt_instance(rhport, ep_addr);
   TU_ASSERT(itf < CFG_TUD_MIDI);
 
+  midid_interface_t* p_midi = &_midid_itf[itf];
+
   // receive new data
   if ( ep_addr == p_midi->ep_out )
   {
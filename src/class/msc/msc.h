@@ -121,8 +121,17 @@ typedef enum
   SCSI_CMD_READ_FORMAT_CAPACITY         = 0x23, ///< The command allows the Host to request a list of the possible format capacities for an installed writable media. This command also has the capability to report the writable capacity for a media when it is installed
   SCSI_CMD_READ_10                      = 0x28, ///< The READ (10) command requests that the device server read the specified logical block(s) and transfer them to the data-in buffer.
   SCSI_CMD_WRITE_10                     = 0x2A, ///< The WRITE (10) command requests thatthe device server transfer the specified logical block(s) from the data-out buffer and write them.
+  SCSI_CMD_READ_16                      = 0x88, ///< The READ (16) command is the same as READ (10) but with 64-bit LBA and 32-bit transfer length.
+  SCSI_CMD_WRITE_16                     = 0x8A, ///< The WRITE (16) command is the same as WRITE (10) but with 64-bit LBA and 32-bit transfer length.
+  SCSI_CMD_SERVICE_ACTION_IN_16         = 0x9E, ///< Service Action In (16), READ CAPACITY (16) is one of its service action.
 }scsi_cmd_type_t;
 
+/// SCSI Service Action for \ref SCSI_CMD_SERVICE_ACTION_IN_16
+enum
+{
+  SCSI_SERVICE_ACTION_READ_CAPACITY_16 = 0x10
+};
+
 /// SCSI Sense Key
 typedef enum
 {
@@ -375,6 +384,46 @@ typedef struct TU_ATTR_PACKED
 TU_VERIFY_STATIC(sizeof(scsi_read10_t) == 10, "size is not correct");
 TU_VERIFY_STATIC(sizeof(scsi_write10_t) == 10, "size is not correct");
 
+/// SCSI Read Capacity 16 Command (Service Action In 16)
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  cmd_code       ; ///< SCSI OpCode for \ref SCSI_CMD_SERVICE_ACTION_IN_16
+  uint8_t  service_action ; ///< \ref SCSI_SERVICE_ACTION_READ_CAPACITY_16 (bit 4:0)
+  uint64_t lba            ; ///< Obsolete
+  uint32_t alloc_length   ; ///< Maximum number of bytes of response
+  uint8_t  reserved       ;
+  uint8_t  control        ;
+} scsi_read_capacity16_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_read_capacity16_t) == 16, "size is not correct");
+
+/// SCSI Read Capacity 16 Response Data
+typedef struct TU_ATTR_PACKED
+{
+  uint64_t last_lba          ; ///< The last Logical Block Address of the device
+  uint32_t block_size        ; ///< Block size in bytes
+  uint8_t  protection        ; ///< Protection type (not supported)
+  uint8_t  lb_per_pb_exponent; ///< Logical blocks per physical block exponent
+  uint16_t lowest_aligned_lba; ///< Lowest aligned logical block address
+  uint8_t  reserved[16]      ;
+} scsi_read_capacity16_resp_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_read_capacity16_resp_t) == 32, "size is not correct");
+
+/// SCSI Read 16 Command
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  cmd_code    ; ///< SCSI OpCode
+  uint8_t  flags       ;
+  uint64_t lba         ; ///< The first Logical Block Address (LBA) accessed by this command
+  uint32_t block_count ; ///< Number of Blocks used by this command
+  uint8_t  group       ;
+  uint8_t  control     ;
+} scsi_read16_t, scsi_write16_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_read16_t) == 16, "size is not correct");
+TU_VERIFY_STATIC(sizeof(scsi_write16_t) == 16, "size is not correct");
+
 #ifdef __cplusplus
  }
 #endif
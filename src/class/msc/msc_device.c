@@ -56,6 +56,7 @@ typedef struct
   CFG_TUSB_MEM_ALIGN msc_cbw_t cbw;
   CFG_TUSB_MEM_ALIGN msc_csw_t csw;
 
+  uint8_t  rhport;
   uint8_t  itf_num;
   uint8_t  ep_in;
   uint8_t  ep_out;
@@ -65,6 +66,19 @@ typedef struct
   uint32_t total_len;   // byte to be transferred, can be smaller than total_bytes in cbw
   uint32_t xferred_len; // numbered of bytes transferred so far in the Data Stage
 
+  // READ10/WRITE10 data buffers, used as a ring of CFG_TUD_MSC_EP_BUFNUM
+  uint32_t staged_len;  // READ10: bytes read from storage, WRITE10: bytes received from host
+  uint16_t buf_len[CFG_TUD_MSC_EP_BUFNUM];
+  uint16_t buf_offset;  // WRITE10: bytes of oldest buffer already written to storage
+  uint8_t  buf_head;    // oldest buffer: being sent (READ10) or to be written to storage (WRITE10)
+  uint8_t  buf_count;
+  bool     xfer_busy;   // READ10/WRITE10 bulk transfer is on-going
+  bool     rdwr_failed; // storage failed, complete with failed status once bulk transfer is done
+  bool     async_busy;  // waiting for application to call tud_msc_async_done()
+  bool     done_pending; // tud_msc_async_done() is called, result is not yet processed by usbd task
+  uint8_t  async_gen;    // changed when SCSI op is started or aborted, stale deferred result is ignored
+  int32_t  async_result;
+
   // Sense Response Data
   uint8_t sense_key;
   uint8_t add_sense_code;
@@ -72,7 +86,7 @@ typedef struct
 }mscd_interface_t;
 
 CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN static mscd_interface_t _mscd_itf;
-CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN static uint8_t _mscd_buf[CFG_TUD_MSC_EP_BUFSIZE];
+CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN static uint8_t _mscd_buf[CFG_TUD_MSC_EP_BUFNUM][CFG_TUD_MSC_EP_BUFSIZE];
 
 //--------------------------------------------------------------------+
 // INTERNAL OBJECT & FUNCTION DECLARATION
@@ -81,7 +95,11 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
 static void proc_read10_cmd(uint8_t rhport, mscd_interface_t* p_msc);
 
 static void proc_write10_cmd(uint8_t rhport, mscd_interface_t* p_msc);
+static void proc_write10_xfer(uint8_t rhport, mscd_interface_t* p_msc);
 static void proc_write10_new_data(uint8_t rhport, mscd_interface_t* p_msc, uint32_t xferred_bytes);
+static void proc_write10_commit(uint8_t rhport, mscd_interface_t* p_msc);
+static void proc_read10_result(mscd_interface_t* p_msc, int32_t nbytes);
+static bool proc_write10_result(mscd_interface_t* p_msc, int32_t nbytes);
 
 TU_ATTR_ALWAYS_INLINE static inline bool is_data_in(uint8_t dir)
 {
@@ -129,36 +147,115 @@ static void fail_scsi_op(uint8_t rhport, mscd_interface_t* p_msc, uint8_t status
   }
 }
 
-static inline uint32_t rdwr10_get_lba(uint8_t const command[])
+// Send status (CSW) once data stage is complete
+static bool proc_stage_status(uint8_t rhport, mscd_interface_t* p_msc)
 {
-  // use offsetof to avoid pointer to the odd/unaligned address
-  uint32_t const lba = tu_unaligned_read32(command + offsetof(scsi_write10_t, lba));
+  msc_cbw_t const * p_cbw = &p_msc->cbw;
+
+  // skip status if epin is currently stalled, will do it when received Clear Stall request
+  if ( !usbd_edpt_stalled(rhport,  p_msc->ep_in) )
+  {
+    if ( (p_cbw->total_bytes > p_msc->xferred_len) && is_data_in(p_cbw->dir) )
+    {
+      // 6.7 The 13 Cases: case 5 (Hi > Di): STALL before status
+      // TU_LOG(MSC_DEBUG, "  SCSI case 5 (Hi > Di): %lu > %lu\r\n", p_cbw->total_bytes, p_msc->xferred_len);
+      usbd_edpt_stall(rhport, p_msc->ep_in);
+    }else
+    {
+      TU_ASSERT( send_csw(rhport, p_msc) );
+    }
+  }
+
+  #if TU_CHECK_MCU(OPT_MCU_CXD56)
+  // WORKAROUND: cxd56 has its own nuttx usb stack which does not forward Set/ClearFeature(Endpoint) to DCD.
+  // There is no way for us to know when EP is un-stall, therefore we will unconditionally un-stall here and
+  // hope everything will work
+  if ( usbd_edpt_stalled(rhport, p_msc->ep_in) )
+  {
+    usbd_edpt_clear_stall(rhport, p_msc->ep_in);
+    send_csw(rhport, p_msc);
+  }
+  #endif
+
+  return true;
+}
+
+static inline void rdwr_reset_buf(mscd_interface_t* p_msc)
+{
+  p_msc->staged_len  = 0;
+  p_msc->buf_offset  = 0;
+  p_msc->buf_head    = 0;
+  p_msc->buf_count   = 0;
+  p_msc->xfer_busy   = false;
+  p_msc->rdwr_failed = false;
+  p_msc->async_busy  = false;
+
+  // result of previous op may be deferred already, it is dropped by proc_async_done() with new generation
+  p_msc->done_pending = false;
+  p_msc->async_gen++;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool is_read_cmd(uint8_t cmd_code)
+{
+  return (cmd_code == SCSI_CMD_READ_10) || (cmd_code == SCSI_CMD_READ_16);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool is_write_cmd(uint8_t cmd_code)
+{
+  return (cmd_code == SCSI_CMD_WRITE_10) || (cmd_code == SCSI_CMD_WRITE_16);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool is_rdwr16_cmd(uint8_t cmd_code)
+{
+  return (cmd_code == SCSI_CMD_READ_16) || (cmd_code == SCSI_CMD_WRITE_16);
+}
 
+static inline uint64_t rdwr_get_lba(uint8_t const command[])
+{
+  // use offsetof to avoid pointer to the odd/unaligned address
   // lba is in Big Endian
-  return tu_ntohl(lba);
+  if ( is_rdwr16_cmd(command[0]) )
+  {
+    uint8_t const* p_lba = command + offsetof(scsi_write16_t, lba);
+    uint32_t const lba_hi = tu_unaligned_read32(p_lba);
+    uint32_t const lba_lo = tu_unaligned_read32(p_lba + 4);
+
+    return (((uint64_t) tu_ntohl(lba_hi)) << 32) | tu_ntohl(lba_lo);
+  }else
+  {
+    uint32_t const lba = tu_unaligned_read32(command + offsetof(scsi_write10_t, lba));
+    return tu_ntohl(lba);
+  }
 }
 
-static inline uint16_t rdwr10_get_blockcount(msc_cbw_t const* cbw)
+static inline uint32_t rdwr_get_blockcount(msc_cbw_t const* cbw)
 {
-  uint16_t const block_count = tu_unaligned_read16(cbw->command + offsetof(scsi_write10_t, block_count));
-  return tu_ntohs(block_count);
+  if ( is_rdwr16_cmd(cbw->command[0]) )
+  {
+    uint32_t const block_count = tu_unaligned_read32(cbw->command + offsetof(scsi_write16_t, block_count));
+    return tu_ntohl(block_count);
+  }else
+  {
+    uint16_t const block_count = tu_unaligned_read16(cbw->command + offsetof(scsi_write10_t, block_count));
+    return tu_ntohs(block_count);
+  }
 }
 
-static inline uint16_t rdwr10_get_blocksize(msc_cbw_t const* cbw)
+static inline uint32_t rdwr_get_blocksize(msc_cbw_t const* cbw)
 {
   // first extract block count in the command
-  uint16_t const block_count = rdwr10_get_blockcount(cbw);
+  uint32_t const block_count = rdwr_get_blockcount(cbw);
 
   // invalid block count
   if (block_count == 0) return 0;
 
-  return (uint16_t) (cbw->total_bytes / block_count);
+  return cbw->total_bytes / block_count;
 }
 
-uint8_t rdwr10_validate_cmd(msc_cbw_t const* cbw)
+uint8_t rdwr_validate_cmd(msc_cbw_t const* cbw)
 {
   uint8_t status = MSC_CSW_STATUS_PASSED;
-  uint16_t const block_count = rdwr10_get_blockcount(cbw);
+  uint32_t const block_count = rdwr_get_blockcount(cbw);
 
   if ( cbw->total_bytes == 0 )
   {
@@ -172,12 +269,12 @@ uint8_t rdwr10_validate_cmd(msc_cbw_t const* cbw)
     }
   }else
   {
-    if ( SCSI_CMD_READ_10 == cbw->command[0] && !is_data_in(cbw->dir) )
+    if ( is_read_cmd(cbw->command[0]) && !is_data_in(cbw->dir) )
     {
       TU_LOG(MSC_DEBUG, "  SCSI case 10 (Ho <> Di)\r\n");
       status = MSC_CSW_STATUS_PHASE_ERROR;
     }
-    else if ( SCSI_CMD_WRITE_10 == cbw->command[0] && is_data_in(cbw->dir) )
+    else if ( is_write_cmd(cbw->command[0]) && is_data_in(cbw->dir) )
     {
       TU_LOG(MSC_DEBUG, "  SCSI case 8 (Hi <> Do)\r\n");
       status = MSC_CSW_STATUS_PHASE_ERROR;
@@ -192,11 +289,57 @@ uint8_t rdwr10_validate_cmd(msc_cbw_t const* cbw)
       TU_LOG(MSC_DEBUG, " Computed block size = 0. SCSI case 7 Hi < Di (READ10) or case 13 Ho < Do (WRIT10)\r\n");
       status = MSC_CSW_STATUS_PHASE_ERROR;
     }
+    else if ( is_rdwr16_cmd(cbw->command[0]) &&
+              !(is_read_cmd(cbw->command[0]) ? (bool) tud_msc_read16_cb : (bool) tud_msc_write16_cb) &&
+              (rdwr_get_lba(cbw->command) + block_count - 1 > UINT32_MAX) )
+    {
+      // application only has 32-bit lba callbacks
+      TU_LOG(MSC_DEBUG, "  SCSI LBA out of range\r\n");
+      tud_msc_set_sense(cbw->lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x21, 0x00);
+      status = MSC_CSW_STATUS_FAILED;
+    }
   }
 
   return status;
 }
 
+// Invoke 64-bit lba callback if implemented by application
+static inline int32_t invoke_read_cb(uint8_t lun, uint64_t lba, uint32_t offset, void* buffer, uint32_t bufsize)
+{
+  if ( tud_msc_read16_cb ) return tud_msc_read16_cb(lun, lba, offset, buffer, bufsize);
+
+  // lba is already verified to fit 32-bit
+  return tud_msc_read10_cb(lun, (uint32_t) lba, offset, buffer, bufsize);
+}
+
+static inline int32_t invoke_write_cb(uint8_t lun, uint64_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize)
+{
+  if ( tud_msc_write16_cb ) return tud_msc_write16_cb(lun, lba, offset, buffer, bufsize);
+
+  // lba is already verified to fit 32-bit
+  return tud_msc_write10_cb(lun, (uint32_t) lba, offset, buffer, bufsize);
+}
+
+// get disk capacity, return false if unit is not ready
+static bool get_capacity(uint8_t lun, uint64_t* block_count, uint32_t* block_size)
+{
+  if ( tud_msc_capacity16_cb )
+  {
+    tud_msc_capacity16_cb(lun, block_count, block_size);
+  }else
+  {
+    uint32_t block_count_u32 = 0;
+    uint16_t block_size_u16  = 0;
+
+    tud_msc_capacity_cb(lun, &block_count_u32, &block_size_u16);
+
+    *block_count = block_count_u32;
+    *block_size  = block_size_u16;
+  }
+
+  return (*block_count != 0) && (*block_size != 0);
+}
+
 //--------------------------------------------------------------------+
 // Debug
 //--------------------------------------------------------------------+
@@ -214,7 +357,10 @@ TU_ATTR_UNUSED static tu_lookup_entry_t const _msc_scsi_cmd_lookup[] =
   { .key = SCSI_CMD_REQUEST_SENSE                , .data = "Request Sense" },
   { .key = SCSI_CMD_READ_FORMAT_CAPACITY         , .data = "Read Format Capacity" },
   { .key = SCSI_CMD_READ_10                      , .data = "Read10" },
-  { .key = SCSI_CMD_WRITE_10                     , .data = "Write10" }
+  { .key = SCSI_CMD_WRITE_10                     , .data = "Write10" },
+  { .key = SCSI_CMD_READ_16                      , .data = "Read16" },
+  { .key = SCSI_CMD_WRITE_16                     , .data = "Write16" },
+  { .key = SCSI_CMD_SERVICE_ACTION_IN_16         , .data = "Service Action In16" }
 };
 
 TU_ATTR_UNUSED static tu_lookup_table_t const _msc_scsi_cmd_table =
@@ -245,6 +391,55 @@ static inline void set_sense_medium_not_present(uint8_t lun)
   tud_msc_set_sense(lun, SCSI_SENSE_NOT_READY, 0x3A, 0x00);
 }
 
+// Deferred from tud_msc_async_done() to run in usbd task context
+static void proc_async_done(void* param)
+{
+  mscd_interface_t* p_msc = &_mscd_itf;
+  msc_cbw_t const * p_cbw = &p_msc->cbw;
+
+  // SCSI op is aborted (and maybe a new one started) since tud_msc_async_done() was called
+  if ( (uint8_t) (uintptr_t) param != p_msc->async_gen ) return;
+
+  p_msc->done_pending = false;
+
+  // SCSI op could be aborted by bot reset or bus reset meanwhile
+  if ( !p_msc->async_busy || (p_msc->stage != MSC_STAGE_DATA) ) return;
+
+  p_msc->async_busy = false;
+
+  if ( is_read_cmd(p_cbw->command[0]) )
+  {
+    proc_read10_result(p_msc, p_msc->async_result);
+    proc_read10_cmd(p_msc->rhport, p_msc);
+  }
+  else if ( is_write_cmd(p_cbw->command[0]) )
+  {
+    proc_write10_result(p_msc, p_msc->async_result);
+    proc_write10_commit(p_msc->rhport, p_msc);
+  }
+
+  // mscd_xfer_cb() is not invoked for this, status must be sent here
+  if ( p_msc->stage == MSC_STAGE_STATUS )
+  {
+    TU_ASSERT( proc_stage_status(p_msc->rhport, p_msc), );
+  }
+}
+
+bool tud_msc_async_done(uint8_t lun, int32_t nbytes, bool in_isr)
+{
+  mscd_interface_t* p_msc = &_mscd_itf;
+  TU_VERIFY(p_msc->async_busy && (lun == p_msc->cbw.lun));
+
+  // only one completion per TUD_MSC_RET_ASYNC, result would be overwritten otherwise
+  TU_VERIFY(!p_msc->done_pending);
+  p_msc->done_pending = true;
+
+  p_msc->async_result = nbytes;
+  usbd_defer_func(proc_async_done, (void*) (uintptr_t) p_msc->async_gen, in_isr);
+
+  return true;
+}
+
 //--------------------------------------------------------------------+
 // USBD Driver API
 //--------------------------------------------------------------------+
@@ -256,7 +451,11 @@ void mscd_init(void)
 void mscd_reset(uint8_t rhport)
 {
   (void) rhport;
+
+  // generation is kept since proc_async_done() of aborted op may still be deferred
+  uint8_t const async_gen = _mscd_itf.async_gen;
   tu_memclr(&_mscd_itf, sizeof(mscd_interface_t));
+  _mscd_itf.async_gen = (uint8_t) (async_gen + 1);
 }
 
 uint16_t mscd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len)
@@ -273,6 +472,7 @@ uint16_t mscd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint1
   TU_ASSERT(max_len >= drv_len, 0);
 
   mscd_interface_t * p_msc = &_mscd_itf;
+  p_msc->rhport  = rhport;
   p_msc->itf_num = itf_desc->bInterfaceNumber;
 
   // Open endpoint pair
@@ -289,6 +489,7 @@ static void proc_bot_reset(mscd_interface_t* p_msc)
   p_msc->stage       = MSC_STAGE_CMD;
   p_msc->total_len   = 0;
   p_msc->xferred_len = 0;
+  rdwr_reset_buf(p_msc);
 
   p_msc->sense_key           = 0;
   p_msc->add_sense_code      = 0;
@@ -424,18 +625,19 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
       p_msc->stage = MSC_STAGE_DATA;
       p_msc->total_len = p_cbw->total_bytes;
       p_msc->xferred_len = 0;
+      rdwr_reset_buf(p_msc);
 
-      // Read10 or Write10
-      if ( (SCSI_CMD_READ_10 == p_cbw->command[0]) || (SCSI_CMD_WRITE_10 == p_cbw->command[0]) )
+      // Read10/16 or Write10/16
+      if ( is_read_cmd(p_cbw->command[0]) || is_write_cmd(p_cbw->command[0]) )
       {
-        uint8_t const status = rdwr10_validate_cmd(p_cbw);
+        uint8_t const status = rdwr_validate_cmd(p_cbw);
 
         if ( status != MSC_CSW_STATUS_PASSED)
         {
           fail_scsi_op(rhport, p_msc, status);
         }else if ( p_cbw->total_bytes )
         {
-          if (SCSI_CMD_READ_10 == p_cbw->command[0])
+          if ( is_read_cmd(p_cbw->command[0]) )
           {
             proc_read10_cmd(rhport, p_msc);
           }else
@@ -455,7 +657,7 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
         // 2. IN & Zero: Process if is built-in, else Invoke app callback. Skip DATA if zero length
         if ( (p_cbw->total_bytes > 0 ) && !is_data_in(p_cbw->dir) )
         {
-          if (p_cbw->total_bytes > sizeof(_mscd_buf))
+          if (p_cbw->total_bytes > CFG_TUD_MSC_EP_BUFSIZE)
           {
             TU_LOG(MSC_DEBUG, "  SCSI reject non READ10/WRITE10 with large data\r\n");
             fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
@@ -463,17 +665,17 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
           {
             // Didn't check for case 9 (Ho > Dn), which requires examining scsi command first
             // but it is OK to just receive data then responded with failed status
-            TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_out, _mscd_buf, (uint16_t) p_msc->total_len) );
+            TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_out, _mscd_buf[0], (uint16_t) p_msc->total_len) );
           }
         }else
         {
           // First process if it is a built-in commands
-          int32_t resplen = proc_builtin_scsi(p_cbw->lun, p_cbw->command, _mscd_buf, sizeof(_mscd_buf));
+          int32_t resplen = proc_builtin_scsi(p_cbw->lun, p_cbw->command, _mscd_buf[0], CFG_TUD_MSC_EP_BUFSIZE);
 
           // Invoke user callback if not built-in
           if ( (resplen < 0) && (p_msc->sense_key == 0) )
           {
-            resplen = tud_msc_scsi_cb(p_cbw->lun, p_cbw->command, _mscd_buf, (uint16_t) p_msc->total_len);
+            resplen = tud_msc_scsi_cb(p_cbw->lun, p_cbw->command, _mscd_buf[0], (uint16_t) p_msc->total_len);
           }
 
           if ( resplen < 0 )
@@ -506,7 +708,7 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
             {
               // cannot return more than host expect
               p_msc->total_len = tu_min32((uint32_t) resplen, p_cbw->total_bytes);
-              TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_in, _mscd_buf, (uint16_t) p_msc->total_len) );
+              TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_in, _mscd_buf[0], (uint16_t) p_msc->total_len) );
             }
           }
         }
@@ -517,9 +719,17 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
       TU_LOG(MSC_DEBUG, "  SCSI Data [Lun%u]\r\n", p_cbw->lun);
       //TU_LOG_MEM(MSC_DEBUG, _mscd_buf, xferred_bytes, 2);
 
-      if (SCSI_CMD_READ_10 == p_cbw->command[0])
+      if ( is_read_cmd(p_cbw->command[0]) )
       {
-        p_msc->xferred_len += xferred_bytes;
+        // xfer_busy is not set if this is a simulated transfer complete to retry storage read
+        if ( p_msc->xfer_busy )
+        {
+          p_msc->xfer_busy = false;
+          p_msc->xferred_len += xferred_bytes;
+
+          p_msc->buf_head = (uint8_t) ((p_msc->buf_head + 1) % CFG_TUD_MSC_EP_BUFNUM);
+          p_msc->buf_count--;
+        }
 
         if ( p_msc->xferred_len >= p_msc->total_len )
         {
@@ -530,7 +740,7 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
           proc_read10_cmd(rhport, p_msc);
         }
       }
-      else if (SCSI_CMD_WRITE_10 == p_cbw->command[0])
+      else if ( is_write_cmd(p_cbw->command[0]) )
       {
         proc_write10_new_data(rhport, p_msc, xferred_bytes);
       }
@@ -541,7 +751,7 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
         // OUT transfer, invoke callback if needed
         if ( !is_data_in(p_cbw->dir) )
         {
-          int32_t cb_result = tud_msc_scsi_cb(p_cbw->lun, p_cbw->command, _mscd_buf, (uint16_t) p_msc->total_len);
+          int32_t cb_result = tud_msc_scsi_cb(p_cbw->lun, p_cbw->command, _mscd_buf[0], (uint16_t) p_msc->total_len);
 
           if ( cb_result < 0 )
           {
@@ -584,10 +794,12 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
         switch(p_cbw->command[0])
         {
           case SCSI_CMD_READ_10:
+          case SCSI_CMD_READ_16:
             if ( tud_msc_read10_complete_cb ) tud_msc_read10_complete_cb(p_cbw->lun);
           break;
 
           case SCSI_CMD_WRITE_10:
+          case SCSI_CMD_WRITE_16:
             if ( tud_msc_write10_complete_cb ) tud_msc_write10_complete_cb(p_cbw->lun);
           break;
 
@@ -609,30 +821,7 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
 
   if ( p_msc->stage == MSC_STAGE_STATUS )
   {
-    // skip status if epin is currently stalled, will do it when received Clear Stall request
-    if ( !usbd_edpt_stalled(rhport,  p_msc->ep_in) )
-    {
-      if ( (p_cbw->total_bytes > p_msc->xferred_len) && is_data_in(p_cbw->dir) )
-      {
-        // 6.7 The 13 Cases: case 5 (Hi > Di): STALL before status
-        // TU_LOG(MSC_DEBUG, "  SCSI case 5 (Hi > Di): %lu > %lu\r\n", p_cbw->total_bytes, p_msc->xferred_len);
-        usbd_edpt_stall(rhport, p_msc->ep_in);
-      }else
-      {
-        TU_ASSERT( send_csw(rhport, p_msc) );
-      }
-    }
-
-    #if TU_CHECK_MCU(OPT_MCU_CXD56)
-    // WORKAROUND: cxd56 has its own nuttx usb stack which does not forward Set/ClearFeature(Endpoint) to DCD.
-    // There is no way for us to know when EP is un-stall, therefore we will unconditionally un-stall here and
-    // hope everything will work
-    if ( usbd_edpt_stalled(rhport, p_msc->ep_in) )
-    {
-      usbd_edpt_clear_stall(rhport, p_msc->ep_in);
-      send_csw(rhport, p_msc);
-    }
-    #endif
+    TU_ASSERT( proc_stage_status(rhport, p_msc) );
   }
 
   return true;
@@ -684,16 +873,12 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
 
     case SCSI_CMD_READ_CAPACITY_10:
     {
-      uint32_t block_count;
+      uint64_t block_count;
       uint32_t block_size;
-      uint16_t block_size_u16;
-
-      tud_msc_capacity_cb(lun, &block_count, &block_size_u16);
-      block_size = (uint32_t) block_size_u16;
 
       // Invalid block size/count from callback, possibly unit is not ready
       // stall this request, set sense key to NOT READY
-      if (block_count == 0 || block_size == 0)
+      if ( !get_capacity(lun, &block_count, &block_size) )
       {
         resplen = -1;
 
@@ -703,7 +888,8 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
       {
         scsi_read_capacity10_resp_t read_capa10;
 
-        read_capa10.last_lba   = tu_htonl(block_count-1);
+        // last lba is capped at 0xFFFFFFFF, which tells host to use READ CAPACITY16
+        read_capa10.last_lba   = tu_htonl((uint32_t) tu_min64(block_count-1, UINT32_MAX));
         read_capa10.block_size = tu_htonl(block_size);
 
         resplen = sizeof(read_capa10);
@@ -712,6 +898,44 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
     }
     break;
 
+    case SCSI_CMD_SERVICE_ACTION_IN_16:
+    {
+      uint64_t block_count;
+      uint32_t block_size;
+
+      if ( (scsi_cmd[1] & 0x1f) != SCSI_SERVICE_ACTION_READ_CAPACITY_16 )
+      {
+        // other service actions are handled by application
+        resplen = -1;
+      }
+      else if ( !get_capacity(lun, &block_count, &block_size) )
+      {
+        resplen = -1;
+
+        // set default sense if not set by callback
+        if ( p_msc->sense_key == 0 ) set_sense_medium_not_present(lun);
+      }else
+      {
+        scsi_read_capacity16_resp_t read_capa16;
+        tu_memclr(&read_capa16, sizeof(read_capa16));
+
+        // 64-bit Big Endian
+        uint64_t const last_lba = block_count - 1;
+        uint8_t* p_last_lba = (uint8_t*) &read_capa16 + offsetof(scsi_read_capacity16_resp_t, last_lba);
+        tu_unaligned_write32(p_last_lba    , tu_htonl((uint32_t) (last_lba >> 32)));
+        tu_unaligned_write32(p_last_lba + 4, tu_htonl((uint32_t) last_lba));
+
+        read_capa16.block_size = tu_htonl(block_size);
+
+        // response is limited by allocation length
+        uint32_t const alloc_len = tu_ntohl(tu_unaligned_read32(scsi_cmd + offsetof(scsi_read_capacity16_t, alloc_length)));
+
+        resplen = (int32_t) tu_min32(sizeof(read_capa16), alloc_len);
+        memcpy(buffer, &read_capa16, (size_t) resplen);
+      }
+    }
+    break;
+
     case SCSI_CMD_READ_FORMAT_CAPACITY:
     {
       scsi_read_format_capacity_data_t read_fmt_capa =
@@ -722,14 +946,12 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
           .block_size_u16  = 0
       };
 
-      uint32_t block_count;
-      uint16_t block_size;
-
-      tud_msc_capacity_cb(lun, &block_count, &block_size);
+      uint64_t block_count;
+      uint32_t block_size;
 
       // Invalid block size/count from callback, possibly unit is not ready
       // stall this request, set sense key to NOT READY
-      if (block_count == 0 || block_size == 0)
+      if ( !get_capacity(lun, &block_count, &block_size) )
       {
         resplen = -1;
 
@@ -737,8 +959,8 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
         if ( p_msc->sense_key == 0 ) set_sense_medium_not_present(lun);
       }else
       {
-        read_fmt_capa.block_num = tu_htonl(block_count);
-        read_fmt_capa.block_size_u16 = tu_htons(block_size);
+        read_fmt_capa.block_num = tu_htonl((uint32_t) tu_min64(block_count, UINT32_MAX));
+        read_fmt_capa.block_size_u16 = tu_htons((uint16_t) block_size);
 
         resplen = sizeof(read_fmt_capa);
         memcpy(buffer, &read_fmt_capa, (size_t) resplen);
@@ -825,41 +1047,89 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
   return resplen;
 }
 
+// Read storage into free buffers while the oldest filled one is being sent
 static void proc_read10_cmd(uint8_t rhport, mscd_interface_t* p_msc)
 {
   msc_cbw_t const * p_cbw = &p_msc->cbw;
 
   // block size already verified not zero
-  uint16_t const block_sz = rdwr10_get_blocksize(p_cbw);
+  uint32_t const block_sz = rdwr_get_blocksize(p_cbw);
 
-  // Adjust lba with transferred bytes
-  uint32_t const lba = rdwr10_get_lba(p_cbw->command) + (p_msc->xferred_len / block_sz);
+  while(1)
+  {
+    // keep IN endpoint busy with the oldest filled buffer
+    if ( !p_msc->xfer_busy && p_msc->buf_count && !p_msc->rdwr_failed )
+    {
+      p_msc->xfer_busy = true;
+      TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_in, _mscd_buf[p_msc->buf_head], p_msc->buf_len[p_msc->buf_head]), );
+    }
 
-  // remaining bytes capped at class buffer
-  int32_t nbytes = (int32_t) tu_min32(sizeof(_mscd_buf), p_cbw->total_bytes-p_msc->xferred_len);
+    if ( p_msc->rdwr_failed || p_msc->async_busy || (p_msc->buf_count == CFG_TUD_MSC_EP_BUFNUM) ||
+         (p_msc->staged_len >= p_msc->total_len) )
+    {
+      break;
+    }
+
+    uint8_t const idx = (uint8_t) ((p_msc->buf_head + p_msc->buf_count) % CFG_TUD_MSC_EP_BUFNUM);
+
+    // Adjust lba with bytes already read
+    uint64_t const lba = rdwr_get_lba(p_cbw->command) + (p_msc->staged_len / block_sz);
+
+    // remaining bytes capped at class buffer
+    int32_t nbytes = (int32_t) tu_min32(CFG_TUD_MSC_EP_BUFSIZE, p_msc->total_len - p_msc->staged_len);
 
-  // Application can consume smaller bytes
-  uint32_t const offset = p_msc->xferred_len % block_sz;
-  nbytes = tud_msc_read10_cb(p_cbw->lun, lba, offset, _mscd_buf, (uint32_t) nbytes);
+    // Application can consume smaller bytes
+    uint32_t const offset = p_msc->staged_len % block_sz;
 
+    // set before invoking callback since tud_msc_async_done() can be called before it returns
+    p_msc->async_busy = true;
+    nbytes = invoke_read_cb(p_cbw->lun, lba, offset, _mscd_buf[idx], (uint32_t) nbytes);
+
+    // application will call tud_msc_async_done() when data is ready
+    if ( nbytes == TUD_MSC_RET_ASYNC ) break;
+
+    p_msc->async_busy = false;
+
+    // zero means not ready, try again when on-going transfer complete
+    if ( nbytes == 0 ) break;
+
+    proc_read10_result(p_msc, nbytes);
+  }
+
+  // nothing on the bus: either failed or application is not ready
+  if ( !p_msc->xfer_busy && !p_msc->async_busy )
+  {
+    if ( p_msc->rdwr_failed )
+    {
+      fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
+    }else
+    {
+      // simulate an transfer complete so that this driver callback will fired again
+      dcd_event_xfer_complete(rhport, p_msc->ep_in, 0, XFER_RESULT_SUCCESS, false);
+    }
+  }
+}
+
+// Update buffer ring with bytes read by application into the next free buffer
+static void proc_read10_result(mscd_interface_t* p_msc, int32_t nbytes)
+{
   if ( nbytes < 0 )
   {
     // negative means error -> endpoint is stalled & status in CSW set to failed
     TU_LOG(MSC_DEBUG, "  tud_msc_read10_cb() return -1\r\n");
 
     // set sense
-    set_sense_medium_not_present(p_cbw->lun);
+    set_sense_medium_not_present(p_msc->cbw.lun);
 
-    fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
+    p_msc->rdwr_failed = true;
   }
-  else if ( nbytes == 0 )
+  else if ( nbytes > 0 )
   {
-    // zero means not ready -> simulate an transfer complete so that this driver callback will fired again
-    dcd_event_xfer_complete(rhport, p_msc->ep_in, 0, XFER_RESULT_SUCCESS, false);
-  }
-  else
-  {
-    TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_in, _mscd_buf, (uint16_t) nbytes), );
+    uint8_t const idx = (uint8_t) ((p_msc->buf_head + p_msc->buf_count) % CFG_TUD_MSC_EP_BUFNUM);
+
+    p_msc->buf_len[idx] = (uint16_t) nbytes;
+    p_msc->staged_len += (uint32_t) nbytes;
+    p_msc->buf_count++;
   }
 }
 
@@ -882,71 +1152,136 @@ static void proc_write10_cmd(uint8_t rhport, mscd_interface_t* p_msc)
     return;
   }
 
+  // Write10 callback will be called later when usb transfer complete
+  proc_write10_xfer(rhport, p_msc);
+}
+
+// receive more data from host if there is free buffer
+static void proc_write10_xfer(uint8_t rhport, mscd_interface_t* p_msc)
+{
+  if ( p_msc->xfer_busy || p_msc->rdwr_failed || (p_msc->buf_count == CFG_TUD_MSC_EP_BUFNUM) ||
+       (p_msc->staged_len >= p_msc->total_len) )
+  {
+    return;
+  }
+
+  uint8_t const idx = (uint8_t) ((p_msc->buf_head + p_msc->buf_count) % CFG_TUD_MSC_EP_BUFNUM);
+
   // remaining bytes capped at class buffer
-  uint16_t nbytes = (uint16_t) tu_min32(sizeof(_mscd_buf), p_cbw->total_bytes-p_msc->xferred_len);
+  uint16_t nbytes = (uint16_t) tu_min32(CFG_TUD_MSC_EP_BUFSIZE, p_msc->total_len - p_msc->staged_len);
 
-  // Write10 callback will be called later when usb transfer complete
-  TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_out, _mscd_buf, nbytes), );
+  p_msc->xfer_busy = true;
+  TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_out, _mscd_buf[idx], nbytes), );
 }
 
 // process new data arrived from WRITE10
 static void proc_write10_new_data(uint8_t rhport, mscd_interface_t* p_msc, uint32_t xferred_bytes)
+{
+  // xfer_busy is not set if this is a simulated transfer complete to retry storage write
+  if ( p_msc->xfer_busy )
+  {
+    uint8_t const idx = (uint8_t) ((p_msc->buf_head + p_msc->buf_count) % CFG_TUD_MSC_EP_BUFNUM);
+
+    p_msc->xfer_busy = false;
+    p_msc->buf_len[idx] = (uint16_t) xferred_bytes;
+    p_msc->staged_len += xferred_bytes;
+    p_msc->buf_count++;
+  }
+
+  // host can send next chunk while we are writing this one to storage
+  proc_write10_xfer(rhport, p_msc);
+
+  proc_write10_commit(rhport, p_msc);
+}
+
+// Write received buffers to storage, then complete data stage when all is done
+static void proc_write10_commit(uint8_t rhport, mscd_interface_t* p_msc)
 {
   msc_cbw_t const * p_cbw = &p_msc->cbw;
 
   // block size already verified not zero
-  uint16_t const block_sz = rdwr10_get_blocksize(p_cbw);
+  uint32_t const block_sz = rdwr_get_blocksize(p_cbw);
+
+  while ( p_msc->buf_count && !p_msc->rdwr_failed && !p_msc->async_busy )
+  {
+    uint8_t* buf = _mscd_buf[p_msc->buf_head] + p_msc->buf_offset;
+    uint32_t const buf_remain = p_msc->buf_len[p_msc->buf_head] - p_msc->buf_offset;
 
-  // Adjust lba with transferred bytes
-  uint32_t const lba = rdwr10_get_lba(p_cbw->command) + (p_msc->xferred_len / block_sz);
+    // Adjust lba with bytes already written
+    uint64_t const lba = rdwr_get_lba(p_cbw->command) + (p_msc->xferred_len / block_sz);
 
-  // Invoke callback to consume new data
-  uint32_t const offset = p_msc->xferred_len % block_sz;
-  int32_t nbytes = tud_msc_write10_cb(p_cbw->lun, lba, offset, _mscd_buf, xferred_bytes);
+    // Invoke callback to consume new data
+    uint32_t const offset = p_msc->xferred_len % block_sz;
+    // set before invoking callback since tud_msc_async_done() can be called before it returns
+    p_msc->async_busy = true;
+    int32_t nbytes = invoke_write_cb(p_cbw->lun, lba, offset, buf, buf_remain);
 
+    // application will call tud_msc_async_done() when data is written
+    if ( nbytes == TUD_MSC_RET_ASYNC ) break;
+
+    p_msc->async_busy = false;
+
+    // Application consume less than what we got (including zero) -> try again later
+    if ( !proc_write10_result(p_msc, nbytes) ) break;
+
+    // prepare to receive more data from host
+    proc_write10_xfer(rhport, p_msc);
+  }
+
+  // wait for on-going transfer or application before completing the data stage
+  if ( p_msc->xfer_busy || p_msc->async_busy ) return;
+
+  if ( p_msc->rdwr_failed )
+  {
+    // all received bytes are counted as transferred
+    p_msc->xferred_len = p_msc->staged_len;
+    fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
+  }
+  else if ( p_msc->xferred_len >= p_msc->total_len )
+  {
+    // Data Stage is complete
+    p_msc->stage = MSC_STAGE_STATUS;
+  }
+  else
+  {
+    // simulate an transfer complete so that this driver callback will be invoked again
+    dcd_event_xfer_complete(rhport, p_msc->ep_out, 0, XFER_RESULT_SUCCESS, false);
+  }
+}
+
+// Update buffer ring with bytes written by application, return true if the oldest buffer is fully consumed
+static bool proc_write10_result(mscd_interface_t* p_msc, int32_t nbytes)
+{
   if ( nbytes < 0 )
   {
     // negative means error -> failed this scsi op
     TU_LOG(MSC_DEBUG, "  tud_msc_write10_cb() return -1\r\n");
 
-    // update actual byte before failed
-    p_msc->xferred_len += xferred_bytes;
-
     // Set sense
-    set_sense_medium_not_present(p_cbw->lun);
+    set_sense_medium_not_present(p_msc->cbw.lun);
 
-    fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
-  }else
-  {
-    // Application consume less than what we got (including zero)
-    if ( (uint32_t) nbytes < xferred_bytes )
-    {
-      uint32_t const left_over = xferred_bytes - (uint32_t) nbytes;
-      if ( nbytes > 0 )
-      {
-        p_msc->xferred_len += (uint16_t) nbytes;
-        memmove(_mscd_buf, _mscd_buf+nbytes, left_over);
-      }
+    p_msc->rdwr_failed = true;
+    return false;
+  }
 
-      // simulate an transfer complete with adjusted parameters --> callback will be invoked with adjusted parameter
-      dcd_event_xfer_complete(rhport, p_msc->ep_out, left_over, XFER_RESULT_SUCCESS, false);
-    }
-    else
-    {
-      // Application consume all bytes in our buffer
-      p_msc->xferred_len += xferred_bytes;
+  uint16_t const buf_remain = (uint16_t) (p_msc->buf_len[p_msc->buf_head] - p_msc->buf_offset);
 
-      if ( p_msc->xferred_len >= p_msc->total_len )
-      {
-        // Data Stage is complete
-        p_msc->stage = MSC_STAGE_STATUS;
-      }else
-      {
-        // prepare to receive more data from host
-        proc_write10_cmd(rhport, p_msc);
-      }
-    }
+  // application should not consume more than what was given
+  if ( (uint32_t) nbytes > buf_remain ) nbytes = buf_remain;
+
+  p_msc->xferred_len += (uint32_t) nbytes;
+
+  if ( nbytes < buf_remain )
+  {
+    p_msc->buf_offset = (uint16_t) (p_msc->buf_offset + nbytes);
+    return false;
   }
+
+  p_msc->buf_offset = 0;
+  p_msc->buf_head   = (uint8_t) ((p_msc->buf_head + 1) % CFG_TUD_MSC_EP_BUFNUM);
+  p_msc->buf_count--;
+
+  return true;
 }
 
 #endif
@@ -50,6 +50,19 @@
 
 TU_VERIFY_STATIC(CFG_TUD_MSC_EP_BUFSIZE < UINT16_MAX, "Size is not correct");
 
+// Number of CFG_TUD_MSC_EP_BUFSIZE buffers used for READ10/WRITE10 data stage.
+// With 2 or more, next chunk is read from (or written to) storage while the previous one is on the bus.
+// Each buffer should be a multiple of the MCU's DMA alignment since they are laid out back to back.
+#ifndef CFG_TUD_MSC_EP_BUFNUM
+  #define CFG_TUD_MSC_EP_BUFNUM   1
+#endif
+
+TU_VERIFY_STATIC(CFG_TUD_MSC_EP_BUFNUM >= 1 && CFG_TUD_MSC_EP_BUFNUM < 256, "Buffer number is not correct");
+
+// Returned by tud_msc_read10_cb()/tud_msc_write10_cb() when storage operation is started and will be
+// completed later on with tud_msc_async_done(). No retry is scheduled meanwhile.
+#define TUD_MSC_RET_ASYNC   (-16)
+
 //--------------------------------------------------------------------+
 // Application API
 //--------------------------------------------------------------------+
@@ -57,6 +70,11 @@ TU_VERIFY_STATIC(CFG_TUD_MSC_EP_BUFSIZE < UINT16_MAX, "Size is not correct");
 // Set SCSI sense response
 bool tud_msc_set_sense(uint8_t lun, uint8_t sense_key, uint8_t add_sense_code, uint8_t add_sense_qualifier);
 
+// Complete a READ10/WRITE10 callback that returned TUD_MSC_RET_ASYNC, can be called from ISR (e.g DMA complete).
+// nbytes has the same meaning as the return value of the callback: number of bytes read/written, 0 if not
+// ready (callback is invoked again) or negative for error.
+bool tud_msc_async_done(uint8_t lun, int32_t nbytes, bool in_isr);
+
 //--------------------------------------------------------------------+
 // Application Callbacks (WEAK is optional)
 //--------------------------------------------------------------------+
@@ -73,6 +91,11 @@ bool tud_msc_set_sense(uint8_t lun, uint8_t sense_key, uint8_t add_sense_code, u
 //
 //   - read < 0       : Indicate application error e.g invalid address. This request will be STALLed
 //                      and return failed status in command status wrapper phase.
+//
+//   - TUD_MSC_RET_ASYNC : Read is started (e.g DMA) and buffer is filled later on, application must call
+//                      tud_msc_async_done() with number of read bytes when complete.
+//
+// - If CFG_TUD_MSC_EP_BUFNUM > 1, callback is invoked for the next chunk while previous one is still being sent.
 int32_t tud_msc_read10_cb (uint8_t lun, uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize);
 
 // Invoked when received SCSI WRITE10 command
@@ -88,6 +111,11 @@ int32_t tud_msc_read10_cb (uint8_t lun, uint32_t lba, uint32_t offset, void* buf
 //   - write < 0       : Indicate application error e.g invalid address. This request will be STALLed
 //                       and return failed status in command status wrapper phase.
 //
+//   - TUD_MSC_RET_ASYNC : Write is started (e.g DMA), buffer must be kept intact until application calls
+//                       tud_msc_async_done() with number of written bytes.
+//
+// - If CFG_TUD_MSC_EP_BUFNUM > 1, host is already sending the next chunk while this callback is invoked.
+//
 // TODO change buffer to const uint8_t*
 int32_t tud_msc_write10_cb (uint8_t lun, uint32_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize);
 
@@ -105,8 +133,9 @@ void tud_msc_capacity_cb(uint8_t lun, uint32_t* block_count, uint16_t* block_siz
 
 /**
  * Invoked when received an SCSI command not in built-in list below.
- * - READ_CAPACITY10, READ_FORMAT_CAPACITY, INQUIRY, TEST_UNIT_READY, START_STOP_UNIT, MODE_SENSE6, REQUEST_SENSE
- * - READ10 and WRITE10 has their own callbacks
+ * - READ_CAPACITY10, READ_CAPACITY16, READ_FORMAT_CAPACITY, INQUIRY, TEST_UNIT_READY, START_STOP_UNIT, MODE_SENSE6,
+ *   REQUEST_SENSE
+ * - READ10/READ16 and WRITE10/WRITE16 has their own callbacks
  *
  * \param[in]   lun         Logical unit number
  * \param[in]   scsi_cmd    SCSI command contents which application must examine to response accordingly
@@ -134,16 +163,30 @@ TU_ATTR_WEAK bool tud_msc_start_stop_cb(uint8_t lun, uint8_t power_condition, bo
 // Invoked when received REQUEST_SENSE
 TU_ATTR_WEAK int32_t tud_msc_request_sense_cb(uint8_t lun, void* buffer, uint16_t bufsize);
 
-// Invoked when Read10 command is complete
+// Invoked when received SCSI READ10 or READ16 command, same as tud_msc_read10_cb() but with 64-bit lba.
+// If implemented, it is used instead of tud_msc_read10_cb() for both commands. Otherwise READ16 is only
+// accepted when all of its blocks are addressable with 32-bit lba.
+TU_ATTR_WEAK int32_t tud_msc_read16_cb(uint8_t lun, uint64_t lba, uint32_t offset, void* buffer, uint32_t bufsize);
+
+// Invoked when received SCSI WRITE10 or WRITE16 command, same as tud_msc_write10_cb() but with 64-bit lba.
+// If implemented, it is used instead of tud_msc_write10_cb() for both commands. Otherwise WRITE16 is only
+// accepted when all of its blocks are addressable with 32-bit lba.
+TU_ATTR_WEAK int32_t tud_msc_write16_cb(uint8_t lun, uint64_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize);
+
+// Invoked when received SCSI_CMD_READ_CAPACITY_10, SCSI_CMD_READ_CAPACITY_16 and SCSI_CMD_READ_FORMAT_CAPACITY,
+// used instead of tud_msc_capacity_cb() for disk with more than 2^32 blocks or block size larger than 64KB
+TU_ATTR_WEAK void tud_msc_capacity16_cb(uint8_t lun, uint64_t* block_count, uint32_t* block_size);
+
+// Invoked when Read10 (or Read16) command is complete
 TU_ATTR_WEAK void tud_msc_read10_complete_cb(uint8_t lun);
 
-// Invoke when Write10 command is complete, can be used to flush flash caching
+// Invoke when Write10 (or Write16) command is complete, can be used to flush flash caching
 TU_ATTR_WEAK void tud_msc_write10_complete_cb(uint8_t lun);
 
 // Invoked when command in tud_msc_scsi_cb is complete
 TU_ATTR_WEAK void tud_msc_scsi_complete_cb(uint8_t lun, uint8_t const scsi_cmd[16]);
 
-// Invoked to check if device is writable as part of SCSI WRITE10
+// Invoked to check if device is writable as part of SCSI WRITE10/WRITE16
 TU_ATTR_WEAK bool tud_msc_is_writable_cb(uint8_t lun);
 
 //--------------------------------------------------------------------+
@@ -33,6 +33,7 @@
 #include "device/usbd_pvt.h"
 
 #include "net_device.h"
+#include "net_xmit.h"
 #include "rndis_protocol.h"
 
 void rndis_class_set_handler(uint8_t *data, int size); /* found in ./misc/networking/rndis_reports.c */
@@ -56,6 +57,8 @@ typedef struct
   // keep a copy of endpoint attribute instead
   uint8_t const * ecm_desc_epdata;
 
+  netd_xmit_t xmit; // packet sent by tud_network_xmit_frags()
+
 } netd_interface_t;
 
 #define CFG_TUD_NET_PACKET_PREFIX_LEN sizeof(rndis_data_packet_t)
@@ -138,6 +141,12 @@ void netd_reset(uint8_t rhport)
 {
   (void) rhport;
 
+  // let application release fragments of the aborted packet
+  if ( _netd_itf.xmit.count && tud_network_xmit_done_cb )
+  {
+    tud_network_xmit_done_cb(_netd_itf.xmit.ref);
+  }
+
   netd_init();
 }
 
@@ -378,7 +387,6 @@ static void handle_incoming_packet(uint32_t len)
 
 bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
 {
-  (void) rhport;
   (void) result;
 
   /* new packet received */
@@ -392,7 +400,12 @@ bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
   {
     /* TinyUSB requires the class driver to implement ZLP (since ZLP usage is class-specific) */
 
-    if ( xferred_bytes && (0 == (xferred_bytes % CFG_TUD_NET_ENDPOINT_SIZE)) )
+    if ( _netd_itf.xmit.count )
+    {
+      /* packet of tud_network_xmit_frags() is sent in several transfers, ZLP included */
+      if ( netd_xmit_complete(&_netd_itf.xmit, rhport, ep_addr) ) can_xmit = true;
+    }
+    else if ( xferred_bytes && (0 == (xferred_bytes % CFG_TUD_NET_ENDPOINT_SIZE)) )
     {
       do_in_xfer(NULL, 0); /* a ZLP is needed */
     }
@@ -418,6 +431,16 @@ bool tud_network_can_xmit(uint16_t size)
   return can_xmit;
 }
 
+static void rndis_fill_header(uint16_t len)
+{
+  rndis_data_packet_t *hdr = (rndis_data_packet_t *) ((void*) transmitted);
+  memset(hdr, 0, sizeof(rndis_data_packet_t));
+  hdr->MessageType = REMOTE_NDIS_PACKET_MSG;
+  hdr->MessageLength = len;
+  hdr->DataOffset = sizeof(rndis_data_packet_t) - offsetof(rndis_data_packet_t, DataOffset);
+  hdr->DataLength = len - sizeof(rndis_data_packet_t);
+}
+
 void tud_network_xmit(void *ref, uint16_t arg)
 {
   uint8_t *data;
@@ -433,15 +456,37 @@ void tud_network_xmit(void *ref, uint16_t arg)
 
   if (!_netd_itf.ecm_mode)
   {
-    rndis_data_packet_t *hdr = (rndis_data_packet_t *) ((void*) transmitted);
-    memset(hdr, 0, sizeof(rndis_data_packet_t));
-    hdr->MessageType = REMOTE_NDIS_PACKET_MSG;
-    hdr->MessageLength = len;
-    hdr->DataOffset = sizeof(rndis_data_packet_t) - offsetof(rndis_data_packet_t, DataOffset);
-    hdr->DataLength = len - sizeof(rndis_data_packet_t);
+    rndis_fill_header(len);
   }
 
   do_in_xfer(transmitted, len);
 }
 
+bool tud_network_xmit_frags(tud_network_frag_t const frags[], uint8_t count, void* ref)
+{
+  TU_VERIFY(can_xmit);
+
+  // transmitted[] is used as bounce buffer
+  uint16_t const hdr_len = (_netd_itf.ecm_mode) ? 0 : CFG_TUD_NET_PACKET_PREFIX_LEN;
+  uint32_t const len = netd_xmit_build(&_netd_itf.xmit, transmitted, sizeof(transmitted), hdr_len, frags, count);
+  TU_VERIFY(len);
+
+  if (!_netd_itf.ecm_mode)
+  {
+    rndis_fill_header((uint16_t) len);
+  }
+
+  if ( 0 == (len % CFG_TUD_NET_ENDPOINT_SIZE) )
+  {
+    netd_xmit_add_zlp(&_netd_itf.xmit);
+  }
+
+  _netd_itf.xmit.ref = ref;
+  can_xmit = false;
+
+  netd_xmit_pump(&_netd_itf.xmit, 0, _netd_itf.ep_in);
+
+  return true;
+}
+
 #endif
@@ -62,6 +62,13 @@ typedef enum
   NCM_SET_CRC_MODE                                 = 0x8A,
 } ncm_request_code_t;
 
+// Table 6.5 NTB Format selected by SET_NTB_FORMAT
+typedef enum
+{
+  NCM_NTB_FORMAT_16 = 0x00,
+  NCM_NTB_FORMAT_32 = 0x01,
+} ncm_ntb_format_t;
+
 #ifdef __cplusplus
  }
 #endif
@@ -33,6 +33,7 @@
 #include "device/usbd.h"
 #include "device/usbd_pvt.h"
 #include "net_device.h"
+#include "net_xmit.h"
 
 //--------------------------------------------------------------------+
 // MACRO CONSTANT TYPEDEF
@@ -42,6 +43,19 @@
 #define NDP16_SIGNATURE_NCM0 0x304D434E
 #define NDP16_SIGNATURE_NCM1 0x314D434E
 
+#define NTH32_SIGNATURE      0x686D636E
+#define NDP32_SIGNATURE_NCM0 0x306D636E
+#define NDP32_SIGNATURE_NCM1 0x316D636E
+
+// Minimum dwNtbInMaxSize accepted by SET_NTB_INPUT_SIZE
+#define NCM_NTB_IN_MIN_SIZE  2048
+
+#define NCM_IS_NTB32()       (CFG_TUD_NCM_NTB32 && ncm_interface.ntb_format == NCM_NTB_FORMAT_32)
+
+TU_VERIFY_STATIC(CFG_TUD_NCM_NTB32 || (CFG_TUD_NCM_IN_NTB_MAX_SIZE <= UINT16_MAX && CFG_TUD_NCM_OUT_NTB_MAX_SIZE <= UINT16_MAX),
+                 "NTB larger than 64 KiB requires CFG_TUD_NCM_NTB32");
+TU_VERIFY_STATIC(CFG_TUD_NCM_IN_NTB_MAX_SIZE <= (NETD_XMIT_CHUNK_MAX - 1) * NETD_XMIT_XFER_MAX, "IN NTB is too large");
+
 typedef struct TU_ATTR_PACKED
 {
   uint16_t wLength;
@@ -58,6 +72,13 @@ typedef struct TU_ATTR_PACKED
   uint16_t wNtbOutMaxDatagrams;
 } ntb_parameters_t;
 
+typedef struct TU_ATTR_PACKED
+{
+  uint32_t dwNtbInMaxSize;
+  uint16_t wNtbInMaxDatagrams;
+  uint16_t wReserved;
+} ntb_input_size_t;
+
 typedef struct TU_ATTR_PACKED
 {
   uint32_t dwSignature;
@@ -81,13 +102,30 @@ typedef struct TU_ATTR_PACKED
   ndp16_datagram_t datagram[];
 } ndp16_t;
 
-typedef union TU_ATTR_PACKED {
-  struct {
-    nth16_t nth;
-    ndp16_t ndp;
-  };
-  uint8_t data[CFG_TUD_NCM_IN_NTB_MAX_SIZE];
-} transmit_ntb_t;
+typedef struct TU_ATTR_PACKED
+{
+  uint32_t dwSignature;
+  uint16_t wHeaderLength;
+  uint16_t wSequence;
+  uint32_t dwBlockLength;
+  uint32_t dwNdpIndex;
+} nth32_t;
+
+typedef struct TU_ATTR_PACKED
+{
+  uint32_t dwDatagramIndex;
+  uint32_t dwDatagramLength;
+} ndp32_datagram_t;
+
+typedef struct TU_ATTR_PACKED
+{
+  uint32_t dwSignature;
+  uint16_t wLength;
+  uint16_t wReserved6;
+  uint32_t dwNextNdpIndex;
+  uint32_t dwReserved12;
+  ndp32_datagram_t datagram[];
+} ndp32_t;
 
 struct ecm_notify_struct
 {
@@ -104,8 +142,21 @@ typedef struct
   uint8_t ep_in;
   uint8_t ep_out;
 
-  const ndp16_t *ndp;
-  uint8_t num_datagrams, current_datagram_index;
+  uint8_t ntb_format;   // NCM_NTB_FORMAT_16 or NCM_NTB_FORMAT_32, selected by host
+
+  uint16_t num_datagrams, current_datagram_index;
+
+  // receive_ntb[] ring: NTBs are received at (rx_rd + rx_count), datagrams are delivered from rx_rd
+  uint32_t rx_ntb_len[CFG_TUD_NCM_OUT_NTB_N];
+  uint16_t rx_xfer_len;  // Length of on-going OUT transfer, an NTB larger than a transfer is received in several
+  uint8_t  rx_rd;
+  uint8_t  rx_count;     // Number of received NTBs not yet fully consumed by application
+  bool     rx_busy;      // OUT transfer is on-going
+  bool     rx_parsed;    // NTB at rx_rd is parsed, its datagrams are being delivered
+  bool     rx_ntb32;     // NTB at rx_rd is NTB32
+  uint16_t rx_ndp_count; // Number of NDPs parsed in NTB at rx_rd
+  uint32_t rx_ndp;       // Offset of NDP being delivered
+  uint32_t rx_next_ndp;  // Offset of next NDP in the chain, 0 if none
 
   enum {
     REPORT_SPEED,
@@ -115,15 +166,22 @@ typedef struct
   bool report_pending;
 
   uint8_t  current_ntb;           // Index in transmit_ntb[] that is currently being filled with datagrams
-  uint8_t  datagram_count;        // Number of datagrams in transmit_ntb[current_ntb]
-  uint16_t next_datagram_offset;  // Offset in transmit_ntb[current_ntb].data to place the next datagram
-  uint16_t ntb_in_size;           // Maximum size of transmitted (IN to host) NTBs; initially CFG_TUD_NCM_IN_NTB_MAX_SIZE
-  uint8_t  max_datagrams_per_ntb; // Maximum number of datagrams per NTB; initially CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB
+  uint8_t  ndp_count;             // Number of NDPs in transmit_ntb[current_ntb]
+  uint8_t  ndp_datagram_count;    // Number of datagrams in the last NDP of transmit_ntb[current_ntb]
+  uint16_t datagram_count;        // Number of datagrams in transmit_ntb[current_ntb]
+  uint32_t ndp_offset;            // Offset of the last NDP in transmit_ntb[current_ntb]
+  uint32_t next_datagram_offset;  // Offset in transmit_ntb[current_ntb] to place the next datagram
+  uint32_t ntb_in_size;           // Maximum size of transmitted (IN to host) NTBs; initially CFG_TUD_NCM_IN_NTB_MAX_SIZE
+  uint16_t max_datagrams_per_ntb; // Maximum number of datagrams per NTB; initially all NDPs can be filled
 
   uint16_t nth_sequence;          // Sequence number counter for transmitted NTBs
 
   bool transferring;
 
+  netd_xmit_t xmit;               // Transfer of NTB currently being sent
+
+  ntb_input_size_t ntb_input;     // Data of GET/SET_NTB_INPUT_SIZE
+
 } ncm_interface_t;
 
 //--------------------------------------------------------------------+
@@ -132,7 +190,7 @@ typedef struct
 
 CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN static const ntb_parameters_t ntb_parameters = {
     .wLength                 = sizeof(ntb_parameters_t),
-    .bmNtbFormatsSupported   = 0x01,
+    .bmNtbFormatsSupported   = CFG_TUD_NCM_NTB32 ? 0x03 : 0x01,
     .dwNtbInMaxSize          = CFG_TUD_NCM_IN_NTB_MAX_SIZE,
     .wNdbInDivisor           = 4,
     .wNdbInPayloadRemainder  = 0,
@@ -145,20 +203,104 @@ CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN static const ntb_parameters_t ntb_parame
     .wNtbOutMaxDatagrams     = 0
 };
 
-CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN static transmit_ntb_t transmit_ntb[2];
+CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN static uint8_t transmit_ntb[2][CFG_TUD_NCM_IN_NTB_MAX_SIZE];
 
-CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN static uint8_t receive_ntb[CFG_TUD_NCM_OUT_NTB_MAX_SIZE];
+CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN static uint8_t receive_ntb[CFG_TUD_NCM_OUT_NTB_N][CFG_TUD_NCM_OUT_NTB_MAX_SIZE];
 
 static ncm_interface_t ncm_interface;
 
+//--------------------------------------------------------------------+
+// NTB16/NTB32 layout
+//--------------------------------------------------------------------+
+
+static inline uint32_t ncm_align(uint32_t offset)
+{
+  return tu_div_ceil(offset, CFG_TUD_NCM_ALIGNMENT) * CFG_TUD_NCM_ALIGNMENT;
+}
+
+static inline uint16_t ncm_nth_len(bool ntb32)
+{
+  return ntb32 ? sizeof(nth32_t) : sizeof(nth16_t);
+}
+
+// Length of NDP with number of entries (including terminator)
+static inline uint32_t ncm_ndp_len(bool ntb32, uint32_t entries)
+{
+  return (uint32_t) (ntb32 ? (sizeof(ndp32_t) + entries * sizeof(ndp32_datagram_t))
+                          : (sizeof(ndp16_t) + entries * sizeof(ndp16_datagram_t)));
+}
+
+// NTB16 can not address more than 64 KiB
+static inline uint32_t ncm_ntb_in_size(void)
+{
+  return NCM_IS_NTB32() ? ncm_interface.ntb_in_size : tu_min32(ncm_interface.ntb_in_size, UINT16_MAX);
+}
+
+static void ncm_write_nth(uint8_t* ntb, uint32_t block_len, uint32_t ndp_index)
+{
+  if (NCM_IS_NTB32()) {
+    nth32_t *nth = (nth32_t *) ntb;
+    nth->dwSignature = NTH32_SIGNATURE;
+    nth->wHeaderLength = sizeof(nth32_t);
+    nth->wSequence = ncm_interface.nth_sequence++;
+    nth->dwBlockLength = block_len;
+    nth->dwNdpIndex = ndp_index;
+  } else {
+    nth16_t *nth = (nth16_t *) ntb;
+    nth->dwSignature = NTH16_SIGNATURE;
+    nth->wHeaderLength = sizeof(nth16_t);
+    nth->wSequence = ncm_interface.nth_sequence++;
+    nth->wBlockLength = (uint16_t) block_len;
+    nth->wNdpIndex = (uint16_t) ndp_index;
+  }
+}
+
+static void ncm_write_datagram(uint8_t* ntb, uint32_t ndp_offset, uint16_t i, uint32_t index, uint32_t len)
+{
+  if (NCM_IS_NTB32()) {
+    ndp32_t *ndp = (ndp32_t *) (ntb + ndp_offset);
+    ndp->datagram[i].dwDatagramIndex = index;
+    ndp->datagram[i].dwDatagramLength = len;
+  } else {
+    ndp16_t *ndp = (ndp16_t *) (ntb + ndp_offset);
+    ndp->datagram[i].wDatagramIndex = (uint16_t) index;
+    ndp->datagram[i].wDatagramLength = (uint16_t) len;
+  }
+}
+
+// Fill in NDP header and terminator after count datagrams
+static void ncm_write_ndp(uint8_t* ntb, uint32_t ndp_offset, uint16_t count, uint32_t next_ndp)
+{
+  ncm_write_datagram(ntb, ndp_offset, count, 0, 0);
+
+  if (NCM_IS_NTB32()) {
+    ndp32_t *ndp = (ndp32_t *) (ntb + ndp_offset);
+    ndp->dwSignature = NDP32_SIGNATURE_NCM0;
+    ndp->wLength = (uint16_t) ncm_ndp_len(true, count + 1u);
+    ndp->wReserved6 = 0;
+    ndp->dwNextNdpIndex = next_ndp;
+    ndp->dwReserved12 = 0;
+  } else {
+    ndp16_t *ndp = (ndp16_t *) (ntb + ndp_offset);
+    ndp->dwSignature = NDP16_SIGNATURE_NCM0;
+    ndp->wLength = (uint16_t) ncm_ndp_len(false, count + 1u);
+    ndp->wNextNdpIndex = (uint16_t) next_ndp;
+  }
+}
+
 /*
  * Set up the NTB state in ncm_interface to be ready to add datagrams.
  */
 static void ncm_prepare_for_tx(void) {
+  bool const ntb32 = NCM_IS_NTB32();
+
   ncm_interface.datagram_count = 0;
+  ncm_interface.ndp_count = 1;
+  ncm_interface.ndp_datagram_count = 0;
+  ncm_interface.ndp_offset = ncm_nth_len(ntb32);
   // datagrams start after all the headers
-  ncm_interface.next_datagram_offset = sizeof(nth16_t) + sizeof(ndp16_t)
-      + ((CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB + 1) * sizeof(ndp16_datagram_t));
+  ncm_interface.next_datagram_offset = ncm_align(ncm_interface.ndp_offset +
+                                                 ncm_ndp_len(ntb32, CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB + 1));
 }
 
 /*
@@ -170,26 +312,24 @@ static void ncm_start_tx(void) {
     return;
   }
 
-  transmit_ntb_t *ntb = &transmit_ntb[ncm_interface.current_ntb];
-  size_t ntb_length = ncm_interface.next_datagram_offset;
-
-  // Fill in NTB header
-  ntb->nth.dwSignature = NTH16_SIGNATURE;
-  ntb->nth.wHeaderLength = sizeof(nth16_t);
-  ntb->nth.wSequence = ncm_interface.nth_sequence++;
-  ntb->nth.wBlockLength = ntb_length;
-  ntb->nth.wNdpIndex = sizeof(nth16_t);
-
-  // Fill in NDP16 header and terminator
-  ntb->ndp.dwSignature = NDP16_SIGNATURE_NCM0;
-  ntb->ndp.wLength = sizeof(ndp16_t) + (ncm_interface.datagram_count + 1) * sizeof(ndp16_datagram_t);
-  ntb->ndp.wNextNdpIndex = 0;
-  ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramIndex = 0;
-  ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramLength = 0;
-
-  // Kick off an endpoint transfer
-  usbd_edpt_xfer(0, ncm_interface.ep_in, ntb->data, ntb_length);
+  uint8_t *ntb = transmit_ntb[ncm_interface.current_ntb];
+  uint32_t const ntb_length = ncm_interface.next_datagram_offset;
+
+  // Fill in NTB header, NDP header and terminator of the last NDP
+  ncm_write_nth(ntb, ntb_length, ncm_nth_len(NCM_IS_NTB32()));
+  ncm_write_ndp(ntb, ncm_interface.ndp_offset, ncm_interface.ndp_datagram_count, 0);
+
+  // NTB32 can be longer than a single transfer
+  TU_ASSERT(netd_xmit_build_linear(&ncm_interface.xmit, ntb, ntb_length), );
+
+  // short NTB which is multiple of packet size must be terminated by ZLP
+  if ((ntb_length % CFG_TUD_NET_ENDPOINT_SIZE) == 0 && ntb_length < ncm_ntb_in_size()) {
+    netd_xmit_add_zlp(&ncm_interface.xmit);
+  }
+
+  // Kick off endpoint transfers
   ncm_interface.transferring = true;
+  netd_xmit_pump(&ncm_interface.xmit, 0, ncm_interface.ep_in);
 
   // Swap to the other NTB and clear it out
   ncm_interface.current_ntb = 1 - ncm_interface.current_ntb;
@@ -225,20 +365,160 @@ static struct ecm_notify_struct ncm_notify_speed_change =
     .uplink = 10000000,
 };
 
+/*
+ * Start receiving into the next free NTB of the ring if there is one
+ */
+static void ncm_rx_arm(void)
+{
+  if (ncm_interface.rx_busy || ncm_interface.rx_count >= CFG_TUD_NCM_OUT_NTB_N) {
+    return;
+  }
+
+  // an NTB larger than a single transfer is continued at its received length
+  uint8_t const idx = (uint8_t) ((ncm_interface.rx_rd + ncm_interface.rx_count) % CFG_TUD_NCM_OUT_NTB_N);
+  uint32_t const offset = ncm_interface.rx_ntb_len[idx];
+
+  ncm_interface.rx_xfer_len = (uint16_t) tu_min32(CFG_TUD_NCM_OUT_NTB_MAX_SIZE - offset, NETD_XMIT_XFER_MAX);
+  ncm_interface.rx_busy = usbd_edpt_xfer(0, ncm_interface.ep_out, receive_ntb[idx] + offset, ncm_interface.rx_xfer_len);
+}
+
+/*
+ * Get datagram i of the NDP being delivered
+ */
+static void ncm_rx_datagram(uint16_t i, uint32_t* index, uint32_t* len)
+{
+  const uint8_t *ndp = receive_ntb[ncm_interface.rx_rd] + ncm_interface.rx_ndp;
+
+  if (ncm_interface.rx_ntb32) {
+    *index = ((const ndp32_t *) ndp)->datagram[i].dwDatagramIndex;
+    *len = ((const ndp32_t *) ndp)->datagram[i].dwDatagramLength;
+  } else {
+    *index = ((const ndp16_t *) ndp)->datagram[i].wDatagramIndex;
+    *len = ((const ndp16_t *) ndp)->datagram[i].wDatagramLength;
+  }
+}
+
+/*
+ * Parse the NTB header at the head of the ring. An invalid NTB has no NDP and is dropped by caller.
+ */
+static void ncm_rx_parse_nth(void)
+{
+  const uint8_t *ntb = receive_ntb[ncm_interface.rx_rd];
+  uint32_t const len = ncm_interface.rx_ntb_len[ncm_interface.rx_rd];
+
+  ncm_interface.rx_parsed = true;
+  ncm_interface.rx_ndp_count = 0;
+  ncm_interface.rx_next_ndp = 0;
+
+  TU_ASSERT(len >= sizeof(nth16_t), );
+
+  uint32_t const signature = tu_unaligned_read32(ntb);
+
+  if (signature == NTH16_SIGNATURE) {
+    ncm_interface.rx_ntb32 = false;
+    ncm_interface.rx_next_ndp = ((const nth16_t *) ntb)->wNdpIndex;
+  } else {
+    TU_ASSERT(CFG_TUD_NCM_NTB32 && signature == NTH32_SIGNATURE && len >= sizeof(nth32_t), );
+    ncm_interface.rx_ntb32 = true;
+    ncm_interface.rx_next_ndp = ((const nth32_t *) ntb)->dwNdpIndex;
+  }
+}
+
+/*
+ * Parse the next NDP in the chain of NTB at the head of the ring. An invalid NDP has no datagrams and ends the chain.
+ */
+static void ncm_rx_parse_ndp(void)
+{
+  const uint8_t *ntb = receive_ntb[ncm_interface.rx_rd];
+  uint32_t const len = ncm_interface.rx_ntb_len[ncm_interface.rx_rd];
+  bool const ntb32 = ncm_interface.rx_ntb32;
+  uint32_t const offset = ncm_interface.rx_next_ndp;
+  uint32_t const ndp_hdr_len = ncm_ndp_len(ntb32, 0);
+
+  ncm_interface.rx_ndp = offset;
+  ncm_interface.rx_next_ndp = 0;
+  ncm_interface.current_datagram_index = 0;
+  ncm_interface.num_datagrams = 0;
+
+  // a malformed NTB could link its NDPs in a loop, valid NDPs do not overlap
+  TU_ASSERT(ncm_interface.rx_ndp_count < tu_min32(len / ndp_hdr_len, UINT16_MAX), );
+  ncm_interface.rx_ndp_count++;
+
+  TU_ASSERT(offset >= ncm_nth_len(ntb32) && offset <= len - ndp_hdr_len, );
+
+  uint32_t signature, ndp_len, next_ndp;
+  if (ntb32) {
+    const ndp32_t *ndp = (const ndp32_t *) (ntb + offset);
+    signature = ndp->dwSignature;
+    ndp_len = ndp->wLength;
+    next_ndp = ndp->dwNextNdpIndex;
+    TU_ASSERT(signature == NDP32_SIGNATURE_NCM0 || signature == NDP32_SIGNATURE_NCM1, );
+  } else {
+    const ndp16_t *ndp = (const ndp16_t *) (ntb + offset);
+    signature = ndp->dwSignature;
+    ndp_len = ndp->wLength;
+    next_ndp = ndp->wNextNdpIndex;
+    TU_ASSERT(signature == NDP16_SIGNATURE_NCM0 || signature == NDP16_SIGNATURE_NCM1, );
+  }
+  TU_ASSERT(ndp_len >= ndp_hdr_len && ndp_len <= len - offset, );
+
+  // count datagrams up to the terminator, each must be within the NTB and after its header
+  uint32_t const entries = (ndp_len - ndp_hdr_len) / (uint32_t) (ntb32 ? sizeof(ndp32_datagram_t) : sizeof(ndp16_datagram_t));
+  uint16_t count = 0;
+  for (uint32_t i = 0; i < entries && count < UINT16_MAX; i++)
+  {
+    uint32_t dg_index, dg_len;
+    ncm_rx_datagram(count, &dg_index, &dg_len);
+    if (!dg_index || !dg_len) {
+      break;
+    }
+
+    TU_ASSERT(dg_len <= tu_min32(len, UINT16_MAX) && dg_index >= ncm_nth_len(ntb32) && dg_index <= len - dg_len, );
+    count++;
+  }
+
+  ncm_interface.num_datagrams = count;
+
+  // next NDP overlapping this one (e.g linked to itself) ends the chain
+  if (next_ndp < offset + ndp_len && next_ndp + ndp_hdr_len > offset) {
+    next_ndp = 0;
+  }
+  ncm_interface.rx_next_ndp = next_ndp;
+}
+
 void tud_network_recv_renew(void)
 {
-  if (!ncm_interface.num_datagrams)
+  while (!ncm_interface.num_datagrams)
   {
-    usbd_edpt_xfer(0, ncm_interface.ep_out, receive_ntb, sizeof(receive_ntb));
-    return;
+    // continue with the next NDP of the head NTB
+    if (ncm_interface.rx_parsed && ncm_interface.rx_next_ndp) {
+      ncm_rx_parse_ndp();
+      continue;
+    }
+
+    // all datagrams of the head NTB are consumed, release it
+    if (ncm_interface.rx_parsed) {
+      ncm_interface.rx_parsed = false;
+      ncm_interface.rx_ntb_len[ncm_interface.rx_rd] = 0;
+      ncm_interface.rx_rd = (uint8_t) ((ncm_interface.rx_rd + 1) % CFG_TUD_NCM_OUT_NTB_N);
+      ncm_interface.rx_count--;
+    }
+
+    ncm_rx_arm();
+
+    if (!ncm_interface.rx_count) {
+      return;
+    }
+
+    ncm_rx_parse_nth();
   }
 
-  const ndp16_t *ndp = ncm_interface.ndp;
-  const int i = ncm_interface.current_datagram_index;
+  uint32_t index, len;
+  ncm_rx_datagram(ncm_interface.current_datagram_index, &index, &len);
   ncm_interface.current_datagram_index++;
   ncm_interface.num_datagrams--;
 
-  tud_network_recv_cb(receive_ntb + ndp->datagram[i].wDatagramIndex, ndp->datagram[i].wDatagramLength);
+  tud_network_recv_cb(receive_ntb[ncm_interface.rx_rd] + index, (uint16_t) len);
 }
 
 //--------------------------------------------------------------------+
@@ -249,7 +529,7 @@ void netd_init(void)
 {
   tu_memclr(&ncm_interface, sizeof(ncm_interface));
   ncm_interface.ntb_in_size = CFG_TUD_NCM_IN_NTB_MAX_SIZE;
-  ncm_interface.max_datagrams_per_ntb = CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB;
+  ncm_interface.max_datagrams_per_ntb = CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB * CFG_TUD_NCM_MAX_NDP_PER_NTB;
   ncm_prepare_for_tx();
 }
 
@@ -257,6 +537,11 @@ void netd_reset(uint8_t rhport)
 {
   (void) rhport;
 
+  // let application release fragments of the aborted datagram
+  if (ncm_interface.xmit.count && ncm_interface.xmit.notify && tud_network_xmit_done_cb) {
+    tud_network_xmit_done_cb(ncm_interface.xmit.ref);
+  }
+
   netd_init();
 }
 
@@ -339,6 +624,22 @@ TU_ATTR_WEAK void tud_network_link_state_cb(bool state)
 // return false to stall control endpoint (e.g unsupported request)
 bool netd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request)
 {
+  // apply SET_NTB_INPUT_SIZE once its data is received
+  if ( stage == CONTROL_STAGE_DATA && request->bmRequestType_bit.type == TUSB_REQ_TYPE_CLASS &&
+       request->bRequest == NCM_SET_NTB_INPUT_SIZE )
+  {
+    uint32_t const in_size = ncm_interface.ntb_input.dwNtbInMaxSize;
+    TU_VERIFY(in_size >= NCM_NTB_IN_MIN_SIZE);
+    ncm_interface.ntb_in_size = tu_min32(in_size, CFG_TUD_NCM_IN_NTB_MAX_SIZE);
+
+    // 8-byte form also limits number of datagrams, 0 means no limit
+    uint16_t const max_datagrams = CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB * CFG_TUD_NCM_MAX_NDP_PER_NTB;
+    uint16_t const req_datagrams = (request->wLength >= 8) ? ncm_interface.ntb_input.wNtbInMaxDatagrams : 0;
+    ncm_interface.max_datagrams_per_ntb = req_datagrams ? tu_min16(req_datagrams, max_datagrams) : max_datagrams;
+
+    return true;
+  }
+
   if ( stage != CONTROL_STAGE_SETUP ) return true;
 
   switch ( request->bmRequestType_bit.type )
@@ -367,9 +668,7 @@ bool netd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
             ncm_interface.itf_data_alt = req_alt;
 
             if (ncm_interface.itf_data_alt) {
-              if (!usbd_edpt_busy(rhport, ncm_interface.ep_out)) {
-                tud_network_recv_renew(); // prepare for incoming datagrams
-              }
+              ncm_rx_arm(); // prepare for incoming datagrams
               if (!ncm_interface.report_pending) {
                 ncm_report();
               }
@@ -390,9 +689,43 @@ bool netd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
     case TUSB_REQ_TYPE_CLASS:
       TU_VERIFY (ncm_interface.itf_num == request->wIndex);
 
-      if (NCM_GET_NTB_PARAMETERS == request->bRequest)
+      switch ( request->bRequest )
       {
-        tud_control_xfer(rhport, request, (void*)(uintptr_t) &ntb_parameters, sizeof(ntb_parameters));
+        case NCM_GET_NTB_PARAMETERS:
+          tud_control_xfer(rhport, request, (void*)(uintptr_t) &ntb_parameters, sizeof(ntb_parameters));
+          break;
+
+        case NCM_GET_NTB_FORMAT:
+        {
+          uint16_t const format = ncm_interface.ntb_format;
+          tud_control_xfer(rhport, request, (void*)(uintptr_t) &format, sizeof(format));
+        }
+          break;
+
+        case NCM_SET_NTB_FORMAT:
+          // only while Data Interface is inactive
+          TU_VERIFY(request->wValue == NCM_NTB_FORMAT_16 || (CFG_TUD_NCM_NTB32 && request->wValue == NCM_NTB_FORMAT_32));
+          TU_VERIFY(ncm_interface.itf_data_alt == 0);
+
+          ncm_interface.ntb_format = (uint8_t) request->wValue;
+          ncm_prepare_for_tx();
+          tud_control_status(rhport, request);
+          break;
+
+        case NCM_GET_NTB_INPUT_SIZE:
+          ncm_interface.ntb_input.dwNtbInMaxSize = ncm_interface.ntb_in_size;
+          ncm_interface.ntb_input.wNtbInMaxDatagrams = ncm_interface.max_datagrams_per_ntb;
+          ncm_interface.ntb_input.wReserved = 0;
+          tud_control_xfer(rhport, request, &ncm_interface.ntb_input, sizeof(ncm_interface.ntb_input));
+          break;
+
+        case NCM_SET_NTB_INPUT_SIZE:
+          TU_VERIFY(request->wLength == 4 || request->wLength == 8);
+          tu_memclr(&ncm_interface.ntb_input, sizeof(ncm_interface.ntb_input));
+          tud_control_xfer(rhport, request, &ncm_interface.ntb_input, request->wLength);
+          break;
+
+        default: break;
       }
 
       break;
@@ -406,37 +739,29 @@ bool netd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
 
 static void handle_incoming_datagram(uint32_t len)
 {
-  uint32_t size = len;
+  ncm_interface.rx_busy = false;
 
-  if (len == 0) {
-    return;
-  }
-
-  TU_ASSERT(size >= sizeof(nth16_t), );
+  uint8_t const idx = (uint8_t) ((ncm_interface.rx_rd + ncm_interface.rx_count) % CFG_TUD_NCM_OUT_NTB_N);
+  ncm_interface.rx_ntb_len[idx] += len;
 
-  const nth16_t *hdr = (const nth16_t *)receive_ntb;
-  TU_ASSERT(hdr->dwSignature == NTH16_SIGNATURE, );
-  TU_ASSERT(hdr->wNdpIndex >= sizeof(nth16_t) && (hdr->wNdpIndex + sizeof(ndp16_t)) <= len, );
+  // NTB is complete with a short transfer or when buffer is full, otherwise it continues in the next transfer
+  if (len < ncm_interface.rx_xfer_len || ncm_interface.rx_ntb_len[idx] >= CFG_TUD_NCM_OUT_NTB_MAX_SIZE) {
+    if (ncm_interface.rx_ntb_len[idx]) {
+      ncm_interface.rx_count++;
+    }
+  }
 
-  const ndp16_t *ndp = (const ndp16_t *)(receive_ntb + hdr->wNdpIndex);
-  TU_ASSERT(ndp->dwSignature == NDP16_SIGNATURE_NCM0 || ndp->dwSignature == NDP16_SIGNATURE_NCM1, );
-  TU_ASSERT(hdr->wNdpIndex + ndp->wLength <= len, );
+  // host can keep sending while earlier NTBs are consumed
+  ncm_rx_arm();
 
-  int num_datagrams = (ndp->wLength - 12) / 4;
-  ncm_interface.current_datagram_index = 0;
-  ncm_interface.num_datagrams = 0;
-  ncm_interface.ndp = ndp;
-  for (int i = 0; i < num_datagrams && ndp->datagram[i].wDatagramIndex && ndp->datagram[i].wDatagramLength; i++)
-  {
-    ncm_interface.num_datagrams++;
+  // start delivering datagrams if application is not working on an earlier NTB
+  if (!ncm_interface.rx_parsed) {
+    tud_network_recv_renew();
   }
-  
-  tud_network_recv_renew();
 }
 
 bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
 {
-  (void) rhport;
   (void) result;
 
   /* new datagram receive_ntb */
@@ -445,8 +770,9 @@ bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
     handle_incoming_datagram(xferred_bytes);
   }
 
-  /* data transmission finished */
-  if (ep_addr == ncm_interface.ep_in )
+  /* data transmission finished, an NTB can be sent in several transfers */
+  if (ep_addr == ncm_interface.ep_in &&
+      (!ncm_interface.xmit.count || netd_xmit_complete(&ncm_interface.xmit, rhport, ep_addr)))
   {
     if (ncm_interface.transferring) {
       ncm_interface.transferring = false;
@@ -477,8 +803,19 @@ bool tud_network_can_xmit(uint16_t size)
     return false;
   }
 
-  size_t next_datagram_offset = ncm_interface.next_datagram_offset;
-  if (next_datagram_offset + size > ncm_interface.ntb_in_size) {
+  uint32_t next_datagram_offset = ncm_interface.next_datagram_offset;
+
+  // last NDP is full, datagram is placed after a new NDP
+  if (ncm_interface.ndp_datagram_count >= CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB) {
+    if (ncm_interface.ndp_count >= CFG_TUD_NCM_MAX_NDP_PER_NTB) {
+      TU_LOG2("NTB full [by NDP]\r\n");
+      return false;
+    }
+
+    next_datagram_offset = ncm_align(next_datagram_offset + ncm_ndp_len(NCM_IS_NTB32(), CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB + 1));
+  }
+
+  if (next_datagram_offset + size > ncm_ntb_in_size()) {
     TU_LOG2("ntb full [by size]\r\n");
     return false;
   }
@@ -488,24 +825,70 @@ bool tud_network_can_xmit(uint16_t size)
 
 void tud_network_xmit(void *ref, uint16_t arg)
 {
-  transmit_ntb_t *ntb = &transmit_ntb[ncm_interface.current_ntb];
-  size_t next_datagram_offset = ncm_interface.next_datagram_offset;
+  uint8_t *ntb = transmit_ntb[ncm_interface.current_ntb];
+
+  // chain a new NDP after the datagrams of the full one
+  if (ncm_interface.ndp_datagram_count >= CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB) {
+    uint32_t const ndp_offset = ncm_interface.next_datagram_offset;
+
+    ncm_write_ndp(ntb, ncm_interface.ndp_offset, ncm_interface.ndp_datagram_count, ndp_offset);
 
-  uint16_t size = tud_network_xmit_cb(ntb->data + next_datagram_offset, ref, arg);
+    ncm_interface.ndp_offset = ndp_offset;
+    ncm_interface.ndp_datagram_count = 0;
+    ncm_interface.ndp_count++;
+    ncm_interface.next_datagram_offset = ncm_align(ndp_offset + ncm_ndp_len(NCM_IS_NTB32(), CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB + 1));
+  }
+
+  uint32_t const datagram_offset = ncm_interface.next_datagram_offset;
+  uint16_t size = tud_network_xmit_cb(ntb + datagram_offset, ref, arg);
 
-  ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramIndex = ncm_interface.next_datagram_offset;
-  ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramLength = size;
+  ncm_write_datagram(ntb, ncm_interface.ndp_offset, ncm_interface.ndp_datagram_count, datagram_offset, size);
 
+  ncm_interface.ndp_datagram_count++;
   ncm_interface.datagram_count++;
-  next_datagram_offset += size;
 
   // round up so the next datagram is aligned correctly
-  next_datagram_offset += (CFG_TUD_NCM_ALIGNMENT - 1);
-  next_datagram_offset -= (next_datagram_offset % CFG_TUD_NCM_ALIGNMENT);
-
-  ncm_interface.next_datagram_offset = next_datagram_offset;
+  ncm_interface.next_datagram_offset = ncm_align(datagram_offset + size);
 
   ncm_start_tx();
 }
 
+bool tud_network_xmit_frags(tud_network_frag_t const frags[], uint8_t count, void* ref)
+{
+  // only when there is nothing else to send, so that datagram order is kept
+  TU_VERIFY(ncm_interface.itf_data_alt == 1 && !ncm_interface.transferring && !ncm_interface.datagram_count);
+
+  // current NTB is used as bounce buffer, datagram is placed right after the headers
+  uint8_t *ntb = transmit_ntb[ncm_interface.current_ntb];
+  bool const ntb32 = NCM_IS_NTB32();
+  uint16_t const ndp_offset = ncm_nth_len(ntb32);
+  uint16_t const hdr_len = (uint16_t) (ndp_offset + ncm_ndp_len(ntb32, 2));
+  uint32_t const ntb_in_size = ncm_ntb_in_size();
+
+  uint32_t const ntb_length = netd_xmit_build(&ncm_interface.xmit, ntb, (uint16_t) tu_min32(ntb_in_size, UINT16_MAX),
+                                              hdr_len, frags, count);
+  TU_VERIFY(ntb_length);
+
+  // Fill in NTB header, NDP header with single datagram and terminator
+  ncm_write_nth(ntb, ntb_length, ndp_offset);
+  ncm_write_datagram(ntb, ndp_offset, 0, hdr_len, ntb_length - hdr_len);
+  ncm_write_ndp(ntb, ndp_offset, 1, 0);
+
+  // short NTB which is multiple of packet size must be terminated by ZLP
+  if ((ntb_length % CFG_TUD_NET_ENDPOINT_SIZE) == 0 && ntb_length < ntb_in_size) {
+    netd_xmit_add_zlp(&ncm_interface.xmit);
+  }
+
+  ncm_interface.xmit.ref = ref;
+  ncm_interface.transferring = true;
+
+  // Swap to the other NTB so that tud_network_xmit() can fill it meanwhile
+  ncm_interface.current_ntb = 1 - ncm_interface.current_ntb;
+  ncm_prepare_for_tx();
+
+  netd_xmit_pump(&ncm_interface.xmit, 0, ncm_interface.ep_in);
+
+  return true;
+}
+
 #endif
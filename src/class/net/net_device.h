@@ -52,14 +52,35 @@
 #define CFG_TUD_NCM_OUT_NTB_MAX_SIZE 3200
 #endif
 
+// Number of OUT NTBs buffered, host can send next NTBs while datagrams of earlier ones are processed
+#ifndef CFG_TUD_NCM_OUT_NTB_N
+#define CFG_TUD_NCM_OUT_NTB_N 1
+#endif
+
+// Maximum number of datagrams per NDP of transmitted NTBs
 #ifndef CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB
 #define CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB 8
 #endif
 
+// Maximum number of NDPs per transmitted NTB, a new NDP is chained when the last one is full
+#ifndef CFG_TUD_NCM_MAX_NDP_PER_NTB
+#define CFG_TUD_NCM_MAX_NDP_PER_NTB 1
+#endif
+
+// Support NTB32 format selected by host with SET_NTB_FORMAT, required for NTBs larger than 64 KiB
+#ifndef CFG_TUD_NCM_NTB32
+#define CFG_TUD_NCM_NTB32 0
+#endif
+
 #ifndef CFG_TUD_NCM_ALIGNMENT
 #define CFG_TUD_NCM_ALIGNMENT 4
 #endif
 
+// Maximum number of fragments of a datagram passed to tud_network_xmit_frags()
+#ifndef CFG_TUD_NET_XMIT_FRAG_MAX
+#define CFG_TUD_NET_XMIT_FRAG_MAX 4
+#endif
+
 #ifdef __cplusplus
  extern "C" {
 #endif
@@ -77,6 +98,19 @@ bool tud_network_can_xmit(uint16_t size);
 // if network_can_xmit() returns true, network_xmit() can be called once
 void tud_network_xmit(void *ref, uint16_t arg);
 
+// Fragment of a datagram for tud_network_xmit_frags()
+typedef struct
+{
+  void const* buffer;
+  uint16_t    len;
+} tud_network_frag_t;
+
+// Transmit a datagram made of fragments (e.g lwIP pbuf chain) without copying it into driver buffer.
+// Whole USB packets of a 4-byte aligned fragment are sent directly from it, only the remaining bytes and
+// protocol headers are copied. Fragments must be accessible by USB DMA and stay valid until
+// tud_network_xmit_done_cb(ref) is invoked. Return false if driver is busy, application should try later.
+bool tud_network_xmit_frags(tud_network_frag_t const frags[], uint8_t count, void* ref);
+
 //--------------------------------------------------------------------+
 // Application Callbacks (WEAK is optional)
 //--------------------------------------------------------------------+
@@ -87,6 +121,9 @@ bool tud_network_recv_cb(const uint8_t *src, uint16_t size);
 // client must provide this: copy from network stack packet pointer to dst
 uint16_t tud_network_xmit_cb(uint8_t *dst, void *ref, uint16_t arg);
 
+// Invoked when datagram of tud_network_xmit_frags() is sent, its fragments can be released
+TU_ATTR_WEAK void tud_network_xmit_done_cb(void *ref);
+
 //------------- ECM/RNDIS -------------//
 
 // client must provide this: initialize any network state back to the beginning
@@ -0,0 +1,192 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2023, Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Private helper for network drivers (NCM, ECM/RNDIS), should only be included by them.
+// Implement tud_network_xmit_frags(): a datagram is sent as consecutive transfers (chunks) on the bulk IN
+// endpoint. All chunks except the last are multiple of packet size so that host sees a single transfer.
+// Fragment parts which fit packet boundaries are sent directly from application buffer, the rest (and the
+// protocol header) are copied into driver's bounce buffer. NCM also uses it to send NTBs longer than a
+// single transfer.
+
+#ifndef _TUSB_NET_XMIT_H_
+#define _TUSB_NET_XMIT_H_
+
+#include "device/usbd_pvt.h"
+#include "net_device.h"
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+
+// Each fragment can produce a bounce and a direct chunk, plus last bounce chunk and ZLP
+#define NETD_XMIT_CHUNK_MAX   (2*CFG_TUD_NET_XMIT_FRAG_MAX + 2)
+
+// Required alignment of a fragment part to be sent directly (DMA)
+#define NETD_XMIT_ALIGN       4
+
+// Largest transfer length which is multiple of packet size
+#define NETD_XMIT_XFER_MAX    ((UINT16_MAX / CFG_TUD_NET_ENDPOINT_SIZE) * CFG_TUD_NET_ENDPOINT_SIZE)
+
+typedef struct
+{
+  uint8_t const * buf;
+  uint16_t        len;
+} netd_xmit_chunk_t;
+
+typedef struct
+{
+  netd_xmit_chunk_t chunk[NETD_XMIT_CHUNK_MAX];
+  uint8_t count;  // number of chunks
+  uint8_t queued; // number of chunks submitted to endpoint
+  uint8_t done;   // number of chunks completed
+  bool    notify; // invoke tud_network_xmit_done_cb() when sent
+  void*   ref;    // passed to tud_network_xmit_done_cb()
+} netd_xmit_t;
+
+//--------------------------------------------------------------------+
+// Helper
+//--------------------------------------------------------------------+
+
+// Split header (already in bounce, hdr_len bytes) + fragments into chunks.
+// Return total length of the transfer, or 0 if it does not fit into bounce
+static inline uint32_t netd_xmit_build(netd_xmit_t* xmit, uint8_t* bounce, uint16_t bounce_size, uint16_t hdr_len,
+                                       tud_network_frag_t const frags[], uint8_t count)
+{
+  uint32_t total = hdr_len;
+  for(uint8_t i=0; i<count; i++) total += frags[i].len;
+
+  // worst case everything is copied
+  if ( (count > CFG_TUD_NET_XMIT_FRAG_MAX) || (total > bounce_size) ) return 0;
+
+  uint16_t const ep_size = CFG_TUD_NET_ENDPOINT_SIZE;
+  uint8_t* start = bounce;          // bounce bytes not yet added to a chunk
+  uint8_t* wr    = bounce + hdr_len;
+
+  xmit->count  = 0;
+  xmit->queued = 0;
+  xmit->done   = 0;
+  xmit->notify = true;
+
+  for(uint8_t i=0; i<count; i++)
+  {
+    uint8_t const* src = (uint8_t const*) frags[i].buffer;
+    uint16_t len = frags[i].len;
+
+    // complete the packet partially filled in bounce
+    uint16_t const pending = (uint16_t) ((wr - start) % ep_size);
+    if ( pending )
+    {
+      uint16_t const fill = tu_min16(len, (uint16_t) (ep_size - pending));
+      memcpy(wr, src, fill);
+      wr  += fill;
+      src += fill;
+      len  = (uint16_t) (len - fill);
+    }
+
+    // whole packets are sent from fragment buffer
+    uint16_t const direct = (uint16_t) (len - (len % ep_size));
+    if ( direct && (0 == ((uintptr_t) src) % NETD_XMIT_ALIGN) )
+    {
+      if ( wr != start )
+      {
+        xmit->chunk[xmit->count++] = (netd_xmit_chunk_t) { .buf = start, .len = (uint16_t) (wr - start) };
+        start = wr;
+      }
+
+      xmit->chunk[xmit->count++] = (netd_xmit_chunk_t) { .buf = src, .len = direct };
+      src += direct;
+      len  = (uint16_t) (len - direct);
+    }
+
+    memcpy(wr, src, len);
+    wr += len;
+  }
+
+  if ( wr != start )
+  {
+    xmit->chunk[xmit->count++] = (netd_xmit_chunk_t) { .buf = start, .len = (uint16_t) (wr - start) };
+  }
+
+  return total;
+}
+
+// Split a contiguous buffer longer than a single transfer into chunks, last chunk is kept for ZLP.
+// Return false if it does not fit
+static inline bool netd_xmit_build_linear(netd_xmit_t* xmit, uint8_t const* buf, uint32_t len)
+{
+  xmit->count  = 0;
+  xmit->queued = 0;
+  xmit->done   = 0;
+  xmit->notify = false;
+
+  while ( len )
+  {
+    TU_VERIFY(xmit->count < NETD_XMIT_CHUNK_MAX - 1);
+
+    uint16_t const xfer_len = (uint16_t) tu_min32(len, NETD_XMIT_XFER_MAX);
+    xmit->chunk[xmit->count++] = (netd_xmit_chunk_t) { .buf = buf, .len = xfer_len };
+    buf += xfer_len;
+    len -= xfer_len;
+  }
+
+  return true;
+}
+
+// Append a zero length chunk to terminate the transfer
+static inline void netd_xmit_add_zlp(netd_xmit_t* xmit)
+{
+  xmit->chunk[xmit->count++] = (netd_xmit_chunk_t) { .buf = NULL, .len = 0 };
+}
+
+// Submit as many chunks as endpoint can queue
+static inline void netd_xmit_pump(netd_xmit_t* xmit, uint8_t rhport, uint8_t ep_addr)
+{
+  while ( (xmit->queued < xmit->count) && usbd_edpt_xfer_queue_available(rhport, ep_addr) )
+  {
+    netd_xmit_chunk_t const* chunk = &xmit->chunk[xmit->queued];
+    TU_ASSERT( usbd_edpt_xfer_queue(rhport, ep_addr, (uint8_t*) (uintptr_t) chunk->buf, chunk->len), );
+    xmit->queued++;
+  }
+}
+
+// Invoked on IN transfer complete, return true if the whole transfer is sent
+static inline bool netd_xmit_complete(netd_xmit_t* xmit, uint8_t rhport, uint8_t ep_addr)
+{
+  xmit->done++;
+
+  if ( xmit->done < xmit->count )
+  {
+    netd_xmit_pump(xmit, rhport, ep_addr);
+    return false;
+  }
+
+  xmit->count = 0;
+  if ( xmit->notify && tud_network_xmit_done_cb ) tud_network_xmit_done_cb(xmit->ref);
+
+  return true;
+}
+
+#endif /* _TUSB_NET_XMIT_H_ */
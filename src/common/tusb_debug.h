@@ -171,6 +171,64 @@ static inline const char* tu_lookup_find(tu_lookup_table_t const* p_table, uint3
   #define TU_LOG3_HEX(...)
 #endif
 
+//--------------------------------------------------------------------+
+// Binary Trace
+// Fixed size records written to a ring without formatting, cheap enough for ISR and production build
+//--------------------------------------------------------------------+
+#if CFG_TUSB_TRACE
+
+TU_VERIFY_STATIC((CFG_TUSB_TRACE_DEPTH & (CFG_TUSB_TRACE_DEPTH-1)) == 0 && CFG_TUSB_TRACE_DEPTH <= 0x8000,
+                 "CFG_TUSB_TRACE_DEPTH must be power of 2 and not exceed 32768");
+
+// Record ID, must be kept in sync with tools/trace_decode.py
+enum
+{
+  TU_TRACE_DCD_EVENT  = 0x00, // + dcd_eventid_t, queued by dcd_event_handler()
+  TU_TRACE_USBD_EVENT = 0x10, // + dcd_eventid_t, processed by tud_task()
+  TU_TRACE_USBD_XFER  = 0x20, // transfer submitted
+  TU_TRACE_USBD_STALL = 0x21, // endpoint stalled
+  TU_TRACE_HCD_EVENT  = 0x40, // + hcd_eventid_t, queued by hcd_event_handler()
+  TU_TRACE_USBH_EVENT = 0x50, // + hcd_eventid_t, processed by tuh_task()
+  TU_TRACE_USBH_XFER  = 0x60, // transfer submitted
+};
+
+typedef struct
+{
+  uint32_t timestamp; // tusb_timestamp_cb()
+  uint8_t  id;        // TU_TRACE_*
+  uint8_t  port;      // rhport (device) or device address (host)
+  uint8_t  ep_addr;
+  uint8_t  result;    // xfer_result_t, speed for bus reset
+  uint32_t len;       // transfer length, first 4 bytes for setup packet
+}tu_trace_record_t;
+
+TU_VERIFY_STATIC(sizeof(tu_trace_record_t) == 12, "size is not correct");
+
+#define TU_TRACE_MAGIC  0x52545554UL // "TUTR"
+
+// Dump the whole structure as-is for decoding
+typedef struct
+{
+  uint32_t magic;
+  uint16_t depth;
+  uint16_t record_size;
+  volatile uint32_t wr_count; // number of records ever written, record n is stored at rec[n % depth]
+  tu_trace_record_t rec[CFG_TUSB_TRACE_DEPTH];
+}tu_trace_ring_t;
+
+extern tu_trace_ring_t tu_trace_ring;
+
+// Lock-free: can be called from both ISR and task
+void tu_trace_write(uint8_t id, uint8_t port, uint8_t ep_addr, uint8_t result, uint32_t len);
+
+#define TU_TRACE(...)   tu_trace_write(__VA_ARGS__)
+
+#else
+
+#define TU_TRACE(...)
+
+#endif
+
 #ifdef __cplusplus
  }
 #endif
@@ -65,22 +65,31 @@ typedef enum
   TU_FIFO_COPY_CST_FULL_WORDS, ///< Copy from/to a constant source/destination address - required for e.g. STM32 to write into USB hardware FIFO
 } tu_fifo_copy_mode_t;
 
-bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_size, bool overwritable)
+TU_ATTR_ALWAYS_INLINE static inline tu_fifo_idx_t _ff_min(tu_fifo_idx_t x, tu_fifo_idx_t y)
+{
+  return (x < y) ? x : y;
+}
+
+bool tu_fifo_config(tu_fifo_t *f, void* buffer, tu_fifo_idx_t depth, uint16_t item_size, bool overwritable)
 {
   // Limit index space to 2*depth - this allows for a fast "modulo" calculation
-  // but limits the maximum depth to 2^16/2 = 2^15 and buffer overflows are detectable
+  // but limits the maximum depth to half of index type range (2^15, or 2^30 with 32-bit index) and buffer overflows are detectable
   // only if overflow happens once (important for unsupervised DMA applications)
-  if (depth > 0x8000) return false;
+  if (depth > TU_FIFO_DEPTH_MAX) return false;
 
   _ff_lock(f->mutex_wr);
   _ff_lock(f->mutex_rd);
 
   f->buffer       = (uint8_t*) buffer;
   f->depth        = depth;
-  f->item_size    = (uint16_t) (item_size & 0x7FFF);
+  f->item_size    = (uint16_t) (item_size & 0x3FFF);
   f->overwritable = overwritable;
+  f->pow2         = tu_is_power_of_two(depth);
   f->rd_idx       = 0;
   f->wr_idx       = 0;
+#if CFG_TUSB_FIFO_MP_WRITE
+  f->wr_rsv       = 0;
+#endif
 
   _ff_unlock(f->mutex_wr);
   _ff_unlock(f->mutex_rd);
@@ -95,12 +104,12 @@ bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_si
 // Intended to be used to read from hardware USB FIFO in e.g. STM32 where all data is read from a constant address
 // Code adapted from dcd_synopsys.c
 // TODO generalize with configurable 1 byte or 4 byte each read
-static void _ff_push_const_addr(uint8_t * ff_buf, const void * app_buf, uint16_t len)
+static void _ff_push_const_addr(uint8_t * ff_buf, const void * app_buf, uint32_t len)
 {
   volatile const uint32_t * reg_rx = (volatile const uint32_t *) app_buf;
 
   // Reading full available 32 bit words from const app address
-  uint16_t full_words = len >> 2;
+  uint32_t full_words = len >> 2;
   while(full_words--)
   {
     tu_unaligned_write32(ff_buf, *reg_rx);
@@ -118,12 +127,12 @@ static void _ff_push_const_addr(uint8_t * ff_buf, const void * app_buf, uint16_t
 
 // Intended to be used to write to hardware USB FIFO in e.g. STM32
 // where all data is written to a constant address in full word copies
-static void _ff_pull_const_addr(void * app_buf, const uint8_t * ff_buf, uint16_t len)
+static void _ff_pull_const_addr(void * app_buf, const uint8_t * ff_buf, uint32_t len)
 {
   volatile uint32_t * reg_tx = (volatile uint32_t *) app_buf;
 
   // Write full available 32 bit words to const address
-  uint16_t full_words = len >> 2;
+  uint32_t full_words = len >> 2;
   while(full_words--)
   {
     *reg_tx = tu_unaligned_read32(ff_buf);
@@ -142,19 +151,19 @@ static void _ff_pull_const_addr(void * app_buf, const uint8_t * ff_buf, uint16_t
 }
 
 // send one item to fifo WITHOUT updating write pointer
-static inline void _ff_push(tu_fifo_t* f, void const * app_buf, uint16_t rel)
+static inline void _ff_push(tu_fifo_t* f, void const * app_buf, tu_fifo_idx_t rel)
 {
   memcpy(f->buffer + (rel * f->item_size), app_buf, f->item_size);
 }
 
 // send n items to fifo WITHOUT updating write pointer
-static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t wr_ptr, tu_fifo_copy_mode_t copy_mode)
+static void _ff_push_n(tu_fifo_t* f, void const * app_buf, tu_fifo_idx_t n, tu_fifo_idx_t wr_ptr, tu_fifo_copy_mode_t copy_mode)
 {
-  uint16_t const lin_count = f->depth - wr_ptr;
-  uint16_t const wrap_count = n - lin_count;
+  tu_fifo_idx_t const lin_count = f->depth - wr_ptr;
+  tu_fifo_idx_t const wrap_count = n - lin_count;
 
-  uint16_t lin_bytes = lin_count * f->item_size;
-  uint16_t wrap_bytes = wrap_count * f->item_size;
+  uint32_t lin_bytes = lin_count * f->item_size;
+  uint32_t wrap_bytes = wrap_count * f->item_size;
 
   // current buffer of fifo
   uint8_t* ff_buf = f->buffer + (wr_ptr * f->item_size);
@@ -192,7 +201,7 @@ static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t
         // Wrap around case
 
         // Write full words to linear part of buffer
-        uint16_t nLin_4n_bytes = lin_bytes & 0xFFFC;
+        uint32_t nLin_4n_bytes = lin_bytes & ~0x03u;
         _ff_push_const_addr(ff_buf, app_buf, nLin_4n_bytes);
         ff_buf += nLin_4n_bytes;
 
@@ -202,7 +211,7 @@ static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t
         {
           volatile const uint32_t * rx_fifo = (volatile const uint32_t *) app_buf;
 
-          uint8_t remrem = (uint8_t) tu_min16(wrap_bytes, 4-rem);
+          uint8_t remrem = (uint8_t) tu_min32(wrap_bytes, 4u-rem);
           wrap_bytes -= remrem;
 
           uint32_t tmp32 = *rx_fifo;
@@ -228,19 +237,19 @@ static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t
 }
 
 // get one item from fifo WITHOUT updating read pointer
-static inline void _ff_pull(tu_fifo_t* f, void * app_buf, uint16_t rel)
+static inline void _ff_pull(tu_fifo_t* f, void * app_buf, tu_fifo_idx_t rel)
 {
   memcpy(app_buf, f->buffer + (rel * f->item_size), f->item_size);
 }
 
 // get n items from fifo WITHOUT updating read pointer
-static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rd_ptr, tu_fifo_copy_mode_t copy_mode)
+static void _ff_pull_n(tu_fifo_t* f, void* app_buf, tu_fifo_idx_t n, tu_fifo_idx_t rd_ptr, tu_fifo_copy_mode_t copy_mode)
 {
-  uint16_t const lin_count = f->depth - rd_ptr;
-  uint16_t const wrap_count = n - lin_count; // only used if wrapped
+  tu_fifo_idx_t const lin_count = f->depth - rd_ptr;
+  tu_fifo_idx_t const wrap_count = n - lin_count; // only used if wrapped
 
-  uint16_t lin_bytes = lin_count * f->item_size;
-  uint16_t wrap_bytes = wrap_count * f->item_size;
+  uint32_t lin_bytes = lin_count * f->item_size;
+  uint32_t wrap_bytes = wrap_count * f->item_size;
 
   // current buffer of fifo
   uint8_t* ff_buf = f->buffer + (rd_ptr * f->item_size);
@@ -276,7 +285,7 @@ static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rd_ptr,
         // Wrap around case
 
         // Read full words from linear part of buffer
-        uint16_t lin_4n_bytes = lin_bytes & 0xFFFC;
+        uint32_t lin_4n_bytes = lin_bytes & ~0x03u;
         _ff_pull_const_addr(app_buf, ff_buf, lin_4n_bytes);
         ff_buf += lin_4n_bytes;
 
@@ -286,7 +295,7 @@ static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rd_ptr,
         {
           volatile uint32_t * reg_tx = (volatile uint32_t *) app_buf;
 
-          uint8_t remrem = (uint8_t) tu_min16(wrap_bytes, 4-rem);
+          uint8_t remrem = (uint8_t) tu_min32(wrap_bytes, 4u-rem);
           wrap_bytes -= remrem;
 
           uint32_t tmp32=0;
@@ -321,24 +330,28 @@ static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rd_ptr,
 
 // return only the index difference and as such can be used to determine an overflow i.e overflowable count
 TU_ATTR_ALWAYS_INLINE static inline
-uint16_t _ff_count(uint16_t depth, uint16_t wr_idx, uint16_t rd_idx)
+tu_fifo_idx_t _ff_count(tu_fifo_t const* f, tu_fifo_idx_t wr_idx, tu_fifo_idx_t rd_idx)
 {
+#if CFG_TUSB_FIFO_POW2
+  if (f->pow2) return (tu_fifo_idx_t) ((wr_idx - rd_idx) & (2*f->depth - 1));
+#endif
+
   // In case we have non-power of two depth we need a further modification
   if (wr_idx >= rd_idx)
   {
-    return (uint16_t) (wr_idx - rd_idx);
+    return (tu_fifo_idx_t) (wr_idx - rd_idx);
   } else
   {
-    return (uint16_t) (2*depth - (rd_idx - wr_idx));
+    return (tu_fifo_idx_t) (2*f->depth - (rd_idx - wr_idx));
   }
 }
 
 // return remaining slot in fifo
 TU_ATTR_ALWAYS_INLINE static inline
-uint16_t _ff_remaining(uint16_t depth, uint16_t wr_idx, uint16_t rd_idx)
+tu_fifo_idx_t _ff_remaining(tu_fifo_t const* f, tu_fifo_idx_t wr_idx, tu_fifo_idx_t rd_idx)
 {
-  uint16_t const count = _ff_count(depth, wr_idx, rd_idx);
-  return (depth > count) ? (depth - count) : 0;
+  tu_fifo_idx_t const count = _ff_count(f, wr_idx, rd_idx);
+  return (f->depth > count) ? (f->depth - count) : 0;
 }
 
 //--------------------------------------------------------------------+
@@ -347,16 +360,22 @@ uint16_t _ff_remaining(uint16_t depth, uint16_t wr_idx, uint16_t rd_idx)
 
 // Advance an absolute index
 // "absolute" index is only in the range of [0..2*depth)
-static uint16_t advance_index(uint16_t depth, uint16_t idx, uint16_t offset)
+static tu_fifo_idx_t advance_index(tu_fifo_t const* f, tu_fifo_idx_t idx, tu_fifo_idx_t offset)
 {
+#if CFG_TUSB_FIFO_POW2
+  if (f->pow2) return (tu_fifo_idx_t) ((idx + offset) & (2*f->depth - 1));
+#endif
+
+  tu_fifo_idx_t const depth = f->depth;
+
   // We limit the index space of p such that a correct wrap around happens
   // Check for a wrap around or if we are in unused index space - This has to be checked first!!
   // We are exploiting the wrap around to the correct index
-  uint16_t new_idx = (uint16_t) (idx + offset);
+  tu_fifo_idx_t new_idx = (tu_fifo_idx_t) (idx + offset);
   if ( (idx > new_idx) || (new_idx >= 2*depth) )
   {
-    uint16_t const non_used_index_space = (uint16_t) (UINT16_MAX - (2*depth-1));
-    new_idx = (uint16_t) (new_idx + non_used_index_space);
+    tu_fifo_idx_t const non_used_index_space = (tu_fifo_idx_t) (TU_FIFO_IDX_MAX - (2*depth-1));
+    new_idx = (tu_fifo_idx_t) (new_idx + non_used_index_space);
   }
 
   return new_idx;
@@ -364,16 +383,16 @@ static uint16_t advance_index(uint16_t depth, uint16_t idx, uint16_t offset)
 
 #if 0 // not used but
 // Backward an absolute index
-static uint16_t backward_index(uint16_t depth, uint16_t idx, uint16_t offset)
+static tu_fifo_idx_t backward_index(tu_fifo_idx_t depth, tu_fifo_idx_t idx, tu_fifo_idx_t offset)
 {
   // We limit the index space of p such that a correct wrap around happens
   // Check for a wrap around or if we are in unused index space - This has to be checked first!!
   // We are exploiting the wrap around to the correct index
-  uint16_t new_idx = (uint16_t) (idx - offset);
+  tu_fifo_idx_t new_idx = (tu_fifo_idx_t) (idx - offset);
   if ( (idx < new_idx) || (new_idx >= 2*depth) )
   {
-    uint16_t const non_used_index_space = (uint16_t) (UINT16_MAX - (2*depth-1));
-    new_idx = (uint16_t) (new_idx - non_used_index_space);
+    tu_fifo_idx_t const non_used_index_space = (tu_fifo_idx_t) (TU_FIFO_IDX_MAX - (2*depth-1));
+    new_idx = (tu_fifo_idx_t) (new_idx - non_used_index_space);
   }
 
   return new_idx;
@@ -382,10 +401,14 @@ static uint16_t backward_index(uint16_t depth, uint16_t idx, uint16_t offset)
 
 // index to pointer, simply an modulo with minus.
 TU_ATTR_ALWAYS_INLINE static inline
-uint16_t idx2ptr(uint16_t depth, uint16_t idx)
+tu_fifo_idx_t idx2ptr(tu_fifo_t const* f, tu_fifo_idx_t idx)
 {
+#if CFG_TUSB_FIFO_POW2
+  if (f->pow2) return (tu_fifo_idx_t) (idx & (f->depth - 1));
+#endif
+
   // Only run at most 3 times since index is limit in the range of [0..2*depth)
-  while ( idx >= depth ) idx -= depth;
+  while ( idx >= f->depth ) idx -= f->depth;
   return idx;
 }
 
@@ -393,9 +416,15 @@ uint16_t idx2ptr(uint16_t depth, uint16_t idx)
 // When an overwritable fifo is overflowed, rd_idx will be re-index so that it forms
 // an full fifo i.e _ff_count() = depth
 TU_ATTR_ALWAYS_INLINE static inline
-uint16_t _ff_correct_read_index(tu_fifo_t* f, uint16_t wr_idx)
+tu_fifo_idx_t _ff_correct_read_index(tu_fifo_t* f, tu_fifo_idx_t wr_idx)
 {
-  uint16_t rd_idx;
+  tu_fifo_idx_t rd_idx;
+#if CFG_TUSB_FIFO_POW2
+  if ( f->pow2 )
+  {
+    rd_idx = (tu_fifo_idx_t) ((wr_idx + f->depth) & (2*f->depth - 1));
+  }else
+#endif
   if ( wr_idx >= f->depth )
   {
     rd_idx = wr_idx - f->depth;
@@ -411,9 +440,9 @@ uint16_t _ff_correct_read_index(tu_fifo_t* f, uint16_t wr_idx)
 
 // Works on local copies of w and r
 // Must be protected by mutexes since in case of an overflow read pointer gets modified
-static bool _tu_fifo_peek(tu_fifo_t* f, void * p_buffer, uint16_t wr_idx, uint16_t rd_idx)
+static bool _tu_fifo_peek(tu_fifo_t* f, void * p_buffer, tu_fifo_idx_t wr_idx, tu_fifo_idx_t rd_idx)
 {
-  uint16_t cnt = _ff_count(f->depth, wr_idx, rd_idx);
+  tu_fifo_idx_t cnt = _ff_count(f, wr_idx, rd_idx);
 
   // nothing to peek
   if ( cnt == 0 ) return false;
@@ -425,7 +454,7 @@ static bool _tu_fifo_peek(tu_fifo_t* f, void * p_buffer, uint16_t wr_idx, uint16
     cnt = f->depth;
   }
 
-  uint16_t rd_ptr = idx2ptr(f->depth, rd_idx);
+  tu_fifo_idx_t rd_ptr = idx2ptr(f, rd_idx);
 
   // Peek data
   _ff_pull(f, p_buffer, rd_ptr);
@@ -435,9 +464,9 @@ static bool _tu_fifo_peek(tu_fifo_t* f, void * p_buffer, uint16_t wr_idx, uint16
 
 // Works on local copies of w and r
 // Must be protected by mutexes since in case of an overflow read pointer gets modified
-static uint16_t _tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n, uint16_t wr_idx, uint16_t rd_idx, tu_fifo_copy_mode_t copy_mode)
+static tu_fifo_idx_t _tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, tu_fifo_idx_t n, tu_fifo_idx_t wr_idx, tu_fifo_idx_t rd_idx, tu_fifo_copy_mode_t copy_mode)
 {
-  uint16_t cnt = _ff_count(f->depth, wr_idx, rd_idx);
+  tu_fifo_idx_t cnt = _ff_count(f, wr_idx, rd_idx);
 
   // nothing to peek
   if ( cnt == 0 ) return 0;
@@ -452,7 +481,7 @@ static uint16_t _tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n, uint1
   // Check if we can read something at and after offset - if too less is available we read what remains
   if ( cnt < n ) n = cnt;
 
-  uint16_t rd_ptr = idx2ptr(f->depth, rd_idx);
+  tu_fifo_idx_t rd_ptr = idx2ptr(f, rd_idx);
 
   // Peek data
   _ff_pull_n(f, p_buffer, n, rd_ptr, copy_mode);
@@ -460,25 +489,25 @@ static uint16_t _tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n, uint1
   return n;
 }
 
-static uint16_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n, tu_fifo_copy_mode_t copy_mode)
+static tu_fifo_idx_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, tu_fifo_idx_t n, tu_fifo_copy_mode_t copy_mode)
 {
   if ( n == 0 ) return 0;
 
   _ff_lock(f->mutex_wr);
 
-  uint16_t wr_idx = f->wr_idx;
-  uint16_t rd_idx = f->rd_idx;
+  tu_fifo_idx_t wr_idx = f->wr_idx;
+  tu_fifo_idx_t rd_idx = f->rd_idx;
 
   uint8_t const* buf8 = (uint8_t const*) data;
 
   TU_LOG(TU_FIFO_DBG, "rd = %3u, wr = %3u, count = %3u, remain = %3u, n = %3u:  ",
-                       rd_idx, wr_idx, _ff_count(f->depth, wr_idx, rd_idx), _ff_remaining(f->depth, wr_idx, rd_idx), n);
+                       rd_idx, wr_idx, _ff_count(f, wr_idx, rd_idx), _ff_remaining(f, wr_idx, rd_idx), n);
 
   if ( !f->overwritable )
   {
     // limit up to full
-    uint16_t const remain = _ff_remaining(f->depth, wr_idx, rd_idx);
-    n = tu_min16(n, remain);
+    tu_fifo_idx_t const remain = _ff_remaining(f, wr_idx, rd_idx);
+    n = _ff_min(n, remain);
   }
   else
   {
@@ -505,13 +534,13 @@ static uint16_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n, tu
     }
     else
     {
-      uint16_t const overflowable_count = _ff_count(f->depth, wr_idx, rd_idx);
+      tu_fifo_idx_t const overflowable_count = _ff_count(f, wr_idx, rd_idx);
       if (overflowable_count + n >= 2*f->depth)
       {
         // Double overflowed
         // Index is bigger than the allowed range [0,2*depth)
         // re-position write index to have a full fifo after pushed
-        wr_idx = advance_index(f->depth, rd_idx, f->depth - n);
+        wr_idx = advance_index(f, rd_idx, f->depth - n);
 
         // TODO we should also shift out n bytes from read index since we avoid changing rd index !!
         // However memmove() is expensive due to actual copying + wrapping consideration.
@@ -529,7 +558,7 @@ static uint16_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n, tu
 
   if (n)
   {
-    uint16_t wr_ptr = idx2ptr(f->depth, wr_idx);
+    tu_fifo_idx_t wr_ptr = idx2ptr(f, wr_idx);
 
     TU_LOG(TU_FIFO_DBG, "actual_n = %u, wr_ptr = %u", n, wr_ptr);
 
@@ -537,7 +566,7 @@ static uint16_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n, tu
     _ff_push_n(f, buf8, n, wr_ptr, copy_mode);
 
     // Advance index
-    f->wr_idx = advance_index(f->depth, wr_idx, n);
+    f->wr_idx = advance_index(f, wr_idx, n);
 
     TU_LOG(TU_FIFO_DBG, "\tnew_wr = %u\n", f->wr_idx);
   }
@@ -547,7 +576,7 @@ static uint16_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n, tu
   return n;
 }
 
-static uint16_t _tu_fifo_read_n(tu_fifo_t* f, void * buffer, uint16_t n, tu_fifo_copy_mode_t copy_mode)
+static tu_fifo_idx_t _tu_fifo_read_n(tu_fifo_t* f, void * buffer, tu_fifo_idx_t n, tu_fifo_copy_mode_t copy_mode)
 {
   _ff_lock(f->mutex_rd);
 
@@ -556,7 +585,7 @@ static uint16_t _tu_fifo_read_n(tu_fifo_t* f, void * buffer, uint16_t n, tu_fifo
   n = _tu_fifo_peek_n(f, buffer, n, f->wr_idx, f->rd_idx, copy_mode);
 
   // Advance read pointer
-  f->rd_idx = advance_index(f->depth, f->rd_idx, n);
+  f->rd_idx = advance_index(f, f->rd_idx, n);
 
   _ff_unlock(f->mutex_rd);
   return n;
@@ -581,9 +610,9 @@ static uint16_t _tu_fifo_read_n(tu_fifo_t* f, void * buffer, uint16_t n, tu_fifo
     @returns Number of items in FIFO
  */
 /******************************************************************************/
-uint16_t tu_fifo_count(tu_fifo_t* f)
+tu_fifo_idx_t tu_fifo_count(tu_fifo_t* f)
 {
-  return tu_min16(_ff_count(f->depth, f->wr_idx, f->rd_idx), f->depth);
+  return _ff_min(_ff_count(f, f->wr_idx, f->rd_idx), f->depth);
 }
 
 /******************************************************************************/
@@ -619,7 +648,7 @@ bool tu_fifo_empty(tu_fifo_t* f)
 /******************************************************************************/
 bool tu_fifo_full(tu_fifo_t* f)
 {
-  return _ff_count(f->depth, f->wr_idx, f->rd_idx) >= f->depth;
+  return _ff_count(f, f->wr_idx, f->rd_idx) >= f->depth;
 }
 
 /******************************************************************************/
@@ -635,9 +664,9 @@ bool tu_fifo_full(tu_fifo_t* f)
     @returns Number of items in FIFO
  */
 /******************************************************************************/
-uint16_t tu_fifo_remaining(tu_fifo_t* f)
+tu_fifo_idx_t tu_fifo_remaining(tu_fifo_t* f)
 {
-  return _ff_remaining(f->depth, f->wr_idx, f->rd_idx);
+  return _ff_remaining(f, f->wr_idx, f->rd_idx);
 }
 
 /******************************************************************************/
@@ -663,7 +692,7 @@ uint16_t tu_fifo_remaining(tu_fifo_t* f)
 /******************************************************************************/
 bool tu_fifo_overflowed(tu_fifo_t* f)
 {
-  return _ff_count(f->depth, f->wr_idx, f->rd_idx) > f->depth;
+  return _ff_count(f, f->wr_idx, f->rd_idx) > f->depth;
 }
 
 // Only use in case tu_fifo_overflow() returned true!
@@ -699,7 +728,7 @@ bool tu_fifo_read(tu_fifo_t* f, void * buffer)
   bool ret = _tu_fifo_peek(f, buffer, f->wr_idx, f->rd_idx);
 
   // Advance pointer
-  f->rd_idx = advance_index(f->depth, f->rd_idx, ret);
+  f->rd_idx = advance_index(f, f->rd_idx, ret);
 
   _ff_unlock(f->mutex_rd);
   return ret;
@@ -721,12 +750,12 @@ bool tu_fifo_read(tu_fifo_t* f, void * buffer)
     @returns number of items read from the FIFO
  */
 /******************************************************************************/
-uint16_t tu_fifo_read_n(tu_fifo_t* f, void * buffer, uint16_t n)
+tu_fifo_idx_t tu_fifo_read_n(tu_fifo_t* f, void * buffer, tu_fifo_idx_t n)
 {
   return _tu_fifo_read_n(f, buffer, n, TU_FIFO_COPY_INC);
 }
 
-uint16_t tu_fifo_read_n_const_addr_full_words(tu_fifo_t* f, void * buffer, uint16_t n)
+tu_fifo_idx_t tu_fifo_read_n_const_addr_full_words(tu_fifo_t* f, void * buffer, tu_fifo_idx_t n)
 {
   return _tu_fifo_read_n(f, buffer, n, TU_FIFO_COPY_CST_FULL_WORDS);
 }
@@ -767,10 +796,10 @@ bool tu_fifo_peek(tu_fifo_t* f, void * p_buffer)
     @returns Number of bytes written to p_buffer
  */
 /******************************************************************************/
-uint16_t tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n)
+tu_fifo_idx_t tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, tu_fifo_idx_t n)
 {
   _ff_lock(f->mutex_rd);
-  uint16_t ret = _tu_fifo_peek_n(f, p_buffer, n, f->wr_idx, f->rd_idx, TU_FIFO_COPY_INC);
+  tu_fifo_idx_t ret = _tu_fifo_peek_n(f, p_buffer, n, f->wr_idx, f->rd_idx, TU_FIFO_COPY_INC);
   _ff_unlock(f->mutex_rd);
   return ret;
 }
@@ -796,20 +825,20 @@ bool tu_fifo_write(tu_fifo_t* f, const void * data)
   _ff_lock(f->mutex_wr);
 
   bool ret;
-  uint16_t const wr_idx = f->wr_idx;
+  tu_fifo_idx_t const wr_idx = f->wr_idx;
 
   if ( tu_fifo_full(f) && !f->overwritable )
   {
     ret = false;
   }else
   {
-    uint16_t wr_ptr = idx2ptr(f->depth, wr_idx);
+    tu_fifo_idx_t wr_ptr = idx2ptr(f, wr_idx);
 
     // Write data
     _ff_push(f, data, wr_ptr);
 
     // Advance pointer
-    f->wr_idx = advance_index(f->depth, wr_idx, 1);
+    f->wr_idx = advance_index(f, wr_idx, 1);
 
     ret = true;
   }
@@ -833,7 +862,7 @@ bool tu_fifo_write(tu_fifo_t* f, const void * data)
     @return Number of written elements
  */
 /******************************************************************************/
-uint16_t tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n)
+tu_fifo_idx_t tu_fifo_write_n(tu_fifo_t* f, const void * data, tu_fifo_idx_t n)
 {
   return _tu_fifo_write_n(f, data, n, TU_FIFO_COPY_INC);
 }
@@ -853,30 +882,134 @@ uint16_t tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n)
     @return Number of written elements
  */
 /******************************************************************************/
-uint16_t tu_fifo_write_n_const_addr_full_words(tu_fifo_t* f, const void * data, uint16_t n)
+tu_fifo_idx_t tu_fifo_write_n_const_addr_full_words(tu_fifo_t* f, const void * data, tu_fifo_idx_t n)
 {
   return _tu_fifo_write_n(f, data, n, TU_FIFO_COPY_CST_FULL_WORDS);
 }
 
+#if CFG_TUSB_FIFO_MP_WRITE
+
+#define MP_RSV_IDX(_rsv)       ((uint16_t) ((_rsv) & 0xFFFFu))
+#define MP_RSV_PENDING(_rsv)   ((_rsv) >> 16)
+#define MP_RSV_ONE_PENDING     0x10000u
+
+TU_ATTR_ALWAYS_INLINE static inline bool _ff_cas32(volatile uint32_t* ptr, uint32_t expected, uint32_t desired)
+{
+  return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool _ff_cas16(volatile uint16_t* ptr, uint16_t expected, uint16_t desired)
+{
+  return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+/******************************************************************************/
+/*!
+    @brief Lock-free write of n elements, can be called concurrently by multiple
+    writers (tasks and ISRs) without mutex. Must not be mixed with other write
+    functions on the same fifo, there is still a single reader.
+
+    Each writer reserves its slots by advancing the reserve index with CAS,
+    copies its data then commits. Write index is only advanced (to the reserve
+    index) when there is no pending writer, therefore reader never sees a
+    partially copied slot. Fifo is never overwritten, data which does not
+    fit is dropped.
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[in]  data
+                The pointer to data to add to the FIFO
+    @param[in]  n
+                Number of element
+    @return Number of written elements
+ */
+/******************************************************************************/
+tu_fifo_idx_t tu_fifo_write_n_mp(tu_fifo_t* f, const void * data, tu_fifo_idx_t n)
+{
+  if ( n == 0 ) return 0;
+
+  uint32_t rsv;
+  uint32_t new_rsv;
+  uint16_t start;
+  uint16_t count;
+
+  // Reserve
+  do
+  {
+    rsv   = f->wr_rsv;
+    start = MP_RSV_IDX(rsv);
+    count = _ff_min(n, _ff_remaining(f, start, f->rd_idx));
+
+    if ( count == 0 ) return 0;
+
+    new_rsv = (rsv + MP_RSV_ONE_PENDING - start) | advance_index(f, start, count);
+  } while ( !_ff_cas32(&f->wr_rsv, rsv, new_rsv) );
+
+  _ff_push_n(f, data, count, idx2ptr(f, start), TU_FIFO_COPY_INC);
+
+  // Commit
+  do
+  {
+    rsv     = f->wr_rsv;
+    new_rsv = rsv - MP_RSV_ONE_PENDING;
+  } while ( !_ff_cas32(&f->wr_rsv, rsv, new_rsv) );
+
+  // Publish reserve index if all writers are committed. A later writer may reserve and publish concurrently,
+  // CAS on write index makes sure it never goes backward.
+  while (1)
+  {
+    uint16_t const wr_idx = f->wr_idx;
+    rsv = f->wr_rsv;
+
+    // pending writer will publish, or already published
+    if ( MP_RSV_PENDING(rsv) || (MP_RSV_IDX(rsv) == wr_idx) ) break;
+
+    if ( _ff_cas16(&f->wr_idx, wr_idx, MP_RSV_IDX(rsv)) ) break;
+  }
+
+  return count;
+}
+
+#endif
+
 /******************************************************************************/
 /*!
     @brief Clear the fifo read and write pointers
 
+    With CFG_TUSB_FIFO_MP_WRITE, multi-producer writers do not take the write
+    mutex: clear fails if a writer is pending, otherwise fifo is emptied by
+    moving read index to write index so that reserve index is never reset
+    under a writer.
+
     @param[in]  f
                 Pointer to the FIFO buffer to manipulate
+    @return true if fifo is cleared
  */
 /******************************************************************************/
 bool tu_fifo_clear(tu_fifo_t *f)
 {
+  bool ret = true;
+
   _ff_lock(f->mutex_wr);
   _ff_lock(f->mutex_rd);
 
+#if CFG_TUSB_FIFO_MP_WRITE
+  if ( MP_RSV_PENDING(f->wr_rsv) )
+  {
+    ret = false;
+  }
+  else
+  {
+    f->rd_idx = f->wr_idx;
+  }
+#else
   f->rd_idx = 0;
   f->wr_idx = 0;
+#endif
 
   _ff_unlock(f->mutex_wr);
   _ff_unlock(f->mutex_rd);
-  return true;
+  return ret;
 }
 
 /******************************************************************************/
@@ -918,9 +1051,9 @@ bool tu_fifo_set_overwritable(tu_fifo_t *f, bool overwritable)
                 Number of items the write pointer moves forward
  */
 /******************************************************************************/
-void tu_fifo_advance_write_pointer(tu_fifo_t *f, uint16_t n)
+void tu_fifo_advance_write_pointer(tu_fifo_t *f, tu_fifo_idx_t n)
 {
-  f->wr_idx = advance_index(f->depth, f->wr_idx, n);
+  f->wr_idx = advance_index(f, f->wr_idx, n);
 }
 
 /******************************************************************************/
@@ -939,9 +1072,9 @@ void tu_fifo_advance_write_pointer(tu_fifo_t *f, uint16_t n)
                 Number of items the read pointer moves forward
  */
 /******************************************************************************/
-void tu_fifo_advance_read_pointer(tu_fifo_t *f, uint16_t n)
+void tu_fifo_advance_read_pointer(tu_fifo_t *f, tu_fifo_idx_t n)
 {
-  f->rd_idx = advance_index(f->depth, f->rd_idx, n);
+  f->rd_idx = advance_index(f, f->rd_idx, n);
 }
 
 /******************************************************************************/
@@ -962,10 +1095,10 @@ void tu_fifo_advance_read_pointer(tu_fifo_t *f, uint16_t n)
 void tu_fifo_get_read_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
 {
   // Operate on temporary values in case they change in between
-  uint16_t wr_idx = f->wr_idx;
-  uint16_t rd_idx = f->rd_idx;
+  tu_fifo_idx_t wr_idx = f->wr_idx;
+  tu_fifo_idx_t rd_idx = f->rd_idx;
 
-  uint16_t cnt = _ff_count(f->depth, wr_idx, rd_idx);
+  tu_fifo_idx_t cnt = _ff_count(f, wr_idx, rd_idx);
 
   // Check overflow and correct if required - may happen in case a DMA wrote too fast
   if (cnt > f->depth)
@@ -988,8 +1121,8 @@ void tu_fifo_get_read_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
   }
 
   // Get relative pointers
-  uint16_t wr_ptr = idx2ptr(f->depth, wr_idx);
-  uint16_t rd_ptr = idx2ptr(f->depth, rd_idx);
+  tu_fifo_idx_t wr_ptr = idx2ptr(f, wr_idx);
+  tu_fifo_idx_t rd_ptr = idx2ptr(f, rd_idx);
 
   // Copy pointer to buffer to start reading from
   info->ptr_lin = &f->buffer[rd_ptr];
@@ -1029,9 +1162,9 @@ void tu_fifo_get_read_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
 /******************************************************************************/
 void tu_fifo_get_write_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
 {
-  uint16_t wr_idx = f->wr_idx;
-  uint16_t rd_idx = f->rd_idx;
-  uint16_t remain = _ff_remaining(f->depth, wr_idx, rd_idx);
+  tu_fifo_idx_t wr_idx = f->wr_idx;
+  tu_fifo_idx_t rd_idx = f->rd_idx;
+  tu_fifo_idx_t remain = _ff_remaining(f, wr_idx, rd_idx);
 
   if (remain == 0)
   {
@@ -1043,8 +1176,8 @@ void tu_fifo_get_write_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
   }
 
   // Get relative pointers
-  uint16_t wr_ptr = idx2ptr(f->depth, wr_idx);
-  uint16_t rd_ptr = idx2ptr(f->depth, rd_idx);
+  tu_fifo_idx_t wr_ptr = idx2ptr(f, wr_idx);
+  tu_fifo_idx_t rd_ptr = idx2ptr(f, rd_idx);
 
   // Copy pointer to buffer to start writing to
   info->ptr_lin = &f->buffer[wr_ptr];
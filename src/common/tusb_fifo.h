@@ -104,18 +104,42 @@ extern "C" {
  *      | R | 1 | 2 | W | 4 | 5 |
 
  */
+// Index and item count type: 16-bit by default, 32-bit with CFG_TUSB_FIFO_IDX32 for large buffers
+#if CFG_TUSB_FIFO_IDX32
+#if CFG_TUSB_FIFO_MP_WRITE
+  #error "CFG_TUSB_FIFO_MP_WRITE requires 16-bit fifo index"
+#endif
+typedef uint32_t tu_fifo_idx_t;
+#define TU_FIFO_IDX_MAX     UINT32_MAX
+#else
+typedef uint16_t tu_fifo_idx_t;
+#define TU_FIFO_IDX_MAX     UINT16_MAX
+#endif
+
+// Index space is 2*depth. With 32-bit index 2*depth would wrap to 0 for depth 2^31, limit to 2^30
+#if CFG_TUSB_FIFO_IDX32
+#define TU_FIFO_DEPTH_MAX   ((TU_FIFO_IDX_MAX >> 2) + 1)
+#else
+#define TU_FIFO_DEPTH_MAX   ((TU_FIFO_IDX_MAX >> 1) + 1)
+#endif
+
 typedef struct
 {
   uint8_t* buffer          ; // buffer pointer
-  uint16_t depth           ; // max items
+  tu_fifo_idx_t depth      ; // max items
 
   struct TU_ATTR_PACKED {
-    uint16_t item_size : 15; // size of each item
+    uint16_t item_size : 14; // size of each item
     bool overwritable  : 1 ; // ovwerwritable when full
+    bool pow2          : 1 ; // depth is power of two, indices wrap with masks if CFG_TUSB_FIFO_POW2
   };
 
-  volatile uint16_t wr_idx ; // write index
-  volatile uint16_t rd_idx ; // read index
+  volatile tu_fifo_idx_t wr_idx ; // write index
+  volatile tu_fifo_idx_t rd_idx ; // read index
+
+#if CFG_TUSB_FIFO_MP_WRITE
+  volatile uint32_t wr_rsv ; // multi-producer reserve index (low 16-bit) and number of pending writers (high 16-bit)
+#endif
 
 #if OSAL_MUTEX_REQUIRED
   osal_mutex_t mutex_wr;
@@ -126,8 +150,8 @@ typedef struct
 
 typedef struct
 {
-  uint16_t len_lin  ; ///< linear length in item size
-  uint16_t len_wrap ; ///< wrapped length in item size
+  tu_fifo_idx_t len_lin  ; ///< linear length in item size
+  tu_fifo_idx_t len_wrap ; ///< wrapped length in item size
   void * ptr_lin    ; ///< linear part start pointer
   void * ptr_wrap   ; ///< wrapped part start pointer
 } tu_fifo_buffer_info_t;
@@ -138,6 +162,7 @@ typedef struct
   .depth                = _depth,                           \
   .item_size            = sizeof(_type),                    \
   .overwritable         = _overwritable,                    \
+  .pow2                 = (((_depth) & ((_depth) - 1)) == 0), \
 }
 
 #define TU_FIFO_DEF(_name, _depth, _type, _overwritable)                      \
@@ -147,7 +172,7 @@ typedef struct
 
 bool tu_fifo_set_overwritable(tu_fifo_t *f, bool overwritable);
 bool tu_fifo_clear(tu_fifo_t *f);
-bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_size, bool overwritable);
+bool tu_fifo_config(tu_fifo_t *f, void* buffer, tu_fifo_idx_t depth, uint16_t item_size, bool overwritable);
 
 #if OSAL_MUTEX_REQUIRED
 TU_ATTR_ALWAYS_INLINE static inline
@@ -163,34 +188,39 @@ void tu_fifo_config_mutex(tu_fifo_t *f, osal_mutex_t wr_mutex, osal_mutex_t rd_m
 
 #endif
 
-bool     tu_fifo_write                  (tu_fifo_t* f, void const * p_data);
-uint16_t tu_fifo_write_n                (tu_fifo_t* f, void const * p_data, uint16_t n);
-uint16_t tu_fifo_write_n_const_addr_full_words    (tu_fifo_t* f, const void * data, uint16_t n);
+bool          tu_fifo_write                  (tu_fifo_t* f, void const * p_data);
+tu_fifo_idx_t tu_fifo_write_n                (tu_fifo_t* f, void const * p_data, tu_fifo_idx_t n);
+tu_fifo_idx_t tu_fifo_write_n_const_addr_full_words    (tu_fifo_t* f, const void * data, tu_fifo_idx_t n);
 
-bool     tu_fifo_read                   (tu_fifo_t* f, void * p_buffer);
-uint16_t tu_fifo_read_n                 (tu_fifo_t* f, void * p_buffer, uint16_t n);
-uint16_t tu_fifo_read_n_const_addr_full_words     (tu_fifo_t* f, void * buffer, uint16_t n);
+bool          tu_fifo_read                   (tu_fifo_t* f, void * p_buffer);
+tu_fifo_idx_t tu_fifo_read_n                 (tu_fifo_t* f, void * p_buffer, tu_fifo_idx_t n);
+tu_fifo_idx_t tu_fifo_read_n_const_addr_full_words     (tu_fifo_t* f, void * buffer, tu_fifo_idx_t n);
+
+#if CFG_TUSB_FIFO_MP_WRITE
+// Lock-free write by multiple producers. Never overwrites even if fifo is overwritable: data which does not fit is dropped
+tu_fifo_idx_t tu_fifo_write_n_mp             (tu_fifo_t* f, void const * p_data, tu_fifo_idx_t n);
+#endif
 
-bool     tu_fifo_peek                   (tu_fifo_t* f, void * p_buffer);
-uint16_t tu_fifo_peek_n                 (tu_fifo_t* f, void * p_buffer, uint16_t n);
+bool          tu_fifo_peek                   (tu_fifo_t* f, void * p_buffer);
+tu_fifo_idx_t tu_fifo_peek_n                 (tu_fifo_t* f, void * p_buffer, tu_fifo_idx_t n);
 
-uint16_t tu_fifo_count                  (tu_fifo_t* f);
-uint16_t tu_fifo_remaining              (tu_fifo_t* f);
-bool     tu_fifo_empty                  (tu_fifo_t* f);
-bool     tu_fifo_full                   (tu_fifo_t* f);
-bool     tu_fifo_overflowed             (tu_fifo_t* f);
-void     tu_fifo_correct_read_pointer   (tu_fifo_t* f);
+tu_fifo_idx_t tu_fifo_count                  (tu_fifo_t* f);
+tu_fifo_idx_t tu_fifo_remaining              (tu_fifo_t* f);
+bool          tu_fifo_empty                  (tu_fifo_t* f);
+bool          tu_fifo_full                   (tu_fifo_t* f);
+bool          tu_fifo_overflowed             (tu_fifo_t* f);
+void          tu_fifo_correct_read_pointer   (tu_fifo_t* f);
 
 TU_ATTR_ALWAYS_INLINE static inline
-uint16_t tu_fifo_depth(tu_fifo_t* f)
+tu_fifo_idx_t tu_fifo_depth(tu_fifo_t* f)
 {
   return f->depth;
 }
 
 // Pointer modifications intended to be used in combinations with DMAs.
 // USE WITH CARE - NO SAFETY CHECKS CONDUCTED HERE! NOT MUTEX PROTECTED!
-void tu_fifo_advance_write_pointer(tu_fifo_t *f, uint16_t n);
-void tu_fifo_advance_read_pointer (tu_fifo_t *f, uint16_t n);
+void tu_fifo_advance_write_pointer(tu_fifo_t *f, tu_fifo_idx_t n);
+void tu_fifo_advance_read_pointer (tu_fifo_t *f, tu_fifo_idx_t n);
 
 // If you want to read/write from/to the FIFO by use of a DMA, you may need to conduct two copies
 // to handle a possible wrapping part. These functions deliver a pointer to start
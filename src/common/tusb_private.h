@@ -68,6 +68,14 @@ typedef struct {
 // Endpoint
 //--------------------------------------------------------------------+
 
+#if CFG_TUSB_EDPT_STATS
+// Timestamp a transfer for latency statistics, 0 if application does not provide timestamp
+uint32_t tu_edpt_stats_timestamp(void);
+
+// Record a completed transfer submitted at start_ts
+void tu_edpt_stats_record(tu_edpt_stats_t* stats, uint32_t start_ts, xfer_result_t result, uint32_t xferred_bytes);
+#endif
+
 // Check if endpoint descriptor is valid per USB specs
 bool tu_edpt_validate(tusb_desc_endpoint_t const * desc_ep, tusb_speed_t speed);
 
@@ -241,6 +241,26 @@ typedef enum
   XFER_RESULT_INVALID
 }xfer_result_t;
 
+// Isochronous packet descriptor. Caller sets the requested length,
+// controller driver writes back actual length and result when transfer completes.
+typedef struct
+{
+  uint16_t length;
+  uint16_t actual_length;
+  uint8_t  result; // xfer_result_t
+}tu_iso_packet_t;
+
+// Per endpoint transfer statistics (CFG_TUSB_EDPT_STATS)
+typedef struct
+{
+  uint32_t xfer_count;  // completed transfers, including failed ones
+  uint32_t byte_count;  // transferred bytes
+  uint32_t error_count; // transfers completed with failed or timeout result
+  uint32_t stall_count; // stalled transfers (host) or endpoint stalled by stack (device)
+  uint32_t latency_max; // max submit to complete latency in timestamp ticks
+  uint32_t latency_hist[CFG_TUSB_EDPT_STATS_HIST_BINS]; // see CFG_TUSB_EDPT_STATS_HIST_SHIFT
+}tu_edpt_stats_t;
+
 enum // TODO remove
 {
   DESC_OFFSET_LEN  = 0,
@@ -53,6 +53,38 @@
 // Invalid driver ID in itf2drv[] ep2drv[][] mapping
 enum { DRVID_INVALID = 0xFFu };
 
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+typedef struct
+{
+  uint8_t* buffer;
+  uint16_t total_bytes;
+}usbd_xfer_req_t;
+
+// Per endpoint transfer queue
+typedef struct
+{
+  usbd_xfer_req_t req[CFG_TUD_EDPT_XFER_QUEUE_SZ];
+  uint8_t rd_idx;
+  uint8_t count;           // requests not yet handed to DCD
+  uint8_t outstanding;     // submitted transfers whose completion is not yet delivered to class driver
+  uint8_t dropped;         // requests dropped by stall, reported as failed after completion of the one owned by DCD
+  volatile bool hw_busy;   // a transfer is currently owned by DCD
+}usbd_xfer_queue_t;
+#endif
+
+#if CFG_TUD_EDPT_XFER_FIFO_SW
+// Software fifo transfer in progress
+typedef struct
+{
+  tu_fifo_t* ff;      // NULL if endpoint is not doing a software fifo transfer
+  uint16_t lin_len;   // length of current part
+  uint16_t wrap_len;  // length of wrapped part to transfer after current part, 0 if none
+  uint16_t xferred;   // bytes transferred by completed parts
+  uint16_t rot;       // OUT: straddling packet is received at buffer start, its first rot bytes belong to buffer end
+  uint16_t mps;       // endpoint max packet size
+}usbd_xfer_fifo_t;
+#endif
+
 typedef struct
 {
   struct TU_ATTR_PACKED
@@ -71,13 +103,28 @@ typedef struct
 
   uint8_t itf2drv[CFG_TUD_INTERFACE_MAX];   // map interface number to driver (0xff is invalid)
   uint8_t ep2drv[CFG_TUD_ENDPPOINT_MAX][2]; // map endpoint to driver ( 0xff is invalid ), can use only 4-bit each
+  uint8_t ep2inst[CFG_TUD_ENDPPOINT_MAX][2]; // map endpoint to driver instance ( 0xff is invalid )
 
   tu_edpt_state_t ep_status[CFG_TUD_ENDPPOINT_MAX][2];
 
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+  usbd_xfer_queue_t xfer_q[CFG_TUD_ENDPPOINT_MAX][2];
+#endif
+
+#if CFG_TUD_EDPT_XFER_FIFO_SW
+  usbd_xfer_fifo_t xfer_ff[CFG_TUD_ENDPPOINT_MAX][2];
+#endif
+
 }usbd_device_t;
 
 static usbd_device_t _usbd_dev;
 
+#if CFG_TUSB_EDPT_STATS
+// not part of _usbd_dev to survive bus reset
+static tu_edpt_stats_t _usbd_stats[CFG_TUD_ENDPPOINT_MAX][2];
+static uint32_t _usbd_stats_ts[CFG_TUD_ENDPPOINT_MAX][2]; // submit timestamp of transfer in progress
+#endif
+
 //--------------------------------------------------------------------+
 // Class Driver
 //--------------------------------------------------------------------+
@@ -328,6 +375,36 @@ void usbd_driver_print_control_complete_name(usbd_control_xfer_cb_t callback)
 
 #endif
 
+#if CFG_TUSB_TRACE
+static void trace_dcd_event(uint8_t id_base, dcd_event_t const * event)
+{
+  uint8_t  ep_addr = 0;
+  uint8_t  result  = 0;
+  uint32_t len     = 0;
+
+  switch ( event->event_id )
+  {
+    case DCD_EVENT_BUS_RESET:
+      result = (uint8_t) event->bus_reset.speed;
+    break;
+
+    case DCD_EVENT_SETUP_RECEIVED:
+      memcpy(&len, &event->setup_received, 4);
+    break;
+
+    case DCD_EVENT_XFER_COMPLETE:
+      ep_addr = event->xfer_complete.ep_addr;
+      result  = event->xfer_complete.result;
+      len     = event->xfer_complete.len;
+    break;
+
+    default: break;
+  }
+
+  tu_trace_write((uint8_t) (id_base + event->event_id), event->rhport, ep_addr, result, len);
+}
+#endif
+
 //--------------------------------------------------------------------+
 // Application API
 //--------------------------------------------------------------------+
@@ -373,6 +450,23 @@ bool tud_connect(void)
   return true;
 }
 
+#if CFG_TUSB_EDPT_STATS
+bool tud_edpt_stats_get(uint8_t ep_addr, tu_edpt_stats_t* stats)
+{
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  TU_VERIFY(epnum < CFG_TUD_ENDPPOINT_MAX);
+
+  // completion is recorded in usbd task, copy with interrupt enabled is fine
+  *stats = _usbd_stats[epnum][tu_edpt_dir(ep_addr)];
+  return true;
+}
+
+void tud_edpt_stats_clear(void)
+{
+  tu_varclr(&_usbd_stats);
+}
+#endif
+
 //--------------------------------------------------------------------+
 // USBD Task
 //--------------------------------------------------------------------+
@@ -439,6 +533,7 @@ static void configuration_reset(uint8_t rhport)
   tu_varclr(&_usbd_dev);
   memset(_usbd_dev.itf2drv, DRVID_INVALID, sizeof(_usbd_dev.itf2drv)); // invalid mapping
   memset(_usbd_dev.ep2drv , DRVID_INVALID, sizeof(_usbd_dev.ep2drv )); // invalid mapping
+  memset(_usbd_dev.ep2inst, 0xff         , sizeof(_usbd_dev.ep2inst)); // invalid mapping
 }
 
 static void usbd_reset(uint8_t rhport)
@@ -486,6 +581,10 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr)
     dcd_event_t event;
     if ( !osal_queue_receive(_usbd_q, &event, timeout_ms) ) return;
 
+#if CFG_TUSB_TRACE
+    trace_dcd_event(TU_TRACE_USBD_EVENT, &event);
+#endif
+
 #if CFG_TUSB_DEBUG >= 2
     if (event.event_id == DCD_EVENT_SETUP_RECEIVED) TU_LOG(USBD_DBG, "\r\n"); // extra line for setup
     TU_LOG(USBD_DBG, "USBD %s ", event.event_id < DCD_EVENT_COUNT ? _usbd_event_str[event.event_id] : "CORRUPTED");
@@ -521,6 +620,10 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr)
         _usbd_dev.ep_status[0][TUSB_DIR_IN ].busy = false;
         _usbd_dev.ep_status[0][TUSB_DIR_IN ].claimed = 0;
 
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+        tu_varclr(&_usbd_dev.xfer_q[0]);
+#endif
+
         // Process control request
         if ( !process_control_request(event.rhport, &event.setup_received) )
         {
@@ -540,8 +643,27 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr)
 
         TU_LOG(USBD_DBG, "on EP %02X with %u bytes\r\n", ep_addr, (unsigned int) event.xfer_complete.len);
 
-        _usbd_dev.ep_status[epnum][ep_dir].busy = false;
-        _usbd_dev.ep_status[epnum][ep_dir].claimed = 0;
+#if CFG_TUSB_EDPT_STATS
+        tu_edpt_stats_record(&_usbd_stats[epnum][ep_dir], _usbd_stats_ts[epnum][ep_dir],
+                             (xfer_result_t) event.xfer_complete.result, event.xfer_complete.len);
+#endif
+
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+        // endpoint is still busy if there are more queued transfers
+        usbd_xfer_queue_t* xfer_q = &_usbd_dev.xfer_q[epnum][ep_dir];
+        if ( xfer_q->outstanding ) xfer_q->outstanding--;
+
+  #if CFG_TUSB_EDPT_STATS
+        // next queued transfer is measured from completion of this one
+        if ( xfer_q->outstanding ) _usbd_stats_ts[epnum][ep_dir] = tu_edpt_stats_timestamp();
+  #endif
+
+        if ( xfer_q->outstanding == 0 )
+#endif
+        {
+          _usbd_dev.ep_status[epnum][ep_dir].busy = false;
+          _usbd_dev.ep_status[epnum][ep_dir].claimed = 0;
+        }
 
         if ( 0 == epnum )
         {
@@ -1071,8 +1193,95 @@ static bool process_get_descriptor(uint8_t rhport, tusb_control_request_t const
 //--------------------------------------------------------------------+
 // DCD Event Handler
 //--------------------------------------------------------------------+
+
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+// Called when DCD completes a transfer: hand the next queued transfer (if any) to DCD immediately
+// to keep the bus busy, instead of waiting for usbd task and class driver to re-submit.
+// Return number of queued transfers rejected by DCD.
+TU_ATTR_FAST_FUNC static uint8_t edpt_xfer_queue_advance(uint8_t rhport, uint8_t ep_addr)
+{
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir   = tu_edpt_dir(ep_addr);
+  usbd_xfer_queue_t* xfer_q = &_usbd_dev.xfer_q[epnum][dir];
+
+  // requests dropped by stall follow the transfer just completed
+  uint8_t failed = xfer_q->dropped;
+  xfer_q->dropped = 0;
+  xfer_q->hw_busy = false;
+
+  while ( xfer_q->count )
+  {
+    usbd_xfer_req_t const req = xfer_q->req[xfer_q->rd_idx];
+    xfer_q->rd_idx = (uint8_t) ((xfer_q->rd_idx + 1) % CFG_TUD_EDPT_XFER_QUEUE_SZ);
+    xfer_q->count--;
+
+    xfer_q->hw_busy = true;
+    if ( dcd_edpt_xfer(rhport, ep_addr, req.buffer, req.total_bytes) ) break;
+
+    xfer_q->hw_busy = false;
+    failed++;
+  }
+
+  return failed;
+}
+#endif
+
+#if CFG_TUD_EDPT_XFER_FIFO_SW
+// Called when DCD completes a part of software fifo transfer: update fifo pointer and start the wrapped part.
+// Return false if transfer continues, otherwise event length is set to total length of the fifo transfer.
+TU_ATTR_FAST_FUNC static bool edpt_xfer_fifo_sw_complete(dcd_event_t* event)
+{
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  usbd_xfer_fifo_t* xff = &_usbd_dev.xfer_ff[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  tu_fifo_t* ff = xff->ff;
+
+  // not a software fifo transfer
+  if ( ff == NULL ) return true;
+
+  uint16_t const len = (uint16_t) event->xfer_complete.len;
+
+  if ( tu_edpt_dir(ep_addr) == TUSB_DIR_IN )
+  {
+    tu_fifo_advance_read_pointer(ff, len);
+  }else
+  {
+    if ( xff->rot )
+    {
+      // move head of straddling packet from buffer start to buffer end
+      uint16_t const head = tu_min16(len, xff->rot);
+      memcpy(ff->buffer + ff->depth - xff->rot, ff->buffer, head);
+      memmove(ff->buffer, ff->buffer + head, len - head);
+    }
+
+    tu_fifo_advance_write_pointer(ff, len);
+  }
+
+  xff->xferred = (uint16_t) (xff->xferred + len);
+
+  // continue with wrapped part if current part is completely transferred
+  if ( xff->wrap_len && (len == xff->lin_len) && (event->xfer_complete.result == XFER_RESULT_SUCCESS) )
+  {
+    xff->lin_len  = xff->wrap_len;
+    xff->wrap_len = 0;
+    xff->rot      = 0;
+
+    if ( dcd_edpt_xfer(event->rhport, ep_addr, ff->buffer, xff->lin_len) ) return false;
+  }
+
+  event->xfer_complete.len = xff->xferred;
+  xff->ff = NULL;
+
+  return true;
+}
+#endif
+
 TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const * event, bool in_isr)
 {
+#if CFG_TUSB_TRACE
+  // SOF would flood the ring
+  if ( event->event_id != DCD_EVENT_SOF ) trace_dcd_event(TU_TRACE_DCD_EVENT, event);
+#endif
+
   switch (event->event_id)
   {
     case DCD_EVENT_UNPLUGGED:
@@ -1128,6 +1337,33 @@ TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const * event, bool in_isr)
       // skip osal queue for SOF in usbd task
     break;
 
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ || CFG_TUD_EDPT_XFER_FIFO_SW
+    case DCD_EVENT_XFER_COMPLETE:
+    {
+#if CFG_TUD_EDPT_XFER_FIFO_SW
+      dcd_event_t event_ff = *event;
+      if ( !edpt_xfer_fifo_sw_complete(&event_ff) ) break;
+      event = &event_ff;
+#endif
+
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+      // Start next queued transfer before notifying usbd task to minimize turnaround on the bus
+      uint8_t failed = edpt_xfer_queue_advance(event->rhport, event->xfer_complete.ep_addr);
+      osal_queue_send(_usbd_q, event, in_isr);
+
+      // Transfers rejected by DCD are reported as failed so that class driver still gets
+      // one completion per submitted transfer, in submission order
+      dcd_event_t event_failed = *event;
+      event_failed.xfer_complete.len    = 0;
+      event_failed.xfer_complete.result = XFER_RESULT_FAILED;
+      while ( failed-- ) osal_queue_send(_usbd_q, &event_failed, in_isr);
+#else
+      osal_queue_send(_usbd_q, event, in_isr);
+#endif
+    }
+    break;
+#endif
+
     default:
       osal_queue_send(_usbd_q, event, in_isr);
     break;
@@ -1199,6 +1435,11 @@ bool usbd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * desc_ep)
   TU_ASSERT(tu_edpt_number(desc_ep->bEndpointAddress) < CFG_TUD_ENDPPOINT_MAX);
   TU_ASSERT(tu_edpt_validate(desc_ep, (tusb_speed_t) _usbd_dev.speed));
 
+#if CFG_TUD_EDPT_XFER_FIFO_SW
+  uint8_t const ep_addr = desc_ep->bEndpointAddress;
+  _usbd_dev.xfer_ff[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)].mps = tu_edpt_packet_size(desc_ep);
+#endif
+
   return dcd_edpt_open(rhport, desc_ep);
 }
 
@@ -1227,6 +1468,25 @@ bool usbd_edpt_release(uint8_t rhport, uint8_t ep_addr)
   return tu_edpt_release(ep_state, _usbd_mutex);
 }
 
+void usbd_edpt_bind_instance(uint8_t rhport, uint8_t ep_addr, uint8_t instance)
+{
+  (void) rhport;
+
+  // endpoint not used by driver e.g unused direction of an endpoint pair
+  if ( ep_addr == 0 ) return;
+
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  TU_ASSERT(epnum < CFG_TUD_ENDPPOINT_MAX, );
+
+  _usbd_dev.ep2inst[epnum][tu_edpt_dir(ep_addr)] = instance;
+}
+
+uint8_t usbd_edpt_instance(uint8_t rhport, uint8_t ep_addr)
+{
+  (void) rhport;
+  return _usbd_dev.ep2inst[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+}
+
 bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes)
 {
   rhport = _usbd_rhport;
@@ -1238,6 +1498,7 @@ bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t
   // TU_VERIFY(tud_ready());
 
   TU_LOG(USBD_DBG, "  Queue EP %02X with %u bytes ...\r\n", ep_addr, total_bytes);
+  TU_TRACE(TU_TRACE_USBD_XFER, rhport, ep_addr, 0, total_bytes);
 
   // Attempt to transfer on a busy endpoint, sound like an race condition !
   TU_ASSERT(_usbd_dev.ep_status[epnum][dir].busy == 0);
@@ -1246,12 +1507,29 @@ bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t
   // could return and USBD task can preempt and clear the busy
   _usbd_dev.ep_status[epnum][dir].busy = true;
 
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+  _usbd_dev.xfer_q[epnum][dir].outstanding = 1;
+  _usbd_dev.xfer_q[epnum][dir].hw_busy = true;
+#endif
+
+#if CFG_TUD_EDPT_XFER_FIFO_SW
+  _usbd_dev.xfer_ff[epnum][dir].ff = NULL;
+#endif
+
+#if CFG_TUSB_EDPT_STATS
+  _usbd_stats_ts[epnum][dir] = tu_edpt_stats_timestamp();
+#endif
+
   if ( dcd_edpt_xfer(rhport, ep_addr, buffer, total_bytes) )
   {
     return true;
   }else
   {
     // DCD error, mark endpoint as ready to allow next transfer
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+    _usbd_dev.xfer_q[epnum][dir].outstanding = 0;
+    _usbd_dev.xfer_q[epnum][dir].hw_busy = false;
+#endif
     _usbd_dev.ep_status[epnum][dir].busy = false;
     _usbd_dev.ep_status[epnum][dir].claimed = 0;
     TU_LOG(USBD_DBG, "FAILED\r\n");
@@ -1260,6 +1538,81 @@ bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t
   }
 }
 
+#if CFG_TUD_EDPT_XFER_FIFO_SW
+// Transfer fifo with dcd_edpt_xfer() directly from/to its buffer. The linear part is transferred first, the wrapped
+// part is started by edpt_xfer_fifo_sw_complete(). Splitting is only done at packet boundary, otherwise host would
+// see a short packet (IN) or a packet would be split between buffer end and start (OUT).
+static bool edpt_xfer_fifo_sw(uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16_t total_bytes)
+{
+  // software transfer works on bytes
+  TU_ASSERT(ff->item_size == 1);
+
+  usbd_xfer_fifo_t* xff = &_usbd_dev.xfer_ff[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  uint16_t const mps = xff->mps;
+  TU_ASSERT(mps);
+
+  tu_fifo_buffer_info_t info;
+  uint8_t* buf;
+
+  xff->xferred  = 0;
+  xff->wrap_len = 0;
+  xff->rot      = 0;
+
+  if ( tu_edpt_dir(ep_addr) == TUSB_DIR_IN )
+  {
+    tu_fifo_get_read_info(ff, &info);
+    total_bytes = (uint16_t) tu_min32(total_bytes, (uint32_t) info.len_lin + info.len_wrap);
+    buf = (uint8_t*) info.ptr_lin;
+
+    if ( total_bytes > info.len_lin )
+    {
+      if ( info.len_lin % mps == 0 )
+      {
+        xff->wrap_len = (uint16_t) (total_bytes - info.len_lin);
+      }
+      // else: short transfer with linear part, remaining data is sent by next transfer
+      total_bytes = info.len_lin;
+    }
+  }else
+  {
+    tu_fifo_get_write_info(ff, &info);
+    buf = (uint8_t*) info.ptr_lin;
+
+    if ( total_bytes > info.len_lin )
+    {
+      uint16_t const rem = info.len_lin % mps;
+
+      if ( rem == 0 )
+      {
+        xff->wrap_len = tu_min16((uint16_t) (total_bytes - info.len_lin), info.len_wrap);
+        total_bytes = info.len_lin;
+      }
+      else if ( info.len_lin > mps )
+      {
+        // receive whole packets only, remaining space is used by next transfer
+        total_bytes = (uint16_t) (info.len_lin - rem);
+      }
+      else
+      {
+        // packet straddles buffer end: receive it at buffer start and move its head to the end on completion
+        TU_VERIFY(info.len_wrap >= mps);
+        xff->rot = info.len_lin;
+        buf = ff->buffer;
+        total_bytes = mps;
+      }
+    }
+  }
+
+  xff->lin_len = total_bytes;
+  xff->ff      = ff;
+
+  if ( dcd_edpt_xfer(rhport, ep_addr, buf, total_bytes) ) return true;
+
+  xff->ff = NULL;
+  return false;
+}
+#endif
+
 // The number of bytes has to be given explicitly to allow more flexible control of how many
 // bytes should be written and second to keep the return value free to give back a boolean
 // success message. If total_bytes is too big, the FIFO will copy only what is available
@@ -1272,6 +1625,7 @@ bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16
   uint8_t const dir   = tu_edpt_dir(ep_addr);
 
   TU_LOG(USBD_DBG, "  Queue ISO EP %02X with %u bytes ... ", ep_addr, total_bytes);
+  TU_TRACE(TU_TRACE_USBD_XFER, rhport, ep_addr, 0, total_bytes);
 
   // Attempt to transfer on a busy endpoint, sound like an race condition !
   TU_ASSERT(_usbd_dev.ep_status[epnum][dir].busy == 0);
@@ -1280,13 +1634,34 @@ bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16
   // and usbd task can preempt and clear the busy
   _usbd_dev.ep_status[epnum][dir].busy = true;
 
-  if (dcd_edpt_xfer_fifo(rhport, ep_addr, ff, total_bytes))
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+  _usbd_dev.xfer_q[epnum][dir].outstanding = 1;
+  _usbd_dev.xfer_q[epnum][dir].hw_busy = true;
+#endif
+
+#if CFG_TUSB_EDPT_STATS
+  _usbd_stats_ts[epnum][dir] = tu_edpt_stats_timestamp();
+#endif
+
+#if CFG_TUD_EDPT_XFER_FIFO_SW
+  bool const xfer_ok = dcd_edpt_xfer_fifo ? dcd_edpt_xfer_fifo(rhport, ep_addr, ff, total_bytes) :
+                                            edpt_xfer_fifo_sw(rhport, ep_addr, ff, total_bytes);
+#else
+  TU_ASSERT(dcd_edpt_xfer_fifo);
+  bool const xfer_ok = dcd_edpt_xfer_fifo(rhport, ep_addr, ff, total_bytes);
+#endif
+
+  if (xfer_ok)
   {
     TU_LOG(USBD_DBG, "OK\r\n");
     return true;
   }else
   {
     // DCD error, mark endpoint as ready to allow next transfer
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+    _usbd_dev.xfer_q[epnum][dir].outstanding = 0;
+    _usbd_dev.xfer_q[epnum][dir].hw_busy = false;
+#endif
     _usbd_dev.ep_status[epnum][dir].busy = false;
     _usbd_dev.ep_status[epnum][dir].claimed = 0;
     TU_LOG(USBD_DBG, "failed\r\n");
@@ -1295,6 +1670,107 @@ bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16
   }
 }
 
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+
+bool usbd_edpt_xfer_queue(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes)
+{
+  rhport = _usbd_rhport;
+
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir   = tu_edpt_dir(ep_addr);
+  usbd_xfer_queue_t* xfer_q = &_usbd_dev.xfer_q[epnum][dir];
+
+  // control endpoint is managed by usbd control transfer
+  TU_ASSERT(epnum != 0);
+  TU_VERIFY(!_usbd_dev.ep_status[epnum][dir].stalled);
+
+  TU_LOG(USBD_DBG, "  Queue EP %02X with %u bytes (%u pending)\r\n", ep_addr, total_bytes, xfer_q->count);
+  TU_TRACE(TU_TRACE_USBD_XFER, rhport, ep_addr, 0, total_bytes);
+
+  bool ret = true;
+
+  // DCD completion can advance the queue in ISR
+  usbd_int_set(false);
+
+  // Set busy first since the actual transfer can be complete before dcd_edpt_xfer()
+  // could return and USBD task can preempt and clear the busy
+  _usbd_dev.ep_status[epnum][dir].busy = true;
+
+  if ( xfer_q->hw_busy )
+  {
+    // DCD is transferring, append to queue to be started right at completion of the current one
+    if ( xfer_q->count < CFG_TUD_EDPT_XFER_QUEUE_SZ )
+    {
+      uint8_t const wr_idx = (uint8_t) ((xfer_q->rd_idx + xfer_q->count) % CFG_TUD_EDPT_XFER_QUEUE_SZ);
+      xfer_q->req[wr_idx].buffer      = buffer;
+      xfer_q->req[wr_idx].total_bytes = total_bytes;
+      xfer_q->count++;
+      xfer_q->outstanding++;
+    }else
+    {
+      ret = false;
+    }
+  }
+  else
+  {
+    // DCD is idle, submit right away
+#if CFG_TUSB_EDPT_STATS
+    // otherwise timestamp is taken when previous transfer completion is delivered
+    if ( xfer_q->outstanding == 0 ) _usbd_stats_ts[epnum][dir] = tu_edpt_stats_timestamp();
+#endif
+
+    xfer_q->hw_busy = true;
+    xfer_q->outstanding++;
+
+    ret = dcd_edpt_xfer(rhport, ep_addr, buffer, total_bytes);
+    if ( !ret )
+    {
+      xfer_q->hw_busy = false;
+      xfer_q->outstanding--;
+      TU_BREAKPOINT();
+    }
+  }
+
+  // DCD error or queue full: endpoint is ready only if nothing else is outstanding
+  if ( xfer_q->outstanding == 0 )
+  {
+    _usbd_dev.ep_status[epnum][dir].busy = false;
+    _usbd_dev.ep_status[epnum][dir].claimed = 0;
+  }
+
+  usbd_int_set(true);
+
+  return ret;
+}
+
+uint8_t usbd_edpt_xfer_queue_available(uint8_t rhport, uint8_t ep_addr)
+{
+  (void) rhport;
+
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir   = tu_edpt_dir(ep_addr);
+  usbd_xfer_queue_t const* xfer_q = &_usbd_dev.xfer_q[epnum][dir];
+
+  // one more if DCD is idle since the transfer is submitted right away
+  return (uint8_t) (CFG_TUD_EDPT_XFER_QUEUE_SZ - xfer_q->count + (xfer_q->hw_busy ? 0 : 1));
+}
+
+#else
+
+bool usbd_edpt_xfer_queue(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes)
+{
+  // no queue, only one transfer at a time
+  TU_VERIFY(!usbd_edpt_busy(rhport, ep_addr));
+  return usbd_edpt_xfer(rhport, ep_addr, buffer, total_bytes);
+}
+
+uint8_t usbd_edpt_xfer_queue_available(uint8_t rhport, uint8_t ep_addr)
+{
+  return usbd_edpt_busy(rhport, ep_addr) ? 0 : 1;
+}
+
+#endif
+
 bool usbd_edpt_busy(uint8_t rhport, uint8_t ep_addr)
 {
   (void) rhport;
@@ -1305,6 +1781,51 @@ bool usbd_edpt_busy(uint8_t rhport, uint8_t ep_addr)
   return _usbd_dev.ep_status[epnum][dir].busy;
 }
 
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+// Report transfers dropped from queue as failed, class driver still gets one completion per submitted transfer
+static void edpt_xfer_queue_report_dropped(uint8_t rhport, uint8_t ep_addr, uint8_t dropped)
+{
+  dcd_event_t event =
+  {
+    .rhport   = rhport,
+    .event_id = DCD_EVENT_XFER_COMPLETE,
+  };
+  event.xfer_complete.ep_addr = ep_addr;
+  event.xfer_complete.len     = 0;
+  event.xfer_complete.result  = XFER_RESULT_FAILED;
+
+  while ( dropped-- ) osal_queue_send(_usbd_q, &event, false);
+}
+
+// Endpoint is stalled: drop requests not yet handed to DCD. The transfer owned by DCD is left to DCD,
+// dropped requests are reported after its completion to keep submission order.
+static void edpt_xfer_queue_drop(uint8_t ep_addr)
+{
+  usbd_xfer_queue_t* xfer_q = &_usbd_dev.xfer_q[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+
+  // DCD completion can advance the queue in ISR
+  usbd_int_set(false);
+  xfer_q->dropped = (uint8_t) (xfer_q->dropped + xfer_q->count);
+  xfer_q->count   = 0;
+  usbd_int_set(true);
+}
+
+// Stall is cleared or endpoint is closed: endpoint is idle from now on, same as with usbd_edpt_xfer(), since
+// DCD may have aborted its transfer without completion. Dropped requests not reported yet are reported now.
+static void edpt_xfer_queue_reset(uint8_t rhport, uint8_t ep_addr)
+{
+  usbd_xfer_queue_t* xfer_q = &_usbd_dev.xfer_q[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+
+  usbd_int_set(false);
+  uint8_t const dropped = (uint8_t) (xfer_q->dropped + xfer_q->count);
+  tu_varclr(xfer_q);
+  xfer_q->outstanding = dropped; // failed completions to be delivered
+  usbd_int_set(true);
+
+  edpt_xfer_queue_report_dropped(rhport, ep_addr, dropped);
+}
+#endif
+
 void usbd_edpt_stall(uint8_t rhport, uint8_t ep_addr)
 {
   rhport = _usbd_rhport;
@@ -1316,9 +1837,18 @@ void usbd_edpt_stall(uint8_t rhport, uint8_t ep_addr)
   if ( !_usbd_dev.ep_status[epnum][dir].stalled )
   {
     TU_LOG(USBD_DBG, "    Stall EP %02X\r\n", ep_addr);
+    TU_TRACE(TU_TRACE_USBD_STALL, rhport, ep_addr, 0, 0);
     dcd_edpt_stall(rhport, ep_addr);
     _usbd_dev.ep_status[epnum][dir].stalled = true;
     _usbd_dev.ep_status[epnum][dir].busy = true;
+
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+    if ( epnum ) edpt_xfer_queue_drop(ep_addr);
+#endif
+
+#if CFG_TUSB_EDPT_STATS
+    _usbd_stats[epnum][dir].stall_count++;
+#endif
   }
 }
 
@@ -1336,6 +1866,10 @@ void usbd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
     dcd_edpt_clear_stall(rhport, ep_addr);
     _usbd_dev.ep_status[epnum][dir].stalled = false;
     _usbd_dev.ep_status[epnum][dir].busy = false;
+
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+    if ( epnum ) edpt_xfer_queue_reset(rhport, ep_addr);
+#endif
   }
 }
 
@@ -1370,6 +1904,10 @@ void usbd_edpt_close(uint8_t rhport, uint8_t ep_addr)
   _usbd_dev.ep_status[epnum][dir].busy = false;
   _usbd_dev.ep_status[epnum][dir].claimed = false;
 
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+  edpt_xfer_queue_reset(rhport, ep_addr);
+#endif
+
   return;
 }
 
@@ -104,6 +104,14 @@ bool tud_control_xfer(uint8_t rhport, tusb_control_request_t const * request, vo
 // Send STATUS (zero length) packet
 bool tud_control_status(uint8_t rhport, tusb_control_request_t const * request);
 
+#if CFG_TUSB_EDPT_STATS
+// Get transfer statistics of an endpoint. Statistics are kept across bus reset and re-configuration
+bool tud_edpt_stats_get(uint8_t ep_addr, tu_edpt_stats_t* stats);
+
+// Clear statistics of all endpoints
+void tud_edpt_stats_clear(void);
+#endif
+
 //--------------------------------------------------------------------+
 // Application Callbacks (WEAK is optional)
 //--------------------------------------------------------------------+
@@ -71,12 +71,28 @@ bool usbd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * desc_ep);
 // Close an endpoint
 void usbd_edpt_close(uint8_t rhport, uint8_t ep_addr);
 
+// Bind endpoint to driver instance (e.g interface index) so that xfer_cb() can get it with usbd_edpt_instance()
+// instead of searching all instances. Endpoint address 0 (unused direction of a pair) is ignored.
+void usbd_edpt_bind_instance(uint8_t rhport, uint8_t ep_addr, uint8_t instance);
+
+// Driver instance bound to endpoint, 0xff if none
+uint8_t usbd_edpt_instance(uint8_t rhport, uint8_t ep_addr);
+
 // Submit a usb transfer
 bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes);
 
 // Submit a usb ISO transfer by use of a FIFO (ring buffer) - all bytes in FIFO get transmitted
 bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16_t total_bytes);
 
+// Submit a usb transfer even if endpoint is busy: it is queued and handed to DCD right at completion of
+// previous transfers. Completions are delivered to xfer_cb() in order, one per submitted transfer.
+// Queue depth is CFG_TUD_EDPT_XFER_QUEUE_SZ, return false if queue is full. Not for control endpoint.
+// Queued transfers not yet handed to DCD when endpoint is stalled or closed are completed as failed with 0 byte.
+bool usbd_edpt_xfer_queue(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes);
+
+// Number of transfers that can be submitted with usbd_edpt_xfer_queue() at the moment
+uint8_t usbd_edpt_xfer_queue_available(uint8_t rhport, uint8_t ep_addr);
+
 // Claim an endpoint before submitting a transfer.
 // If caller does not make any transfer, it must release endpoint for others.
 bool usbd_edpt_claim(uint8_t rhport, uint8_t ep_addr);
@@ -159,6 +159,14 @@ bool hcd_setup_send(uint8_t rhport, uint8_t dev_addr, uint8_t const setup_packet
 // clear stall, data toggle is also reset to DATA0
 bool hcd_edpt_clear_stall(uint8_t dev_addr, uint8_t ep_addr);
 
+// optional: submit an isochronous transfer of num_packets packets, one per endpoint interval.
+// Packets are laid out back to back in buffer. When all packets are done, per-packet actual length
+// and result are written to packets[] and hcd_event_xfer_complete() is invoked with the total bytes.
+// A transfer can be submitted while another one is in progress on the endpoint, it is then scheduled
+// right after it. Return false if the HCD can not queue more transfers.
+bool hcd_edpt_iso_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer,
+                       tu_iso_packet_t* packets, uint16_t num_packets) TU_ATTR_WEAK;
+
 //--------------------------------------------------------------------+
 // USBH implemented API
 //--------------------------------------------------------------------+
@@ -116,6 +116,11 @@ typedef struct {
   }ep_callback[CFG_TUH_ENDPOINT_MAX][2];
 #endif
 
+#if CFG_TUSB_EDPT_STATS
+  tu_edpt_stats_t stats[CFG_TUH_ENDPOINT_MAX][2];
+  uint32_t stats_ts[CFG_TUH_ENDPOINT_MAX][2]; // submit timestamp of transfer in progress
+#endif
+
 } usbh_device_t;
 
 //--------------------------------------------------------------------+
@@ -368,6 +373,17 @@ bool tuh_init(uint8_t controller_id)
   return true;
 }
 
+#if CFG_TUSB_TRACE
+static void trace_hcd_event(uint8_t id_base, hcd_event_t const* event)
+{
+  bool const is_xfer = (event->event_id == HCD_EVENT_XFER_COMPLETE);
+
+  tu_trace_write((uint8_t) (id_base + event->event_id), is_xfer ? event->dev_addr : event->rhport,
+                 is_xfer ? event->xfer_complete.ep_addr : 0, is_xfer ? event->xfer_complete.result : 0,
+                 is_xfer ? event->xfer_complete.len : 0);
+}
+#endif
+
 /* USB Host Driver task
  * This top level thread manages all host controller event and delegates events to class-specific drivers.
  * This should be called periodically within the mainloop or rtos thread.
@@ -399,6 +415,10 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr)
     hcd_event_t event;
     if ( !osal_queue_receive(_usbh_q, &event, timeout_ms) ) return;
 
+#if CFG_TUSB_TRACE
+    trace_hcd_event(TU_TRACE_USBH_EVENT, &event);
+#endif
+
     switch (event.event_id)
     {
       case HCD_EVENT_DEVICE_ATTACH:
@@ -449,6 +469,11 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr)
             usbh_control_xfer_cb(event.dev_addr, ep_addr, event.xfer_complete.result, event.xfer_complete.len);
           }else
           {
+#if CFG_TUSB_EDPT_STATS
+            tu_edpt_stats_record(&dev->stats[epnum][ep_dir], dev->stats_ts[epnum][ep_dir],
+                                 event.xfer_complete.result, event.xfer_complete.len);
+#endif
+
             uint8_t drv_id = dev->ep2drv[epnum][ep_dir];
             if(drv_id < USBH_CLASS_DRIVER_COUNT)
             {
@@ -766,6 +791,7 @@ bool usbh_edpt_xfer_with_callback(uint8_t dev_addr, uint8_t ep_addr, uint8_t * b
   tu_edpt_state_t* ep_state = &dev->ep_status[epnum][dir];
 
   TU_LOG_USBH("  Queue EP %02X with %u bytes ... ", ep_addr, total_bytes);
+  TU_TRACE(TU_TRACE_USBH_XFER, dev_addr, ep_addr, 0, total_bytes);
 
   // Attempt to transfer on a busy endpoint, sound like an race condition !
   TU_ASSERT(ep_state->busy == 0);
@@ -779,6 +805,10 @@ bool usbh_edpt_xfer_with_callback(uint8_t dev_addr, uint8_t ep_addr, uint8_t * b
   dev->ep_callback[epnum][dir].user_data   = user_data;
 #endif
 
+#if CFG_TUSB_EDPT_STATS
+  dev->stats_ts[epnum][dir] = tu_edpt_stats_timestamp();
+#endif
+
   if ( hcd_edpt_xfer(dev->rhport, dev_addr, ep_addr, buffer, total_bytes) )
   {
     TU_LOG_USBH("OK\r\n");
@@ -794,6 +824,49 @@ bool usbh_edpt_xfer_with_callback(uint8_t dev_addr, uint8_t ep_addr, uint8_t * b
   }
 }
 
+bool usbh_edpt_iso_xfer(uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer, tu_iso_packet_t* packets, uint16_t num_packets)
+{
+  // HCD does not support isochronous transfer
+  TU_VERIFY(hcd_edpt_iso_xfer);
+
+  usbh_device_t* dev = get_device(dev_addr);
+  TU_VERIFY(dev && num_packets);
+
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir   = tu_edpt_dir(ep_addr);
+  tu_edpt_state_t* ep_state = &dev->ep_status[epnum][dir];
+
+  TU_LOG_USBH("  Queue ISO EP %02X with %u packets ... ", ep_addr, num_packets);
+
+  // HCD may accept a transfer queued behind the one in progress for continuous streaming
+  bool const was_busy = ep_state->busy;
+  ep_state->busy = 1;
+
+#if CFG_TUH_API_EDPT_XFER
+  dev->ep_callback[epnum][dir].complete_cb = NULL;
+  dev->ep_callback[epnum][dir].user_data   = 0;
+#endif
+
+#if CFG_TUSB_EDPT_STATS
+  if ( !was_busy ) dev->stats_ts[epnum][dir] = tu_edpt_stats_timestamp();
+#endif
+
+  if ( hcd_edpt_iso_xfer(dev->rhport, dev_addr, ep_addr, buffer, packets, num_packets) )
+  {
+    TU_LOG_USBH("OK\r\n");
+    return true;
+  }else
+  {
+    if ( !was_busy )
+    {
+      ep_state->busy    = 0;
+      ep_state->claimed = 0;
+    }
+    TU_LOG1("Failed\r\n");
+    return false;
+  }
+}
+
 static bool usbh_edpt_control_open(uint8_t dev_addr, uint8_t max_packet_size)
 {
   TU_LOG_USBH("[%u:%u] Open EP0 with Size = %u\r\n", usbh_get_rhport(dev_addr), dev_addr, max_packet_size);
@@ -818,6 +891,20 @@ bool tuh_edpt_open(uint8_t dev_addr, tusb_desc_endpoint_t const * desc_ep)
   return hcd_edpt_open(usbh_get_rhport(dev_addr), dev_addr, desc_ep);
 }
 
+#if CFG_TUSB_EDPT_STATS
+bool tuh_edpt_stats_get(uint8_t daddr, uint8_t ep_addr, tu_edpt_stats_t* stats)
+{
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  TU_VERIFY(epnum < CFG_TUH_ENDPOINT_MAX);
+
+  usbh_device_t const* dev = get_device(daddr);
+  TU_VERIFY(dev);
+
+  *stats = dev->stats[epnum][tu_edpt_dir(ep_addr)];
+  return true;
+}
+#endif
+
 bool usbh_edpt_busy(uint8_t dev_addr, uint8_t ep_addr)
 {
   uint8_t const epnum = tu_edpt_number(ep_addr);
@@ -854,6 +941,10 @@ void hcd_devtree_get_info(uint8_t dev_addr, hcd_devtree_info_t* devtree_info)
 
 TU_ATTR_FAST_FUNC void hcd_event_handler(hcd_event_t const* event, bool in_isr)
 {
+#if CFG_TUSB_TRACE
+  trace_hcd_event(TU_TRACE_HCD_EVENT, event);
+#endif
+
   switch (event->event_id)
   {
     default:
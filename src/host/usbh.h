@@ -165,6 +165,11 @@ bool tuh_edpt_xfer(tuh_xfer_t* xfer);
 // Open an non-control endpoint
 bool tuh_edpt_open(uint8_t dev_addr, tusb_desc_endpoint_t const * desc_ep);
 
+#if CFG_TUSB_EDPT_STATS
+// Get transfer statistics of a non-control endpoint. Statistics are cleared when device is removed
+bool tuh_edpt_stats_get(uint8_t daddr, uint8_t ep_addr, tu_edpt_stats_t* stats);
+#endif
+
 // Set Configuration (control transfer)
 // config_num = 0 will un-configure device. Note: config_num = config_descriptor_index + 1
 // true on success, false if there is on-going control transfer or incorrect parameters
@@ -79,6 +79,12 @@ static inline bool usbh_edpt_xfer(uint8_t dev_addr, uint8_t ep_addr, uint8_t * b
 }
 
 
+// Submit an isochronous transfer of num_packets, require HCD support.
+// Per-packet actual length and result are written back to packets[] on completion
+// Can be called while a transfer is in progress to queue the next one back to back, if HCD supports it
+bool usbh_edpt_iso_xfer(uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer, tu_iso_packet_t* packets, uint16_t num_packets);
+
+
 // Claim an endpoint before submitting a transfer.
 // If caller does not make any transfer, it must release endpoint for others.
 bool usbh_edpt_claim(uint8_t dev_addr, uint8_t ep_addr);
@@ -0,0 +1,251 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2023, Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_OSAL_POSIX_H_
+#define _TUSB_OSAL_POSIX_H_
+
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// POSIX threads port, mostly for running and stress-testing the stack on a host machine. USB "interrupt" is
+// expected to be a separate thread calling dcd/hcd event handler with in_isr = true, which is treated the same
+// as a normal thread here.
+
+//--------------------------------------------------------------------+
+// TASK API
+//--------------------------------------------------------------------+
+
+// Absolute time msec from now, for timed wait
+TU_ATTR_ALWAYS_INLINE static inline void _osal_abstime(clockid_t clk, struct timespec* ts, uint32_t msec)
+{
+  clock_gettime(clk, ts);
+  ts->tv_sec  += (time_t) (msec / 1000);
+  ts->tv_nsec += (long) ((msec % 1000) * 1000000UL);
+  if ( ts->tv_nsec >= 1000000000L )
+  {
+    ts->tv_sec++;
+    ts->tv_nsec -= 1000000000L;
+  }
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void osal_task_delay(uint32_t msec)
+{
+  struct timespec ts = { .tv_sec = (time_t) (msec / 1000), .tv_nsec = (long) ((msec % 1000) * 1000000UL) };
+  while ( nanosleep(&ts, &ts) && (errno == EINTR) ) {}
+}
+
+// Condition variable use monotonic clock so that timeout is not affected by system time change
+TU_ATTR_ALWAYS_INLINE static inline void _osal_cond_init(pthread_cond_t* cond)
+{
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(cond, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+// Wait on condition with mutex locked, return false if timed out
+TU_ATTR_ALWAYS_INLINE static inline bool _osal_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex,
+                                                         struct timespec const* abstime)
+{
+  if ( abstime == NULL ) return 0 == pthread_cond_wait(cond, mutex);
+  return ETIMEDOUT != pthread_cond_timedwait(cond, mutex, abstime);
+}
+
+//--------------------------------------------------------------------+
+// Semaphore API
+//--------------------------------------------------------------------+
+typedef struct
+{
+  pthread_mutex_t mutex;
+  pthread_cond_t  cond;
+  uint32_t        count;
+}osal_semaphore_def_t;
+
+typedef osal_semaphore_def_t* osal_semaphore_t;
+
+TU_ATTR_ALWAYS_INLINE static inline osal_semaphore_t osal_semaphore_create(osal_semaphore_def_t* semdef)
+{
+  pthread_mutex_init(&semdef->mutex, NULL);
+  _osal_cond_init(&semdef->cond);
+  semdef->count = 0;
+  return semdef;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_semaphore_post(osal_semaphore_t sem_hdl, bool in_isr)
+{
+  (void) in_isr;
+
+  pthread_mutex_lock(&sem_hdl->mutex);
+  sem_hdl->count++;
+  pthread_cond_signal(&sem_hdl->cond);
+  pthread_mutex_unlock(&sem_hdl->mutex);
+
+  return true;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_semaphore_wait (osal_semaphore_t sem_hdl, uint32_t msec)
+{
+  struct timespec abstime;
+  if ( msec != OSAL_TIMEOUT_WAIT_FOREVER ) _osal_abstime(CLOCK_MONOTONIC, &abstime, msec);
+
+  pthread_mutex_lock(&sem_hdl->mutex);
+
+  bool success = true;
+  while ( success && (sem_hdl->count == 0) )
+  {
+    success = _osal_cond_wait(&sem_hdl->cond, &sem_hdl->mutex,
+                              (msec == OSAL_TIMEOUT_WAIT_FOREVER) ? NULL : &abstime);
+  }
+
+  // signaled right at timeout is still taken
+  success = (sem_hdl->count > 0);
+  if ( success ) sem_hdl->count--;
+
+  pthread_mutex_unlock(&sem_hdl->mutex);
+
+  return success;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void osal_semaphore_reset(osal_semaphore_t sem_hdl)
+{
+  pthread_mutex_lock(&sem_hdl->mutex);
+  sem_hdl->count = 0;
+  pthread_mutex_unlock(&sem_hdl->mutex);
+}
+
+//--------------------------------------------------------------------+
+// MUTEX API
+// Within tinyusb, mutex is never used in ISR context
+//--------------------------------------------------------------------+
+typedef pthread_mutex_t osal_mutex_def_t, *osal_mutex_t;
+
+TU_ATTR_ALWAYS_INLINE static inline osal_mutex_t osal_mutex_create(osal_mutex_def_t* mdef)
+{
+  pthread_mutex_init(mdef, NULL);
+  return mdef;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_mutex_lock (osal_mutex_t mutex_hdl, uint32_t msec)
+{
+  if ( msec == OSAL_TIMEOUT_WAIT_FOREVER ) return 0 == pthread_mutex_lock(mutex_hdl);
+
+  // pthread_mutex_timedlock() only supports realtime clock
+  struct timespec abstime;
+  _osal_abstime(CLOCK_REALTIME, &abstime, msec);
+
+  return 0 == pthread_mutex_timedlock(mutex_hdl, &abstime);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_mutex_unlock(osal_mutex_t mutex_hdl)
+{
+  return 0 == pthread_mutex_unlock(mutex_hdl);
+}
+
+//--------------------------------------------------------------------+
+// QUEUE API
+//--------------------------------------------------------------------+
+#include "common/tusb_fifo.h"
+
+typedef struct
+{
+  tu_fifo_t       ff;
+  pthread_mutex_t mutex;
+  pthread_cond_t  cond;   // signaled when an item is added
+}osal_queue_def_t;
+
+typedef osal_queue_def_t* osal_queue_t;
+
+// _int_set is used by OS NONE for locking (disable usb isr) only
+#define OSAL_QUEUE_DEF(_int_set, _name, _depth, _type)      \
+  uint8_t _name##_buf[_depth*sizeof(_type)];               \
+  osal_queue_def_t _name = {                               \
+    .ff = TU_FIFO_INIT(_name##_buf, _depth, _type, false)  \
+  }
+
+TU_ATTR_ALWAYS_INLINE static inline osal_queue_t osal_queue_create(osal_queue_def_t* qdef)
+{
+  pthread_mutex_init(&qdef->mutex, NULL);
+  _osal_cond_init(&qdef->cond);
+  tu_fifo_clear(&qdef->ff);
+  return (osal_queue_t) qdef;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_receive(osal_queue_t qhdl, void* data, uint32_t msec)
+{
+  struct timespec abstime;
+  if ( msec != OSAL_TIMEOUT_WAIT_FOREVER ) _osal_abstime(CLOCK_MONOTONIC, &abstime, msec);
+
+  pthread_mutex_lock(&qhdl->mutex);
+
+  bool success = tu_fifo_read(&qhdl->ff, data);
+  while ( !success && msec )
+  {
+    bool const signaled = _osal_cond_wait(&qhdl->cond, &qhdl->mutex,
+                                          (msec == OSAL_TIMEOUT_WAIT_FOREVER) ? NULL : &abstime);
+
+    success = tu_fifo_read(&qhdl->ff, data);
+    if ( !signaled ) break; // timed out
+  }
+
+  pthread_mutex_unlock(&qhdl->mutex);
+
+  return success;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_send(osal_queue_t qhdl, void const * data, bool in_isr)
+{
+  (void) in_isr;
+
+  pthread_mutex_lock(&qhdl->mutex);
+  bool success = tu_fifo_write(&qhdl->ff, data);
+  if ( success ) pthread_cond_signal(&qhdl->cond);
+  pthread_mutex_unlock(&qhdl->mutex);
+
+  TU_ASSERT(success);
+
+  return success;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_empty(osal_queue_t qhdl)
+{
+  pthread_mutex_lock(&qhdl->mutex);
+  bool const empty = tu_fifo_empty(&qhdl->ff);
+  pthread_mutex_unlock(&qhdl->mutex);
+
+  return empty;
+}
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_OSAL_POSIX_H_ */
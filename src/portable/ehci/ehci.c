@@ -59,16 +59,95 @@
 #define FRAMELIST_SIZE                  (1024 >> FRAMELIST_SIZE_BIT_VALUE)
 
 #define QHD_MAX      (CFG_TUH_DEVICE_MAX*CFG_TUH_ENDPOINT_MAX)
-#define QTD_MAX      QHD_MAX
 
+// Transfers larger than QTD_MAX_BYTES are split into a chain of TDs from the pool
+#ifndef CFG_TUH_EHCI_QTD_MAX
+  #define CFG_TUH_EHCI_QTD_MAX  QHD_MAX
+#endif
+
+#define QTD_MAX      CFG_TUH_EHCI_QTD_MAX
+
+enum {
+  QTD_MAX_BYTES = 4*4096 // always fit in 5 page pointers regardless of buffer offset
+};
+
+// index + 1 of QHD in pool, 0 means not opened
+#if QHD_MAX < 255
+typedef uint8_t qhd_idx_t;
+#else
+typedef uint16_t qhd_idx_t;
+#endif
+
+enum {
+  UFRAME_PERIODIC_BW  = 6000 , // 80% of 7500 bytes in a microframe is available for periodic transfer
+  FS_FRAME_PERIODIC_BW= 1350 , // 90% of 1500 bytes in a full-speed frame is available for periodic transfer
+  FS_INT_OVERHEAD     = 13     // full-speed interrupt protocol overhead in bytes
+};
+
+// Periodic bandwidth is accounted over the first PERIOD_BW_FRAMES frames, longer periods wrap around
+#define PERIOD_BW_FRAMES  TU_MIN(FRAMELIST_SIZE, 32)
+
+#if CFG_TUH_ISO_EP_MAX
+enum {
+  ISO_SCHED_THRESHOLD = 2    , // frames ahead of current frame where isochronous TDs are scheduled
+  ISO_XFER_MAX        = 2    , // transfers per endpoint: one in progress and one queued behind it
+  ISO_UFRAME_MASK     = 0x3FFF, // frame index register is 14-bit
+  ISO_SPLIT_MAX_BYTES = 188  , // max full-speed bytes per microframe through transaction translator
+  FS_ISO_OVERHEAD     = 9      // full-speed isochronous protocol overhead in bytes
+};
+
+// siTD Transaction Position for OUT start-split
+enum {
+  SITD_TP_ALL = 0,
+  SITD_TP_BEGIN
+};
+
+// Opened isochronous endpoint, highspeed uses iTD and full-speed uses siTD, one TD per frame
 typedef struct
 {
-  ehci_link_t period_framelist[FRAMELIST_SIZE];
+  uint8_t  used;
+  uint8_t  dev_addr;
+  uint8_t  ep_addr;
+  uint8_t  is_hs;
+
+  uint8_t  smask;     // iTD: microframes having transaction, siTD: start-split mask
+  uint8_t  cmask;     // siTD: complete-split mask
+  uint8_t  mult;      // highspeed transactions per microframe
+  uint8_t  hub_addr;
+  uint8_t  hub_port;
+
+  uint16_t max_packet_size;
+  uint16_t interval;  // polling interval in microframes
+  uint16_t bw;        // bytes reserved in each microframe of smask | cmask
+
+  // a transfer can be queued behind the one in progress, scheduled right after it
+  struct {
+    tu_iso_packet_t* packets;
+    uint16_t num_packets;
+    uint16_t pending;    // number of TDs still in the periodic schedule
+    uint16_t start_slot; // framelist index of the first TD
+    uint32_t xferred_bytes;
+  }xfer[ISO_XFER_MAX];
+
+  uint8_t  xfer_idx;      // slot of the next submitted transfer
+  uint16_t next_uframe;   // frame index (in microframes) following the last submitted transfer
+}ehci_iso_ep_t;
+
+// iTD is fully used by HC, HCD data is kept separately
+typedef struct
+{
+  uint8_t  used;
+  uint8_t  iso_idx;
+  uint8_t  xfer_idx;
+  uint16_t pkt_idx;
+}ehci_itd_info_t;
+#endif
 
-  // TODO only implement 1 ms & 2 ms & 4 ms, 8 ms (framelist)
-  // [0] : 1ms, [1] : 2ms, [2] : 4ms, [3] : 8 ms
-  // TODO better implementation without dummy head to save SRAM
-  ehci_qhd_t period_head_arr[4];
+typedef struct
+{
+  // Interrupt QHDs are linked directly into framelist entries, sorted by descending period so that
+  // a QHD is shared as tail by all entries polling it (EHCI 4.6.1). Isochronous TDs are linked first.
+  ehci_link_t period_framelist[FRAMELIST_SIZE];
 
   // Note control qhd of dev0 is used as head of async list
   struct {
@@ -79,9 +158,32 @@ typedef struct
   ehci_qhd_t qhd_pool[QHD_MAX];
   ehci_qtd_t qtd_pool[QTD_MAX] TU_ATTR_ALIGNED(32);
 
+  // Inactive TD used as alternate next pointer: HC parks here on short packet instead of
+  // continuing with the remaining TDs of a chained transfer
+  ehci_qtd_t qtd_dead TU_ATTR_ALIGNED(32);
+
+  // Free QHDs are linked by index with free_next, free QTDs are linked with their next pointer
+  uint16_t qhd_free_head; // QHD_MAX if empty
+  ehci_qtd_t* qtd_free_head;
+
+  // QHD of non-control endpoints, indexed by device address, endpoint number - 1 and direction
+  qhd_idx_t ep_qhd[CFG_TUH_DEVICE_MAX+CFG_TUH_HUB+1][15][2];
+
+  uint16_t uframe_bw[PERIOD_BW_FRAMES][8]; // bytes reserved in each microframe
+  uint16_t fs_bw[PERIOD_BW_FRAMES];        // full-speed bytes reserved in each frame
+
+#if CFG_TUH_ISO_EP_MAX
+  ehci_itd_t  itd_pool[EHCI_MAX_ITD];
+  ehci_sitd_t sitd_pool[EHCI_MAX_SITD];
+  ehci_itd_info_t itd_info[EHCI_MAX_ITD];
+
+  ehci_iso_ep_t iso_ep[CFG_TUH_ISO_EP_MAX];
+#endif
+
   ehci_registers_t* regs;
 
   volatile uint32_t uframe_number;
+  uint16_t period_removed_frame; // frame when interrupt QHDs were last removed, see async_advance_isr()
 }ehci_data_t;
 
 // Periodic frame list must be 4K alignment
@@ -90,12 +192,6 @@ CFG_TUSB_MEM_SECTION TU_ATTR_ALIGNED(4096) static ehci_data_t ehci_data;
 //--------------------------------------------------------------------+
 // PROTOTYPE
 //--------------------------------------------------------------------+
-static inline ehci_link_t* get_period_head(uint8_t rhport, uint32_t interval_ms)
-{
-  (void) rhport;
-  return (ehci_link_t*) &ehci_data.period_head_arr[ tu_log2( tu_min32(FRAMELIST_SIZE, interval_ms) ) ];
-}
-
 static inline ehci_qhd_t* qhd_control(uint8_t dev_addr)
 {
   return &ehci_data.control[dev_addr].qhd;
@@ -115,7 +211,8 @@ static inline ehci_qtd_t* qtd_control(uint8_t dev_addr)
 
 
 static inline ehci_qhd_t* qhd_next (ehci_qhd_t const * p_qhd);
-static inline ehci_qhd_t* qhd_find_free (void);
+static inline ehci_qhd_t* qhd_alloc (void);
+static inline void qhd_free (ehci_qhd_t* p_qhd);
 static inline ehci_qhd_t* qhd_get_from_addr (uint8_t dev_addr, uint8_t ep_addr);
 
 // determine if a queue head has bus-related error
@@ -127,15 +224,25 @@ static inline bool qhd_has_xact_error (ehci_qhd_t * p_qhd)
 
 static void qhd_init(ehci_qhd_t *p_qhd, uint8_t dev_addr, tusb_desc_endpoint_t const * ep_desc);
 
-static inline ehci_qtd_t* qtd_find_free (void);
+static inline ehci_qtd_t* qtd_alloc (void);
+static inline void qtd_free (ehci_qtd_t* p_qtd);
 static inline ehci_qtd_t* qtd_next (ehci_qtd_t const * p_qtd);
-static inline void qtd_insert_to_qhd (ehci_qhd_t *p_qhd, ehci_qtd_t *p_qtd_new);
+static inline void qtd_insert_to_qhd (ehci_qhd_t *p_qhd, ehci_qtd_t *p_qtd_first, ehci_qtd_t *p_qtd_last);
 static inline void qtd_remove_1st_from_qhd (ehci_qhd_t *p_qhd);
+static void qtd_remove_xfer_from_qhd (ehci_qhd_t *p_qhd);
 static void qtd_init (ehci_qtd_t* p_qtd, void const* buffer, uint16_t total_bytes);
 
 static inline void list_insert (ehci_link_t *current, ehci_link_t *new, uint8_t new_type);
 static inline ehci_link_t* list_next (ehci_link_t *p_link_pointer);
 
+static bool period_qhd_open(ehci_qhd_t* p_qhd, tusb_desc_endpoint_t const * ep_desc);
+static void period_qhd_close(ehci_qhd_t* p_qhd);
+
+#if CFG_TUH_ISO_EP_MAX
+static bool iso_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const * ep_desc);
+static void iso_edpt_close_by_addr(uint8_t rhport, uint8_t dev_addr);
+#endif
+
 //--------------------------------------------------------------------+
 // HCD API
 //--------------------------------------------------------------------+
@@ -205,16 +312,9 @@ static void list_remove_qhd_by_addr(ehci_link_t* list_head, uint8_t dev_addr)
       // EHCI 4.8.2 link the removed qhd to async head (which always reachable by Host Controller)
       qhd->next.address = ((uint32_t) list_head) | (EHCI_QTYPE_QHD << 1);
 
-      if ( qhd->int_smask )
-      {
-        // period list queue element is guarantee to be free in the next frame (1 ms)
-        qhd->used = 0;
-      }else
-      {
-        // async list use async advance handshake
-        // mark as removing, will completely re-usable when async advance isr occurs
-        qhd->removing = 1;
-      }
+      // async list use async advance handshake
+      // mark as removing, will completely re-usable when async advance isr occurs
+      qhd->removing = 1;
     }
   }
 }
@@ -225,15 +325,34 @@ void hcd_device_close(uint8_t rhport, uint8_t dev_addr)
   // skip dev0
   if (dev_addr == 0) return;
 
+  // free lists are also modified by isr
+  hcd_int_disable(rhport);
+
   // Remove from async list
   list_remove_qhd_by_addr( (ehci_link_t*) qhd_async_head(rhport), dev_addr );
 
-  // Remove from all interval period list
-  for(uint8_t i = 0; i < TU_ARRAY_SIZE(ehci_data.period_head_arr); i++)
+  // Remove interrupt QHDs from periodic schedule, they are guaranteed to be free in the next frame (1 ms).
+  // mark as removing, will be released by async advance isr once frame has changed
+  for(uint32_t i = 0; i < QHD_MAX; i++)
   {
-    list_remove_qhd_by_addr( (ehci_link_t*) &ehci_data.period_head_arr[i], dev_addr);
+    ehci_qhd_t* qhd = &ehci_data.qhd_pool[i];
+    if ( qhd->used && !qhd->removing && qhd->int_smask && qhd->dev_addr == dev_addr )
+    {
+      period_qhd_close(qhd);
+      qhd->removing = 1;
+      ehci_data.period_removed_frame = (uint16_t) (ehci_data.regs->frame_index >> 3);
+    }
   }
 
+#if CFG_TUH_ISO_EP_MAX
+  // Remove isochronous TDs from framelist
+  iso_edpt_close_by_addr(rhport, dev_addr);
+#endif
+
+  tu_memclr(ehci_data.ep_qhd[dev_addr], sizeof(ehci_data.ep_qhd[dev_addr]));
+
+  hcd_int_enable(rhport);
+
   // Async doorbell (EHCI 4.8.2 for operational details)
   ehci_data.regs->command_bm.async_adv_doorbell = 1;
 }
@@ -246,6 +365,22 @@ bool ehci_init(uint8_t rhport, uint32_t capability_reg, uint32_t operatial_reg)
 
   ehci_data.regs = (ehci_registers_t* ) operatial_reg;
 
+  //------------- QHD & QTD free lists -------------//
+  for(uint16_t i = 0; i < QHD_MAX; i++)
+  {
+    ehci_data.qhd_pool[i].free_next = (uint16_t) (i+1);
+  }
+  ehci_data.qhd_free_head = 0;
+
+  ehci_data.qtd_free_head = NULL;
+  for(uint32_t i = QTD_MAX; i > 0; i--)
+  {
+    qtd_free(&ehci_data.qtd_pool[i-1]);
+  }
+
+  ehci_data.qtd_dead.next.terminate      = 1;
+  ehci_data.qtd_dead.alternate.terminate = 1;
+
   ehci_registers_t* regs = ehci_data.regs;
 
   //------------- CTRLDSSEGMENT Register (skip) -------------//
@@ -269,42 +404,13 @@ bool ehci_init(uint8_t rhport, uint32_t capability_reg, uint32_t operatial_reg)
   regs->async_list_addr = (uint32_t) async_head;
 
   //------------- Periodic List -------------//
-  // Build the polling interval tree with 1 ms, 2 ms, 4 ms and 8 ms (framesize) only
-  for ( uint32_t i = 0; i < TU_ARRAY_SIZE(ehci_data.period_head_arr); i++ )
-  {
-    ehci_data.period_head_arr[i].int_smask          = 1; // queue head in period list must have smask non-zero
-    ehci_data.period_head_arr[i].qtd_overlay.halted = 1; // dummy node, always inactive
-  }
-
-  ehci_link_t * const framelist  = ehci_data.period_framelist;
-  ehci_link_t * const period_1ms = get_period_head(rhport, 1u);
-
-  // all links --> period_head_arr[0] (1ms)
-  // 0, 2, 4, 6 etc --> period_head_arr[1] (2ms)
-  // 1, 5 --> period_head_arr[2] (4ms)
-  // 3 --> period_head_arr[3] (8ms)
-
-  // TODO EHCI_FRAMELIST_SIZE with other size than 8
+  // Empty schedule, interrupt QHDs and isochronous TDs are linked when opened
+  ehci_link_t * const framelist = ehci_data.period_framelist;
   for(uint32_t i=0; i<FRAMELIST_SIZE; i++)
   {
-    framelist[i].address = (uint32_t) period_1ms;
-    framelist[i].type    = EHCI_QTYPE_QHD;
+    framelist[i].terminate = 1;
   }
 
-  for(uint32_t i=0; i<FRAMELIST_SIZE; i+=2)
-  {
-    list_insert(framelist + i, get_period_head(rhport, 2u), EHCI_QTYPE_QHD);
-  }
-
-  for(uint32_t i=1; i<FRAMELIST_SIZE; i+=4)
-  {
-    list_insert(framelist + i, get_period_head(rhport, 4u), EHCI_QTYPE_QHD);
-  }
-
-  list_insert(framelist+3, get_period_head(rhport, 8u), EHCI_QTYPE_QHD);
-
-  period_1ms->terminate    = 1;
-
   regs->periodic_list_base = (uint32_t) framelist;
 
   //------------- TT Control (NXP only) -------------//
@@ -343,8 +449,18 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
 {
   (void) rhport;
 
-  // TODO not support ISO yet
-  TU_ASSERT (ep_desc->bmAttributes.xfer != TUSB_XFER_ISOCHRONOUS);
+  // transfers are split into whole packets, zero max packet size endpoint (e.g alternate setting 0) can't be used
+  TU_ASSERT(tu_edpt_packet_size(ep_desc));
+
+  // Isochronous endpoint does not use QHD, its TDs are linked directly to framelist
+  if ( ep_desc->bmAttributes.xfer == TUSB_XFER_ISOCHRONOUS )
+  {
+#if CFG_TUH_ISO_EP_MAX
+    return iso_edpt_open(rhport, dev_addr, ep_desc);
+#else
+    TU_ASSERT(false);
+#endif
+  }
 
   //------------- Prepare Queue Head -------------//
   ehci_qhd_t * p_qhd;
@@ -354,40 +470,39 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
     p_qhd = qhd_control(dev_addr);
   }else
   {
-    p_qhd = qhd_find_free();
+    hcd_int_disable(rhport);
+    p_qhd = qhd_alloc();
+    hcd_int_enable(rhport);
+
+    TU_ASSERT(p_qhd);
+
+    uint8_t const ep_addr = ep_desc->bEndpointAddress;
+    ehci_data.ep_qhd[dev_addr][tu_edpt_number(ep_addr)-1][tu_edpt_dir(ep_addr)] = (qhd_idx_t) (p_qhd - ehci_data.qhd_pool + 1);
   }
-  TU_ASSERT(p_qhd);
 
   qhd_init(p_qhd, dev_addr, ep_desc);
 
   // control of dev0 is always present as async head
   if ( dev_addr == 0 ) return true;
 
-  // Insert to list
-  ehci_link_t * list_head = NULL;
-
-  switch (ep_desc->bmAttributes.xfer)
+  if ( ep_desc->bmAttributes.xfer == TUSB_XFER_INTERRUPT )
   {
-    case TUSB_XFER_CONTROL:
-    case TUSB_XFER_BULK:
-      list_head = (ehci_link_t*) qhd_async_head(rhport);
-    break;
-
-    case TUSB_XFER_INTERRUPT:
-      list_head = get_period_head(rhport, p_qhd->interval_ms);
-    break;
-
-    case TUSB_XFER_ISOCHRONOUS:
-      // TODO iso is not supported
-    break;
+    // schedule is also walked by isr
+    hcd_int_disable(rhport);
+    bool const ret = period_qhd_open(p_qhd, ep_desc);
+    if ( !ret )
+    {
+      uint8_t const ep_addr = ep_desc->bEndpointAddress;
+      ehci_data.ep_qhd[dev_addr][tu_edpt_number(ep_addr)-1][tu_edpt_dir(ep_addr)] = 0;
+      qhd_free(p_qhd);
+    }
+    hcd_int_enable(rhport);
 
-    default: break;
+    return ret;
   }
 
-  TU_ASSERT(list_head);
-
   // TODO might need to disable async/period list
-  list_insert(list_head, (ehci_link_t*) p_qhd, EHCI_QTYPE_QHD);
+  list_insert((ehci_link_t*) qhd_async_head(rhport), (ehci_link_t*) p_qhd, EHCI_QTYPE_QHD);
 
   return true;
 }
@@ -407,57 +522,88 @@ bool hcd_setup_send(uint8_t rhport, uint8_t dev_addr, uint8_t const setup_packet
   // sw region
   qhd->p_qtd_list_head = td;
   qhd->p_qtd_list_tail = td;
+  qhd->total_xferred_bytes = 8;
 
-  // attach TD
+  // attach TD, alternate may still point to dead TD after a short data stage
   qhd->qtd_overlay.next.address = (uint32_t) td;
+  qhd->qtd_overlay.alternate.terminate = 1;
 
   return true;
 }
 
 bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer, uint16_t buflen)
 {
-  (void) rhport;
-
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir   = tu_edpt_dir(ep_addr);
 
-  if ( epnum == 0 )
-  {
-    ehci_qhd_t* qhd = qhd_control(dev_addr);
-    ehci_qtd_t* qtd = qtd_control(dev_addr);
+  ehci_qhd_t *p_qhd = qhd_get_from_addr(dev_addr, ep_addr);
+  TU_ASSERT(p_qhd);
 
-    qtd_init(qtd, buffer, buflen);
+  // Split into a chain of TDs each carrying whole packets, only the last one interrupts on complete
+  uint16_t const mps      = p_qhd->max_packet_size;
+  uint16_t const qtd_size = (uint16_t) (QTD_MAX_BYTES - (QTD_MAX_BYTES % mps));
 
-    // first first data toggle is always 1 (data & setup stage)
-    qtd->data_toggle = 1;
-    qtd->pid = dir ? EHCI_PID_IN : EHCI_PID_OUT;
-    qtd->int_on_complete = 1;
-    qtd->next.terminate  = 1;
+  ehci_qtd_t* p_first = NULL;
+  ehci_qtd_t* p_last  = NULL;
+  uint16_t offset = 0;
+  uint8_t toggle = 1; // first data toggle of control data & status stage is always 1
 
-    // sw region
-    qhd->p_qtd_list_head = qtd;
-    qhd->p_qtd_list_tail = qtd;
+  // free lists and TD list are also modified by isr
+  hcd_int_disable(rhport);
 
-    // attach TD
-    qhd->qtd_overlay.next.address = (uint32_t) qtd;
-  }else
+  do
   {
-    ehci_qhd_t *p_qhd = qhd_get_from_addr(dev_addr, ep_addr);
-    ehci_qtd_t *p_qtd = qtd_find_free();
-    TU_ASSERT(p_qtd);
+    // control transfer starts with the per-device TD, the rest of the chain is from pool
+    ehci_qtd_t* p_qtd = (epnum == 0 && p_first == NULL) ? qtd_control(dev_addr) : qtd_alloc();
+    if ( p_qtd == NULL ) break;
+
+    uint16_t const len = tu_min16((uint16_t) (buflen - offset), qtd_size);
+
+    qtd_init(p_qtd, buffer + offset, len);
+
+    if ( epnum == 0 )
+    {
+      p_qtd->pid         = dir ? EHCI_PID_IN : EHCI_PID_OUT;
+      p_qtd->data_toggle = toggle;
+      toggle ^= (uint8_t) (((len + mps - 1) / mps) & 1);
+    }else
+    {
+      p_qtd->pid = p_qhd->pid;
+    }
 
-    qtd_init(p_qtd, buffer, buflen);
-    p_qtd->pid = p_qhd->pid;
+    if ( p_last ) p_last->next.address = (uint32_t) p_qtd;
+    else          p_first = p_qtd;
+    p_last = p_qtd;
 
-    // Insert TD to QH
-    qtd_insert_to_qhd(p_qhd, p_qtd);
+    offset = (uint16_t) (offset + len);
+  } while ( offset < buflen );
 
-    p_qhd->p_qtd_list_tail->int_on_complete = 1;
+  if ( offset < buflen || p_first == NULL )
+  {
+    // out of TD, release the partial chain
+    while ( p_first )
+    {
+      ehci_qtd_t* p_next = qtd_next(p_first);
+      qtd_free(p_first);
+      p_first = p_next;
+    }
 
-    // attach head QTD to QHD start transferring
-    p_qhd->qtd_overlay.next.address = (uint32_t) p_qhd->p_qtd_list_head;
+    hcd_int_enable(rhport);
+    TU_ASSERT(false);
   }
 
+  p_last->int_on_complete = 1;
+
+  // Insert TD chain to QH
+  qtd_insert_to_qhd(p_qhd, p_first, p_last);
+  p_qhd->total_xferred_bytes = buflen;
+
+  // attach head QTD to QHD start transferring, alternate may still point to dead TD after a short packet
+  p_qhd->qtd_overlay.next.address = (uint32_t) p_qhd->p_qtd_list_head;
+  p_qhd->qtd_overlay.alternate.terminate = 1;
+
+  hcd_int_enable(rhport);
+
   return true;
 }
 
@@ -469,6 +615,621 @@ bool hcd_edpt_clear_stall(uint8_t dev_addr, uint8_t ep_addr)
   return true;
 }
 
+//--------------------------------------------------------------------+
+// Periodic Schedule
+//--------------------------------------------------------------------+
+
+// Most loaded microframe in mask among frames polled with period & phase
+static uint16_t period_uframe_bw_peak(uint16_t period, uint16_t phase, uint8_t mask)
+{
+  uint16_t const step = tu_min16(period, PERIOD_BW_FRAMES);
+  uint16_t peak = 0;
+
+  for(uint16_t f = (uint16_t) (phase % step); f < PERIOD_BW_FRAMES; f = (uint16_t) (f + step))
+  {
+    for(uint8_t u=0; u<8; u++)
+    {
+      if ( tu_bit_test(mask, u) ) peak = tu_max16(peak, ehci_data.uframe_bw[f][u]);
+    }
+  }
+  return peak;
+}
+
+// Most loaded full-speed frame among frames polled with period & phase
+static uint16_t period_fs_bw_peak(uint16_t period, uint16_t phase)
+{
+  uint16_t const step = tu_min16(period, PERIOD_BW_FRAMES);
+  uint16_t peak = 0;
+
+  for(uint16_t f = (uint16_t) (phase % step); f < PERIOD_BW_FRAMES; f = (uint16_t) (f + step))
+  {
+    peak = tu_max16(peak, ehci_data.fs_bw[f]);
+  }
+  return peak;
+}
+
+// Reserve (positive) or release (negative) bandwidth in frames polled with period & phase
+static void period_bw_update(uint16_t period, uint16_t phase, uint8_t mask, int32_t hs_bytes, int32_t fs_bytes)
+{
+  uint16_t const step = tu_min16(period, PERIOD_BW_FRAMES);
+
+  for(uint16_t f = (uint16_t) (phase % step); f < PERIOD_BW_FRAMES; f = (uint16_t) (f + step))
+  {
+    for(uint8_t u=0; u<8; u++)
+    {
+      if ( tu_bit_test(mask, u) ) ehci_data.uframe_bw[f][u] = (uint16_t) (ehci_data.uframe_bw[f][u] + hs_bytes);
+    }
+    ehci_data.fs_bw[f] = (uint16_t) (ehci_data.fs_bw[f] + fs_bytes);
+  }
+}
+
+// Bandwidth of interrupt QHD: highspeed bytes in each microframe of smask | cmask and
+// full-speed bytes in each frame for split transaction (low speed is 8 times slower)
+static void period_qhd_bw(ehci_qhd_t const* p_qhd, uint16_t* hs_bytes, uint16_t* fs_bytes)
+{
+  uint16_t const mps = (uint16_t) p_qhd->max_packet_size;
+
+  *hs_bytes = mps;
+  *fs_bytes = (p_qhd->ep_speed == TUSB_SPEED_HIGH) ? 0 :
+              (p_qhd->ep_speed == TUSB_SPEED_FULL) ? (uint16_t) (mps + FS_INT_OVERHEAD) : (uint16_t) (8*(mps + FS_INT_OVERHEAD));
+}
+
+// Pick the frame phase and microframes with least reserved bandwidth, then link QHD to every framelist entry it polls.
+// Highspeed interval below 8 microframes polls several microframes in every frame, full/low speed
+// start-split in microframe Y and complete-split in Y+2 to Y+4 (EHCI 4.12.2.1)
+static bool period_qhd_open(ehci_qhd_t* p_qhd, tusb_desc_endpoint_t const * ep_desc)
+{
+  bool const is_hs = (p_qhd->ep_speed == TUSB_SPEED_HIGH);
+  uint8_t const binterval = ep_desc->bInterval;
+
+  uint16_t period;         // in frames
+  uint8_t  uframe_step;    // highspeed microframes between transactions within a frame
+  uint8_t  start_count;    // number of candidate start microframes
+
+  if ( is_hs )
+  {
+    TU_ASSERT(1 <= binterval && binterval <= 16);
+    uint32_t const interval = 1u << (binterval-1); // microframes
+
+    period      = (uint16_t) tu_min32(tu_max32(interval >> 3, 1), FRAMELIST_SIZE);
+    uframe_step = (uint8_t) tu_min32(interval, 8);
+    start_count = uframe_step;
+  }else
+  {
+    TU_ASSERT(binterval);
+
+    // full/low speed interval is in frames, round down to power of 2
+    period      = (uint16_t) tu_min32(1u << tu_log2(binterval), FRAMELIST_SIZE);
+    uframe_step = 8;
+    start_count = 4; // complete-split must not go past microframe 7
+  }
+
+  uint16_t hs_bytes, fs_bytes;
+  period_qhd_bw(p_qhd, &hs_bytes, &fs_bytes);
+
+  //------------- find least loaded phase & microframes -------------//
+  uint32_t best = UINT32_MAX;
+  uint16_t best_phase = 0;
+  uint8_t  best_smask = 0, best_cmask = 0;
+
+  for(uint16_t phase = 0; phase < tu_min16(period, PERIOD_BW_FRAMES); phase++)
+  {
+    uint16_t const fs_peak = is_hs ? 0 : period_fs_bw_peak(period, phase);
+
+    for(uint8_t u0 = 0; u0 < start_count; u0++)
+    {
+      uint8_t smask = 0;
+      for(uint8_t u = u0; u < 8; u = (uint8_t) (u + uframe_step)) smask |= (uint8_t) TU_BIT(u);
+
+      uint8_t const cmask = is_hs ? 0 : (uint8_t) (TU_BIN8(11100) << u0);
+      uint16_t const hs_peak = period_uframe_bw_peak(period, phase, smask | cmask);
+
+      // full-speed frame budget of transaction translator first, then highspeed microframe
+      uint32_t const cost = (((uint32_t) fs_peak) << 16) | hs_peak;
+      if ( cost < best )
+      {
+        best       = cost;
+        best_phase = phase;
+        best_smask = smask;
+        best_cmask = cmask;
+      }
+    }
+  }
+
+  TU_VERIFY((best & 0xFFFF) + hs_bytes <= UFRAME_PERIODIC_BW);
+  TU_VERIFY((best >> 16) + fs_bytes <= FS_FRAME_PERIODIC_BW);
+
+  p_qhd->int_smask    = best_smask;
+  p_qhd->fl_int_cmask = best_cmask;
+  p_qhd->period_log2  = tu_log2(period);
+  p_qhd->period_phase = best_phase;
+
+  period_bw_update(period, best_phase, best_smask | best_cmask, hs_bytes, fs_bytes);
+
+  //------------- link to framelist -------------//
+  for(uint32_t f = best_phase; f < FRAMELIST_SIZE; f += period)
+  {
+    // skip isochronous TDs and QHDs with longer period, stop if already linked through a shared one
+    ehci_link_t* prev = &ehci_data.period_framelist[f];
+    while ( !prev->terminate )
+    {
+      if ( prev->type == EHCI_QTYPE_QHD )
+      {
+        ehci_qhd_t const* next = (ehci_qhd_t const*) tu_align32(prev->address);
+        if ( next == p_qhd || next->period_log2 <= p_qhd->period_log2 ) break;
+      }
+      prev = list_next(prev);
+    }
+
+    if ( tu_align32(prev->address) != (uint32_t) p_qhd )
+    {
+      list_insert(prev, (ehci_link_t*) p_qhd, EHCI_QTYPE_QHD);
+    }
+  }
+
+  return true;
+}
+
+// Unlink interrupt QHD from all framelist entries and release its bandwidth
+static void period_qhd_close(ehci_qhd_t* p_qhd)
+{
+  uint16_t const period = (uint16_t) (1u << p_qhd->period_log2);
+
+  for(uint32_t f = p_qhd->period_phase; f < FRAMELIST_SIZE; f += period)
+  {
+    ehci_link_t* prev = &ehci_data.period_framelist[f];
+    while ( !prev->terminate )
+    {
+      if ( tu_align32(prev->address) == (uint32_t) p_qhd )
+      {
+        prev->address = p_qhd->next.address;
+        break;
+      }
+      prev = list_next(prev);
+    }
+  }
+
+  uint16_t hs_bytes, fs_bytes;
+  period_qhd_bw(p_qhd, &hs_bytes, &fs_bytes);
+  period_bw_update(period, p_qhd->period_phase, p_qhd->int_smask | p_qhd->fl_int_cmask, -hs_bytes, -fs_bytes);
+}
+
+//--------------------------------------------------------------------+
+// Isochronous
+//--------------------------------------------------------------------+
+#if CFG_TUH_ISO_EP_MAX
+
+static ehci_iso_ep_t* iso_ep_from_addr(uint8_t dev_addr, uint8_t ep_addr)
+{
+  for(uint8_t i=0; i<CFG_TUH_ISO_EP_MAX; i++)
+  {
+    ehci_iso_ep_t* iso = &ehci_data.iso_ep[i];
+    if ( iso->used && iso->dev_addr == dev_addr && iso->ep_addr == ep_addr ) return iso;
+  }
+
+  return NULL;
+}
+
+// Number of packets carried by the TD starting at pkt_idx: up to 8 for highspeed iTD, 1 for siTD
+static inline uint8_t iso_td_packet_count(ehci_iso_ep_t const* iso, uint8_t xfer_idx, uint16_t pkt_idx)
+{
+  uint16_t const per_frame = iso->is_hs ? tu_max16(8 / iso->interval, 1) : 1;
+  return (uint8_t) tu_min16(per_frame, iso->xfer[xfer_idx].num_packets - pkt_idx);
+}
+
+// Framelist index of the TD starting at pkt_idx
+static inline uint16_t iso_td_slot(ehci_iso_ep_t const* iso, uint8_t xfer_idx, uint16_t pkt_idx)
+{
+  return (uint16_t) ((iso->xfer[xfer_idx].start_slot + ((pkt_idx * (uint32_t) iso->interval) >> 3)) & (FRAMELIST_SIZE-1));
+}
+
+static bool iso_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const * ep_desc)
+{
+  (void) rhport;
+
+  uint8_t iso_idx;
+  for(iso_idx=0; iso_idx<CFG_TUH_ISO_EP_MAX; iso_idx++)
+  {
+    if ( !ehci_data.iso_ep[iso_idx].used ) break;
+  }
+  TU_ASSERT(iso_idx < CFG_TUH_ISO_EP_MAX);
+
+  hcd_devtree_info_t devtree_info;
+  hcd_devtree_get_info(dev_addr, &devtree_info);
+  TU_ASSERT(devtree_info.speed != TUSB_SPEED_LOW);
+
+  ehci_iso_ep_t* iso = &ehci_data.iso_ep[iso_idx];
+  tu_memclr(iso, sizeof(ehci_iso_ep_t));
+
+  uint16_t const max_packet_size = tu_edpt_packet_size(ep_desc);
+  uint8_t const binterval = tu_max8(1, tu_min8(ep_desc->bInterval, 16));
+
+  iso->dev_addr        = dev_addr;
+  iso->ep_addr         = ep_desc->bEndpointAddress;
+  iso->is_hs           = (devtree_info.speed == TUSB_SPEED_HIGH) ? 1 : 0;
+  iso->hub_addr        = devtree_info.hub_addr;
+  iso->hub_port        = devtree_info.hub_port;
+  iso->max_packet_size = max_packet_size;
+
+  // interval is 2^(bInterval-1) microframes for highspeed or frames for full-speed, capped to framelist
+  uint32_t const interval = (1u << (binterval-1)) * (iso->is_hs ? 1 : 8);
+  iso->interval = (uint16_t) tu_min32(interval, FRAMELIST_SIZE*8);
+
+  if ( iso->is_hs )
+  {
+    iso->mult = (uint8_t) (1 + ((tu_le16toh(ep_desc->wMaxPacketSize) >> 11) & 0x03));
+    iso->bw   = (uint16_t) (max_packet_size*iso->mult);
+
+    // choose the least loaded set of microframes
+    uint8_t const period = (uint8_t) tu_min16(iso->interval, 8);
+    uint16_t best = UINT16_MAX;
+    for(uint8_t phase=0; phase<period; phase++)
+    {
+      uint8_t mask = 0;
+      for(uint8_t u=phase; u<8; u = (uint8_t) (u+period)) mask |= (uint8_t) TU_BIT(u);
+
+      uint16_t const peak = period_uframe_bw_peak(1, 0, mask);
+      if ( peak < best )
+      {
+        best = peak;
+        iso->smask = mask;
+      }
+    }
+  }else
+  {
+    TU_VERIFY(period_fs_bw_peak(1, 0) + max_packet_size + FS_ISO_OVERHEAD <= FS_FRAME_PERIODIC_BW);
+
+    uint8_t const nsplit = (uint8_t) tu_max32(1, tu_div_ceil(max_packet_size, ISO_SPLIT_MAX_BYTES));
+    if ( tu_edpt_dir(iso->ep_addr) == TUSB_DIR_IN )
+    {
+      // start-split in microframe 0, complete-splits from microframe 2: one per 188 bytes plus one
+      uint8_t const ncsplit = tu_min8(nsplit+1, 6);
+      iso->smask = 0x01;
+      iso->cmask = (uint8_t) (((1u << ncsplit) - 1) << 2);
+    }else
+    {
+      // data is sent with consecutive 188-byte start-splits, no complete-split
+      iso->smask = (uint8_t) ((1u << nsplit) - 1);
+      iso->cmask = 0;
+    }
+    iso->bw = ISO_SPLIT_MAX_BYTES;
+  }
+
+  TU_VERIFY(period_uframe_bw_peak(1, 0, iso->smask | iso->cmask) + iso->bw <= UFRAME_PERIODIC_BW);
+
+  // reserve bandwidth in every frame
+  period_bw_update(1, 0, iso->smask | iso->cmask, iso->bw, iso->is_hs ? 0 : max_packet_size + FS_ISO_OVERHEAD);
+
+  iso->used = 1;
+
+  return true;
+}
+
+// Remove an iTD/siTD from framelist entry, isochronous TDs are always linked before interrupt QHDs
+static void framelist_remove(uint16_t slot, ehci_link_t* td)
+{
+  ehci_link_t* prev = &ehci_data.period_framelist[slot];
+
+  while ( !prev->terminate && prev->type != EHCI_QTYPE_QHD )
+  {
+    if ( tu_align32(prev->address) == (uint32_t) td )
+    {
+      prev->address = td->address;
+      return;
+    }
+    prev = list_next(prev);
+  }
+}
+
+static inline bool itd_is_active(ehci_itd_t const* itd)
+{
+  for(uint8_t u=0; u<8; u++)
+  {
+    if ( itd->xact[u].active ) return true;
+  }
+  return false;
+}
+
+static ehci_link_t* itd_init(ehci_iso_ep_t const* iso, uint8_t iso_idx, uint8_t xfer_idx, uint16_t pkt_idx, uint8_t const* buffer, bool ioc)
+{
+  uint8_t i;
+  for(i=0; i<EHCI_MAX_ITD; i++)
+  {
+    if ( !ehci_data.itd_info[i].used ) break;
+  }
+  TU_ASSERT(i < EHCI_MAX_ITD, NULL);
+
+  ehci_itd_t* itd = &ehci_data.itd_pool[i];
+  tu_memclr(itd, sizeof(ehci_itd_t));
+
+  ehci_data.itd_info[i].used     = 1;
+  ehci_data.itd_info[i].iso_idx  = iso_idx;
+  ehci_data.itd_info[i].xfer_idx = xfer_idx;
+  ehci_data.itd_info[i].pkt_idx  = pkt_idx;
+
+  tu_iso_packet_t const* packets = iso->xfer[xfer_idx].packets;
+  uint8_t const count = iso_td_packet_count(iso, xfer_idx, pkt_idx);
+  uint32_t const page0 = tu_align4k((uint32_t) buffer);
+  uint32_t addr = (uint32_t) buffer;
+  uint8_t n = 0;
+  uint8_t last = 0;
+
+  // packets are placed in microframes of smask, buffer spans at most 7 pages (8 x 3072 bytes)
+  for(uint8_t u=0; u<8 && n<count; u++)
+  {
+    if ( !tu_bit_test(iso->smask, u) ) continue;
+
+    uint16_t const len = packets[pkt_idx + n].length;
+
+    itd->xact[u].offset      = tu_offset4k(addr);
+    itd->xact[u].page_select = (tu_align4k(addr) - page0) >> 12;
+    itd->xact[u].length      = len;
+    itd->xact[u].active      = 1;
+
+    addr += len;
+    last = u;
+    n++;
+  }
+  itd->xact[last].int_on_complete = ioc ? 1 : 0;
+
+  for(uint8_t p=0; p<7; p++)
+  {
+    itd->BufferPointer[p] = page0 + 4096u*p;
+  }
+
+  itd->BufferPointer[0] |= iso->dev_addr | (tu_edpt_number(iso->ep_addr) << 8);
+  itd->BufferPointer[1] |= iso->max_packet_size | (tu_edpt_dir(iso->ep_addr) << 11);
+  itd->BufferPointer[2] |= iso->mult;
+
+  return &itd->next;
+}
+
+static ehci_link_t* sitd_init(ehci_iso_ep_t const* iso, uint8_t iso_idx, uint8_t xfer_idx, uint16_t pkt_idx, uint8_t const* buffer, bool ioc)
+{
+  ehci_sitd_t* sitd = NULL;
+  for(uint8_t i=0; i<EHCI_MAX_SITD; i++)
+  {
+    if ( !ehci_data.sitd_pool[i].used )
+    {
+      sitd = &ehci_data.sitd_pool[i];
+      break;
+    }
+  }
+  TU_ASSERT(sitd, NULL);
+
+  tu_memclr(sitd, sizeof(ehci_sitd_t));
+
+  uint16_t const len = iso->xfer[xfer_idx].packets[pkt_idx].length;
+  uint8_t const dir  = tu_edpt_dir(iso->ep_addr);
+
+  sitd->dev_addr        = iso->dev_addr;
+  sitd->ep_number       = tu_edpt_number(iso->ep_addr);
+  sitd->hub_addr        = iso->hub_addr;
+  sitd->port_number     = iso->hub_port;
+  sitd->direction       = dir;
+
+  sitd->int_smask       = iso->smask;
+  sitd->fl_int_cmask    = iso->cmask;
+
+  sitd->total_bytes     = len;
+  sitd->int_on_complete = ioc ? 1 : 0;
+  sitd->active          = 1;
+
+  sitd->buffer[0] = (uint32_t) buffer;
+  sitd->buffer[1] = tu_align4k((uint32_t) buffer) + 4096;
+
+  if ( dir == TUSB_DIR_OUT )
+  {
+    // only issue as many start-splits as this packet needs
+    uint8_t const tcount = (uint8_t) tu_max32(1, tu_div_ceil(len, ISO_SPLIT_MAX_BYTES));
+    sitd->int_smask  = (uint8_t) ((1u << tcount) - 1);
+    sitd->buffer[1] |= (uint32_t) (((tcount > 1 ? SITD_TP_BEGIN : SITD_TP_ALL) << 3) | tcount);
+  }
+
+  sitd->back.terminate = 1;
+
+  sitd->used     = 1;
+  sitd->xfer_idx = xfer_idx & 1u;
+  sitd->iso_idx  = iso_idx;
+  sitd->pkt_idx  = pkt_idx;
+
+  return &sitd->next;
+}
+
+bool hcd_edpt_iso_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer,
+                       tu_iso_packet_t* packets, uint16_t num_packets)
+{
+  (void) rhport;
+
+  ehci_iso_ep_t* iso = iso_ep_from_addr(dev_addr, ep_addr);
+  TU_ASSERT(iso && num_packets);
+
+  // one transfer in progress and one queued behind it
+  uint8_t const xfer_idx = iso->xfer_idx;
+  TU_ASSERT(iso->xfer[xfer_idx].pending == 0);
+
+  uint16_t const max_len = (uint16_t) (iso->is_hs ? iso->max_packet_size*iso->mult : iso->max_packet_size);
+  for(uint16_t i=0; i<num_packets; i++)
+  {
+    TU_ASSERT(packets[i].length <= max_len);
+  }
+
+  // Start right after the transfer in progress for continuous streaming, unless its end is already too close
+  // or passed. Otherwise start at a few frames ahead of current frame.
+  uint16_t const now   = (uint16_t) (ehci_data.regs->frame_index & ISO_UFRAME_MASK & ~7u);
+  uint16_t       start = (uint16_t) ((now + ISO_SCHED_THRESHOLD*8) & ISO_UFRAME_MASK);
+  if ( iso->xfer[xfer_idx ^ 1].pending )
+  {
+    uint16_t const ahead = (uint16_t) ((iso->next_uframe - now) & ISO_UFRAME_MASK);
+    if ( ahead >= ISO_SCHED_THRESHOLD*8 && ahead <= FRAMELIST_SIZE*8 ) start = iso->next_uframe;
+  }
+
+  // TDs of all scheduled transfers must not share a framelist entry
+  uint32_t const span = (((num_packets-1u) * iso->interval) >> 3) + 1;
+  TU_ASSERT((((start - now) & ISO_UFRAME_MASK) >> 3) + span <= FRAMELIST_SIZE);
+
+  iso->xfer[xfer_idx].packets       = packets;
+  iso->xfer[xfer_idx].num_packets   = num_packets;
+  iso->xfer[xfer_idx].xferred_bytes = 0;
+  iso->xfer[xfer_idx].start_slot    = (uint16_t) ((start >> 3) & (FRAMELIST_SIZE-1));
+
+  uint8_t const iso_idx = (uint8_t) (iso - ehci_data.iso_ep);
+  uint16_t td_count = 0;
+  for(uint16_t pkt_idx=0; pkt_idx<num_packets; pkt_idx = (uint16_t) (pkt_idx + iso_td_packet_count(iso, xfer_idx, pkt_idx)))
+  {
+    td_count++;
+  }
+
+  // check there is enough TDs for the whole transfer before touching the schedule
+  uint16_t td_free = 0;
+  if ( iso->is_hs )
+  {
+    for(uint8_t i=0; i<EHCI_MAX_ITD; i++)
+    {
+      if ( !ehci_data.itd_info[i].used ) td_free++;
+    }
+  }else
+  {
+    for(uint8_t i=0; i<EHCI_MAX_SITD; i++)
+    {
+      if ( !ehci_data.sitd_pool[i].used ) td_free++;
+    }
+  }
+  TU_ASSERT(td_count <= td_free);
+
+  iso->xfer[xfer_idx].pending = td_count;
+
+  // next transfer starts at the frame following the last packet interval
+  uint32_t const frames = tu_div_ceil(num_packets * (uint32_t) iso->interval, 8);
+  iso->next_uframe = (uint16_t) ((start + frames*8) & ISO_UFRAME_MASK);
+  iso->xfer_idx    = xfer_idx ^ 1u;
+
+  uint8_t const* p_data = buffer;
+  uint16_t pkt_idx = 0;
+  while ( pkt_idx < num_packets )
+  {
+    uint8_t const count = iso_td_packet_count(iso, xfer_idx, pkt_idx);
+    bool const ioc = (pkt_idx + count == num_packets);
+
+    ehci_link_t* td = iso->is_hs ? itd_init (iso, iso_idx, xfer_idx, pkt_idx, p_data, ioc) :
+                                   sitd_init(iso, iso_idx, xfer_idx, pkt_idx, p_data, ioc);
+    TU_ASSERT(td); // should not happen, free TDs are checked above
+    list_insert(&ehci_data.period_framelist[iso_td_slot(iso, xfer_idx, pkt_idx)], td, iso->is_hs ? EHCI_QTYPE_ITD : EHCI_QTYPE_SITD);
+
+    for(uint8_t i=0; i<count; i++) p_data += packets[pkt_idx+i].length;
+    pkt_idx = (uint16_t) (pkt_idx + count);
+  }
+
+  return true;
+}
+
+// Remove TD from schedule, complete the transfer if it is the last one
+static void iso_td_retire(ehci_iso_ep_t* iso, uint8_t xfer_idx, uint16_t pkt_idx, ehci_link_t* td, bool notify)
+{
+  framelist_remove(iso_td_slot(iso, xfer_idx, pkt_idx), td);
+
+  if ( iso->xfer[xfer_idx].pending && (--iso->xfer[xfer_idx].pending == 0) && notify )
+  {
+    // per packet result is reported in packets[]
+    hcd_event_xfer_complete(iso->dev_addr, iso->ep_addr, iso->xfer[xfer_idx].xferred_bytes, XFER_RESULT_SUCCESS, true);
+  }
+}
+
+static void iso_xfer_complete_isr(uint8_t rhport)
+{
+  (void) rhport;
+
+  //------------- highspeed iTD -------------//
+  for(uint8_t i=0; i<EHCI_MAX_ITD; i++)
+  {
+    ehci_itd_info_t* info = &ehci_data.itd_info[i];
+    ehci_itd_t* itd = &ehci_data.itd_pool[i];
+    if ( !info->used || itd_is_active(itd) ) continue;
+
+    ehci_iso_ep_t* iso = &ehci_data.iso_ep[info->iso_idx];
+    uint8_t const count = iso_td_packet_count(iso, info->xfer_idx, info->pkt_idx);
+    bool const is_in = (tu_edpt_dir(iso->ep_addr) == TUSB_DIR_IN);
+    uint8_t n = 0;
+
+    for(uint8_t u=0; u<8 && n<count; u++)
+    {
+      if ( !tu_bit_test(iso->smask, u) ) continue;
+
+      tu_iso_packet_t* pkt = &iso->xfer[info->xfer_idx].packets[info->pkt_idx + n];
+
+      // HC only updates length for IN
+      pkt->actual_length = is_in ? (uint16_t) itd->xact[u].length : pkt->length;
+      pkt->result = (itd->xact[u].error || itd->xact[u].babble_err || itd->xact[u].buffer_err) ?
+                    XFER_RESULT_FAILED : XFER_RESULT_SUCCESS;
+
+      iso->xfer[info->xfer_idx].xferred_bytes += pkt->actual_length;
+      n++;
+    }
+
+    info->used = 0;
+    iso_td_retire(iso, info->xfer_idx, info->pkt_idx, &itd->next, true);
+  }
+
+  //------------- full-speed siTD -------------//
+  for(uint8_t i=0; i<EHCI_MAX_SITD; i++)
+  {
+    ehci_sitd_t* sitd = &ehci_data.sitd_pool[i];
+    if ( !sitd->used || sitd->active ) continue;
+
+    ehci_iso_ep_t* iso = &ehci_data.iso_ep[sitd->iso_idx];
+    tu_iso_packet_t* pkt = &iso->xfer[sitd->xfer_idx].packets[sitd->pkt_idx];
+
+    // total bytes is decreased by HC as data is transferred
+    pkt->actual_length = (uint16_t) (pkt->length - sitd->total_bytes);
+    pkt->result = (sitd->error || sitd->xact_err || sitd->babble_err || sitd->buffer_err || sitd->missed_uframe) ?
+                  XFER_RESULT_FAILED : XFER_RESULT_SUCCESS;
+
+    iso->xfer[sitd->xfer_idx].xferred_bytes += pkt->actual_length;
+
+    sitd->used = 0;
+    iso_td_retire(iso, sitd->xfer_idx, sitd->pkt_idx, &sitd->next, true);
+  }
+}
+
+static void iso_edpt_close_by_addr(uint8_t rhport, uint8_t dev_addr)
+{
+  (void) rhport;
+
+  for(uint8_t iso_idx=0; iso_idx<CFG_TUH_ISO_EP_MAX; iso_idx++)
+  {
+    ehci_iso_ep_t* iso = &ehci_data.iso_ep[iso_idx];
+    if ( !(iso->used && iso->dev_addr == dev_addr) ) continue;
+
+    // deactivate and unlink all scheduled TDs
+    for(uint8_t i=0; i<EHCI_MAX_ITD; i++)
+    {
+      ehci_itd_info_t* info = &ehci_data.itd_info[i];
+      if ( !(info->used && info->iso_idx == iso_idx) ) continue;
+
+      for(uint8_t u=0; u<8; u++) ehci_data.itd_pool[i].xact[u].active = 0;
+      info->used = 0;
+      iso_td_retire(iso, info->xfer_idx, info->pkt_idx, &ehci_data.itd_pool[i].next, false);
+    }
+
+    for(uint8_t i=0; i<EHCI_MAX_SITD; i++)
+    {
+      ehci_sitd_t* sitd = &ehci_data.sitd_pool[i];
+      if ( !(sitd->used && sitd->iso_idx == iso_idx) ) continue;
+
+      sitd->active = 0;
+      sitd->used   = 0;
+      iso_td_retire(iso, sitd->xfer_idx, sitd->pkt_idx, &sitd->next, false);
+    }
+
+    //------------- release bandwidth -------------//
+    period_bw_update(1, 0, iso->smask | iso->cmask, -iso->bw, iso->is_hs ? 0 : -(iso->max_packet_size + FS_ISO_OVERHEAD));
+
+    iso->used = 0;
+  }
+}
+
+#endif
+
 //--------------------------------------------------------------------+
 // EHCI Interrupt Handler
 //--------------------------------------------------------------------+
@@ -480,13 +1241,36 @@ static void async_advance_isr(uint8_t rhport)
 {
   (void) rhport;
 
+  // interrupt QHD can still be walked by controller in the frame it is removed from periodic schedule
+  bool const same_frame = (ehci_data.regs->frame_index >> 3) == ehci_data.period_removed_frame;
+  bool period_pending = false;
+
   ehci_qhd_t* qhd_pool = ehci_data.qhd_pool;
   for(uint32_t i = 0; i < QHD_MAX; i++)
   {
     if ( qhd_pool[i].removing )
     {
-      qhd_pool[i].removing = 0;
-      qhd_pool[i].used     = 0;
+      if ( qhd_pool[i].int_smask && same_frame )
+      {
+        period_pending = true;
+      }else
+      {
+        qhd_free(&qhd_pool[i]);
+      }
+    }
+  }
+
+  // ring doorbell again to check for next frame
+  if ( period_pending ) ehci_data.regs->command_bm.async_adv_doorbell = 1;
+
+  // control QHD is not from pool, only release its TD chain
+  for(uint32_t i = 1; i < TU_ARRAY_SIZE(ehci_data.control); i++)
+  {
+    ehci_qhd_t* qhd = &ehci_data.control[i].qhd;
+    if ( qhd->removing )
+    {
+      while ( qhd->p_qtd_list_head ) qtd_remove_xfer_from_qhd(qhd);
+      qhd->removing = 0;
     }
   }
 }
@@ -510,14 +1294,23 @@ static void qhd_xfer_complete_isr(ehci_qhd_t * p_qhd)
   while(p_qhd->p_qtd_list_head != NULL && !p_qhd->p_qtd_list_head->active)
   {
     ehci_qtd_t * volatile qtd = (ehci_qtd_t * volatile) p_qhd->p_qtd_list_head;
-    bool const is_ioc = (qtd->int_on_complete != 0);
+    bool is_ioc = (qtd->int_on_complete != 0);
     uint8_t const ep_addr = tu_edpt_addr(p_qhd->ep_number, qtd->pid == EHCI_PID_IN ? 1 : 0);
 
-    p_qhd->total_xferred_bytes += qtd->expected_bytes - qtd->total_bytes;
+    // short packet before the last TD of a chain: HC is parked at the dead TD, transfer ends here
+    bool const is_short = !is_ioc && (qtd->pid == EHCI_PID_IN) && (qtd->total_bytes != 0);
+
+    p_qhd->total_xferred_bytes = (uint16_t) (p_qhd->total_xferred_bytes - qtd->total_bytes);
 
     // TD need to be freed and removed from qhd, before invoking callback
-    qtd->used = 0; // free QTD
     qtd_remove_1st_from_qhd(p_qhd);
+    qtd_free(qtd);
+
+    if (is_short)
+    {
+      qtd_remove_xfer_from_qhd(p_qhd);
+      is_ioc = true;
+    }
 
     if (is_ioc)
     {
@@ -540,38 +1333,18 @@ static void async_list_xfer_complete_isr(ehci_qhd_t * const async_head)
   }while(p_qhd != async_head); // async list traversal, stop if loop around
 }
 
-static void period_list_xfer_complete_isr(uint8_t hostid, uint32_t interval_ms)
+// Interrupt QHDs are shared by many framelist entries, scan the pool instead of walking the schedule
+static void period_list_xfer_complete_isr(uint8_t hostid)
 {
-  uint16_t max_loop = 0;
-  uint32_t const period_1ms_addr = (uint32_t) get_period_head(hostid, 1u);
-  ehci_link_t next_item = * get_period_head(hostid, interval_ms);
+  (void) hostid;
 
-  // TODO abstract max loop guard for period
-  while( !next_item.terminate &&
-      !(interval_ms > 1 && period_1ms_addr == tu_align32(next_item.address)) &&
-      max_loop < (QHD_MAX + EHCI_MAX_ITD + EHCI_MAX_SITD)*CFG_TUH_DEVICE_MAX)
+  for(uint32_t i = 0; i < QHD_MAX; i++)
   {
-    switch ( next_item.type )
+    ehci_qhd_t* p_qhd_int = &ehci_data.qhd_pool[i];
+    if ( p_qhd_int->used && !p_qhd_int->removing && p_qhd_int->int_smask && !p_qhd_int->qtd_overlay.halted )
     {
-      case EHCI_QTYPE_QHD:
-      {
-        ehci_qhd_t *p_qhd_int = (ehci_qhd_t *) tu_align32(next_item.address);
-        if ( !p_qhd_int->qtd_overlay.halted )
-        {
-          qhd_xfer_complete_isr(p_qhd_int);
-        }
-      }
-      break;
-
-      case EHCI_QTYPE_ITD: // TODO support hs/fs ISO
-      case EHCI_QTYPE_SITD:
-      case EHCI_QTYPE_FSTN:
-				
-      default: break;
+      qhd_xfer_complete_isr(p_qhd_int);
     }
-
-    next_item = *list_next(&next_item);
-    max_loop++;
   }
 }
 
@@ -586,12 +1359,19 @@ static void qhd_xfer_error_isr(ehci_qhd_t * p_qhd)
     // no error bits are set, endpoint is halted due to STALL
     error_event = qhd_has_xact_error(p_qhd) ? XFER_RESULT_FAILED : XFER_RESULT_STALLED;
 
-    p_qhd->total_xferred_bytes += p_qhd->p_qtd_list_head->expected_bytes - p_qhd->p_qtd_list_head->total_bytes;
-
 //    if ( XFER_RESULT_FAILED == error_event )    TU_BREAKPOINT(); // TODO skip unplugged device
 
-    p_qhd->p_qtd_list_head->used = 0; // free QTD
-    qtd_remove_1st_from_qhd(p_qhd);
+    // drop all TDs of the failed transfer, overlay must not point to them once halt is cleared
+    qtd_remove_xfer_from_qhd(p_qhd);
+
+    if ( p_qhd->p_qtd_list_head )
+    {
+      p_qhd->qtd_overlay.next.address = (uint32_t) p_qhd->p_qtd_list_head;
+    }else
+    {
+      p_qhd->qtd_overlay.next.terminate = 1;
+    }
+    p_qhd->qtd_overlay.alternate.terminate = 1;
 
     if ( 0 == p_qhd->ep_number )
     {
@@ -602,9 +1382,6 @@ static void qhd_xfer_error_isr(ehci_qhd_t * p_qhd)
       p_qhd->qtd_overlay.next.terminate      = 1;
       p_qhd->qtd_overlay.alternate.terminate = 1;
       p_qhd->qtd_overlay.halted              = 0;
-
-      ehci_qtd_t *p_setup = qtd_control(p_qhd->dev_addr);
-      p_setup->used = 0;
     }
 
     // call USBH callback
@@ -625,33 +1402,13 @@ static void xfer_error_isr(uint8_t hostid)
     p_qhd = qhd_next(p_qhd);
   }while(p_qhd != async_head); // async list traversal, stop if loop around
 
-  //------------- TODO refractor period list -------------//
-  uint32_t const period_1ms_addr = (uint32_t) get_period_head(hostid, 1u);
-  for (uint32_t interval_ms=1; interval_ms <= FRAMELIST_SIZE; interval_ms *= 2)
+  //------------- period list -------------//
+  for(uint32_t i = 0; i < QHD_MAX; i++)
   {
-    ehci_link_t next_item = * get_period_head(hostid, interval_ms);
-
-    // TODO abstract max loop guard for period
-    while( !next_item.terminate &&
-           !(interval_ms > 1 && period_1ms_addr == tu_align32(next_item.address)) )
+    ehci_qhd_t* p_qhd_int = &ehci_data.qhd_pool[i];
+    if ( p_qhd_int->used && !p_qhd_int->removing && p_qhd_int->int_smask )
     {
-      switch ( next_item.type )
-      {
-        case EHCI_QTYPE_QHD:
-        {
-          ehci_qhd_t *p_qhd_int = (ehci_qhd_t *) tu_align32(next_item.address);
-          qhd_xfer_error_isr(p_qhd_int);
-        }
-        break;
-
-				// TODO support hs/fs ISO
-        case EHCI_QTYPE_ITD:
-        case EHCI_QTYPE_SITD:
-        case EHCI_QTYPE_FSTN:
-        default: break;
-      }
-
-      next_item = *list_next(&next_item);
+      qhd_xfer_error_isr(p_qhd_int);
     }
   }
 }
@@ -709,6 +1466,11 @@ void hcd_int_handler(uint8_t rhport)
   if (int_status & EHCI_INT_MASK_ERROR)
   {
     xfer_error_isr(rhport);
+
+#if CFG_TUH_ISO_EP_MAX
+    // isochronous error does not halt, TD is retired as usual with error status
+    iso_xfer_complete_isr(rhport);
+#endif
   }
 
   //------------- some QTD/SITD/ITD with IOC set is completed -------------//
@@ -719,10 +1481,11 @@ void hcd_int_handler(uint8_t rhport)
 
   if (int_status & EHCI_INT_MASK_NXP_PERIODIC)
   {
-    for (uint32_t i=1; i <= FRAMELIST_SIZE; i *= 2)
-    {
-      period_list_xfer_complete_isr( rhport, i );
-    }
+    period_list_xfer_complete_isr(rhport);
+
+#if CFG_TUH_ISO_EP_MAX
+    iso_xfer_complete_isr(rhport);
+#endif
   }
 
   //------------- There is some removed async previously -------------//
@@ -738,14 +1501,31 @@ void hcd_int_handler(uint8_t rhport)
 
 
 //------------- queue head helper -------------//
-static inline ehci_qhd_t* qhd_find_free (void)
+static inline ehci_qhd_t* qhd_alloc (void)
+{
+  if ( ehci_data.qhd_free_head >= QHD_MAX ) return NULL;
+
+  ehci_qhd_t* p_qhd = &ehci_data.qhd_pool[ehci_data.qhd_free_head];
+  ehci_data.qhd_free_head = p_qhd->free_next;
+
+  return p_qhd;
+}
+
+// Return QHD and its remaining TDs to free lists
+static inline void qhd_free (ehci_qhd_t* p_qhd)
 {
-  for (uint32_t i=0; i<QHD_MAX; i++)
+  while ( p_qhd->p_qtd_list_head )
   {
-    if ( !ehci_data.qhd_pool[i].used ) return &ehci_data.qhd_pool[i];
+    ehci_qtd_t* qtd = p_qhd->p_qtd_list_head;
+    qtd_remove_1st_from_qhd(p_qhd);
+    qtd_free(qtd);
   }
 
-  return NULL;
+  p_qhd->used     = 0;
+  p_qhd->removing = 0;
+
+  p_qhd->free_next = ehci_data.qhd_free_head;
+  ehci_data.qhd_free_head = (uint16_t) (p_qhd - ehci_data.qhd_pool);
 }
 
 static inline ehci_qhd_t* qhd_next(ehci_qhd_t const * p_qhd)
@@ -755,29 +1535,31 @@ static inline ehci_qhd_t* qhd_next(ehci_qhd_t const * p_qhd)
 
 static inline ehci_qhd_t* qhd_get_from_addr(uint8_t dev_addr, uint8_t ep_addr)
 {
-  ehci_qhd_t* qhd_pool = ehci_data.qhd_pool;
-
-  for(uint32_t i=0; i<QHD_MAX; i++)
-  {
-    if ( (qhd_pool[i].dev_addr == dev_addr) &&
-          ep_addr == tu_edpt_addr(qhd_pool[i].ep_number, qhd_pool[i].pid) )
-    {
-      return &qhd_pool[i];
-    }
-  }
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  if ( epnum == 0 ) return qhd_control(dev_addr);
 
-  return NULL;
+  qhd_idx_t const idx = ehci_data.ep_qhd[dev_addr][epnum-1][tu_edpt_dir(ep_addr)];
+  return idx ? &ehci_data.qhd_pool[idx-1] : NULL;
 }
 
 //------------- TD helper -------------//
-static inline ehci_qtd_t* qtd_find_free(void)
+static inline ehci_qtd_t* qtd_alloc(void)
+{
+  ehci_qtd_t* p_qtd = ehci_data.qtd_free_head;
+  if ( p_qtd ) ehci_data.qtd_free_head = (ehci_qtd_t*) p_qtd->next.address;
+
+  return p_qtd;
+}
+
+// Free QTD is not linked to any QHD, its next pointer is used for the free list
+static inline void qtd_free(ehci_qtd_t* p_qtd)
 {
-  for (uint32_t i=0; i<QTD_MAX; i++)
+  // control QTDs are not from pool
+  if ( (p_qtd >= ehci_data.qtd_pool) && (p_qtd < ehci_data.qtd_pool + QTD_MAX) )
   {
-    if ( !ehci_data.qtd_pool[i].used ) return &ehci_data.qtd_pool[i];
+    p_qtd->next.address = (uint32_t) ehci_data.qtd_free_head;
+    ehci_data.qtd_free_head = p_qtd;
   }
-
-  return NULL;
 }
 
 static inline ehci_qtd_t* qtd_next(ehci_qtd_t const * p_qtd )
@@ -796,16 +1578,34 @@ static inline void qtd_remove_1st_from_qhd(ehci_qhd_t *p_qhd)
   }
 }
 
-static inline void qtd_insert_to_qhd(ehci_qhd_t *p_qhd, ehci_qtd_t *p_qtd_new)
+// Remove all TDs of the transfer at list head (up to the one with IOC) and free them
+static void qtd_remove_xfer_from_qhd(ehci_qhd_t *p_qhd)
+{
+  while ( p_qhd->p_qtd_list_head )
+  {
+    ehci_qtd_t* qtd = p_qhd->p_qtd_list_head;
+    bool const is_ioc = (qtd->int_on_complete != 0);
+
+    p_qhd->total_xferred_bytes = (uint16_t) (p_qhd->total_xferred_bytes - qtd->total_bytes);
+
+    qtd_remove_1st_from_qhd(p_qhd);
+    qtd_free(qtd);
+
+    if ( is_ioc ) break;
+  }
+}
+
+// Append a chain of TDs already linked by their next pointer
+static inline void qtd_insert_to_qhd(ehci_qhd_t *p_qhd, ehci_qtd_t *p_qtd_first, ehci_qtd_t *p_qtd_last)
 {
   if (p_qhd->p_qtd_list_head == NULL) // empty list
   {
-    p_qhd->p_qtd_list_head               = p_qhd->p_qtd_list_tail = p_qtd_new;
+    p_qhd->p_qtd_list_head               = p_qtd_first;
   }else
   {
-    p_qhd->p_qtd_list_tail->next.address = (uint32_t) p_qtd_new;
-    p_qhd->p_qtd_list_tail               = p_qtd_new;
+    p_qhd->p_qtd_list_tail->next.address = (uint32_t) p_qtd_first;
   }
+  p_qhd->p_qtd_list_tail                 = p_qtd_last;
 }
 
 static void qhd_init(ehci_qhd_t *p_qhd, uint8_t dev_addr, tusb_desc_endpoint_t const * ep_desc)
@@ -820,7 +1620,6 @@ static void qhd_init(ehci_qhd_t *p_qhd, uint8_t dev_addr, tusb_desc_endpoint_t c
   hcd_devtree_get_info(dev_addr, &devtree_info);
 
   uint8_t const xfer_type = ep_desc->bmAttributes.xfer;
-  uint8_t const interval = ep_desc->bInterval;
 
   p_qhd->dev_addr           = dev_addr;
   p_qhd->fl_inactive_next_xact = 0;
@@ -832,35 +1631,8 @@ static void qhd_init(ehci_qhd_t *p_qhd, uint8_t dev_addr, tusb_desc_endpoint_t c
   p_qhd->fl_ctrl_ep_flag    = ((xfer_type == TUSB_XFER_CONTROL) && (p_qhd->ep_speed != TUSB_SPEED_HIGH))  ? 1 : 0;
   p_qhd->nak_reload         = 0;
 
-  // Bulk/Control -> smask = cmask = 0
-  // TODO Isochronous
-  if (TUSB_XFER_INTERRUPT == xfer_type)
-  {
-    if (TUSB_SPEED_HIGH == p_qhd->ep_speed)
-    {
-      TU_ASSERT( interval <= 16, );
-      if ( interval < 4) // sub millisecond interval
-      {
-        p_qhd->interval_ms = 0;
-        p_qhd->int_smask   = (interval == 1) ? TU_BIN8(11111111) :
-                             (interval == 2) ? TU_BIN8(10101010) : TU_BIN8(01000100);
-      }else
-      {
-        p_qhd->interval_ms = (uint8_t) tu_min16( 1 << (interval-4), 255 );
-        p_qhd->int_smask = TU_BIT(interval % 8);
-      }
-    }else
-    {
-      TU_ASSERT( 0 != interval, );
-      // Full/Low: 4.12.2.1 (EHCI) case 1 schedule start split at 1 us & complete split at 2,3,4 uframes
-      p_qhd->int_smask    = 0x01;
-      p_qhd->fl_int_cmask = TU_BIN8(11100);
-      p_qhd->interval_ms  = interval;
-    }
-  }else
-  {
-    p_qhd->int_smask = p_qhd->fl_int_cmask = 0;
-  }
+  // Bulk/Control -> smask = cmask = 0, interrupt masks are chosen when linked to periodic schedule
+  p_qhd->int_smask = p_qhd->fl_int_cmask = 0;
 
   p_qhd->fl_hub_addr     = devtree_info.hub_addr;
   p_qhd->fl_hub_port     = devtree_info.hub_port;
@@ -887,15 +1659,12 @@ static void qtd_init(ehci_qtd_t* p_qtd, void const* buffer, uint16_t total_bytes
 {
   tu_memclr(p_qtd, sizeof(ehci_qtd_t));
 
-  p_qtd->used                = 1;
-
   p_qtd->next.terminate      = 1; // init to null
-  p_qtd->alternate.terminate = 1; // not used, always set to terminated
+  p_qtd->alternate.address   = (uint32_t) &ehci_data.qtd_dead; // stop at dead TD on short packet
   p_qtd->active              = 1;
   p_qtd->err_count           = 3; // TODO 3 consecutive errors tolerance
   p_qtd->data_toggle         = 0;
   p_qtd->total_bytes         = total_bytes;
-  p_qtd->expected_bytes      = total_bytes;
 
   p_qtd->buffer[0] = (uint32_t) buffer;
   for(uint8_t i=1; i<5; i++)
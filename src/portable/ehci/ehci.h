@@ -47,10 +47,20 @@
 // EHCI CONFIGURATION & CONSTANTS
 //--------------------------------------------------------------------+
 
+// Number of iTD (highspeed) and siTD (full-speed split) for isochronous transfers.
+// Each one carries a single frame of an isochronous transfer.
+#ifndef CFG_TUH_EHCI_ITD_MAX
+  #define CFG_TUH_EHCI_ITD_MAX    16
+#endif
+
+#ifndef CFG_TUH_EHCI_SITD_MAX
+  #define CFG_TUH_EHCI_SITD_MAX   16
+#endif
+
 // TODO merge OHCI with EHCI
 enum {
-  EHCI_MAX_ITD  = 4,
-  EHCI_MAX_SITD = 16
+  EHCI_MAX_ITD  = CFG_TUH_EHCI_ITD_MAX,
+  EHCI_MAX_SITD = CFG_TUH_EHCI_SITD_MAX
 };
 
 //--------------------------------------------------------------------+
@@ -88,16 +98,8 @@ typedef struct
 	// Word 0: Next QTD Pointer
 	ehci_link_t next;
 
-	// Word 1: Alternate Next QTD Pointer (not used)
-	union{
-	  ehci_link_t alternate;
-	  struct {
-	    uint32_t                : 5;
-	    uint32_t used           : 1;
-	    uint32_t                : 10;
-	    uint32_t expected_bytes : 16;
-	  };
-	};
+	// Word 1: Alternate Next QTD Pointer, followed by HC on short packet
+	ehci_link_t alternate;
 
 	// Word 2: qTQ Token
 	volatile uint32_t ping_err             : 1  ; ///< For Highspeed: 0 Out, 1 Ping. Full/Slow used as error indicator
@@ -160,10 +162,13 @@ typedef struct TU_ATTR_ALIGNED(32)
 	uint8_t used;
 	uint8_t removing; // removed from asyn list, waiting for async advance
 	uint8_t pid;
-	uint8_t interval_ms; // polling interval in frames (or millisecond)
+	uint8_t period_log2; // interrupt polling period is 2^n frames
 
-	uint16_t total_xferred_bytes; // number of bytes xferred until a qtd with ioc bit set
-	uint8_t reserved2[2];
+	uint16_t total_xferred_bytes; // requested bytes minus bytes left in retired qtds of current transfer
+	union {
+	  uint16_t free_next;    // index of next free QHD in pool, only valid while QHD is free
+	  uint16_t period_phase; // first framelist entry polling interrupt QHD, only valid while QHD is used
+	};
 
 	ehci_qtd_t * volatile p_qtd_list_head;	// head of the scheduled TD list
 	ehci_qtd_t * volatile p_qtd_list_tail;	// tail of the scheduled TD list
@@ -257,9 +262,10 @@ typedef struct TU_ATTR_ALIGNED(32)
 	ehci_link_t back;
 
 	/// SITD is 32-byte aligned but occupies only 28 --> 4 bytes for storing extra data
-	uint8_t used;
-	uint8_t ihd_idx;
-	uint8_t reserved2[2];
+	uint8_t used     : 1;
+	uint8_t xfer_idx : 1; // transfer slot of the isochronous endpoint
+	uint8_t iso_idx; // isochronous endpoint this siTD belongs to
+	uint16_t pkt_idx; // packet index within the transfer
 } ehci_sitd_t;
 
 TU_VERIFY_STATIC( sizeof(ehci_sitd_t) == 32, "size is not correct" );
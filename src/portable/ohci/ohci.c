@@ -138,6 +138,14 @@ enum {
   PID_FROM_TD = 0,
 };
 
+#if CFG_TUH_ISO_EP_MAX
+enum {
+  ISO_SCHED_THRESHOLD   = 2    , // frames ahead of current frame where isochronous TDs start
+  ISO_FRAME_PERIODIC_BW = 1350 , // 90% of 1500 bytes frame, same ratio as periodic start
+  ISO_OVERHEAD          = 9      // full-speed isochronous protocol overhead in bytes
+};
+#endif
+
 //--------------------------------------------------------------------+
 // INTERNAL OBJECT & FUNCTION DECLARATION
 //--------------------------------------------------------------------+
@@ -148,12 +156,18 @@ static ohci_ed_t * const p_ed_head[] =
     [TUSB_XFER_CONTROL]     = &ohci_data.control[0].ed,
     [TUSB_XFER_BULK   ]     = &ohci_data.bulk_head_ed,
     [TUSB_XFER_INTERRUPT]   = &ohci_data.period_head_ed,
-    [TUSB_XFER_ISOCHRONOUS] = NULL // TODO Isochronous
+    [TUSB_XFER_ISOCHRONOUS] = &ohci_data.period_head_ed // iso EDs are at the end of periodic list
 };
 
 static void ed_list_insert(ohci_ed_t * p_pre, ohci_ed_t * p_ed);
 static void ed_list_remove_by_addr(ohci_ed_t * p_head, uint8_t dev_addr);
 
+#if CFG_TUH_ISO_EP_MAX
+static bool iso_edpt_open(uint8_t dev_addr, tusb_desc_endpoint_t const * ep_desc);
+static void iso_edpt_close_by_addr(uint8_t dev_addr);
+static void itd_xfer_complete_isr(ochi_itd_t* itd);
+#endif
+
 //--------------------------------------------------------------------+
 // USBH-HCD API
 //--------------------------------------------------------------------+
@@ -189,7 +203,11 @@ bool hcd_init(uint8_t rhport)
       OHCI_INT_MASTER_ENABLE_MASK;
 
   OHCI_REG->control |= OHCI_CONTROL_CONTROL_BULK_RATIO | OHCI_CONTROL_LIST_CONTROL_ENABLE_MASK |
-       OHCI_CONTROL_LIST_BULK_ENABLE_MASK | OHCI_CONTROL_LIST_PERIODIC_ENABLE_MASK; // TODO Isochronous
+       OHCI_CONTROL_LIST_BULK_ENABLE_MASK | OHCI_CONTROL_LIST_PERIODIC_ENABLE_MASK;
+
+#if CFG_TUH_ISO_EP_MAX
+  OHCI_REG->control |= OHCI_CONTROL_LIST_ISOCHRONOUS_ENABLE_MASK;
+#endif
 
   OHCI_REG->frame_interval = (OHCI_FMINTERVAL_FSMPS << 16) | OHCI_FMINTERVAL_FI;
   OHCI_REG->periodic_start = (OHCI_FMINTERVAL_FI * 9) / 10; // Periodic start is 90% of frame interval
@@ -252,10 +270,13 @@ void hcd_device_close(uint8_t rhport, uint8_t dev_addr)
     // remove bulk
     ed_list_remove_by_addr(p_ed_head[TUSB_XFER_BULK], dev_addr);
 
+#if CFG_TUH_ISO_EP_MAX
+    // free isochronous TDs, iso EDs are removed together with interrupt ones
+    iso_edpt_close_by_addr(dev_addr);
+#endif
+
     // remove interrupt
     ed_list_remove_by_addr(p_ed_head[TUSB_XFER_INTERRUPT], dev_addr);
-
-    // TODO remove ISO
   }
 }
 
@@ -402,8 +423,14 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
 {
   (void) rhport;
 
-  // TODO iso support
-  TU_ASSERT(ep_desc->bmAttributes.xfer != TUSB_XFER_ISOCHRONOUS);
+  if ( ep_desc->bmAttributes.xfer == TUSB_XFER_ISOCHRONOUS )
+  {
+#if CFG_TUH_ISO_EP_MAX
+    return iso_edpt_open(dev_addr, ep_desc);
+#else
+    TU_ASSERT(false);
+#endif
+  }
 
   //------------- Prepare Queue Head -------------//
   ohci_ed_t * p_ed;
@@ -478,8 +505,9 @@ bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t *
   }else
   {
     ohci_ed_t * ed = ed_from_addr(dev_addr, ep_addr);
-    ohci_gtd_t* gtd = gtd_find_free();
+    TU_ASSERT(ed && !ed->is_iso);
 
+    ohci_gtd_t* gtd = gtd_find_free();
     TU_ASSERT(gtd);
 
     gtd_init(gtd, buffer, buflen);
@@ -511,6 +539,298 @@ bool hcd_edpt_clear_stall(uint8_t dev_addr, uint8_t ep_addr)
 }
 
 
+//--------------------------------------------------------------------+
+// Isochronous
+//--------------------------------------------------------------------+
+#if CFG_TUH_ISO_EP_MAX
+
+// iTD buffer_page0 12 lsb: transfer slot and packet index of the first frame
+enum {
+  ITD_XFER_IDX_BIT = 11,
+  ITD_PKT_IDX_MASK = TU_BIT(ITD_XFER_IDX_BIT) - 1
+};
+
+// find isochronous endpoint of an ED, or a free one if ed is NULL
+static ohci_iso_ep_t* iso_ep_from_ed(ohci_ed_t const * ed)
+{
+  for(uint8_t i=0; i<CFG_TUH_ISO_EP_MAX; i++)
+  {
+    if ( ohci_data.iso_ep[i].ed == ed ) return &ohci_data.iso_ep[i];
+  }
+
+  return NULL;
+}
+
+static ochi_itd_t* itd_find_free(void)
+{
+  for(uint8_t i=0; i < OHCI_MAX_ITD; i++)
+  {
+    if ( !ohci_data.itd_pool[i].used ) return &ohci_data.itd_pool[i];
+  }
+
+  return NULL;
+}
+
+// Empty iTD at tail of ED TD queue, HC never processes the TD pointed by TailP
+static void itd_init_tail(ochi_itd_t* itd, uint8_t iso_idx)
+{
+  tu_memclr(itd, sizeof(ochi_itd_t));
+  itd->used    = 1;
+  itd->iso_idx = iso_idx;
+}
+
+static bool iso_edpt_open(uint8_t dev_addr, tusb_desc_endpoint_t const * ep_desc)
+{
+  ohci_iso_ep_t* iso = iso_ep_from_ed(NULL);
+  TU_ASSERT(iso);
+
+  uint16_t const ep_size = tu_edpt_packet_size(ep_desc);
+  TU_VERIFY(ohci_data.iso_bw + ep_size + ISO_OVERHEAD <= ISO_FRAME_PERIODIC_BW);
+
+  ochi_itd_t* tail = itd_find_free();
+  TU_ASSERT(tail);
+
+  ohci_ed_t* p_ed = ed_find_free();
+  TU_ASSERT(p_ed);
+
+  ed_init(p_ed, dev_addr, ep_size, ep_desc->bEndpointAddress, TUSB_XFER_ISOCHRONOUS, ep_desc->bInterval);
+
+  uint8_t const iso_idx = (uint8_t) (iso - ohci_data.iso_ep);
+  itd_init_tail(tail, iso_idx);
+
+  // empty TD queue: HeadP = TailP
+  p_ed->td_head.address = (uint32_t) tail;
+  p_ed->td_tail         = (uint32_t) tail;
+
+  tu_memclr(iso, sizeof(ohci_iso_ep_t));
+  iso->ed       = p_ed;
+  iso->tail     = tail;
+  iso->interval = (uint16_t) (1u << (tu_max8(1, tu_min8(ep_desc->bInterval, 16)) - 1)); // 2^(bInterval-1) frames
+
+  ohci_data.iso_bw = (uint16_t) (ohci_data.iso_bw + ep_size + ISO_OVERHEAD);
+
+  // iso EDs must be placed after all interrupt EDs, interrupt EDs are always inserted right after the head
+  ohci_ed_t* p_pre = p_ed_head[TUSB_XFER_ISOCHRONOUS];
+  while ( p_pre->next ) p_pre = (ohci_ed_t*) p_pre->next;
+
+  ed_list_insert(p_pre, p_ed);
+
+  return true;
+}
+
+static void iso_edpt_close_by_addr(uint8_t dev_addr)
+{
+  for(uint8_t iso_idx=0; iso_idx<CFG_TUH_ISO_EP_MAX; iso_idx++)
+  {
+    ohci_iso_ep_t* iso = &ohci_data.iso_ep[iso_idx];
+    if ( !(iso->ed && iso->ed->dev_addr == dev_addr) ) continue;
+
+    // also frees the tail iTD
+    for(uint8_t i=0; i<OHCI_MAX_ITD; i++)
+    {
+      if ( ohci_data.itd_pool[i].used && ohci_data.itd_pool[i].iso_idx == iso_idx ) ohci_data.itd_pool[i].used = 0;
+    }
+
+    ohci_data.iso_bw = (uint16_t) (ohci_data.iso_bw - iso->ed->max_packet_size - ISO_OVERHEAD);
+    iso->ed   = NULL;
+    iso->tail = NULL;
+  }
+}
+
+static inline bool td_is_iso(ohci_td_item_t const * td)
+{
+  return ((uint32_t) td >= (uint32_t) ohci_data.itd_pool) && ((uint32_t) td < (uint32_t) (ohci_data.itd_pool + OHCI_MAX_ITD));
+}
+
+// Number of packets the iTD starting at pkt_idx can carry: up to 8 consecutive frames,
+// data must be within the page of the first byte and the page of the last byte
+static uint8_t itd_packet_count(ohci_iso_ep_t const* iso, uint8_t xfer_idx, uint16_t pkt_idx, uint32_t addr)
+{
+  if ( iso->interval > 1 ) return 1;
+
+  tu_iso_packet_t const* packets = iso->xfer[xfer_idx].packets;
+  uint8_t count = 0;
+  uint32_t end = addr;
+
+  while ( (count < 8) && (pkt_idx + count < iso->xfer[xfer_idx].num_packets) )
+  {
+    uint32_t const next_end = end + packets[pkt_idx + count].length;
+    if ( tu_align4k(next_end - 1) - tu_align4k(addr) > 4096 ) break;
+
+    end = next_end;
+    count++;
+  }
+
+  return count;
+}
+
+static void itd_init(ochi_itd_t* itd, ohci_iso_ep_t const* iso, uint8_t iso_idx, uint8_t xfer_idx, uint16_t pkt_idx,
+                     uint8_t count, uint32_t addr)
+{
+  tu_memclr(itd, sizeof(ochi_itd_t));
+
+  uint32_t const page0 = tu_align4k(addr);
+
+  itd->used            = 1;
+  itd->iso_idx         = iso_idx;
+  itd->starting_frame  = (uint16_t) (iso->xfer[xfer_idx].start_frame + pkt_idx*iso->interval);
+  itd->frame_count     = (uint8_t) (count - 1);
+  itd->delay_interrupt = OHCI_INT_ON_COMPLETE_NO;
+  itd->condition_code  = OHCI_CCODE_NOT_ACCESSED;
+  itd->buffer_page0    = page0 | ((uint32_t) xfer_idx << ITD_XFER_IDX_BIT) | pkt_idx;
+
+  for(uint8_t i=0; i<count; i++)
+  {
+    // condition code is NotAccessed, bit 12 selects page of buffer_end
+    itd->offset_packetstatus[i] = (uint16_t) ((OHCI_CCODE_NOT_ACCESSED << 12) | (tu_align4k(addr) != page0 ? TU_BIT(12) : 0) |
+                                              tu_offset4k(addr));
+    addr += iso->xfer[xfer_idx].packets[pkt_idx + i].length;
+  }
+
+  itd->buffer_end = addr - 1;
+}
+
+bool hcd_edpt_iso_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer,
+                       tu_iso_packet_t* packets, uint16_t num_packets)
+{
+  (void) rhport;
+
+  ohci_ed_t* ed = ed_from_addr(dev_addr, ep_addr);
+  TU_ASSERT(ed && ed->is_iso);
+
+  ohci_iso_ep_t* iso = iso_ep_from_ed(ed);
+  TU_ASSERT(iso);
+
+  // one transfer in progress and one queued behind it
+  uint8_t const xfer_idx = iso->xfer_idx;
+  TU_ASSERT(iso->xfer[xfer_idx].pending == 0);
+
+  // packet index is kept in buffer_page0, zero length packet cannot be described with offsets
+  TU_ASSERT(num_packets && num_packets <= ITD_PKT_IDX_MASK + 1);
+  for(uint16_t i=0; i<num_packets; i++)
+  {
+    TU_ASSERT(packets[i].length && packets[i].length <= ed->max_packet_size);
+  }
+
+  iso->xfer[xfer_idx].packets       = packets;
+  iso->xfer[xfer_idx].num_packets   = num_packets;
+  iso->xfer[xfer_idx].xferred_bytes = 0;
+
+  // check there is enough TDs for the whole transfer: the current tail becomes the first iTD, one more is new tail
+  uint16_t td_count = 0;
+  uint32_t addr = (uint32_t) buffer;
+  for(uint16_t pkt_idx=0; pkt_idx<num_packets; td_count++)
+  {
+    uint8_t const count = itd_packet_count(iso, xfer_idx, pkt_idx, addr);
+    for(uint8_t i=0; i<count; i++) addr += packets[pkt_idx+i].length;
+    pkt_idx = (uint16_t) (pkt_idx + count);
+  }
+
+  uint16_t td_free = 0;
+  for(uint8_t i=0; i<OHCI_MAX_ITD; i++)
+  {
+    if ( !ohci_data.itd_pool[i].used ) td_free++;
+  }
+  TU_ASSERT(td_count <= td_free);
+
+  // Start right after the transfer in progress for continuous streaming, unless its end is already too close
+  // or passed. Otherwise start at a few frames ahead of current frame.
+  uint16_t const now = (uint16_t) OHCI_REG->frame_number;
+  uint16_t start = (uint16_t) (now + ISO_SCHED_THRESHOLD);
+  if ( iso->xfer[xfer_idx ^ 1].pending && ((int16_t) (iso->next_frame - now) >= ISO_SCHED_THRESHOLD) )
+  {
+    start = iso->next_frame;
+  }
+
+  iso->xfer[xfer_idx].start_frame = start;
+  iso->xfer[xfer_idx].pending     = td_count;
+
+  uint8_t const iso_idx = (uint8_t) (iso - ohci_data.iso_ep);
+  ochi_itd_t* first = iso->tail;
+  ochi_itd_t* itd   = first;
+  ochi_itd_t* prev  = NULL;
+
+  addr = (uint32_t) buffer;
+  for(uint16_t pkt_idx=0; pkt_idx<num_packets; )
+  {
+    // should not happen since free TDs are checked above, TDs are not visible to HC yet and can be released
+    if ( !itd )
+    {
+      for(ochi_itd_t* p = (ochi_itd_t*) first->next; p; p = (ochi_itd_t*) p->next) p->used = 0;
+      itd_init_tail(first, iso_idx);
+      iso->xfer[xfer_idx].pending = 0;
+      TU_ASSERT(itd);
+    }
+
+    uint8_t const count = itd_packet_count(iso, xfer_idx, pkt_idx, addr);
+    itd_init(itd, iso, iso_idx, xfer_idx, pkt_idx, count, addr);
+
+    if ( prev ) prev->next = (uint32_t) itd;
+    prev = itd;
+
+    for(uint8_t i=0; i<count; i++) addr += packets[pkt_idx+i].length;
+    pkt_idx = (uint16_t) (pkt_idx + count);
+
+    itd = itd_find_free();
+  }
+
+  prev->delay_interrupt = OHCI_INT_ON_COMPLETE_YES;
+
+  // new empty tail
+  if ( !itd )
+  {
+    for(ochi_itd_t* p = (ochi_itd_t*) first->next; p; p = (ochi_itd_t*) p->next) p->used = 0;
+    itd_init_tail(first, iso_idx);
+    iso->xfer[xfer_idx].pending = 0;
+    TU_ASSERT(itd);
+  }
+  itd_init_tail(itd, iso_idx);
+  prev->next = (uint32_t) itd;
+
+  iso->tail       = itd;
+  iso->next_frame = (uint16_t) (start + num_packets*iso->interval);
+  iso->xfer_idx   = xfer_idx ^ 1u;
+
+  // HC starts on the old tail once TailP is moved past it
+  ed->td_tail = (uint32_t) itd;
+
+  return true;
+}
+
+static void itd_xfer_complete_isr(ochi_itd_t* itd)
+{
+  ohci_iso_ep_t* iso = &ohci_data.iso_ep[itd->iso_idx];
+  uint16_t const pkt_idx  = (uint16_t) (itd->buffer_page0 & ITD_PKT_IDX_MASK);
+  uint8_t  const xfer_idx = (uint8_t) ((itd->buffer_page0 >> ITD_XFER_IDX_BIT) & 1u);
+  bool const is_in = (iso->ed->pid == PID_IN);
+
+  for(uint8_t i=0; i<=itd->frame_count; i++)
+  {
+    tu_iso_packet_t* pkt = &iso->xfer[xfer_idx].packets[pkt_idx + i];
+    uint16_t const psw = itd->offset_packetstatus[i];
+    uint8_t const ccode = (uint8_t) (psw >> 12);
+
+    // short IN packet is not an error, PSW size is bytes received for IN
+    bool const success = (ccode == OHCI_CCODE_NO_ERROR) || (ccode == OHCI_CCODE_DATA_UNDERRUN);
+
+    pkt->result        = success ? XFER_RESULT_SUCCESS : XFER_RESULT_FAILED;
+    pkt->actual_length = success ? (is_in ? (uint16_t) (psw & 0x7FFu) : pkt->length) : 0;
+
+    iso->xfer[xfer_idx].xferred_bytes += pkt->actual_length;
+  }
+
+  itd->used = 0; // free TD
+
+  if ( iso->xfer[xfer_idx].pending && (--iso->xfer[xfer_idx].pending == 0) )
+  {
+    // per packet result is reported in packets[]
+    hcd_event_xfer_complete(iso->ed->dev_addr, tu_edpt_addr(iso->ed->ep_number, is_in ? 1 : 0),
+                            iso->xfer[xfer_idx].xferred_bytes, XFER_RESULT_SUCCESS, true);
+  }
+}
+
+#endif
+
 //--------------------------------------------------------------------+
 // OHCI Interrupt Handler
 //--------------------------------------------------------------------+
@@ -568,7 +888,15 @@ static void done_queue_isr(uint8_t hostid)
 
   while( td_head != NULL )
   {
-    // TODO check if td_head is iso td
+#if CFG_TUH_ISO_EP_MAX
+    if ( td_is_iso(td_head) )
+    {
+      itd_xfer_complete_isr((ochi_itd_t*) td_head);
+      td_head = (ohci_td_item_t*) td_head->next;
+      continue;
+    }
+#endif
+
     //------------- Non ISO transfer -------------//
     ohci_gtd_t * const qtd = (ohci_gtd_t *) td_head;
     xfer_result_t const event = (qtd->condition_code == OHCI_CCODE_NO_ERROR) ? XFER_RESULT_SUCCESS :
@@ -37,9 +37,15 @@
 #define HOST_HCD_XFER_INTERRUPT // TODO interrupt is used widely, should always be enabled
 #define OHCI_PERIODIC_LIST (defined HOST_HCD_XFER_INTERRUPT || defined HOST_HCD_XFER_ISOCHRONOUS)
 
+// Number of isochronous TD, each covers up to 8 consecutive frames of an isochronous transfer.
+// Each opened isochronous endpoint also holds one as empty tail of its TD queue
+#ifndef CFG_TUH_OHCI_ITD_MAX
+  #define CFG_TUH_OHCI_ITD_MAX    16
+#endif
+
 // TODO merge OHCI with EHCI
 enum {
-  OHCI_MAX_ITD = 4
+  OHCI_MAX_ITD = CFG_TUH_OHCI_ITD_MAX
 };
 
 #define ED_MAX       (CFG_TUH_DEVICE_MAX*CFG_TUH_ENDPOINT_MAX)
@@ -129,14 +135,14 @@ typedef struct TU_ATTR_ALIGNED(32)
 {
 	/*---------- Word 1 ----------*/
   uint32_t starting_frame          : 16;
-  uint32_t                         : 5; // can be used
+  uint32_t iso_idx                 : 5; // HCD: isochronous endpoint the td belongs to
   uint32_t delay_interrupt         : 3;
   uint32_t frame_count             : 3;
-  uint32_t                         : 1; // can be used
+  uint32_t used                    : 1; // HCD
   volatile uint32_t condition_code : 4;
 
 	/*---------- Word 2 ----------*/
-	uint32_t buffer_page0;	// 12 lsb bits can be used
+	uint32_t buffer_page0;	// 12 lsb bits: HCD transfer slot (bit 11) and packet index of the first frame
 
 	/*---------- Word 3 ----------*/
 	volatile uint32_t next;
@@ -150,6 +156,26 @@ typedef struct TU_ATTR_ALIGNED(32)
 
 TU_VERIFY_STATIC( sizeof(ochi_itd_t) == 32, "size is not correct" );
 
+// Opened isochronous endpoint and its transfers: one in progress and one queued right after it
+typedef struct
+{
+  ohci_ed_t* ed;       // NULL if not opened
+  ochi_itd_t* tail;    // empty iTD at ED TailP, becomes first iTD of next transfer
+  uint16_t interval;   // in frames
+  uint16_t next_frame; // frame following the last submitted transfer
+  uint8_t  xfer_idx;   // slot of the next submitted transfer
+
+  struct {
+    tu_iso_packet_t* packets;
+    uint16_t num_packets;
+    uint16_t pending;    // number of iTD not yet retired
+    uint16_t start_frame;
+    uint32_t xferred_bytes;
+  }xfer[2];
+}ohci_iso_ep_t;
+
+TU_VERIFY_STATIC( CFG_TUH_ISO_EP_MAX <= 32, "iTD iso_idx is 5 bits" );
+
 // structure with member alignment required from large to small
 typedef struct TU_ATTR_ALIGNED(256)
 {
@@ -164,10 +190,15 @@ typedef struct TU_ATTR_ALIGNED(256)
     ohci_gtd_t gtd;
   }control[CFG_TUH_DEVICE_MAX+CFG_TUH_HUB+1];
 
-  //  ochi_itd_t itd[OHCI_MAX_ITD]; // itd requires alignment of 32
   ohci_ed_t ed_pool[ED_MAX];
   ohci_gtd_t gtd_pool[GTD_MAX];
 
+#if CFG_TUH_ISO_EP_MAX
+  ochi_itd_t itd_pool[OHCI_MAX_ITD]; // itd requires alignment of 32
+  ohci_iso_ep_t iso_ep[CFG_TUH_ISO_EP_MAX];
+  uint16_t iso_bw; // bytes reserved for isochronous in each frame
+#endif
+
   volatile uint16_t frame_number_hi;
 
 } ohci_data_t;
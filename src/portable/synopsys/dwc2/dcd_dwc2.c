@@ -79,13 +79,16 @@
 #define dcache_clean_invalidate(_addr, _size)
 #endif
 
-static TU_ATTR_ALIGNED(4) uint32_t _setup_packet[2];
+CFG_TUSB_MEM_SECTION static TU_ATTR_ALIGNED(4) uint32_t _setup_packet[2];
 
 typedef struct {
   uint8_t * buffer;
   tu_fifo_t * ff;
   uint16_t total_len;
   uint16_t max_size;
+  uint16_t dma_len;   // bytes armed for current DMA round, EP0 moves only one packet per round
+  uint16_t dma_tail;  // OUT bytes of the trailing partial packet, received in a second round through bounce buffer
+  bool dma_bounce;    // current OUT round is received into bounce buffer
   uint8_t interval;
 } xfer_ctl_t;
 
@@ -95,6 +98,29 @@ static xfer_ctl_t xfer_status[DWC2_EP_MAX][2];
 // EP0 transfers are limited to 1 packet - larger sizes has to be split
 static uint16_t ep0_pending[2];                   // Index determines direction as tusb_dir_t type
 
+// Data transfer mode in use, selected by CFG_TUD_DWC2_DMA and what the core actually supports
+enum {
+  DMA_MODE_NONE = 0, // slave mode
+  DMA_MODE_BUFFER,
+  DMA_MODE_DESC,
+};
+
+#if CFG_TUD_DWC2_DMA
+static uint8_t _dma_mode;
+
+// Descriptor DMA: one descriptor per endpoint & direction is enough since a transfer is at most 64KB
+CFG_TUSB_MEM_SECTION static TU_ATTR_ALIGNED(4) dwc2_dma_desc_t _dma_desc[DWC2_EP_MAX][2];
+
+// OUT DMA always writes whole packets to memory. A partial packet at the end of a transfer (e.g 31-byte MSC CBW)
+// is received here then copied to the caller's buffer, so that the core never writes past it.
+// IN DMA needs a word aligned address: fifo data that is unaligned or wrapped is copied here one packet at a time.
+#define DMA_BOUNCE_SIZE   (TUD_OPT_HIGH_SPEED ? 512 : 64)
+CFG_TUSB_MEM_SECTION static TU_ATTR_ALIGNED(4) uint8_t _dma_bounce[DWC2_EP_MAX][2][DMA_BOUNCE_SIZE];
+#else
+// slave mode only, let compiler strip all DMA code
+#define _dma_mode   DMA_MODE_NONE
+#endif
+
 // TX FIFO RAM allocation so far in words - RX FIFO size is readily available from dwc2->grxfsiz
 static uint16_t _allocated_fifo_words_tx;         // TX FIFO size in words (IN EPs)
 static bool     _out_ep_closed;                   // Flag to check if RX FIFO size needs an update (reduce its size)
@@ -124,6 +150,60 @@ static void update_grxfsiz(uint8_t rhport)
   dwc2->grxfsiz = calc_grxfsiz(max_epsize, ep_count);
 }
 
+#if CFG_TUD_DWC2_DMA
+// Arm a single descriptor for the whole transfer of an endpoint
+static uint32_t dma_desc_arm(uint8_t epnum, uint8_t dir, uint8_t * buffer, uint16_t len)
+{
+  xfer_ctl_t const * xfer = XFER_CTL_BASE(epnum, dir);
+  dwc2_dma_desc_t * desc  = &_dma_desc[epnum][dir];
+
+  uint32_t status = DEV_DMA_BS_HOST_READY | DEV_DMA_L | DEV_DMA_IOC;
+
+  if ( dir == TUSB_DIR_IN )
+  {
+    // short packet flag makes the core end the transfer with a short or zero-length packet
+    if ( (len % xfer->max_size) || (len == 0) ) status |= DEV_DMA_SP;
+    status |= len;
+  }
+  else
+  {
+    // OUT descriptor size must be a multiple of max packet size. Only a partial packet into the bounce buffer
+    // is rounded up (see edpt_schedule_packets()), so the size still fits in 16-bit and the buffer.
+    status |= tu_min32(tu_div_ceil(len, xfer->max_size) * xfer->max_size, DEV_DMA_NBYTES_MASK);
+  }
+
+  // zero-length status stage still needs a valid address
+  desc->buffer = (uint32_t) (uintptr_t) (buffer ? buffer : (uint8_t*) _setup_packet);
+  desc->status = status;
+  dcache_clean(desc, sizeof(dwc2_dma_desc_t));
+
+  return (uint32_t) (uintptr_t) desc;
+}
+
+// Arm EP0 OUT to receive the next SETUP packet into _setup_packet
+static void dma_setup_prepare(uint8_t rhport)
+{
+  dwc2_regs_t * dwc2  = DWC2_REG(rhport);
+  dwc2_epout_t* epout = &dwc2->epout[0];
+
+  // Core from 3.00a can receive SETUP while EP0 OUT is still enabled for status/data stage
+  if ( (dwc2->gsnpsid >= DWC2_CORE_REV_3_00a) && (epout->doepctl & DOEPCTL_EPENA) ) return;
+
+  if ( _dma_mode == DMA_MODE_DESC )
+  {
+    XFER_CTL_BASE(0, TUSB_DIR_OUT)->dma_len = 8;
+    epout->doepdma = dma_desc_arm(0, TUSB_DIR_OUT, (uint8_t*) _setup_packet, 8);
+  }
+  else
+  {
+    epout->doeptsiz = (1 << DOEPTSIZ_STUPCNT_Pos) | (1 << DOEPTSIZ_PKTCNT_Pos) | (8 << DOEPTSIZ_XFRSIZ_Pos);
+    epout->doepdma  = (uint32_t) (uintptr_t) _setup_packet;
+  }
+
+  epout->doepctl |= DOEPCTL_EPENA | DOEPCTL_USBAEP;
+}
+#endif
+
 // Start of Bus Reset
 static void bus_reset(uint8_t rhport)
 {
@@ -213,34 +293,86 @@ static void bus_reset(uint8_t rhport)
   xfer_status[0][TUSB_DIR_OUT].max_size = 64;
   xfer_status[0][TUSB_DIR_IN ].max_size = 64;
 
-  dwc2->epout[0].doeptsiz |= (3 << DOEPTSIZ_STUPCNT_Pos);
+#if CFG_TUD_DWC2_DMA
+  if ( _dma_mode != DMA_MODE_NONE )
+  {
+    // SETUP packets are written to memory by the core
+    dma_setup_prepare(rhport);
+  }
+  else
+#endif
+  {
+    dwc2->epout[0].doeptsiz |= (3 << DOEPTSIZ_STUPCNT_Pos);
+  }
 
   dwc2->gintmsk |= GINTMSK_OEPINT | GINTMSK_IEPINT;
 }
 
-static void edpt_schedule_packets(uint8_t rhport, uint8_t const epnum, uint8_t const dir, uint16_t const num_packets, uint16_t total_bytes)
+static void edpt_schedule_packets(uint8_t rhport, uint8_t const epnum, uint8_t const dir, uint16_t num_packets, uint16_t total_bytes)
 {
   (void) rhport;
 
   dwc2_regs_t * dwc2 = DWC2_REG(rhport);
+  xfer_ctl_t *const xfer = XFER_CTL_BASE(epnum, dir);
 
   // EP0 is limited to one packet each xfer
   // We use multiple transaction of xfer->max_size length to get a whole transfer done
   if ( epnum == 0 )
   {
-    xfer_ctl_t *const xfer = XFER_CTL_BASE(epnum, dir);
     total_bytes = tu_min16(ep0_pending[dir], xfer->max_size);
     ep0_pending[dir] -= total_bytes;
   }
 
+#if CFG_TUD_DWC2_DMA
+  // OUT with DMA: receive whole packets directly into the buffer, then the trailing partial packet in another
+  // round through the bounce buffer. Fifo OUT transfer is always a single packet through the bounce buffer.
+  xfer->dma_tail   = 0;
+  xfer->dma_bounce = false;
+
+  if ( (_dma_mode != DMA_MODE_NONE) && (dir == TUSB_DIR_OUT) && (total_bytes != 0) )
+  {
+    uint16_t const tail = total_bytes % xfer->max_size;
+
+    if ( xfer->ff || (total_bytes < xfer->max_size) )
+    {
+      xfer->dma_bounce = true;
+    }
+    else if ( tail )
+    {
+      xfer->dma_tail = tail;
+      total_bytes   -= tail;
+    }
+
+    num_packets = tu_div_ceil(total_bytes, xfer->max_size);
+  }
+#endif
+
+  xfer->dma_len = total_bytes;
+
   // IN and OUT endpoint xfers are interrupt-driven, we just schedule them here.
   if ( dir == TUSB_DIR_IN )
   {
     dwc2_epin_t* epin = dwc2->epin;
 
-    // A full IN transfer (multiple packets, possibly) triggers XFRC.
-    epin[epnum].dieptsiz = (num_packets << DIEPTSIZ_PKTCNT_Pos) |
-                           ((total_bytes << DIEPTSIZ_XFRSIZ_Pos) & DIEPTSIZ_XFRSIZ_Msk);
+#if CFG_TUD_DWC2_DMA
+    if ( _dma_mode == DMA_MODE_DESC )
+    {
+      dcache_clean(xfer->buffer, total_bytes);
+      epin[epnum].diepdma = dma_desc_arm(epnum, dir, xfer->buffer, total_bytes);
+    }
+    else
+#endif
+    {
+      // A full IN transfer (multiple packets, possibly) triggers XFRC.
+      epin[epnum].dieptsiz = (num_packets << DIEPTSIZ_PKTCNT_Pos) |
+                             ((total_bytes << DIEPTSIZ_XFRSIZ_Pos) & DIEPTSIZ_XFRSIZ_Msk);
+
+      if ( _dma_mode == DMA_MODE_BUFFER )
+      {
+        dcache_clean(xfer->buffer, total_bytes);
+        epin[epnum].diepdma = (uint32_t) (uintptr_t) xfer->buffer;
+      }
+    }
 
     epin[epnum].diepctl |= DIEPCTL_EPENA | DIEPCTL_CNAK;
 
@@ -252,7 +384,8 @@ static void edpt_schedule_packets(uint8_t rhport, uint8_t const epnum, uint8_t c
       epin[epnum].diepctl |= (odd_frame_now ? DIEPCTL_SD0PID_SEVNFRM_Msk : DIEPCTL_SODDFRM_Msk);
     }
     // Enable fifo empty interrupt only if there are something to put in the fifo.
-    if ( total_bytes != 0 )
+    // With DMA the core fetches data from memory by itself.
+    if ( (_dma_mode == DMA_MODE_NONE) && (total_bytes != 0) )
     {
       dwc2->diepempmsk |= (1 << epnum);
     }
@@ -261,10 +394,33 @@ static void edpt_schedule_packets(uint8_t rhport, uint8_t const epnum, uint8_t c
   {
     dwc2_epout_t* epout = dwc2->epout;
 
-    // A full OUT transfer (multiple packets, possibly) triggers XFRC.
-    epout[epnum].doeptsiz &= ~(DOEPTSIZ_PKTCNT_Msk | DOEPTSIZ_XFRSIZ);
-    epout[epnum].doeptsiz |= (num_packets << DOEPTSIZ_PKTCNT_Pos) |
-                             ((total_bytes << DOEPTSIZ_XFRSIZ_Pos) & DOEPTSIZ_XFRSIZ_Msk);
+#if CFG_TUD_DWC2_DMA
+    uint8_t * const dma_buf = xfer->dma_bounce ? _dma_bounce[epnum][TUSB_DIR_OUT] : xfer->buffer;
+
+    if ( _dma_mode == DMA_MODE_DESC )
+    {
+      epout[epnum].doepdma = dma_desc_arm(epnum, dir, dma_buf, total_bytes);
+    }
+    else
+#endif
+    {
+      // A full OUT transfer (multiple packets, possibly) triggers XFRC.
+      // With buffer DMA the size must be whole packets, a partial one is received into the bounce buffer
+      uint32_t const xfrsize = (_dma_mode == DMA_MODE_NONE) ? total_bytes :
+                               tu_div_ceil(total_bytes, xfer->max_size) * xfer->max_size;
+
+      epout[epnum].doeptsiz &= ~(DOEPTSIZ_PKTCNT_Msk | DOEPTSIZ_XFRSIZ);
+      epout[epnum].doeptsiz |= (num_packets << DOEPTSIZ_PKTCNT_Pos) |
+                               ((xfrsize << DOEPTSIZ_XFRSIZ_Pos) & DOEPTSIZ_XFRSIZ_Msk);
+
+#if CFG_TUD_DWC2_DMA
+      if ( _dma_mode == DMA_MODE_BUFFER )
+      {
+        // zero-length status stage still needs a valid address
+        epout[epnum].doepdma = (uint32_t) (uintptr_t) (dma_buf ? dma_buf : (uint8_t*) _setup_packet);
+      }
+#endif
+    }
 
     epout[epnum].doepctl |= DOEPCTL_EPENA | DOEPCTL_CNAK;
     if ( (epout[epnum].doepctl & DOEPCTL_EPTYP) == DOEPCTL_EPTYP_0 &&
@@ -351,6 +507,33 @@ void print_dwc2_info(dwc2_regs_t * dwc2)
 }
 #endif
 
+#if CFG_TUD_DWC2_DMA
+// Select DMA mode from configuration and core capability, must be called after core reset
+static void dma_init(dwc2_regs_t * dwc2)
+{
+  _dma_mode = DMA_MODE_NONE;
+
+  // slave-only and external DMA cores (and GD32VF103 with all-zero hwcfg) keep using FIFO push/pop
+  if ( dwc2->ghwcfg2_bm.arch != GHWCFG2_ARCH_INTERNAL_DMA ) return;
+
+  // Isochronous descriptors are not implemented: fall back to buffer DMA when an ISO class (audio, video) is enabled
+  if ( (CFG_TUD_DWC2_DMA == DMA_MODE_DESC) && !(CFG_TUD_AUDIO || CFG_TUD_VIDEO) && dwc2->ghwcfg4_bm.dma_desc_enable )
+  {
+    _dma_mode = DMA_MODE_DESC;
+    dwc2->dcfg |= DCFG_DESCDMA;
+  }
+  else
+  {
+    _dma_mode = DMA_MODE_BUFFER;
+  }
+
+  // INCR4 burst
+  dwc2->gahbcfg = (dwc2->gahbcfg & ~GAHBCFG_HBSTLEN_Msk) | GAHBCFG_HBSTLEN_2 | GAHBCFG_DMAEN;
+
+  TU_LOG(DWC2_DEBUG, "DMA mode = %u\r\n", _dma_mode);
+}
+#endif
+
 static void reset_core(dwc2_regs_t * dwc2)
 {
   // reset core
@@ -521,6 +704,10 @@ void dcd_init (uint8_t rhport)
   // Force device mode
   dwc2->gusbcfg = (dwc2->gusbcfg & ~GUSBCFG_FHMOD) | GUSBCFG_FDMOD;
 
+#if CFG_TUD_DWC2_DMA
+  dma_init(dwc2);
+#endif
+
   // Clear A override, force B Valid
   dwc2->gotgctl = (dwc2->gotgctl & ~GOTGCTL_AVALOEN) | GOTGCTL_BVALOEN | GOTGCTL_BVALOVAL;
 
@@ -535,8 +722,11 @@ void dcd_init (uint8_t rhport)
   // Required as part of core initialization.
   // TODO: How should mode mismatch be handled? It will cause
   // the core to stop working/require reset.
-  dwc2->gintmsk = GINTMSK_OTGINT   | GINTMSK_MMISM  | GINTMSK_RXFLVLM  |
-                  GINTMSK_USBSUSPM | GINTMSK_USBRST | GINTMSK_ENUMDNEM | GINTMSK_WUIM;
+  dwc2->gintmsk = GINTMSK_OTGINT   | GINTMSK_MMISM  | GINTMSK_USBSUSPM |
+                  GINTMSK_USBRST   | GINTMSK_ENUMDNEM | GINTMSK_WUIM;
+
+  // RX FIFO is only read by CPU in slave mode
+  if ( _dma_mode == DMA_MODE_NONE ) dwc2->gintmsk |= GINTMSK_RXFLVLM;
 
   // Enable global interrupt
   dwc2->gahbcfg |= GAHBCFG_GINT;
@@ -643,6 +833,11 @@ bool dcd_edpt_open (uint8_t rhport, tusb_desc_endpoint_t const * desc_edpt)
   xfer->max_size = tu_edpt_packet_size(desc_edpt);
   xfer->interval = desc_edpt->bInterval;
 
+  // Isochronous descriptors (with frame number) are not implemented: ISO endpoints can not be opened in
+  // descriptor DMA mode. Audio/video builds already fall back to buffer DMA in dma_init(), other ISO users
+  // need CFG_TUD_DWC2_DMA = 1.
+  TU_ASSERT(!(_dma_mode == DMA_MODE_DESC && desc_edpt->bmAttributes.xfer == TUSB_XFER_ISOCHRONOUS));
+
   uint16_t const fifo_size = tu_div_ceil(xfer->max_size, 4);
 
   if(dir == TUSB_DIR_OUT)
@@ -746,6 +941,14 @@ bool dcd_edpt_xfer (uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t
   xfer->ff          = NULL;
   xfer->total_len   = total_bytes;
 
+#if CFG_TUD_DWC2_DMA
+  // partial OUT packet is received through the bounce buffer
+  if ( (_dma_mode != DMA_MODE_NONE) && (dir == TUSB_DIR_OUT) && (total_bytes % xfer->max_size) )
+  {
+    TU_ASSERT(xfer->max_size <= DMA_BOUNCE_SIZE);
+  }
+#endif
+
   // EP0 can only handle one packet
   if(epnum == 0)
   {
@@ -773,6 +976,9 @@ bool dcd_edpt_xfer (uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t
 // bytes should be written and second to keep the return value free to give back a boolean
 // success message. If total_bytes is too big, the FIFO will copy only what is available
 // into the USB buffer!
+// Note: with DMA the core can not wrap around the ring buffer by itself. IN sends whole packets of the linear
+// part of the fifo when it is word aligned, otherwise a single packet copied to the bounce buffer.
+// OUT receives a single packet through the bounce buffer.
 bool dcd_edpt_xfer_fifo (uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16_t total_bytes)
 {
   // USB buffers always work in bytes so to avoid unnecessary divisions we demand item_size = 1
@@ -784,6 +990,39 @@ bool dcd_edpt_xfer_fifo (uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16
   xfer_ctl_t * xfer = XFER_CTL_BASE(epnum, dir);
   xfer->buffer      = NULL;
   xfer->ff          = ff;
+
+#if CFG_TUD_DWC2_DMA
+  if ( _dma_mode != DMA_MODE_NONE )
+  {
+    if ( dir == TUSB_DIR_IN )
+    {
+      tu_fifo_buffer_info_t info;
+      tu_fifo_get_read_info(ff, &info);
+
+      total_bytes = (uint16_t) tu_min32(total_bytes, info.len_lin + info.len_wrap);
+
+      if ( !(((uintptr_t) info.ptr_lin) & 3) && (info.len_lin >= tu_min16(total_bytes, xfer->max_size)) )
+      {
+        // DMA directly from fifo, a short packet must only end the transfer
+        if ( total_bytes > info.len_lin ) total_bytes = (uint16_t) (info.len_lin - info.len_lin % xfer->max_size);
+        xfer->buffer = info.ptr_lin;
+      }
+      else
+      {
+        TU_ASSERT(xfer->max_size <= DMA_BOUNCE_SIZE);
+        total_bytes  = tu_min16(total_bytes, xfer->max_size);
+        tu_fifo_peek_n(ff, _dma_bounce[epnum][TUSB_DIR_IN], total_bytes);
+        xfer->buffer = _dma_bounce[epnum][TUSB_DIR_IN];
+      }
+    }
+    else
+    {
+      TU_ASSERT(xfer->max_size <= DMA_BOUNCE_SIZE);
+      total_bytes = (uint16_t) tu_min32(total_bytes, tu_min32(xfer->max_size, tu_fifo_remaining(ff)));
+    }
+  }
+#endif
+
   xfer->total_len   = total_bytes;
 
   uint16_t num_packets = (total_bytes / xfer->max_size);
@@ -1085,6 +1324,81 @@ static void handle_rxflvl_irq(uint8_t rhport)
   }
 }
 
+#if CFG_TUD_DWC2_DMA
+// Number of bytes DMA'ed into memory for the current round of an OUT endpoint
+static uint16_t dma_out_received(uint8_t rhport, uint8_t epnum)
+{
+  dwc2_regs_t * dwc2 = DWC2_REG(rhport);
+  xfer_ctl_t const * xfer = XFER_CTL_BASE(epnum, TUSB_DIR_OUT);
+
+  // both modes are armed with whole packets
+  uint32_t const armed = tu_div_ceil(xfer->dma_len, xfer->max_size) * xfer->max_size;
+  uint32_t remaining;
+
+  if ( _dma_mode == DMA_MODE_DESC )
+  {
+    dwc2_dma_desc_t * desc = &_dma_desc[epnum][TUSB_DIR_OUT];
+    dcache_invalidate(desc, sizeof(dwc2_dma_desc_t));
+
+    remaining = desc->status & DEV_DMA_NBYTES_MASK;
+  }
+  else
+  {
+    remaining = (dwc2->epout[epnum].doeptsiz & DOEPTSIZ_XFRSIZ_Msk) >> DOEPTSIZ_XFRSIZ_Pos;
+  }
+
+  return (uint16_t) tu_min32(armed - remaining, xfer->dma_len);
+}
+
+// OUT transfer complete in DMA mode, there is no RXFLVL to track received bytes
+static void handle_epout_dma_xfrc(uint8_t rhport, uint8_t epnum)
+{
+  xfer_ctl_t *xfer = XFER_CTL_BASE(epnum, TUSB_DIR_OUT);
+  uint16_t const received = dma_out_received(rhport, epnum);
+
+  if ( xfer->dma_bounce )
+  {
+    dcache_invalidate(_dma_bounce[epnum][TUSB_DIR_OUT], received);
+
+    if ( xfer->ff )
+    {
+      tu_fifo_write_n(xfer->ff, _dma_bounce[epnum][TUSB_DIR_OUT], received);
+    }
+    else
+    {
+      memcpy(xfer->buffer, _dma_bounce[epnum][TUSB_DIR_OUT], received);
+    }
+  }
+  else
+  {
+    dcache_invalidate(xfer->buffer, received);
+  }
+
+  // EP0 moves one packet per round, other endpoints may still have a partial packet to receive
+  uint16_t const pending = (epnum == 0) ? ep0_pending[TUSB_DIR_OUT] : xfer->dma_tail;
+
+  // schedule another round if this was not a short packet
+  if ( pending && (received == xfer->dma_len) )
+  {
+    xfer->buffer += received;
+    edpt_schedule_packets(rhport, epnum, TUSB_DIR_OUT, 1, pending);
+  }
+  else
+  {
+    // Truncate transfer length in case of short packet
+    xfer->total_len -= (xfer->dma_len - received) + pending;
+    if ( epnum == 0 )
+    {
+      ep0_pending[TUSB_DIR_OUT] = 0;
+
+      dma_setup_prepare(rhport);
+    }
+
+    dcd_event_xfer_complete(rhport, epnum, xfer->total_len, XFER_RESULT_SUCCESS, true);
+  }
+}
+#endif
+
 static void handle_epout_irq (uint8_t rhport)
 {
   dwc2_regs_t * dwc2     = DWC2_REG(rhport);
@@ -1112,6 +1426,15 @@ static void handle_epout_irq (uint8_t rhport)
         }
 
         epout->doepint = clear_flag;
+
+#if CFG_TUD_DWC2_DMA
+        if ( _dma_mode != DMA_MODE_NONE )
+        {
+          dcache_invalidate(_setup_packet, sizeof(_setup_packet));
+          dma_setup_prepare(rhport);
+        }
+#endif
+
         dcd_event_setup_received(rhport, (uint8_t*) _setup_packet, true);
       }
 
@@ -1120,6 +1443,18 @@ static void handle_epout_irq (uint8_t rhport)
       {
         epout->doepint = DOEPINT_XFRC;
 
+#if CFG_TUD_DWC2_DMA
+        if ( _dma_mode != DMA_MODE_NONE )
+        {
+          // SETUP is also DMA'ed as an OUT transfer on EP0, it is already handled above
+          if ( !((n == 0) && (doepint & (DOEPINT_STUP | DOEPINT_STPKTRX))) )
+          {
+            handle_epout_dma_xfrc(rhport, n);
+          }
+          continue;
+        }
+#endif
+
         xfer_ctl_t *xfer = XFER_CTL_BASE(n, TUSB_DIR_OUT);
 
         // EP0 can only handle one packet
@@ -1159,11 +1494,21 @@ static void handle_epin_irq (uint8_t rhport)
         // EP0 can only handle one packet
         if ( (n == 0) && ep0_pending[TUSB_DIR_IN] )
         {
+          // With DMA, advance to the next packet in memory
+          if ( _dma_mode != DMA_MODE_NONE ) xfer->buffer += xfer->dma_len;
+
           // Schedule another packet to be transmitted.
           edpt_schedule_packets(rhport, n, TUSB_DIR_IN, 1, ep0_pending[TUSB_DIR_IN]);
         }
         else
         {
+#if CFG_TUD_DWC2_DMA
+          // Be ready for the next SETUP once control data/status stage is done
+          if ( (n == 0) && (_dma_mode != DMA_MODE_NONE) ) dma_setup_prepare(rhport);
+
+          // Data was sent by DMA from the fifo or its bounce copy
+          if ( xfer->ff && (_dma_mode != DMA_MODE_NONE) ) tu_fifo_advance_read_pointer(xfer->ff, xfer->total_len);
+#endif
           dcd_event_xfer_complete(rhport, n | TUSB_DIR_IN_MASK, xfer->total_len, XFER_RESULT_SUCCESS, true);
         }
       }
@@ -81,6 +81,12 @@ enum {
   FS_PHY_TYPE_ULPI,
 };
 
+enum {
+  GHWCFG2_ARCH_SLAVE_ONLY = 0,
+  GHWCFG2_ARCH_EXTERNAL_DMA,
+  GHWCFG2_ARCH_INTERNAL_DMA,
+};
+
 typedef struct TU_ATTR_PACKED
 {
   uint32_t op_mode                  : 3; // 0: HNP and SRP | 1: SRP | 2: non-HNP, non-SRP
@@ -183,6 +189,15 @@ typedef struct
            uint32_t reserved18[2];    // B18..B1C
 } dwc2_epout_t;
 
+// Device DMA descriptor (scatter/gather mode) for non-isochronous endpoint
+typedef struct
+{
+  volatile uint32_t status;           // Buffer status quadlet
+  volatile uint32_t buffer;           // Buffer address
+} dwc2_dma_desc_t;
+
+TU_VERIFY_STATIC(sizeof(dwc2_dma_desc_t) == 8, "incorrect size");
+
 typedef struct
 {
   //------------- Core Global -------------//
@@ -429,6 +444,10 @@ TU_VERIFY_STATIC(offsetof(dwc2_regs_t, fifo   ) == 0x1000, "incorrect size");
 #define DCFG_XCVRDLY_Msk                 (0x1UL << DCFG_XCVRDLY_Pos)             /*!< 0x00004000 */
 #define DCFG_XCVRDLY                     DCFG_XCVRDLY_Msk                        // Enables delay between xcvr_sel and txvalid during device chirp
 
+#define DCFG_DESCDMA_Pos                 (23U)
+#define DCFG_DESCDMA_Msk                 (0x1UL << DCFG_DESCDMA_Pos)              // 0x00800000 */
+#define DCFG_DESCDMA                     DCFG_DESCDMA_Msk                         // Enable scatter/gather DMA in device mode */
+
 #define DCFG_PERSCHIVL_Pos               (24U)
 #define DCFG_PERSCHIVL_Msk               (0x3UL << DCFG_PERSCHIVL_Pos)            // 0x03000000 */
 #define DCFG_PERSCHIVL                   DCFG_PERSCHIVL_Msk                       // Periodic scheduling interval */
@@ -1732,6 +1751,24 @@ TU_VERIFY_STATIC(offsetof(dwc2_regs_t, fifo   ) == 0x1000, "incorrect size");
 #define PCGCTL1_TIMER                   (0x3ul << 1)
 #define PCGCTL1_GATEEN                  TU_BIT(0)
 
+/********************  Bit definition for device DMA descriptor status quadlet  ********************/
+#define DEV_DMA_BS_MASK                 (0x3ul << 30)  // Buffer status
+#define DEV_DMA_BS_SHIFT                30
+#define DEV_DMA_BS_HOST_READY           (0x0ul << 30)
+#define DEV_DMA_BS_DMA_BUSY             (0x1ul << 30)
+#define DEV_DMA_BS_DMA_DONE             (0x2ul << 30)
+#define DEV_DMA_BS_HOST_BUSY            (0x3ul << 30)
+#define DEV_DMA_STS_MASK                (0x3ul << 28)  // Rx/Tx status
+#define DEV_DMA_STS_SUCCESS             (0x0ul << 28)
+#define DEV_DMA_STS_BUFF_FLUSH          (0x1ul << 28)
+#define DEV_DMA_STS_BUFF_ERR            (0x3ul << 28)
+#define DEV_DMA_L                       TU_BIT(27)     // Last descriptor in the list
+#define DEV_DMA_SP                      TU_BIT(26)     // Short packet
+#define DEV_DMA_IOC                     TU_BIT(25)     // Interrupt on complete
+#define DEV_DMA_SR                      TU_BIT(24)     // Setup packet received
+#define DEV_DMA_MTRF                    TU_BIT(23)     // Multiple transfer
+#define DEV_DMA_NBYTES_MASK             (0xfffful << 0)
+
 #ifdef __cplusplus
  }
 #endif
@@ -115,6 +115,69 @@ bool tu_edpt_release(tu_edpt_state_t* ep_state, osal_mutex_t mutex)
   return ret;
 }
 
+#if CFG_TUSB_TRACE
+tu_trace_ring_t tu_trace_ring =
+{
+  .magic       = TU_TRACE_MAGIC,
+  .depth       = CFG_TUSB_TRACE_DEPTH,
+  .record_size = sizeof(tu_trace_record_t)
+};
+
+void tu_trace_write(uint8_t id, uint8_t port, uint8_t ep_addr, uint8_t result, uint32_t len)
+{
+  // reserve a slot, oldest record is overwritten. A record being written while the ring is dumped can be torn
+#if defined(__ARM_ARCH_6M__)
+  // ARMv6-M has no LDREX/STREX, __atomic_fetch_add() would need libatomic: mask interrupts instead
+  uint32_t primask;
+  __asm volatile ("mrs %0, primask\n cpsid i" : "=r" (primask) :: "memory");
+  uint32_t const n = tu_trace_ring.wr_count++;
+  __asm volatile ("msr primask, %0" :: "r" (primask) : "memory");
+#else
+  uint32_t const n = __atomic_fetch_add(&tu_trace_ring.wr_count, 1, __ATOMIC_RELAXED);
+#endif
+  tu_trace_record_t* rec = &tu_trace_ring.rec[n & (CFG_TUSB_TRACE_DEPTH-1)];
+
+  rec->timestamp = tusb_timestamp_cb ? tusb_timestamp_cb() : 0;
+  rec->id        = id;
+  rec->port      = port;
+  rec->ep_addr   = ep_addr;
+  rec->result    = result;
+  rec->len       = len;
+}
+#endif
+
+#if CFG_TUSB_EDPT_STATS
+uint32_t tu_edpt_stats_timestamp(void)
+{
+  return tusb_timestamp_cb ? tusb_timestamp_cb() : 0;
+}
+
+void tu_edpt_stats_record(tu_edpt_stats_t* stats, uint32_t start_ts, xfer_result_t result, uint32_t xferred_bytes)
+{
+  stats->xfer_count++;
+  stats->byte_count += xferred_bytes;
+
+  if ( result == XFER_RESULT_STALLED )
+  {
+    stats->stall_count++;
+  }
+  else if ( result != XFER_RESULT_SUCCESS )
+  {
+    stats->error_count++;
+  }
+
+  if ( tusb_timestamp_cb )
+  {
+    uint32_t const latency = tusb_timestamp_cb() - start_ts;
+    uint32_t const scaled  = latency >> CFG_TUSB_EDPT_STATS_HIST_SHIFT;
+    uint8_t  const bin     = scaled ? (uint8_t) (tu_log2(scaled) + 1) : 0;
+
+    stats->latency_hist[tu_min8(bin, CFG_TUSB_EDPT_STATS_HIST_BINS - 1)]++;
+    stats->latency_max = tu_max32(stats->latency_max, latency);
+  }
+}
+#endif
+
 bool tu_edpt_validate(tusb_desc_endpoint_t const * desc_ep, tusb_speed_t speed)
 {
   uint16_t const max_packet_size = tu_edpt_packet_size(desc_ep);
@@ -302,7 +365,7 @@ uint32_t tu_edpt_stream_write_xfer(tu_edpt_stream_t* s)
   TU_VERIFY( stream_claim(s), 0 );
 
   // Pull data from FIFO -> EP buf
-  uint16_t const count = tu_fifo_read_n(&s->ff, s->ep_buf, s->ep_bufsize);
+  uint16_t const count = (uint16_t) tu_fifo_read_n(&s->ff, s->ep_buf, s->ep_bufsize);
 
   if ( count )
   {
@@ -321,7 +384,7 @@ uint32_t tu_edpt_stream_write(tu_edpt_stream_t* s, void const *buffer, uint32_t
 {
   TU_VERIFY(bufsize); // TODO support ZLP
 
-  uint16_t ret = tu_fifo_write_n(&s->ff, buffer, (uint16_t) bufsize);
+  tu_fifo_idx_t ret = tu_fifo_write_n(&s->ff, buffer, (tu_fifo_idx_t) bufsize);
 
   // flush if fifo has more than packet size or
   // in rare case: fifo depth is configured too small (which never reach packet size)
@@ -339,7 +402,7 @@ uint32_t tu_edpt_stream_write(tu_edpt_stream_t* s, void const *buffer, uint32_t
 
 uint32_t tu_edpt_stream_read_xfer(tu_edpt_stream_t* s)
 {
-  uint16_t available = tu_fifo_remaining(&s->ff);
+  tu_fifo_idx_t available = tu_fifo_remaining(&s->ff);
 
   // Prepare for incoming data but only allow what we can store in the ring buffer.
   // TODO Actually we can still carry out the transfer, keeping count of received bytes
@@ -356,8 +419,7 @@ uint32_t tu_edpt_stream_read_xfer(tu_edpt_stream_t* s)
   if ( available >= s->ep_packetsize )
   {
     // multiple of packet size limit by ep bufsize
-    uint16_t count = (uint16_t) (available & ~(s->ep_packetsize -1));
-    count = tu_min16(count, s->ep_bufsize);
+    uint16_t count = (uint16_t) (tu_min32(available, s->ep_bufsize) & ~(s->ep_packetsize - 1u));
 
     TU_ASSERT( stream_xfer(s, count), 0 );
 
@@ -372,7 +434,7 @@ uint32_t tu_edpt_stream_read_xfer(tu_edpt_stream_t* s)
 
 uint32_t tu_edpt_stream_read(tu_edpt_stream_t* s, void* buffer, uint32_t bufsize)
 {
-  uint32_t num_read = tu_fifo_read_n(&s->ff, buffer, (uint16_t) bufsize);
+  uint32_t num_read = tu_fifo_read_n(&s->ff, buffer, (tu_fifo_idx_t) bufsize);
   tu_edpt_stream_read_xfer(s);
   return num_read;
 }
@@ -128,6 +128,10 @@ bool tusb_init(void);
 // Check if stack is initialized
 bool tusb_inited(void);
 
+// Invoked to timestamp endpoint latency statistics (CFG_TUSB_EDPT_STATS) and trace records (CFG_TUSB_TRACE),
+// e.g cycle counter or microsecond timer. Latency histogram is not recorded and trace timestamp is 0 if not implemented
+TU_ATTR_WEAK uint32_t tusb_timestamp_cb(void);
+
 // TODO
 // bool tusb_teardown(void);
 
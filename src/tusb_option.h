@@ -176,6 +176,7 @@ typedef int make_iso_compilers_happy;
 #define OPT_OS_PICO       5  ///< Raspberry Pi Pico SDK
 #define OPT_OS_RTTHREAD   6  ///< RT-Thread
 #define OPT_OS_RTX4       7  ///< Keil RTX 4
+#define OPT_OS_POSIX      8  ///< POSIX threads (Linux, macOS etc.)
 
 // Allow to use command line to change the config name/location
 #ifdef CFG_TUSB_CONFIG_FILE
@@ -294,6 +295,52 @@ typedef int make_iso_compilers_happy;
   #define CFG_TUSB_MEM_ALIGN      TU_ATTR_ALIGNED(4)
 #endif
 
+// tu_fifo index arithmetic
+// - 0: compare and subtract for all depths
+// - 1: FIFOs with power-of-two depth wrap indices with masks, other depths keep compare and subtract
+#ifndef CFG_TUSB_FIFO_POW2
+  #define CFG_TUSB_FIFO_POW2      0
+#endif
+
+// tu_fifo index width
+// - 0: 16-bit indices and counts, depth up to 32K items
+// - 1: 32-bit indices and counts for large (e.g external RAM) buffers, depth up to 2^30 items
+#ifndef CFG_TUSB_FIFO_IDX32
+  #define CFG_TUSB_FIFO_IDX32     0
+#endif
+
+// Lock-free multi-producer write with tu_fifo_write_n_mp(), used by CDC and vendor TX instead of the write mutex.
+// Require compiler atomic compare-and-swap (e.g ARMv7-M and later) and 16-bit fifo index. Multi-producer writes
+// never overwrite: data which does not fit is dropped even if fifo is overwritable.
+#ifndef CFG_TUSB_FIFO_MP_WRITE
+  #define CFG_TUSB_FIFO_MP_WRITE  0
+#endif
+
+// Per endpoint transfer statistics, see tud_edpt_stats_get() and tuh_edpt_stats_get()
+#ifndef CFG_TUSB_EDPT_STATS
+  #define CFG_TUSB_EDPT_STATS     0
+#endif
+
+// Latency histogram in ticks of tusb_timestamp_cb(): bin 0 counts latency < 2^SHIFT,
+// bin n counts [2^(n-1+SHIFT), 2^(n+SHIFT)), last bin counts everything above
+#ifndef CFG_TUSB_EDPT_STATS_HIST_BINS
+  #define CFG_TUSB_EDPT_STATS_HIST_BINS   8
+#endif
+
+#ifndef CFG_TUSB_EDPT_STATS_HIST_SHIFT
+  #define CFG_TUSB_EDPT_STATS_HIST_SHIFT  0
+#endif
+
+// Binary trace of stack events into ring buffer tu_trace_ring, independent of CFG_TUSB_DEBUG.
+// Dump the ring and decode it with tools/trace_decode.py. Depth must be power of 2
+#ifndef CFG_TUSB_TRACE
+  #define CFG_TUSB_TRACE          0
+#endif
+
+#ifndef CFG_TUSB_TRACE_DEPTH
+  #define CFG_TUSB_TRACE_DEPTH    256
+#endif
+
 // OS selection
 #ifndef CFG_TUSB_OS
   #define CFG_TUSB_OS             OPT_OS_NONE
@@ -315,6 +362,19 @@ typedef int make_iso_compilers_happy;
   #define CFG_TUD_INTERFACE_MAX   16
 #endif
 
+// Number of transfers that can be queued per endpoint behind the one in progress with
+// usbd_edpt_xfer_queue(). Queued transfers are handed to DCD right at completion of previous one.
+// 0 to disable
+#ifndef CFG_TUD_EDPT_XFER_QUEUE_SZ
+  #define CFG_TUD_EDPT_XFER_QUEUE_SZ  0
+#endif
+
+// Software usbd_edpt_xfer_fifo() for ports without dcd_edpt_xfer_fifo(): fifo linear and wrapped parts are
+// transferred with (at most) two dcd_edpt_xfer() and reported as a single completion to class driver
+#ifndef CFG_TUD_EDPT_XFER_FIFO_SW
+  #define CFG_TUD_EDPT_XFER_FIFO_SW   0
+#endif
+
 #ifndef CFG_TUD_CDC
   #define CFG_TUD_CDC             0
 #endif
@@ -372,6 +432,15 @@ typedef int make_iso_compilers_happy;
   #define CFG_TUD_NCM         0
 #endif
 
+// Data transfer mode of Synopsys DWC2 device controller
+// - 0: slave, CPU copies every packet to/from the data FIFOs
+// - 1: internal buffer DMA
+// - 2: scatter/gather descriptor DMA, fallback to buffer DMA if not supported by the core or
+//      audio/video class is enabled (isochronous descriptors are not implemented)
+#ifndef CFG_TUD_DWC2_DMA
+  #define CFG_TUD_DWC2_DMA    0
+#endif
+
 //--------------------------------------------------------------------
 // Host Options (Default)
 //--------------------------------------------------------------------
@@ -415,6 +484,11 @@ typedef int make_iso_compilers_happy;
 #define CFG_TUH_API_EDPT_XFER 0
 #endif
 
+// Max number of isochronous endpoints opened at the same time, 0 disables isochronous support in HCD
+#ifndef CFG_TUH_ISO_EP_MAX
+#define CFG_TUH_ISO_EP_MAX 0
+#endif
+
 // Enable PIO-USB software host controller
 #ifndef CFG_TUH_RPI_PIO_USB
 #define CFG_TUH_RPI_PIO_USB 0
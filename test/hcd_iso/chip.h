@@ -0,0 +1,7 @@
+// Stand-in for LPC175x_6x chip.h from the MCU SDK: ohci.c only needs the USB base address
+#ifndef CHIP_H_
+#define CHIP_H_
+
+#define LPC_USB_BASE  0x2008C000
+
+#endif
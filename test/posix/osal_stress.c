@@ -0,0 +1,249 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2023, Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Stress test for OSAL POSIX port (OPT_OS_POSIX): semaphore, queue and fifo with mutex or lock-free multi-producer
+// write are hammered by concurrent threads with real preemption. Data integrity is verified and throughput printed.
+// Exit with non-zero code on failure.
+
+#include <stdio.h>
+#include <sched.h>
+
+#include "osal/osal.h"
+#include "common/tusb_fifo.h"
+
+#define PRODUCER_NUM    4
+#define ITEM_PER_THREAD 200000
+#define FIFO_DEPTH      256
+#define QUEUE_DEPTH     16
+
+// item is producer id (high byte) + sequence number
+#define ITEM(_id, _seq)   ( ((uint32_t) (_id) << 24) | (_seq) )
+#define ITEM_ID(_item)    ((_item) >> 24)
+#define ITEM_SEQ(_item)   ((_item) & 0xFFFFFFUL)
+
+static uint32_t elapsed_ms(struct timespec const* start)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t) ((now.tv_sec - start->tv_sec)*1000 + (now.tv_nsec - start->tv_nsec)/1000000);
+}
+
+static void report(char const* name, uint32_t items, struct timespec const* start)
+{
+  uint32_t const ms = elapsed_ms(start);
+  printf("%-24s %8lu items in %5lu ms: %6lu k items/s\r\n", name, (unsigned long) items, (unsigned long) ms,
+         (unsigned long) (ms ? items/ms : 0));
+}
+
+// Each producer's items must be received in order, exactly once
+static bool consume_verify(uint32_t next_seq[PRODUCER_NUM], uint32_t item)
+{
+  uint32_t const id = ITEM_ID(item);
+  TU_VERIFY(id < PRODUCER_NUM && ITEM_SEQ(item) == next_seq[id]);
+  next_seq[id]++;
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Semaphore
+//--------------------------------------------------------------------+
+static osal_semaphore_def_t _sem_ping_def, _sem_pong_def;
+static osal_semaphore_t _sem_ping, _sem_pong;
+
+static void* sem_pong_thread(void* arg)
+{
+  (void) arg;
+  for(uint32_t i=0; i<ITEM_PER_THREAD; i++)
+  {
+    if ( !osal_semaphore_wait(_sem_ping, 1000) ) return NULL;
+    osal_semaphore_post(_sem_pong, false);
+  }
+  return NULL;
+}
+
+static bool test_semaphore(void)
+{
+  _sem_ping = osal_semaphore_create(&_sem_ping_def);
+  _sem_pong = osal_semaphore_create(&_sem_pong_def);
+
+  // timeout without post
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  TU_VERIFY(!osal_semaphore_wait(_sem_ping, 50));
+
+  uint32_t const ms = elapsed_ms(&start);
+  TU_VERIFY(ms >= 50 && ms < 1000);
+
+  // ping pong
+  pthread_t thread;
+  pthread_create(&thread, NULL, sem_pong_thread, NULL);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(uint32_t i=0; i<ITEM_PER_THREAD; i++)
+  {
+    osal_semaphore_post(_sem_ping, false);
+    TU_VERIFY(osal_semaphore_wait(_sem_pong, 1000));
+  }
+  pthread_join(thread, NULL);
+
+  report("Semaphore ping-pong", ITEM_PER_THREAD, &start);
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Queue
+//--------------------------------------------------------------------+
+OSAL_QUEUE_DEF(usbd_int_set, _queue_def, QUEUE_DEPTH, uint32_t);
+static osal_queue_t _queue;
+
+static void* queue_producer(void* arg)
+{
+  uint32_t const id = (uint32_t) (uintptr_t) arg;
+
+  for(uint32_t seq=0; seq<ITEM_PER_THREAD; seq++)
+  {
+    uint32_t const item = ITEM(id, seq);
+    while ( !osal_queue_send(_queue, &item, false) ) sched_yield(); // full
+  }
+
+  return NULL;
+}
+
+static bool test_queue(void)
+{
+  _queue = osal_queue_create(&_queue_def);
+
+  // timeout on empty queue
+  uint32_t item;
+  TU_VERIFY(!osal_queue_receive(_queue, &item, 0));
+  TU_VERIFY(!osal_queue_receive(_queue, &item, 10));
+
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  pthread_t thread[PRODUCER_NUM];
+  for(uintptr_t i=0; i<PRODUCER_NUM; i++) pthread_create(&thread[i], NULL, queue_producer, (void*) i);
+
+  uint32_t next_seq[PRODUCER_NUM] = { 0 };
+  for(uint32_t n=0; n<PRODUCER_NUM*ITEM_PER_THREAD; n++)
+  {
+    TU_VERIFY(osal_queue_receive(_queue, &item, 1000));
+    TU_VERIFY(consume_verify(next_seq, item));
+  }
+
+  for(uint32_t i=0; i<PRODUCER_NUM; i++) pthread_join(thread[i], NULL);
+  TU_VERIFY(osal_queue_empty(_queue));
+
+  report("Queue", PRODUCER_NUM*ITEM_PER_THREAD, &start);
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// FIFO
+//--------------------------------------------------------------------+
+static tu_fifo_t _ff;
+static uint32_t _ff_buf[FIFO_DEPTH];
+static osal_mutex_def_t _ff_mutex_wr_def, _ff_mutex_rd_def;
+static bool _ff_mp;
+
+static void* fifo_producer(void* arg)
+{
+  uint32_t const id = (uint32_t) (uintptr_t) arg;
+  uint32_t items[16];
+  uint32_t seq = 0;
+
+  while ( seq < ITEM_PER_THREAD )
+  {
+    // vary write size to have partial and wrapped writes
+    uint32_t const count = tu_min32(1 + (seq % 16), ITEM_PER_THREAD - seq);
+    for(uint32_t i=0; i<count; i++) items[i] = ITEM(id, seq + i);
+
+#if CFG_TUSB_FIFO_MP_WRITE
+    uint32_t const written = _ff_mp ? tu_fifo_write_n_mp(&_ff, items, (tu_fifo_idx_t) count) :
+                                      tu_fifo_write_n(&_ff, items, (tu_fifo_idx_t) count);
+#else
+    uint32_t const written = tu_fifo_write_n(&_ff, items, (tu_fifo_idx_t) count);
+#endif
+
+    seq += written;
+    if ( written < count ) sched_yield(); // full
+  }
+
+  return NULL;
+}
+
+static bool test_fifo(bool mp)
+{
+  tu_fifo_config(&_ff, _ff_buf, FIFO_DEPTH, sizeof(uint32_t), false);
+  _ff_mp = mp;
+
+  // multi-producer write is lock-free, single reader does not need mutex either
+  if ( !mp )
+  {
+    tu_fifo_config_mutex(&_ff, osal_mutex_create(&_ff_mutex_wr_def), osal_mutex_create(&_ff_mutex_rd_def));
+  }
+
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  pthread_t thread[PRODUCER_NUM];
+  for(uintptr_t i=0; i<PRODUCER_NUM; i++) pthread_create(&thread[i], NULL, fifo_producer, (void*) i);
+
+  uint32_t next_seq[PRODUCER_NUM] = { 0 };
+  uint32_t received = 0;
+  uint32_t items[32];
+
+  while ( received < PRODUCER_NUM*ITEM_PER_THREAD )
+  {
+    tu_fifo_idx_t const count = tu_fifo_read_n(&_ff, items, TU_ARRAY_SIZE(items));
+    if ( !count )
+    {
+      TU_VERIFY(elapsed_ms(&start) < 60000);
+      sched_yield();
+    }
+
+    for(uint32_t i=0; i<count; i++) TU_VERIFY(consume_verify(next_seq, items[i]));
+    received += count;
+  }
+
+  for(uint32_t i=0; i<PRODUCER_NUM; i++) pthread_join(thread[i], NULL);
+  TU_VERIFY(tu_fifo_empty(&_ff));
+
+  report(mp ? "FIFO multi-producer" : "FIFO mutex", received, &start);
+  return true;
+}
+
+int main(void)
+{
+  bool ok = test_semaphore() && test_queue() && test_fifo(false);
+
+#if CFG_TUSB_FIFO_MP_WRITE
+  ok = ok && test_fifo(true);
+#endif
+
+  printf("%s\r\n", ok ? "PASSED" : "FAILED");
+  return ok ? 0 : 1;
+}
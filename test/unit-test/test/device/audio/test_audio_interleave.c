@@ -0,0 +1,157 @@
+/* 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include <string.h>
+#include "unity.h"
+
+#include "tusb_option.h"
+#include "audio_interleave.h"
+
+// stream of one packet: max 4 bytes per sample, 8 support FIFOs and some samples per FIFO
+#define SAMPLE_MAX    4
+#define FF_MAX        8
+#define N_SAMPLE      29
+
+// one extra byte to test unaligned buffers
+uint8_t stream[1 + SAMPLE_MAX * FF_MAX * N_SAMPLE];
+uint8_t stream_ref[sizeof(stream)];
+uint8_t ff_buf[FF_MAX][1 + SAMPLE_MAX * N_SAMPLE + 1];
+uint8_t ff_ref[FF_MAX][sizeof(ff_buf[0])];
+
+void setUp(void)
+{
+  for ( unsigned i = 0; i < sizeof(stream); i++ ) stream[i] = (uint8_t) (i * 7 + 3);
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+// Reference per-sample copy
+//--------------------------------------------------------------------+
+static uint8_t * ref_decode(uint16_t n_bytes, uint8_t * dst, uint8_t * dst_end, uint8_t * src, uint8_t n_ff_used)
+{
+  while ( dst < dst_end )
+  {
+    memcpy(dst, src, n_bytes);
+    dst += n_bytes;
+    src += n_bytes * n_ff_used;
+  }
+  return src;
+}
+
+static uint8_t * ref_encode(uint16_t n_bytes, uint8_t * src, uint8_t * src_end, uint8_t * dst, uint8_t n_ff_used)
+{
+  while ( src < src_end )
+  {
+    memcpy(dst, src, n_bytes);
+    src += n_bytes;
+    dst += n_bytes * n_ff_used;
+  }
+  return dst;
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+
+// every sample size, FIFO count, sample count (to cover batched loop and tail) and alignment
+void test_decode(void)
+{
+  for ( uint8_t n_bytes = 1; n_bytes <= SAMPLE_MAX; n_bytes++ )
+  {
+    for ( uint8_t n_ff = 1; n_ff <= FF_MAX; n_ff++ )
+    {
+      for ( uint16_t n_sample = 0; n_sample <= N_SAMPLE; n_sample++ )
+      {
+        for ( uint8_t offset = 0; offset < 2; offset++ )
+        {
+          uint16_t const len = (uint16_t) (n_sample * n_bytes);
+
+          memset(ff_buf, 0xAA, sizeof(ff_buf));
+          memset(ff_ref, 0xAA, sizeof(ff_ref));
+
+          uint8_t* src     = stream + offset;
+          uint8_t* src_ref = stream + offset;
+
+          for ( uint8_t i = 0; i < n_ff; i++ )
+          {
+            uint8_t* dst     = ff_buf[i] + offset;
+            uint8_t* dst_ref = ff_ref[i] + offset;
+
+            src     = audiod_interleaved_copy_bytes_fast_decode(n_bytes, dst, dst + len, src, n_ff);
+            src_ref = ref_decode(n_bytes, dst_ref, dst_ref + len, src_ref, n_ff);
+
+            // next FIFO starts at its first sample of the stream
+            TEST_ASSERT_EQUAL_PTR(src_ref, src);
+            src     = stream + offset + (i + 1) * n_bytes;
+            src_ref = src;
+          }
+
+          TEST_ASSERT_EQUAL_MEMORY(ff_ref, ff_buf, sizeof(ff_buf));
+        }
+      }
+    }
+  }
+}
+
+void test_encode(void)
+{
+  for ( uint8_t n_bytes = 1; n_bytes <= SAMPLE_MAX; n_bytes++ )
+  {
+    for ( uint8_t n_ff = 1; n_ff <= FF_MAX; n_ff++ )
+    {
+      for ( uint16_t n_sample = 0; n_sample <= N_SAMPLE; n_sample++ )
+      {
+        for ( uint8_t offset = 0; offset < 2; offset++ )
+        {
+          uint16_t const len = (uint16_t) (n_sample * n_bytes);
+
+          for ( uint8_t i = 0; i < n_ff; i++ )
+          {
+            for ( unsigned k = 0; k < sizeof(ff_buf[i]); k++ ) ff_buf[i][k] = (uint8_t) (i * 31 + k);
+          }
+
+          memset(stream, 0xAA, sizeof(stream));
+          memset(stream_ref, 0xAA, sizeof(stream_ref));
+
+          for ( uint8_t i = 0; i < n_ff; i++ )
+          {
+            uint8_t* src = ff_buf[i] + offset;
+
+            uint8_t* dst     = audiod_interleaved_copy_bytes_fast_encode(n_bytes, src, src + len, stream + offset + i * n_bytes, n_ff);
+            uint8_t* dst_ref = ref_encode(n_bytes, src, src + len, stream_ref + offset + i * n_bytes, n_ff);
+
+            TEST_ASSERT_EQUAL(dst_ref - stream_ref, dst - stream);
+          }
+
+          TEST_ASSERT_EQUAL_MEMORY(stream_ref, stream, sizeof(stream));
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,326 @@
+/* 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, hathach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Built with CFG_TUD_MSC_EP_BUFNUM = 2 (see project.yml): storage is accessed while the other buffer is transferred
+
+#include <stdio.h>
+#include "unity.h"
+
+// Files to test
+#include "osal/osal.h"
+#include "tusb_fifo.h"
+#include "tusb.h"
+#include "usbd.h"
+TEST_FILE("usbd_control.c")
+TEST_FILE("msc_device.c")
+
+// Mock File
+#include "mock_dcd.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+
+enum
+{
+  EDPT_CTRL_OUT = 0x00,
+  EDPT_CTRL_IN  = 0x80,
+
+  EDPT_MSC_OUT  = 0x01,
+  EDPT_MSC_IN   = 0x81,
+};
+
+uint8_t const rhport = 0;
+
+enum
+{
+  ITF_NUM_MSC,
+  ITF_NUM_TOTAL
+};
+
+#define CONFIG_TOTAL_LEN    (TUD_CONFIG_DESC_LEN + TUD_MSC_DESC_LEN)
+
+uint8_t const desc_configuration[] =
+{
+  // Config number, interface count, string index, total length, attribute, power in mA
+  TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
+
+  // Interface number, string index, EP Out & EP In address, EP size
+  TUD_MSC_DESCRIPTOR(ITF_NUM_MSC, 0, EDPT_MSC_OUT, EDPT_MSC_IN, TUD_OPT_HIGH_SPEED ? 512 : 64),
+};
+
+tusb_control_request_t const request_set_configuration =
+{
+  .bmRequestType = 0x00,
+  .bRequest      = TUSB_REQ_SET_CONFIGURATION,
+  .wValue        = 1,
+  .wIndex        = 0,
+  .wLength       = 0
+};
+
+enum
+{
+  DISK_BLOCK_NUM  = 16, // 8KB is the smallest size that windows allow to mount
+  DISK_BLOCK_SIZE = 512,
+
+  BLOCK_COUNT     = 4,  // blocks per READ10/WRITE10, twice the buffer ring
+  LBA             = 2
+};
+
+TU_VERIFY_STATIC(CFG_TUD_MSC_EP_BUFNUM == 2 && CFG_TUD_MSC_EP_BUFSIZE == DISK_BLOCK_SIZE, "test expects 2 block buffers");
+
+uint8_t msc_disk[DISK_BLOCK_NUM][DISK_BLOCK_SIZE];
+
+// Sequence of storage callbacks and bulk transfers e.g "R2 I512 " for tud_msc_read10_cb(lba 2) then IN transfer
+char event_log[256];
+
+// Host side of bulk endpoints: CBW to send, data to send (WRITE10) and received data (READ10)
+msc_cbw_t host_cbw;
+uint8_t   host_data[BLOCK_COUNT][DISK_BLOCK_SIZE];
+uint32_t  host_data_len;
+
+static void log_event(char type, uint32_t value)
+{
+  size_t const len = strlen(event_log);
+  snprintf(event_log + len, sizeof(event_log) - len, "%c%lu ", type, (unsigned long) value);
+}
+
+//--------------------------------------------------------------------+
+// Application callbacks
+//--------------------------------------------------------------------+
+
+void tud_msc_inquiry_cb(uint8_t lun, uint8_t vendor_id[8], uint8_t product_id[16], uint8_t product_rev[4])
+{
+  (void) lun;
+  (void) vendor_id;
+  (void) product_id;
+  (void) product_rev;
+}
+
+bool tud_msc_test_unit_ready_cb(uint8_t lun)
+{
+  (void) lun;
+  return true;
+}
+
+void tud_msc_capacity_cb(uint8_t lun, uint32_t* block_count, uint16_t* block_size)
+{
+  (void) lun;
+
+  *block_count = DISK_BLOCK_NUM;
+  *block_size  = DISK_BLOCK_SIZE;
+}
+
+int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize)
+{
+  (void) lun;
+
+  log_event('R', lba);
+
+  memcpy(buffer, msc_disk[lba] + offset, bufsize);
+  return (int32_t) bufsize;
+}
+
+int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize)
+{
+  (void) lun;
+
+  log_event('W', lba);
+
+  memcpy(msc_disk[lba] + offset, buffer, bufsize);
+  return (int32_t) bufsize;
+}
+
+int32_t tud_msc_scsi_cb (uint8_t lun, uint8_t const scsi_cmd[16], void* buffer, uint16_t bufsize)
+{
+  (void) lun;
+  (void) scsi_cmd;
+  (void) buffer;
+  (void) bufsize;
+
+  return -1;
+}
+
+uint8_t const * tud_descriptor_device_cb(void)
+{
+  return NULL;
+}
+
+uint8_t const * tud_descriptor_configuration_cb(uint8_t index)
+{
+  (void) index;
+  return desc_configuration;
+}
+
+uint16_t const* tud_descriptor_string_cb(uint8_t index, uint16_t langid)
+{
+  (void) index;
+  (void) langid;
+  return NULL;
+}
+
+//--------------------------------------------------------------------+
+// Host side of bulk endpoints
+//--------------------------------------------------------------------+
+
+// Stub of dcd_edpt_xfer(): host fills OUT buffer when transfer is queued, IN data is collected
+static bool stub_dcd_edpt_xfer(uint8_t rhport_, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes, int num_calls)
+{
+  (void) rhport_;
+  (void) num_calls;
+
+  if ( ep_addr == EDPT_MSC_OUT )
+  {
+    if ( total_bytes == sizeof(msc_cbw_t) )
+    {
+      memcpy(buffer, &host_cbw, sizeof(msc_cbw_t));
+    }else
+    {
+      TEST_ASSERT_LESS_OR_EQUAL(sizeof(host_data), host_data_len + total_bytes);
+      memcpy(buffer, ((uint8_t*) host_data) + host_data_len, total_bytes);
+      host_data_len += total_bytes;
+    }
+
+    log_event('O', total_bytes);
+  }
+  else if ( ep_addr == EDPT_MSC_IN )
+  {
+    if ( total_bytes != sizeof(msc_csw_t) )
+    {
+      TEST_ASSERT_LESS_OR_EQUAL(sizeof(host_data), host_data_len + total_bytes);
+      memcpy(((uint8_t*) host_data) + host_data_len, buffer, total_bytes);
+      host_data_len += total_bytes;
+    }
+
+    log_event('I', total_bytes);
+  }
+
+  return true;
+}
+
+// Configure device, host sends CBW
+static void send_cbw(uint8_t cmd_code, uint8_t dir)
+{
+  scsi_read10_t const cmd =
+  {
+    .cmd_code    = cmd_code,
+    .lba         = tu_htonl(LBA),
+    .block_count = tu_htons(BLOCK_COUNT)
+  };
+
+  host_cbw = (msc_cbw_t)
+  {
+    .signature   = MSC_CBW_SIGNATURE,
+    .tag         = 0xCAFECAFE,
+    .total_bytes = BLOCK_COUNT*DISK_BLOCK_SIZE,
+    .lun         = 0,
+    .dir         = dir,
+    .cmd_len     = sizeof(scsi_read10_t)
+  };
+  memcpy(host_cbw.command, &cmd, sizeof(cmd));
+
+  uint8_t const* desc_ep = tu_desc_next(tu_desc_next(desc_configuration));
+
+  dcd_event_setup_received(rhport, (uint8_t*) &request_set_configuration, false);
+
+  dcd_edpt_open_ExpectAndReturn(rhport, (tusb_desc_endpoint_t const *) desc_ep, true);
+  dcd_edpt_open_ExpectAndReturn(rhport, (tusb_desc_endpoint_t const *) tu_desc_next(desc_ep), true);
+
+  dcd_event_xfer_complete(rhport, EDPT_MSC_OUT, sizeof(msc_cbw_t), 0, true);
+
+  tud_task();
+}
+
+// Host completes bulk transfer
+static void xfer_complete(uint8_t ep_addr, uint32_t len)
+{
+  strcat(event_log, "| ");
+  dcd_event_xfer_complete(rhport, ep_addr, len, 0, true);
+  tud_task();
+}
+
+void setUp(void)
+{
+  dcd_int_disable_Ignore();
+  dcd_int_enable_Ignore();
+  dcd_edpt_xfer_Stub(stub_dcd_edpt_xfer);
+
+  if ( !tusb_inited() )
+  {
+    dcd_init_Expect(rhport);
+    tusb_init();
+  }
+
+  dcd_event_bus_reset(rhport, TUSB_SPEED_HIGH, false);
+  tud_task();
+
+  for(uint32_t i=0; i<sizeof(msc_disk); i++) ((uint8_t*) msc_disk)[i] = (uint8_t) (i + i/DISK_BLOCK_SIZE);
+
+  event_log[0]  = 0;
+  host_data_len = 0;
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+//
+//--------------------------------------------------------------------+
+
+// next block is read from storage while previous one is sent
+void test_msc_read10_bufnum(void)
+{
+  send_cbw(SCSI_CMD_READ_10, TUSB_DIR_IN_MASK);
+  TEST_ASSERT_EQUAL_STRING("O31 R2 I512 R3 ", event_log);
+
+  for(uint8_t i=0; i<BLOCK_COUNT; i++) xfer_complete(EDPT_MSC_IN, DISK_BLOCK_SIZE);
+
+  // CSW
+  xfer_complete(EDPT_MSC_IN, sizeof(msc_csw_t));
+
+  TEST_ASSERT_EQUAL_STRING("O31 R2 I512 R3 | I512 R4 | I512 R5 | I512 | I13 | O31 ", event_log);
+  TEST_ASSERT_EQUAL(sizeof(host_data), host_data_len);
+  TEST_ASSERT_EQUAL_MEMORY(msc_disk[LBA], host_data, sizeof(host_data));
+}
+
+// next block is received from host while previous one is written to storage
+void test_msc_write10_bufnum(void)
+{
+  for(uint32_t i=0; i<sizeof(host_data); i++) ((uint8_t*) host_data)[i] = (uint8_t) (0xff - i);
+
+  send_cbw(SCSI_CMD_WRITE_10, 0);
+  TEST_ASSERT_EQUAL_STRING("O31 O512 ", event_log);
+
+  for(uint8_t i=0; i<BLOCK_COUNT; i++) xfer_complete(EDPT_MSC_OUT, DISK_BLOCK_SIZE);
+
+  // CSW
+  xfer_complete(EDPT_MSC_IN, sizeof(msc_csw_t));
+
+  TEST_ASSERT_EQUAL_STRING("O31 O512 | O512 W2 | O512 W3 | O512 W4 | W5 I13 | O31 ", event_log);
+  TEST_ASSERT_EQUAL(sizeof(host_data), host_data_len);
+  TEST_ASSERT_EQUAL_MEMORY(host_data, msc_disk[LBA], sizeof(host_data));
+}
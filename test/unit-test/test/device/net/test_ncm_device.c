@@ -0,0 +1,682 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2023, Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// NCM driver is tested alone: the usbd endpoint and control API it uses are faked below.
+// Built with CFG_TUD_NCM_NTB32, CFG_TUD_NCM_OUT_NTB_N = 2 and 2 NDPs of 2 datagrams per IN NTB (see project.yml)
+
+#include <string.h>
+#include "unity.h"
+
+// Files to test
+#include "tusb_option.h"
+#include "device/usbd_pvt.h"
+#include "net_device.h"
+TEST_FILE("ncm_device.c")
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+
+enum
+{
+  ITF_NUM_NCM = 0,
+
+  EDPT_NOTIF = 0x81,
+  EDPT_OUT   = 0x02,
+  EDPT_IN    = 0x82,
+
+  EDPT_SIZE  = CFG_TUD_NET_ENDPOINT_SIZE,
+};
+
+enum
+{
+  NTH16_LEN = 12,
+  NDP16_LEN = 8,  // without datagram entries
+  NTH32_LEN = 16,
+  NDP32_LEN = 16,
+};
+
+#define NTH16_SIGNATURE      0x484D434E
+#define NDP16_SIGNATURE_NCM0 0x304D434E
+#define NTH32_SIGNATURE      0x686D636E
+#define NDP32_SIGNATURE_NCM0 0x306D636E
+
+uint8_t const desc_ncm[] =
+{
+  // Management interface, header functional descriptor, notification endpoint
+  9, TUSB_DESC_INTERFACE, ITF_NUM_NCM, 0, 1, TUSB_CLASS_CDC, CDC_COMM_SUBCLASS_NETWORK_CONTROL_MODEL, 0, 0,
+  5, TUSB_DESC_CS_INTERFACE, CDC_FUNC_DESC_HEADER, U16_TO_U8S_LE(0x0110),
+  7, TUSB_DESC_ENDPOINT, EDPT_NOTIF, TUSB_XFER_INTERRUPT, U16_TO_U8S_LE(64), 50,
+
+  // Data interface alternate 0 and 1 with bulk endpoint pair
+  9, TUSB_DESC_INTERFACE, ITF_NUM_NCM+1, 0, 0, TUSB_CLASS_CDC_DATA, 0, NCM_DATA_PROTOCOL_NETWORK_TRANSFER_BLOCK, 0,
+  9, TUSB_DESC_INTERFACE, ITF_NUM_NCM+1, 1, 2, TUSB_CLASS_CDC_DATA, 0, NCM_DATA_PROTOCOL_NETWORK_TRANSFER_BLOCK, 0,
+  7, TUSB_DESC_ENDPOINT, EDPT_OUT, TUSB_XFER_BULK, U16_TO_U8S_LE(EDPT_SIZE), 0,
+  7, TUSB_DESC_ENDPOINT, EDPT_IN , TUSB_XFER_BULK, U16_TO_U8S_LE(EDPT_SIZE), 0,
+};
+
+//------------- usbd fake -------------//
+
+// last transfer armed on OUT endpoint
+uint8_t* out_buf;
+uint16_t out_len;
+uint8_t  out_armed;
+
+// transfers queued on IN endpoint
+typedef struct
+{
+  uint8_t const* buf;
+  uint16_t len;
+} in_xfer_t;
+
+in_xfer_t in_xfer[16];
+uint8_t   in_count;
+uint8_t   in_queue_available;
+
+bool usbd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * desc_ep)
+{
+  (void) rhport;
+  (void) desc_ep;
+  return true;
+}
+
+bool usbd_open_edpt_pair(uint8_t rhport, uint8_t const* p_desc, uint8_t ep_count, uint8_t xfer_type, uint8_t* ep_out, uint8_t* ep_in)
+{
+  (void) rhport;
+  (void) p_desc;
+  (void) ep_count;
+  (void) xfer_type;
+
+  *ep_out = EDPT_OUT;
+  *ep_in  = EDPT_IN;
+  return true;
+}
+
+bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes)
+{
+  (void) rhport;
+
+  if ( ep_addr == EDPT_OUT )
+  {
+    out_buf = buffer;
+    out_len = total_bytes;
+    out_armed++;
+  }
+
+  return true;
+}
+
+bool usbd_edpt_xfer_queue(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes)
+{
+  (void) rhport;
+
+  TEST_ASSERT_EQUAL_HEX8(EDPT_IN, ep_addr);
+  TEST_ASSERT_NOT_EQUAL(0, in_queue_available);
+  TEST_ASSERT_LESS_THAN(TU_ARRAY_SIZE(in_xfer), in_count);
+
+  in_xfer[in_count++] = (in_xfer_t) { .buf = buffer, .len = total_bytes };
+  in_queue_available--;
+
+  return true;
+}
+
+uint8_t usbd_edpt_xfer_queue_available(uint8_t rhport, uint8_t ep_addr)
+{
+  (void) rhport;
+  (void) ep_addr;
+  return in_queue_available;
+}
+
+bool tud_control_xfer(uint8_t rhport, tusb_control_request_t const * request, void* buffer, uint16_t len)
+{
+  (void) rhport;
+  (void) request;
+  (void) buffer;
+  (void) len;
+  return true;
+}
+
+bool tud_control_status(uint8_t rhport, tusb_control_request_t const * request)
+{
+  (void) rhport;
+  (void) request;
+  return true;
+}
+
+//------------- network callbacks -------------//
+
+// received datagrams, each is kept until tud_network_recv_renew()
+uint8_t  rx_data[8][2048];
+uint16_t rx_len[8];
+uint8_t  rx_count;
+
+uint8_t  tx_marker;
+void*    xmit_done_ref;
+uint8_t  xmit_done_count;
+
+bool tud_network_recv_cb(const uint8_t *src, uint16_t size)
+{
+  TEST_ASSERT_LESS_THAN(TU_ARRAY_SIZE(rx_data), rx_count);
+  TEST_ASSERT_LESS_OR_EQUAL(sizeof(rx_data[0]), size);
+
+  memcpy(rx_data[rx_count], src, size);
+  rx_len[rx_count] = size;
+  rx_count++;
+
+  return true;
+}
+
+// datagram of arg bytes, all set to tx_marker
+uint16_t tud_network_xmit_cb(uint8_t *dst, void *ref, uint16_t arg)
+{
+  (void) ref;
+  memset(dst, tx_marker, arg);
+  return arg;
+}
+
+void tud_network_xmit_done_cb(void *ref)
+{
+  xmit_done_ref = ref;
+  xmit_done_count++;
+}
+
+//--------------------------------------------------------------------+
+// Helper
+//--------------------------------------------------------------------+
+
+static void set_data_alt(uint8_t alt)
+{
+  tusb_control_request_t const request =
+  {
+    .bmRequestType = 0x01,
+    .bRequest      = TUSB_REQ_SET_INTERFACE,
+    .wValue        = alt,
+    .wIndex        = ITF_NUM_NCM+1,
+    .wLength       = 0
+  };
+
+  TEST_ASSERT_TRUE(netd_control_xfer_cb(0, CONTROL_STAGE_SETUP, &request));
+}
+
+static void set_ntb_format(uint16_t format)
+{
+  tusb_control_request_t const request =
+  {
+    .bmRequestType = 0x21,
+    .bRequest      = NCM_SET_NTB_FORMAT,
+    .wValue        = format,
+    .wIndex        = ITF_NUM_NCM,
+    .wLength       = 0
+  };
+
+  TEST_ASSERT_TRUE(netd_control_xfer_cb(0, CONTROL_STAGE_SETUP, &request));
+}
+
+// Host sends an NTB on OUT endpoint
+static void receive(uint8_t const* ntb, uint16_t len)
+{
+  TEST_ASSERT_NOT_NULL(out_buf);
+  TEST_ASSERT_LESS_OR_EQUAL(out_len, len);
+
+  memcpy(out_buf, ntb, len);
+  TEST_ASSERT_TRUE(netd_xfer_cb(0, EDPT_OUT, XFER_RESULT_SUCCESS, len));
+}
+
+// Application consumes all pending datagrams
+static void renew_all(void)
+{
+  uint8_t count;
+  do
+  {
+    count = rx_count;
+    tud_network_recv_renew();
+  } while ( count != rx_count );
+}
+
+// Complete IN transfers queued so far
+static void complete_in(uint8_t start)
+{
+  uint8_t const count = in_count;
+  for ( uint8_t i = start; i < count; i++ )
+  {
+    in_queue_available++;
+    TEST_ASSERT_TRUE(netd_xfer_cb(0, EDPT_IN, XFER_RESULT_SUCCESS, in_xfer[i].len));
+  }
+}
+
+// Concatenate IN transfers from start into buf, return total length
+static uint16_t collect_in(uint8_t start, uint8_t* buf)
+{
+  uint16_t len = 0;
+  for ( uint8_t i = start; i < in_count; i++ )
+  {
+    memcpy(buf + len, in_xfer[i].buf, in_xfer[i].len);
+    len += in_xfer[i].len;
+  }
+  return len;
+}
+
+// NTB16 with NDP right after NTH, datagram i has len[i] bytes of value (0x10 + i)
+static uint16_t build_ntb16(uint8_t* ntb, uint16_t const len[], uint8_t count)
+{
+  uint16_t const ndp = NTH16_LEN;
+  uint16_t offset = (uint16_t) (ndp + NDP16_LEN + 4*(count+1));
+
+  tu_unaligned_write32(ntb, NTH16_SIGNATURE);
+  tu_unaligned_write16(ntb + 4, NTH16_LEN);
+  tu_unaligned_write16(ntb + 6, 0);
+  tu_unaligned_write16(ntb + 10, ndp);
+
+  tu_unaligned_write32(ntb + ndp, NDP16_SIGNATURE_NCM0);
+  tu_unaligned_write16(ntb + ndp + 4, (uint16_t) (NDP16_LEN + 4*(count+1)));
+  tu_unaligned_write16(ntb + ndp + 6, 0);
+
+  for ( uint8_t i = 0; i < count; i++ )
+  {
+    tu_unaligned_write16(ntb + ndp + NDP16_LEN + 4*i    , offset);
+    tu_unaligned_write16(ntb + ndp + NDP16_LEN + 4*i + 2, len[i]);
+    memset(ntb + offset, 0x10 + i, len[i]);
+    offset = (uint16_t) (offset + tu_div_ceil(len[i], 4)*4);
+  }
+
+  // terminator
+  tu_unaligned_write32(ntb + ndp + NDP16_LEN + 4*count, 0);
+
+  tu_unaligned_write16(ntb + 8, offset);
+  return offset;
+}
+
+static void check_rx(uint8_t i, uint16_t len, uint8_t value)
+{
+  TEST_ASSERT_EQUAL(len, rx_len[i]);
+  TEST_ASSERT_EACH_EQUAL_HEX8(value, rx_data[i], len);
+}
+
+void setUp(void)
+{
+  out_buf   = NULL;
+  out_len   = 0;
+  out_armed = 0;
+  in_count  = 0;
+  in_queue_available = 4;
+
+  rx_count  = 0;
+  tx_marker = 0;
+  xmit_done_ref   = NULL;
+  xmit_done_count = 0;
+
+  netd_init();
+  TEST_ASSERT_EQUAL(sizeof(desc_ncm), netd_open(0, (tusb_desc_interface_t const*) desc_ncm, sizeof(desc_ncm)));
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+// Receive: NTB parser
+//--------------------------------------------------------------------+
+
+void test_ncm_rx_ntb16(void)
+{
+  uint8_t ntb[512];
+  uint16_t const len[] = { 60, 33 };
+
+  set_data_alt(1);
+  TEST_ASSERT_EQUAL(1, out_armed);
+
+  receive(ntb, build_ntb16(ntb, len, 2));
+  renew_all();
+
+  TEST_ASSERT_EQUAL(2, rx_count);
+  check_rx(0, 60, 0x10);
+  check_rx(1, 33, 0x11);
+}
+
+void test_ncm_rx_ntb32_ndp_chain(void)
+{
+  uint8_t ntb[512];
+  memset(ntb, 0, sizeof(ntb));
+
+  // NTH32, NDP32 with 1 datagram linked to NDP32 with 2 datagrams placed after the datagrams
+  uint32_t const ndp1 = NTH32_LEN;
+  uint32_t const ndp2 = 256;
+
+  tu_unaligned_write32(ntb, NTH32_SIGNATURE);
+  tu_unaligned_write16(ntb + 4, NTH32_LEN);
+  tu_unaligned_write32(ntb + 8, 320);
+  tu_unaligned_write32(ntb + 12, ndp1);
+
+  tu_unaligned_write32(ntb + ndp1, NDP32_SIGNATURE_NCM0);
+  tu_unaligned_write16(ntb + ndp1 + 4, NDP32_LEN + 8*2);
+  tu_unaligned_write32(ntb + ndp1 + 8, ndp2);
+  tu_unaligned_write32(ntb + ndp1 + NDP32_LEN    , 64);
+  tu_unaligned_write32(ntb + ndp1 + NDP32_LEN + 4, 40);
+  memset(ntb + 64, 0x10, 40);
+
+  tu_unaligned_write32(ntb + ndp2, NDP32_SIGNATURE_NCM0);
+  tu_unaligned_write16(ntb + ndp2 + 4, NDP32_LEN + 8*3);
+  tu_unaligned_write32(ntb + ndp2 + NDP32_LEN     , 128);
+  tu_unaligned_write32(ntb + ndp2 + NDP32_LEN +  4, 50);
+  tu_unaligned_write32(ntb + ndp2 + NDP32_LEN +  8, 192);
+  tu_unaligned_write32(ntb + ndp2 + NDP32_LEN + 12, 20);
+  memset(ntb + 128, 0x11, 50);
+  memset(ntb + 192, 0x12, 20);
+
+  set_data_alt(1);
+  receive(ntb, 320);
+  renew_all();
+
+  TEST_ASSERT_EQUAL(3, rx_count);
+  check_rx(0, 40, 0x10);
+  check_rx(1, 50, 0x11);
+  check_rx(2, 20, 0x12);
+}
+
+void test_ncm_rx_truncated_nth(void)
+{
+  uint8_t ntb[512];
+  uint16_t const len[] = { 60 };
+  build_ntb16(ntb, len, 1);
+
+  set_data_alt(1);
+
+  // shorter than NTH: dropped and OUT endpoint is armed again
+  receive(ntb, NTH16_LEN - 1);
+  renew_all();
+
+  TEST_ASSERT_EQUAL(0, rx_count);
+  TEST_ASSERT_EQUAL(2, out_armed);
+
+  // NTB received afterwards is still parsed
+  receive(ntb, build_ntb16(ntb, len, 1));
+  TEST_ASSERT_EQUAL(1, rx_count);
+}
+
+void test_ncm_rx_truncated_ndp(void)
+{
+  uint8_t ntb[512];
+  uint16_t const len[] = { 60 };
+  build_ntb16(ntb, len, 1);
+
+  set_data_alt(1);
+
+  // NTB ends within the NDP header
+  receive(ntb, NTH16_LEN + NDP16_LEN - 1);
+  renew_all();
+  TEST_ASSERT_EQUAL(0, rx_count);
+
+  // NDP length goes past end of NTB
+  uint16_t const ntb_len = build_ntb16(ntb, len, 1);
+  tu_unaligned_write16(ntb + NTH16_LEN + 4, ntb_len);
+  receive(ntb, ntb_len);
+  renew_all();
+  TEST_ASSERT_EQUAL(0, rx_count);
+}
+
+void test_ncm_rx_ndp_out_of_range(void)
+{
+  uint8_t ntb[512];
+  uint16_t const len[] = { 60 };
+
+  set_data_alt(1);
+
+  // NDP index past end of NTB
+  uint16_t ntb_len = build_ntb16(ntb, len, 1);
+  tu_unaligned_write16(ntb + 10, ntb_len);
+  receive(ntb, ntb_len);
+  renew_all();
+  TEST_ASSERT_EQUAL(0, rx_count);
+
+  // NDP index within NTH
+  ntb_len = build_ntb16(ntb, len, 1);
+  tu_unaligned_write16(ntb + 10, 4);
+  receive(ntb, ntb_len);
+  renew_all();
+  TEST_ASSERT_EQUAL(0, rx_count);
+}
+
+void test_ncm_rx_datagram_out_of_range(void)
+{
+  uint8_t ntb[512];
+  uint16_t const len[] = { 60, 20 };
+  uint16_t const ndp = NTH16_LEN;
+
+  set_data_alt(1);
+
+  // second datagram ends past end of NTB: whole NDP is dropped
+  uint16_t ntb_len = build_ntb16(ntb, len, 2);
+  tu_unaligned_write16(ntb + ndp + NDP16_LEN + 6, 21);
+  receive(ntb, ntb_len);
+  renew_all();
+  TEST_ASSERT_EQUAL(0, rx_count);
+
+  // datagram length larger than NTB, index + length wraps around 16-bit
+  ntb_len = build_ntb16(ntb, len, 2);
+  tu_unaligned_write16(ntb + ndp + NDP16_LEN + 6, 0xFFF0);
+  receive(ntb, ntb_len);
+  renew_all();
+  TEST_ASSERT_EQUAL(0, rx_count);
+}
+
+void test_ncm_rx_datagram_overlap_header(void)
+{
+  uint8_t ntb[512];
+  uint16_t const len[] = { 60 };
+
+  set_data_alt(1);
+
+  // datagram starts within NTH
+  uint16_t const ntb_len = build_ntb16(ntb, len, 1);
+  tu_unaligned_write16(ntb + NTH16_LEN + NDP16_LEN, 4);
+  receive(ntb, ntb_len);
+  renew_all();
+  TEST_ASSERT_EQUAL(0, rx_count);
+}
+
+void test_ncm_rx_ndp_overlap(void)
+{
+  uint8_t ntb[512];
+  uint16_t const len[] = { 60 };
+  uint16_t const ndp = NTH16_LEN;
+
+  set_data_alt(1);
+
+  // NDP linked to itself: its datagram is delivered once
+  uint16_t ntb_len = build_ntb16(ntb, len, 1);
+  tu_unaligned_write16(ntb + ndp + 6, ndp);
+  receive(ntb, ntb_len);
+  renew_all();
+  TEST_ASSERT_EQUAL(1, rx_count);
+
+  // next NDP starts within this one
+  rx_count = 0;
+  ntb_len = build_ntb16(ntb, len, 1);
+  tu_unaligned_write16(ntb + ndp + 6, ndp + 4);
+  receive(ntb, ntb_len);
+  renew_all();
+  TEST_ASSERT_EQUAL(1, rx_count);
+  check_rx(0, 60, 0x10);
+}
+
+//--------------------------------------------------------------------+
+// Receive: ring of NTBs
+//--------------------------------------------------------------------+
+
+void test_ncm_rx_ring(void)
+{
+  uint8_t ntb[2][512];
+  uint16_t const len_a[] = { 60, 70 };
+  uint16_t const len_b[] = { 80 };
+
+  uint16_t const ntb_a = build_ntb16(ntb[0], len_a, 2);
+  uint16_t const ntb_b = build_ntb16(ntb[1], len_b, 1);
+  memset(ntb[1] + tu_unaligned_read16(ntb[1] + NTH16_LEN + NDP16_LEN), 0x20, 80); // tell apart from NTB A
+
+  set_data_alt(1);
+  uint8_t* const slot0 = out_buf;
+
+  // first datagram is delivered, application keeps it: next NTB is received into the other buffer
+  receive(ntb[0], ntb_a);
+  TEST_ASSERT_EQUAL(1, rx_count);
+  TEST_ASSERT_EQUAL(2, out_armed);
+  TEST_ASSERT_TRUE(out_buf != slot0);
+
+  // both buffers are in use, OUT endpoint is not armed
+  receive(ntb[1], ntb_b);
+  TEST_ASSERT_EQUAL(1, rx_count);
+  TEST_ASSERT_EQUAL(2, out_armed);
+
+  // rest of NTB A, then NTB A is released and OUT endpoint armed on it
+  tud_network_recv_renew();
+  TEST_ASSERT_EQUAL(2, rx_count);
+  TEST_ASSERT_EQUAL(2, out_armed);
+
+  tud_network_recv_renew();
+  TEST_ASSERT_EQUAL(3, rx_count);
+  TEST_ASSERT_EQUAL(3, out_armed);
+  TEST_ASSERT_EQUAL_PTR(slot0, out_buf);
+
+  renew_all();
+  TEST_ASSERT_EQUAL(3, rx_count);
+  check_rx(0, 60, 0x10);
+  check_rx(1, 70, 0x11);
+  check_rx(2, 80, 0x20);
+}
+
+//--------------------------------------------------------------------+
+// Transmit
+//--------------------------------------------------------------------+
+
+// NTB32 IN with more datagrams than an NDP holds is sent with chained NDPs, and parsed back by receive path
+void test_ncm_tx_ntb32_ndp_chain(void)
+{
+  static uint8_t ntb[CFG_TUD_NCM_IN_NTB_MAX_SIZE];
+
+  set_ntb_format(NCM_NTB_FORMAT_32);
+  set_data_alt(1);
+
+  // first datagram is sent right away, the next ones are batched while it is in flight
+  tx_marker = 0x30;
+  TEST_ASSERT_TRUE(tud_network_can_xmit(100));
+  tud_network_xmit(NULL, 100);
+  TEST_ASSERT_EQUAL(1, in_count);
+
+  for ( uint8_t i = 1; i < 4; i++ )
+  {
+    tx_marker = (uint8_t) (0x30 + i);
+    TEST_ASSERT_TRUE(tud_network_can_xmit(100));
+    tud_network_xmit(NULL, (uint16_t) (100 + i));
+  }
+  TEST_ASSERT_EQUAL(1, in_count);
+
+  complete_in(0);
+  TEST_ASSERT_EQUAL(2, in_count);
+
+  uint16_t const ntb_len = collect_in(1, ntb);
+  TEST_ASSERT_EQUAL_HEX32(NTH32_SIGNATURE, tu_unaligned_read32(ntb));
+  TEST_ASSERT_EQUAL(ntb_len, tu_unaligned_read32(ntb + 8));
+
+  // 3 datagrams: first NDP is full and links to the second
+  uint32_t const ndp1 = tu_unaligned_read32(ntb + 12);
+  uint32_t const ndp2 = tu_unaligned_read32(ntb + ndp1 + 8);
+  TEST_ASSERT_NOT_EQUAL(0, ndp2);
+  TEST_ASSERT_EQUAL(0, tu_unaligned_read32(ntb + ndp2 + 8));
+
+  receive(ntb, ntb_len);
+  renew_all();
+
+  TEST_ASSERT_EQUAL(3, rx_count);
+  check_rx(0, 101, 0x31);
+  check_rx(1, 102, 0x32);
+  check_rx(2, 103, 0x33);
+}
+
+// Whole packets of aligned fragment are sent directly, the rest is copied to bounce buffer
+void test_ncm_xmit_frags(void)
+{
+  static uint8_t ntb[CFG_TUD_NCM_IN_NTB_MAX_SIZE];
+  static uint8_t frag_a[100], frag_c[50];
+  static TU_ATTR_ALIGNED(4) uint8_t frag_b[1200];
+  int dummy_ref;
+
+  memset(frag_a, 0x41, sizeof(frag_a));
+  memset(frag_c, 0x43, sizeof(frag_c));
+  for ( uint16_t i = 0; i < sizeof(frag_b); i++ ) frag_b[i] = (uint8_t) i;
+
+  tud_network_frag_t const frags[] =
+  {
+    { .buffer = frag_a, .len = sizeof(frag_a) },
+    { .buffer = frag_b, .len = sizeof(frag_b) },
+    { .buffer = frag_c, .len = sizeof(frag_c) },
+  };
+
+  set_data_alt(1);
+
+  // only 2 transfers can be queued at first
+  in_queue_available = 2;
+  TEST_ASSERT_TRUE(tud_network_xmit_frags(frags, 3, &dummy_ref));
+  TEST_ASSERT_EQUAL(2, in_count);
+
+  // driver is busy until datagram is sent
+  TEST_ASSERT_FALSE(tud_network_xmit_frags(frags, 3, &dummy_ref));
+
+  // NTH16 + NDP16 with 1 datagram + terminator = 28 bytes, then 100 bytes of A and 384 bytes of B fill a packet
+  uint16_t const hdr_len = NTH16_LEN + NDP16_LEN + 2*4;
+  uint16_t const b_copied = EDPT_SIZE - hdr_len - sizeof(frag_a);
+  uint16_t const b_direct = (uint16_t) ((sizeof(frag_b) - b_copied) / EDPT_SIZE * EDPT_SIZE);
+
+  TEST_ASSERT_EQUAL(EDPT_SIZE, in_xfer[0].len);
+  TEST_ASSERT_EQUAL_PTR(frag_b + b_copied, in_xfer[1].buf);
+  TEST_ASSERT_EQUAL(b_direct, in_xfer[1].len);
+
+  // last chunk is queued once a transfer completes
+  in_queue_available++;
+  TEST_ASSERT_TRUE(netd_xfer_cb(0, EDPT_IN, XFER_RESULT_SUCCESS, in_xfer[0].len));
+  TEST_ASSERT_EQUAL(3, in_count);
+  TEST_ASSERT_EQUAL(sizeof(frag_b) - b_copied - b_direct + sizeof(frag_c), in_xfer[2].len);
+
+  // all chunks but the last are whole packets, so that host sees a single transfer
+  for ( uint8_t i = 0; i < in_count - 1; i++ ) TEST_ASSERT_EQUAL(0, in_xfer[i].len % EDPT_SIZE);
+
+  uint16_t const ntb_len = collect_in(0, ntb);
+  TEST_ASSERT_EQUAL(hdr_len + sizeof(frag_a) + sizeof(frag_b) + sizeof(frag_c), ntb_len);
+
+  TEST_ASSERT_EQUAL(0, xmit_done_count);
+  complete_in(1);
+  TEST_ASSERT_EQUAL(1, xmit_done_count);
+  TEST_ASSERT_EQUAL_PTR(&dummy_ref, xmit_done_ref);
+
+  // receive path gets back the datagram made of all fragments
+  receive(ntb, ntb_len);
+  renew_all();
+
+  TEST_ASSERT_EQUAL(1, rx_count);
+  TEST_ASSERT_EQUAL(ntb_len - hdr_len, rx_len[0]);
+  TEST_ASSERT_EQUAL_MEMORY(frag_a, rx_data[0], sizeof(frag_a));
+  TEST_ASSERT_EQUAL_MEMORY(frag_b, rx_data[0] + sizeof(frag_a), sizeof(frag_b));
+  TEST_ASSERT_EQUAL_MEMORY(frag_c, rx_data[0] + sizeof(frag_a) + sizeof(frag_b), sizeof(frag_c));
+}
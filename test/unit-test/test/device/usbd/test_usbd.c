@@ -29,6 +29,7 @@
 #include "tusb_fifo.h"
 #include "tusb.h"
 #include "usbd.h"
+#include "usbd_pvt.h"
 TEST_FILE("usbd_control.c")
 
 // Mock File
@@ -78,6 +79,30 @@ uint8_t const data_desc_configuration[] =
   TUD_CONFIG_DESCRIPTOR(1, 0, 0, TUD_CONFIG_DESC_LEN, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
 };
 
+enum
+{
+  EDPT_MSC_OUT = 0x01,
+  EDPT_MSC_IN  = 0x81
+};
+
+uint8_t const data_desc_configuration_msc[] =
+{
+  // Config number, interface count, string index, total length, attribute, power in mA
+  TUD_CONFIG_DESCRIPTOR(1, 1, 0, TUD_CONFIG_DESC_LEN + TUD_MSC_DESC_LEN, 0, 100),
+
+  // Interface number, string index, EP Out & EP In address, EP size
+  TUD_MSC_DESCRIPTOR(0, 0, EDPT_MSC_OUT, EDPT_MSC_IN, 512),
+};
+
+tusb_control_request_t const req_set_configuration =
+{
+  .bmRequestType = 0x00,
+  .bRequest = TUSB_REQ_SET_CONFIGURATION,
+  .wValue = 1,
+  .wIndex = 0x0000,
+  .wLength = 0
+};
+
 tusb_control_request_t const req_get_desc_device =
 {
   .bmRequestType = 0x80,
@@ -242,3 +267,127 @@ void test_usbd_control_in_zlp(void)
 
   tud_task();
 }
+
+//--------------------------------------------------------------------+
+// Transfer queue
+//--------------------------------------------------------------------+
+
+// configure with MSC (mocked) so that its endpoints are bound to the driver
+static void configure_msc(void)
+{
+  dcd_event_bus_reset(rhport, TUSB_SPEED_HIGH, false);
+  mscd_reset_Expect(rhport);
+  tud_task();
+
+  desc_configuration = data_desc_configuration_msc;
+  dcd_event_setup_received(rhport, (uint8_t*) &req_set_configuration, false);
+
+  mscd_open_IgnoreAndReturn(TUD_MSC_DESC_LEN);
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_IN, NULL, 0, true);
+  tud_task();
+
+  dcd_event_xfer_complete(rhport, EDPT_CTRL_IN, 0, 0, false);
+  dcd_edpt0_status_complete_ExpectWithArray(rhport, &req_set_configuration, 1);
+  tud_task();
+}
+
+// first transfer goes to DCD, the others are queued
+static void queue_transfers(uint8_t buf[][8])
+{
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, buf[0], 8, true);
+  TEST_ASSERT_TRUE(usbd_edpt_xfer_queue(rhport, EDPT_MSC_IN, buf[0], 8));
+  TEST_ASSERT_TRUE(usbd_edpt_xfer_queue(rhport, EDPT_MSC_IN, buf[1], 8));
+  TEST_ASSERT_TRUE(usbd_edpt_xfer_queue(rhport, EDPT_MSC_IN, buf[2], 8));
+  TEST_ASSERT_EQUAL(CFG_TUD_EDPT_XFER_QUEUE_SZ - 2, usbd_edpt_xfer_queue_available(rhport, EDPT_MSC_IN));
+}
+
+void test_usbd_xfer_queue_stall(void)
+{
+  uint8_t buf[4][8];
+
+  configure_msc();
+  queue_transfers(buf);
+
+  // stall drops queued transfers, the one owned by DCD is left to DCD
+  dcd_edpt_stall_Expect(rhport, EDPT_MSC_IN);
+  usbd_edpt_stall(rhport, EDPT_MSC_IN);
+  TEST_ASSERT_EQUAL(CFG_TUD_EDPT_XFER_QUEUE_SZ, usbd_edpt_xfer_queue_available(rhport, EDPT_MSC_IN));
+
+  // can not queue while stalled
+  TEST_ASSERT_FALSE(usbd_edpt_xfer_queue(rhport, EDPT_MSC_IN, buf[3], 8));
+
+  // nothing is reported until DCD completes its transfer
+  tud_task();
+  TEST_ASSERT_TRUE(usbd_edpt_busy(rhport, EDPT_MSC_IN));
+
+  // one completion per transfer in submission order: the one from DCD, then dropped ones as failed
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 0, XFER_RESULT_STALLED, false);
+  mscd_xfer_cb_ExpectAndReturn(rhport, EDPT_MSC_IN, XFER_RESULT_STALLED, 0, true);
+  mscd_xfer_cb_ExpectAndReturn(rhport, EDPT_MSC_IN, XFER_RESULT_FAILED, 0, true);
+  mscd_xfer_cb_ExpectAndReturn(rhport, EDPT_MSC_IN, XFER_RESULT_FAILED, 0, true);
+  tud_task();
+
+  // clearing stall does not report anything again
+  dcd_edpt_clear_stall_Expect(rhport, EDPT_MSC_IN);
+  usbd_edpt_clear_stall(rhport, EDPT_MSC_IN);
+  tud_task();
+  TEST_ASSERT_FALSE(usbd_edpt_busy(rhport, EDPT_MSC_IN));
+
+  // queue works again: first transfer goes straight to DCD
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, buf[3], 8, true);
+  TEST_ASSERT_TRUE(usbd_edpt_xfer_queue(rhport, EDPT_MSC_IN, buf[3], 8));
+
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 8, XFER_RESULT_SUCCESS, false);
+  mscd_xfer_cb_ExpectAndReturn(rhport, EDPT_MSC_IN, XFER_RESULT_SUCCESS, 8, true);
+  tud_task();
+  TEST_ASSERT_FALSE(usbd_edpt_busy(rhport, EDPT_MSC_IN));
+}
+
+void test_usbd_xfer_queue_stall_aborted(void)
+{
+  uint8_t buf[4][8];
+
+  configure_msc();
+  queue_transfers(buf);
+
+  dcd_edpt_stall_Expect(rhport, EDPT_MSC_IN);
+  usbd_edpt_stall(rhport, EDPT_MSC_IN);
+
+  // DCD aborted its transfer without completion: only dropped ones are reported once stall is cleared
+  dcd_edpt_clear_stall_Expect(rhport, EDPT_MSC_IN);
+  usbd_edpt_clear_stall(rhport, EDPT_MSC_IN);
+  TEST_ASSERT_FALSE(usbd_edpt_busy(rhport, EDPT_MSC_IN));
+  TEST_ASSERT_EQUAL(CFG_TUD_EDPT_XFER_QUEUE_SZ + 1, usbd_edpt_xfer_queue_available(rhport, EDPT_MSC_IN));
+
+  // new transfer submitted before failed completions are delivered
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, buf[3], 8, true);
+  TEST_ASSERT_TRUE(usbd_edpt_xfer_queue(rhport, EDPT_MSC_IN, buf[3], 8));
+
+  mscd_xfer_cb_ExpectAndReturn(rhport, EDPT_MSC_IN, XFER_RESULT_FAILED, 0, true);
+  mscd_xfer_cb_ExpectAndReturn(rhport, EDPT_MSC_IN, XFER_RESULT_FAILED, 0, true);
+  tud_task();
+  TEST_ASSERT_TRUE(usbd_edpt_busy(rhport, EDPT_MSC_IN));
+
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 8, XFER_RESULT_SUCCESS, false);
+  mscd_xfer_cb_ExpectAndReturn(rhport, EDPT_MSC_IN, XFER_RESULT_SUCCESS, 8, true);
+  tud_task();
+  TEST_ASSERT_FALSE(usbd_edpt_busy(rhport, EDPT_MSC_IN));
+}
+
+void test_usbd_xfer_stall_no_queue(void)
+{
+  uint8_t buf[8];
+
+  configure_msc();
+
+  // plain transfer is not reported on stall or clear stall, same as without transfer queue
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, buf, 8, true);
+  TEST_ASSERT_TRUE(usbd_edpt_xfer(rhport, EDPT_MSC_IN, buf, 8));
+
+  dcd_edpt_stall_Expect(rhport, EDPT_MSC_IN);
+  usbd_edpt_stall(rhport, EDPT_MSC_IN);
+  dcd_edpt_clear_stall_Expect(rhport, EDPT_MSC_IN);
+  usbd_edpt_clear_stall(rhport, EDPT_MSC_IN);
+  tud_task();
+  TEST_ASSERT_FALSE(usbd_edpt_busy(rhport, EDPT_MSC_IN));
+}
@@ -76,6 +76,9 @@
 #define CFG_TUD_TASK_QUEUE_SZ    100
 #define CFG_TUD_ENDPOINT0_SIZE    64
 
+// transfer queue per endpoint
+#define CFG_TUD_EDPT_XFER_QUEUE_SZ 4
+
 //------------- CLASS -------------//
 //#define CFG_TUD_CDC              0
 #define CFG_TUD_MSC              1
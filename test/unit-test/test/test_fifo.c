@@ -42,7 +42,8 @@ uint8_t rd_buf[FIFO_SIZE];
 
 void setUp(void)
 {
-  tu_fifo_clear(ff);
+  // reset indices to 0, clear only empties the fifo with CFG_TUSB_FIFO_MP_WRITE
+  tu_fifo_config(ff, tu_ff_buf, FIFO_SIZE, sizeof(uint8_t), false);
   memset(&info, 0, sizeof(tu_fifo_buffer_info_t));
 
   for(int i=0; i<sizeof(test_data); i++) test_data[i] = i;
@@ -359,7 +360,8 @@ void test_rd_idx_wrap()
   uint8_t buf[10];
   uint8_t dst[10];
 
-  tu_fifo_config(&ff10, buf, 10, 1, 1);
+  TEST_ASSERT_TRUE(tu_fifo_config(&ff10, buf, 10, 1, 1));
+  TEST_ASSERT_FALSE(ff10.pow2);
 
   uint16_t n;
 
@@ -376,3 +378,152 @@ void test_rd_idx_wrap()
   TEST_ASSERT_EQUAL(n, 2);
   TEST_ASSERT_EQUAL(ff10.rd_idx, 6);
 }
+
+void test_pow2_idx_wrap()
+{
+  tu_fifo_t ff8;
+  uint8_t buf[8];
+  uint8_t dst[8];
+
+  TEST_ASSERT_TRUE(tu_fifo_config(&ff8, buf, 8, 1, 1));
+  TEST_ASSERT_TRUE(ff8.pow2);
+
+  uint16_t n;
+
+  ff8.wr_idx = 2;
+  ff8.rd_idx = 14;
+  TEST_ASSERT_EQUAL(4, tu_fifo_count(&ff8));
+
+  n = tu_fifo_read_n(&ff8, dst, 8);
+  TEST_ASSERT_EQUAL(4, n);
+  TEST_ASSERT_EQUAL(2, ff8.rd_idx);
+
+  // overflowed: read index is corrected to a full fifo
+  ff8.wr_idx = 13;
+  TEST_ASSERT_TRUE(tu_fifo_overflowed(&ff8));
+
+  n = tu_fifo_read_n(&ff8, dst, 8);
+  TEST_ASSERT_EQUAL(8, n);
+  TEST_ASSERT_EQUAL(13, ff8.rd_idx);
+}
+
+void test_idx32_large_depth()
+{
+#if !CFG_TUSB_FIFO_IDX32
+  TEST_ASSERT_FALSE(tu_fifo_config(&tu_ff, tu_ff_buf, TU_FIFO_DEPTH_MAX+1, 1, false));
+  TEST_IGNORE_MESSAGE("requires CFG_TUSB_FIFO_IDX32");
+#else
+  enum { DEPTH = 1u << 17 };
+  static uint8_t buf[DEPTH];
+  static uint8_t data[DEPTH];
+  static uint8_t dst[DEPTH];
+  tu_fifo_t ff;
+  tu_fifo_buffer_info_t info;
+
+  for(uint32_t i=0; i < DEPTH; i++) data[i] = (uint8_t) (i*7);
+
+  TEST_ASSERT_TRUE(tu_fifo_config(&ff, buf, DEPTH, 1, false));
+
+  // wrap around in the middle of a transfer larger than 16-bit
+  TEST_ASSERT_EQUAL(30000, tu_fifo_write_n(&ff, data, 30000));
+  TEST_ASSERT_EQUAL(30000, tu_fifo_read_n(&ff, dst, 30000));
+
+  TEST_ASSERT_EQUAL(DEPTH, tu_fifo_write_n(&ff, data, DEPTH));
+  TEST_ASSERT_TRUE(tu_fifo_full(&ff));
+  TEST_ASSERT_EQUAL(DEPTH, tu_fifo_count(&ff));
+
+  tu_fifo_get_read_info(&ff, &info);
+  TEST_ASSERT_EQUAL(DEPTH-30000, info.len_lin);
+  TEST_ASSERT_EQUAL(30000, info.len_wrap);
+
+  TEST_ASSERT_EQUAL(DEPTH, tu_fifo_read_n(&ff, dst, DEPTH));
+  TEST_ASSERT_EQUAL_MEMORY(data, dst, DEPTH);
+  TEST_ASSERT_TRUE(tu_fifo_empty(&ff));
+#endif
+}
+
+// Largest depth is accepted and its index wraps correctly, one more is rejected
+void test_depth_max()
+{
+  tu_fifo_t ff_max;
+
+  TEST_ASSERT_FALSE(tu_fifo_config(&ff_max, tu_ff_buf, TU_FIFO_DEPTH_MAX+1, 1, false));
+#if CFG_TUSB_FIFO_IDX32
+  TEST_ASSERT_EQUAL(1u << 30, TU_FIFO_DEPTH_MAX);
+  TEST_ASSERT_FALSE(tu_fifo_config(&ff_max, tu_ff_buf, 1u << 31, 1, false));
+#endif
+
+  // buffer is not accessed by index only operations
+  TEST_ASSERT_TRUE(tu_fifo_config(&ff_max, tu_ff_buf, TU_FIFO_DEPTH_MAX, 1, false));
+
+  // last index of 2*depth space wraps to 0
+  ff_max.wr_idx = (tu_fifo_idx_t) (2*TU_FIFO_DEPTH_MAX - 1);
+  ff_max.rd_idx = ff_max.wr_idx;
+  tu_fifo_advance_write_pointer(&ff_max, 1);
+  TEST_ASSERT_EQUAL(0, ff_max.wr_idx);
+  TEST_ASSERT_EQUAL(1, tu_fifo_count(&ff_max));
+
+  // full
+  tu_fifo_advance_write_pointer(&ff_max, TU_FIFO_DEPTH_MAX - 1);
+  TEST_ASSERT_TRUE(tu_fifo_full(&ff_max));
+  TEST_ASSERT_EQUAL(TU_FIFO_DEPTH_MAX, tu_fifo_count(&ff_max));
+  TEST_ASSERT_FALSE(tu_fifo_overflowed(&ff_max));
+}
+
+void test_mp_write()
+{
+#if !CFG_TUSB_FIFO_MP_WRITE
+  TEST_IGNORE_MESSAGE("requires CFG_TUSB_FIFO_MP_WRITE");
+#else
+  uint8_t data[FIFO_SIZE+10];
+  for(uint8_t i=0; i < sizeof(data); i++) data[i] = i;
+
+  TEST_ASSERT_EQUAL(10, tu_fifo_write_n_mp(ff, data, 10));
+  TEST_ASSERT_EQUAL(10, tu_fifo_count(ff));
+
+  // never overwrite, extra data is dropped
+  TEST_ASSERT_EQUAL(FIFO_SIZE-10, tu_fifo_write_n_mp(ff, data+10, FIFO_SIZE));
+  TEST_ASSERT_TRUE(tu_fifo_full(ff));
+  TEST_ASSERT_EQUAL(0, tu_fifo_write_n_mp(ff, data, 1));
+
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_read_n(ff, rd_buf, FIFO_SIZE));
+  TEST_ASSERT_EQUAL_MEMORY(data, rd_buf, FIFO_SIZE);
+
+  // wrap around
+  TEST_ASSERT_EQUAL(5, tu_fifo_write_n_mp(ff, data, 5));
+  TEST_ASSERT_EQUAL(5, tu_fifo_read_n(ff, rd_buf, FIFO_SIZE));
+  TEST_ASSERT_EQUAL_MEMORY(data, rd_buf, 5);
+
+  tu_fifo_clear(ff);
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_write_n_mp(ff, data, FIFO_SIZE));
+#endif
+}
+
+// clear must not reset reserve index under a pending multi-producer writer
+void test_mp_clear()
+{
+#if !CFG_TUSB_FIFO_MP_WRITE
+  TEST_IGNORE_MESSAGE("requires CFG_TUSB_FIFO_MP_WRITE");
+#else
+  uint8_t data[10];
+  for(uint8_t i=0; i < sizeof(data); i++) data[i] = i;
+
+  TEST_ASSERT_EQUAL(10, tu_fifo_write_n_mp(ff, data, 10));
+
+  // a writer has reserved 4 items and is still copying
+  ff->wr_rsv = 0x10000u | 14;
+  TEST_ASSERT_FALSE(tu_fifo_clear(ff));
+  TEST_ASSERT_EQUAL(10, tu_fifo_count(ff));
+
+  // writer committed and published
+  ff->wr_rsv = 14;
+  ff->wr_idx = 14;
+  TEST_ASSERT_TRUE(tu_fifo_clear(ff));
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+
+  // next write continues after the reserved slots
+  TEST_ASSERT_EQUAL(3, tu_fifo_write_n_mp(ff, data, 3));
+  TEST_ASSERT_EQUAL(3, tu_fifo_read_n(ff, rd_buf, FIFO_SIZE));
+  TEST_ASSERT_EQUAL_MEMORY(data, rd_buf, 3);
+#endif
+}
@@ -0,0 +1,323 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2023, Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// CPU benchmark of data copy kernels, measured with host clock: results are only comparable on the same machine
+// and are reported without pass/fail. Each kernel is checked against the baseline before being measured.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "tusb.h"
+#include "class/audio/audio_interleave.h"
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF PROTYPES
+//--------------------------------------------------------------------+
+
+// each kernel is timed over COPY_BENCH_ROUNDS rounds of COPY_BENCH_ITER packets, median round is reported
+#define COPY_BENCH_ITER      2000
+#define COPY_BENCH_ROUNDS    15
+
+// one high speed isochronous packet
+#define AUDIO_PACKET_SIZE    (8*192)
+#define AUDIO_FF_MAX         8
+
+// FIFO write + read, build with FIFO_POW2=1 to compare index arithmetic
+#define FIFO_BENCH_DEPTH     64
+#define FIFO_BENCH_ITER      1000000
+
+bool bench_audio_interleave(void);
+bool bench_fifo(void);
+
+static uint8_t audio_stream[AUDIO_PACKET_SIZE];
+static uint8_t audio_stream_ref[AUDIO_PACKET_SIZE];
+static uint8_t audio_ff[AUDIO_FF_MAX][AUDIO_PACKET_SIZE];
+static uint8_t audio_ref[AUDIO_FF_MAX][AUDIO_PACKET_SIZE];
+
+static uint8_t fifo_bench_buf[FIFO_BENCH_DEPTH];
+static tu_fifo_t fifo_bench = TU_FIFO_INIT(fifo_bench_buf, FIFO_BENCH_DEPTH, uint8_t, false);
+static volatile uint32_t fifo_bench_sink;
+
+static uint64_t time_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static uint64_t median_ns(uint64_t* ns, uint8_t count)
+{
+  // insertion sort, count is small
+  for ( uint8_t i = 1; i < count; i++ )
+  {
+    uint64_t const v = ns[i];
+    uint8_t j = i;
+    for ( ; j > 0 && ns[j-1] > v; j-- ) ns[j] = ns[j-1];
+    ns[j] = v;
+  }
+
+  return ns[count/2];
+}
+
+//--------------------------------------------------------------------+
+// Audio interleave
+//--------------------------------------------------------------------+
+
+// Kernels of audio_device.c before word-batched copy, as baseline. Kept verbatim apart from the name.
+typedef struct{
+  uint16_t val;
+} __attribute((__packed__)) unaligned_uint16_t;
+
+typedef struct{
+  uint32_t val;
+} __attribute((__packed__)) unaligned_uint32_t;
+
+static uint8_t * baseline_decode(uint16_t const nBytesToCopy, void * dst, uint8_t * dst_end, uint8_t * src, uint8_t const n_ff_used)
+{
+  switch (nBytesToCopy)
+  {
+    case 1:
+      while((uint8_t *)dst < dst_end)
+      {
+        *(uint8_t *)dst++ = *src;
+        src += n_ff_used;
+      }
+      break;
+
+    case 2:
+      while((uint8_t *)dst < dst_end)
+      {
+        *(unaligned_uint16_t*)dst = *(unaligned_uint16_t*)src;
+        dst += 2;
+        src += 2 * n_ff_used;
+      }
+      break;
+
+    case 3:
+      while((uint8_t *)dst < dst_end)
+      {
+        *(uint8_t *)dst++ = *src++;
+        *(uint8_t *)dst++ = *src++;
+        *(uint8_t *)dst++ = *src++;
+
+        src += 3 * (n_ff_used - 1);
+      }
+      break;
+
+    case 4:
+      while((uint8_t *)dst < dst_end)
+      {
+        *(unaligned_uint32_t*)dst = *(unaligned_uint32_t*)src;
+        dst += 4;
+        src += 4 * n_ff_used;
+      }
+      break;
+  }
+
+  return src;
+}
+
+static uint8_t * baseline_encode(uint16_t const nBytesToCopy, uint8_t * src, uint8_t * src_end, uint8_t * dst, uint8_t const n_ff_used)
+{
+  switch (nBytesToCopy)
+  {
+    case 1:
+      while(src < src_end)
+      {
+        *dst = *src++;
+        dst += n_ff_used;
+      }
+      break;
+
+    case 2:
+      while(src < src_end)
+      {
+        *(unaligned_uint16_t*)dst = *(unaligned_uint16_t*)src;
+        src += 2;
+        dst += 2 * n_ff_used;
+      }
+      break;
+
+    case 3:
+      while(src < src_end)
+      {
+        *dst++ = *src++;
+        *dst++ = *src++;
+        *dst++ = *src++;
+
+        dst += 3 * (n_ff_used - 1);
+      }
+      break;
+
+    case 4:
+      while(src < src_end)
+      {
+        *(unaligned_uint32_t*)dst = *(unaligned_uint32_t*)src;
+        src += 4;
+        dst += 4 * n_ff_used;
+      }
+      break;
+  }
+
+  return dst;
+}
+
+static void audio_decode(bool fast, uint8_t n_bytes, uint8_t n_ff, uint8_t ff[][AUDIO_PACKET_SIZE])
+{
+  uint16_t const len = (uint16_t) (AUDIO_PACKET_SIZE / n_ff);
+
+  for ( uint8_t i = 0; i < n_ff; i++ )
+  {
+    uint8_t* src = audio_stream + i * n_bytes;
+    if ( fast )
+    {
+      audiod_interleaved_copy_bytes_fast_decode(n_bytes, ff[i], ff[i] + len, src, n_ff);
+    }else
+    {
+      baseline_decode(n_bytes, ff[i], ff[i] + len, src, n_ff);
+    }
+  }
+}
+
+static void audio_encode(bool fast, uint8_t n_bytes, uint8_t n_ff)
+{
+  uint16_t const len = (uint16_t) (AUDIO_PACKET_SIZE / n_ff);
+
+  for ( uint8_t i = 0; i < n_ff; i++ )
+  {
+    uint8_t* dst = audio_stream + i * n_bytes;
+    if ( fast )
+    {
+      audiod_interleaved_copy_bytes_fast_encode(n_bytes, audio_ff[i], audio_ff[i] + len, dst, n_ff);
+    }else
+    {
+      baseline_encode(n_bytes, audio_ff[i], audio_ff[i] + len, dst, n_ff);
+    }
+  }
+}
+
+// Median time in ns to decode/encode a packet with word-batched kernel and baseline kernel
+bool bench_audio_interleave(void)
+{
+  static uint8_t const ff_count[] = { 1, 2, 4, 8 };
+
+  for ( unsigned i = 0; i < sizeof(audio_stream); i++ ) audio_stream_ref[i] = (uint8_t) (i * 7 + 3);
+
+  printf("%-24s %12s %10s %10s\r\n", "Audio interleave", "", "fast", "baseline");
+
+  for ( uint8_t n_bytes = 1; n_bytes <= 4; n_bytes++ )
+  {
+    for ( unsigned k = 0; k < sizeof(ff_count); k++ )
+    {
+      uint8_t const n_ff = ff_count[k];
+
+      // packet must be whole samples of all FIFOs
+      if ( AUDIO_PACKET_SIZE % (n_bytes * n_ff) ) continue;
+
+      memcpy(audio_stream, audio_stream_ref, sizeof(audio_stream));
+
+      // decode must match baseline, encode of decoded FIFOs must give back the original stream
+      audio_decode(true , n_bytes, n_ff, audio_ff);
+      audio_decode(false, n_bytes, n_ff, audio_ref);
+      TU_VERIFY(0 == memcmp(audio_ff, audio_ref, sizeof(audio_ff)));
+
+      memset(audio_stream, 0, sizeof(audio_stream));
+      audio_encode(true, n_bytes, n_ff);
+      TU_VERIFY(0 == memcmp(audio_stream, audio_stream_ref, sizeof(audio_stream)));
+
+      // rounds of both kernels are interleaved so that frequency scaling or other load affects them alike
+      uint64_t round_ns[2][2][COPY_BENCH_ROUNDS]; // [decode, encode][fast, baseline][round]
+      for ( uint8_t r = 0; r < COPY_BENCH_ROUNDS; r++ )
+      {
+        for ( uint8_t fast = 0; fast < 2; fast++ )
+        {
+          uint64_t start = time_ns();
+          for ( uint32_t n = 0; n < COPY_BENCH_ITER; n++ ) audio_decode(fast, n_bytes, n_ff, audio_ff);
+          round_ns[0][!fast][r] = (time_ns() - start) / COPY_BENCH_ITER;
+
+          start = time_ns();
+          for ( uint32_t n = 0; n < COPY_BENCH_ITER; n++ ) audio_encode(fast, n_bytes, n_ff);
+          round_ns[1][!fast][r] = (time_ns() - start) / COPY_BENCH_ITER;
+        }
+      }
+
+      uint64_t ns[2][2];
+      for ( uint8_t i = 0; i < 4; i++ ) ns[i/2][i%2] = median_ns(round_ns[i/2][i%2], COPY_BENCH_ROUNDS);
+
+      char name[32];
+      snprintf(name, sizeof(name), "  %u-byte x %u FIFO", n_bytes, n_ff);
+      printf("%-24s %12s %7lu ns %7lu ns\r\n", name, "decode", (unsigned long) ns[0][0], (unsigned long) ns[0][1]);
+      printf("%-24s %12s %7lu ns %7lu ns\r\n", ""  , "encode", (unsigned long) ns[1][0], (unsigned long) ns[1][1]);
+    }
+  }
+
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// FIFO
+//--------------------------------------------------------------------+
+
+// Average time of a single item and a 48-item (wrapping) write + read, in tenth of ns
+bool bench_fifo(void)
+{
+  uint8_t data[48];
+  uint32_t sum = 0;
+
+  for ( unsigned i = 0; i < sizeof(data); i++ ) data[i] = (uint8_t) i;
+  tu_fifo_clear(&fifo_bench);
+
+  uint64_t start = time_ns();
+  for ( uint32_t n = 0; n < FIFO_BENCH_ITER; n++ )
+  {
+    uint8_t v = (uint8_t) n;
+    tu_fifo_write(&fifo_bench, &v);
+    tu_fifo_read(&fifo_bench, &v);
+    sum += v;
+  }
+  uint64_t const single = (time_ns() - start) * 10 / FIFO_BENCH_ITER;
+
+  start = time_ns();
+  for ( uint32_t n = 0; n < FIFO_BENCH_ITER; n++ )
+  {
+    tu_fifo_write_n(&fifo_bench, data, sizeof(data));
+    tu_fifo_read_n(&fifo_bench, data, sizeof(data));
+    sum += data[0];
+  }
+  uint64_t const multi = (time_ns() - start) * 10 / FIFO_BENCH_ITER;
+
+  // every read must give back what is written
+  TU_VERIFY(tu_fifo_empty(&fifo_bench) && (data[47] == 47));
+  fifo_bench_sink = sum; // keep reads from being optimized out
+
+  char name[32];
+  snprintf(name, sizeof(name), "FIFO depth %u%s", FIFO_BENCH_DEPTH, CFG_TUSB_FIFO_POW2 ? " (pow2)" : "");
+  printf("%-24s %12s %4lu.%lu ns\r\n", name, "1 item", (unsigned long) (single/10), (unsigned long) (single%10));
+  printf("%-24s %12s %4lu.%lu ns\r\n", ""  , "48 items", (unsigned long) (multi/10), (unsigned long) (multi%10));
+
+  return true;
+}
@@ -0,0 +1,389 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2023, Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Benchmark of host and device stack connected by virtual bus. Throughput is measured in bus frames (1 ms) so that
+// result is deterministic and comparable between CI runs. Exit with non-zero code if any benchmark fails.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tusb.h"
+#include "vbus.h"
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF PROTYPES
+//--------------------------------------------------------------------+
+
+#define BENCH_TIMEOUT_FRAMES  20000
+
+// CPU benchmarks in bench_copy.c
+bool bench_audio_interleave(void);
+bool bench_fifo(void);
+
+#define CDC_BENCH_SIZE        (64*1024)
+#define HID_BENCH_REPORTS     1000
+
+#define MSC_BLOCK_SIZE        512
+#define MSC_BLOCK_NUM         64
+#define MSC_READ_BLOCKS       8     // blocks per read10 command
+#define MSC_BENCH_SIZE        (256*1024)
+
+static uint8_t msc_disk[MSC_BLOCK_NUM][MSC_BLOCK_SIZE];
+
+// Host side state
+static uint8_t cdc_idx   = TUSB_INDEX_INVALID;
+static uint8_t msc_daddr = 0;
+static uint8_t hid_daddr = 0;
+static uint8_t hid_instance;
+
+static uint32_t hid_received;
+static uint32_t msc_received;
+static bool     msc_busy;
+static bool     msc_failed;
+
+static uint8_t buf[4096];
+
+static void bus_task(void)
+{
+  tud_task(); // tinyusb device task
+  tuh_task(); // tinyusb host task
+  vbus_task();
+}
+
+static void report(char const* name, uint32_t bytes, uint32_t frames)
+{
+  // bytes per frame (1 ms) is also KB/s
+  printf("%-24s %7lu bytes in %5lu frames: %4lu KB/s\r\n", name, (unsigned long) bytes, (unsigned long) frames,
+         (unsigned long) (frames ? bytes/frames : 0));
+}
+
+//--------------------------------------------------------------------+
+// Benchmarks
+//--------------------------------------------------------------------+
+
+static bool bench_enumeration(void)
+{
+  uint32_t const start = vbus_frame();
+
+  while ( (cdc_idx == TUSB_INDEX_INVALID) || !msc_daddr || !hid_daddr )
+  {
+    TU_VERIFY(vbus_frame() - start < BENCH_TIMEOUT_FRAMES);
+    bus_task();
+  }
+
+  printf("%-24s %27lu frames\r\n", "Enumeration", (unsigned long) (vbus_frame() - start));
+  return true;
+}
+
+static bool bench_cdc_out(void)
+{
+  uint32_t const start = vbus_frame();
+  uint32_t sent = 0, received = 0;
+
+  while ( received < CDC_BENCH_SIZE )
+  {
+    TU_VERIFY(vbus_frame() - start < BENCH_TIMEOUT_FRAMES);
+
+    if ( sent < CDC_BENCH_SIZE )
+    {
+      uint32_t const count = tu_min32(tuh_cdc_write_available(cdc_idx), tu_min32(CDC_BENCH_SIZE - sent, 64));
+      for(uint32_t i=0; i<count; i++) buf[i] = (uint8_t) (sent + i);
+
+      if ( count ) sent += tuh_cdc_write(cdc_idx, buf, count);
+      tuh_cdc_write_flush(cdc_idx);
+    }
+
+    uint32_t const count = tud_cdc_read(buf, sizeof(buf));
+    for(uint32_t i=0; i<count; i++) TU_VERIFY(buf[i] == (uint8_t) (received + i));
+    received += count;
+
+    bus_task();
+  }
+
+  report("CDC host -> device", received, vbus_frame() - start);
+  return true;
+}
+
+static bool bench_cdc_in(void)
+{
+  uint32_t const start = vbus_frame();
+  uint32_t sent = 0, received = 0;
+
+  while ( received < CDC_BENCH_SIZE )
+  {
+    TU_VERIFY(vbus_frame() - start < BENCH_TIMEOUT_FRAMES);
+
+    if ( sent < CDC_BENCH_SIZE )
+    {
+      uint32_t const count = tu_min32(tud_cdc_write_available(), tu_min32(CDC_BENCH_SIZE - sent, 64));
+      for(uint32_t i=0; i<count; i++) buf[i] = (uint8_t) (sent + i);
+
+      if ( count ) sent += tud_cdc_write(buf, count);
+      tud_cdc_write_flush();
+    }
+
+    uint32_t const count = tuh_cdc_read(cdc_idx, buf, sizeof(buf));
+    for(uint32_t i=0; i<count; i++) TU_VERIFY(buf[i] == (uint8_t) (received + i));
+    received += count;
+
+    bus_task();
+  }
+
+  report("CDC device -> host", received, vbus_frame() - start);
+  return true;
+}
+
+static bool msc_read10_complete_cb(uint8_t dev_addr, tuh_msc_complete_data_t const* cb_data)
+{
+  (void) dev_addr;
+
+  msc_busy = false;
+  if ( cb_data->csw->status == MSC_CSW_STATUS_PASSED )
+  {
+    msc_received += MSC_READ_BLOCKS*MSC_BLOCK_SIZE;
+  }else
+  {
+    msc_failed = true;
+  }
+
+  return true;
+}
+
+static bool bench_msc_read10(void)
+{
+  uint32_t const start = vbus_frame();
+  uint32_t lba = 0;
+
+  msc_received = 0;
+
+  while ( msc_received < MSC_BENCH_SIZE )
+  {
+    TU_VERIFY(vbus_frame() - start < BENCH_TIMEOUT_FRAMES && !msc_failed);
+
+    if ( !msc_busy )
+    {
+      // verify previous read
+      if ( msc_received ) TU_VERIFY(0 == memcmp(buf, msc_disk[(lba + MSC_BLOCK_NUM - MSC_READ_BLOCKS) % MSC_BLOCK_NUM],
+                                                MSC_READ_BLOCKS*MSC_BLOCK_SIZE));
+
+      msc_busy = true;
+      TU_VERIFY(tuh_msc_read10(msc_daddr, 0, buf, lba, MSC_READ_BLOCKS, msc_read10_complete_cb, 0));
+      lba = (lba + MSC_READ_BLOCKS) % MSC_BLOCK_NUM;
+    }
+
+    bus_task();
+  }
+
+  // wait for the last command to complete
+  while ( msc_busy ) bus_task();
+
+  report("MSC read10", msc_received, vbus_frame() - start);
+  return true;
+}
+
+static bool bench_hid(void)
+{
+  uint32_t const start = vbus_frame();
+
+  hid_received = 0;
+  TU_VERIFY(tuh_hid_receive_report(hid_daddr, hid_instance));
+
+  while ( hid_received < HID_BENCH_REPORTS )
+  {
+    TU_VERIFY(vbus_frame() - start < BENCH_TIMEOUT_FRAMES);
+
+    if ( tud_hid_ready() )
+    {
+      memset(buf, (int) hid_received, CFG_TUD_HID_EP_BUFSIZE);
+      tud_hid_report(0, buf, CFG_TUD_HID_EP_BUFSIZE);
+    }
+
+    bus_task();
+  }
+
+  uint32_t const frames = vbus_frame() - start;
+  printf("%-24s %7lu reports in %4lu frames: %4lu reports/s\r\n", "HID interrupt IN", (unsigned long) hid_received,
+         (unsigned long) frames, (unsigned long) (frames ? 1000*hid_received/frames : 0));
+
+  return true;
+}
+
+/*------------- MAIN -------------*/
+int main(void)
+{
+  for(uint32_t lba = 0; lba < MSC_BLOCK_NUM; lba++)
+  {
+    for(uint32_t i = 0; i < MSC_BLOCK_SIZE; i++) msc_disk[lba][i] = (uint8_t) (lba + i);
+  }
+
+  // init device and host stack on configured roothub port
+  tud_init(BOARD_TUD_RHPORT);
+  tuh_init(BOARD_TUH_RHPORT);
+
+  bool ok = bench_enumeration() && bench_cdc_out() && bench_cdc_in() && bench_msc_read10() && bench_hid() &&
+            bench_audio_interleave() && bench_fifo();
+
+  if ( !ok ) printf("Benchmark failed at frame %lu\r\n", (unsigned long) vbus_frame());
+
+  return ok ? 0 : 1;
+}
+
+// Timestamp of transfer statistics and trace is bus frame number
+uint32_t tusb_timestamp_cb(void)
+{
+  return vbus_frame();
+}
+
+//--------------------------------------------------------------------+
+// Host callbacks
+//--------------------------------------------------------------------+
+
+void tuh_cdc_mount_cb(uint8_t idx)
+{
+  cdc_idx = idx;
+}
+
+void tuh_cdc_umount_cb(uint8_t idx)
+{
+  (void) idx;
+  cdc_idx = TUSB_INDEX_INVALID;
+}
+
+void tuh_msc_mount_cb(uint8_t dev_addr)
+{
+  msc_daddr = dev_addr;
+}
+
+void tuh_msc_umount_cb(uint8_t dev_addr)
+{
+  (void) dev_addr;
+  msc_daddr = 0;
+}
+
+void tuh_hid_mount_cb(uint8_t dev_addr, uint8_t instance, uint8_t const* desc_report, uint16_t desc_len)
+{
+  (void) desc_report;
+  (void) desc_len;
+
+  hid_daddr    = dev_addr;
+  hid_instance = instance;
+}
+
+void tuh_hid_umount_cb(uint8_t dev_addr, uint8_t instance)
+{
+  (void) dev_addr;
+  (void) instance;
+  hid_daddr = 0;
+}
+
+void tuh_hid_report_received_cb(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len)
+{
+  (void) report;
+  (void) len;
+
+  hid_received++;
+  tuh_hid_receive_report(dev_addr, instance);
+}
+
+//--------------------------------------------------------------------+
+// Device callbacks
+//--------------------------------------------------------------------+
+
+void tud_msc_inquiry_cb(uint8_t lun, uint8_t vendor_id[8], uint8_t product_id[16], uint8_t product_rev[4])
+{
+  (void) lun;
+
+  memcpy(vendor_id  , "TinyUSB ", 8);
+  memcpy(product_id , "Virtual Bus Disk", 16);
+  memcpy(product_rev, "1.0 ", 4);
+}
+
+bool tud_msc_test_unit_ready_cb(uint8_t lun)
+{
+  (void) lun;
+  return true;
+}
+
+void tud_msc_capacity_cb(uint8_t lun, uint32_t* block_count, uint16_t* block_size)
+{
+  (void) lun;
+
+  *block_count = MSC_BLOCK_NUM;
+  *block_size  = MSC_BLOCK_SIZE;
+}
+
+int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize)
+{
+  (void) lun;
+
+  TU_VERIFY(lba < MSC_BLOCK_NUM, -1);
+  memcpy(buffer, msc_disk[lba] + offset, bufsize);
+
+  return (int32_t) bufsize;
+}
+
+int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize)
+{
+  (void) lun;
+
+  TU_VERIFY(lba < MSC_BLOCK_NUM, -1);
+  memcpy(msc_disk[lba] + offset, buffer, bufsize);
+
+  return (int32_t) bufsize;
+}
+
+int32_t tud_msc_scsi_cb(uint8_t lun, uint8_t const scsi_cmd[16], void* buffer, uint16_t bufsize)
+{
+  (void) scsi_cmd;
+  (void) buffer;
+  (void) bufsize;
+
+  // Set Sense = Invalid Command Operation
+  tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x20, 0x00);
+  return -1;
+}
+
+uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t* buffer,
+                               uint16_t reqlen)
+{
+  (void) instance;
+  (void) report_id;
+  (void) report_type;
+  (void) buffer;
+  (void) reqlen;
+
+  return 0;
+}
+
+void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t const* buffer,
+                           uint16_t bufsize)
+{
+  (void) instance;
+  (void) report_id;
+  (void) report_type;
+  (void) buffer;
+  (void) bufsize;
+}
@@ -0,0 +1,73 @@
+# ---------------------------------------
+# Common make definition for all virtual bus harness
+# ---------------------------------------
+
+# Build directory
+BUILD := _build
+PROJECT := $(notdir $(CURDIR))
+
+#-------------- Host compiler ------------
+
+CC ?= gcc
+SIZE = size
+MKDIR = mkdir
+
+ifeq ($(CMDEXE),1)
+  CP = copy
+  RM = del
+  PYTHON = python
+else
+  SED = sed
+  CP = cp
+  RM = rm
+  PYTHON = python3
+endif
+
+#-------------- Source files and compiler flags --------------
+
+INC += $(TOP)/test/vbus
+
+# Compiler Flags
+CFLAGS += \
+  -ggdb \
+  -fdata-sections \
+  -ffunction-sections \
+  -fno-strict-aliasing \
+  -Wall \
+  -Wextra \
+  -Werror \
+  -Wfatal-errors \
+  -Wdouble-promotion \
+  -Wstrict-prototypes \
+  -Wstrict-overflow \
+  -Werror-implicit-function-declaration \
+  -Wfloat-equal \
+  -Wundef \
+  -Wshadow \
+  -Wwrite-strings \
+  -Wsign-compare \
+  -Wmissing-format-attribute \
+  -Wunreachable-code \
+  -Wcast-align \
+  -Wcast-qual \
+  -Wnull-dereference \
+  -Wuninitialized \
+  -Wunused \
+  -Wredundant-decls \
+  -O2
+
+# virtual bus has 16 endpoints in each direction
+CFLAGS += \
+  -DCFG_TUSB_MCU=OPT_MCU_NONE \
+  -DTUP_DCD_ENDPOINT_MAX=16
+
+# Power-of-two FIFO index arithmetic, built in its own directory
+ifeq ($(FIFO_POW2),1)
+  CFLAGS += -DCFG_TUSB_FIFO_POW2=1
+  BUILD := _build_pow2
+endif
+
+# Log level is mapped to TUSB DEBUG option
+ifneq ($(LOG),)
+  CFLAGS += -DCFG_TUSB_DEBUG=$(LOG)
+endif
@@ -0,0 +1,498 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2023, Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "device/dcd.h"
+#include "host/hcd.h"
+#include "vbus.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+
+// host pipes for address 0 (enumeration) and configured devices
+#define VBUS_DEV_MAX  (CFG_TUH_DEVICE_MAX + 1)
+
+typedef struct
+{
+  uint8_t* buffer;
+  uint16_t total_len;
+  uint16_t xferred;
+  bool     active;
+}vbus_xfer_t;
+
+typedef struct
+{
+  vbus_xfer_t xfer;
+  uint16_t mps;
+  uint8_t  type;
+  uint8_t  interval;    // interrupt endpoint polling interval in frames
+  uint32_t next_frame;  // interrupt endpoint is not polled before this frame
+  bool     opened;
+  bool     stalled;
+}vbus_edpt_t;
+
+typedef struct
+{
+  uint32_t frame;
+  int32_t  budget;      // remaining bandwidth of current frame in bytes
+
+  //------------- Device -------------//
+  uint8_t dcd_rhport;
+  bool    pullup;
+  bool    sof_en;
+  uint8_t dev_addr;
+  uint8_t new_addr;     // set address takes effect after status stage
+  bool    addr_pending;
+  vbus_edpt_t dev_ep[16][2];
+
+  //------------- Host -------------//
+  uint8_t hcd_rhport;
+  bool    hcd_inited;
+  bool    attached;
+  bool    setup_pending;
+  uint8_t setup_addr;
+  uint8_t setup_packet[8];
+  vbus_edpt_t host_ep[VBUS_DEV_MAX][16][2];
+}vbus_t;
+
+static vbus_t _vbus;
+
+static void edpt_init(vbus_edpt_t* ep, uint16_t mps, uint8_t type, uint8_t interval)
+{
+  tu_memclr(ep, sizeof(vbus_edpt_t));
+  ep->mps      = mps;
+  ep->type     = type;
+  ep->interval = interval ? interval : 1;
+  ep->opened   = true;
+}
+
+static void device_bus_reset(void)
+{
+  _vbus.dev_addr     = 0;
+  _vbus.addr_pending = false;
+
+  tu_memclr(_vbus.dev_ep, sizeof(_vbus.dev_ep));
+  edpt_init(&_vbus.dev_ep[0][TUSB_DIR_OUT], CFG_TUD_ENDPOINT0_SIZE, TUSB_XFER_CONTROL, 0);
+  edpt_init(&_vbus.dev_ep[0][TUSB_DIR_IN ], CFG_TUD_ENDPOINT0_SIZE, TUSB_XFER_CONTROL, 0);
+}
+
+//--------------------------------------------------------------------+
+// Bus
+//--------------------------------------------------------------------+
+
+uint32_t vbus_frame(void)
+{
+  return _vbus.frame;
+}
+
+static void bus_consume(int32_t cost)
+{
+  _vbus.budget -= cost;
+
+  if ( _vbus.budget <= 0 )
+  {
+    _vbus.frame++;
+    _vbus.budget += VBUS_FRAME_BYTES;
+
+    if ( _vbus.pullup && _vbus.sof_en ) dcd_event_sof(_vbus.dcd_rhport, _vbus.frame & 0x7FF, true);
+  }
+}
+
+static void device_xfer_complete(uint8_t ep_addr, vbus_edpt_t* ep)
+{
+  ep->xfer.active = false;
+
+  // set address is effective after status stage
+  if ( (ep_addr == 0x80) && _vbus.addr_pending )
+  {
+    _vbus.dev_addr     = _vbus.new_addr;
+    _vbus.addr_pending = false;
+  }
+
+  dcd_event_xfer_complete(_vbus.dcd_rhport, ep_addr, ep->xfer.xferred, XFER_RESULT_SUCCESS, true);
+}
+
+static void host_xfer_complete(uint8_t daddr, uint8_t ep_addr, vbus_edpt_t* ep, xfer_result_t result)
+{
+  ep->xfer.active = false;
+  hcd_event_xfer_complete(daddr, ep_addr, ep->xfer.xferred, result, true);
+}
+
+// Move a packet between host pipe and device endpoint, return bus cost
+static int32_t bus_transaction(uint8_t ep_addr, vbus_edpt_t* hep, vbus_edpt_t* dep)
+{
+  uint8_t const daddr = _vbus.dev_addr;
+
+  if ( dep->stalled )
+  {
+    host_xfer_complete(daddr, ep_addr, hep, XFER_RESULT_STALLED);
+    return VBUS_NAK_COST;
+  }
+
+  // NAK
+  if ( !dep->xfer.active ) return VBUS_NAK_COST;
+
+  vbus_xfer_t* src;
+  vbus_xfer_t* dst;
+
+  if ( tu_edpt_dir(ep_addr) == TUSB_DIR_OUT )
+  {
+    src = &hep->xfer;
+    dst = &dep->xfer;
+  }else
+  {
+    src = &dep->xfer;
+    dst = &hep->xfer;
+  }
+
+  // packet size is decided by sender, receiver buffer overflow (babble) is truncated
+  uint16_t len = tu_min16((uint16_t) (src->total_len - src->xferred), dep->mps);
+  len = tu_min16(len, (uint16_t) (dst->total_len - dst->xferred));
+
+  if ( len ) memcpy(dst->buffer + dst->xferred, src->buffer + src->xferred, len);
+  src->xferred = (uint16_t) (src->xferred + len);
+  dst->xferred = (uint16_t) (dst->xferred + len);
+
+  // sender is done when all bytes are sent, receiver when buffer is full or short packet is received
+  bool const src_done = (src->xferred == src->total_len);
+  bool const dst_done = (dst->xferred == dst->total_len) || (len < dep->mps);
+
+  bool const host_done = (tu_edpt_dir(ep_addr) == TUSB_DIR_OUT) ? src_done : dst_done;
+  bool const dev_done  = (tu_edpt_dir(ep_addr) == TUSB_DIR_OUT) ? dst_done : src_done;
+
+  if ( dev_done  ) device_xfer_complete(ep_addr, dep);
+  if ( host_done ) host_xfer_complete(daddr, ep_addr, hep, XFER_RESULT_SUCCESS);
+
+  return len + VBUS_PACKET_OVERHEAD;
+}
+
+void vbus_task(void)
+{
+  // device connection
+  if ( _vbus.hcd_inited && (_vbus.pullup != _vbus.attached) )
+  {
+    _vbus.attached = _vbus.pullup;
+
+    if ( _vbus.attached )
+    {
+      hcd_event_device_attach(_vbus.hcd_rhport, true);
+    }else
+    {
+      hcd_event_device_remove(_vbus.hcd_rhport, true);
+    }
+  }
+
+  if ( !_vbus.attached )
+  {
+    bus_consume(VBUS_NAK_COST);
+    return;
+  }
+
+  int32_t cost = 0;
+
+  // setup packet is always ACKed by device
+  if ( _vbus.setup_pending && (_vbus.setup_addr == _vbus.dev_addr) )
+  {
+    _vbus.setup_pending = false;
+
+    // setup clears control endpoint stall and aborts previous control transfer
+    for(uint8_t dir = 0; dir < 2; dir++)
+    {
+      _vbus.dev_ep[0][dir].stalled     = false;
+      _vbus.dev_ep[0][dir].xfer.active = false;
+    }
+
+    dcd_event_setup_received(_vbus.dcd_rhport, _vbus.setup_packet, true);
+    hcd_event_xfer_complete(_vbus.setup_addr, 0, 8, XFER_RESULT_SUCCESS, true);
+
+    cost += 8 + VBUS_PACKET_OVERHEAD;
+  }
+
+  // host schedules all pending transfers of addressed device, one packet each
+  vbus_edpt_t (*host_ep)[2] = _vbus.host_ep[_vbus.dev_addr];
+
+  for(uint8_t epnum = 0; epnum < 16; epnum++)
+  {
+    for(uint8_t dir = 0; dir < 2; dir++)
+    {
+      vbus_edpt_t* hep = &host_ep[epnum][dir];
+      vbus_edpt_t* dep = &_vbus.dev_ep[epnum][dir];
+
+      if ( !hep->xfer.active || !dep->opened ) continue;
+
+      // periodic endpoint is polled once per interval
+      bool const periodic = (hep->type == TUSB_XFER_INTERRUPT) || (hep->type == TUSB_XFER_ISOCHRONOUS);
+      if ( periodic )
+      {
+        if ( (int32_t) (_vbus.frame - hep->next_frame) < 0 ) continue;
+        hep->next_frame = _vbus.frame + hep->interval;
+      }
+
+      cost += bus_transaction(tu_edpt_addr(epnum, dir), hep, dep);
+    }
+  }
+
+  bus_consume(cost ? cost : VBUS_NAK_COST);
+}
+
+//--------------------------------------------------------------------+
+// Device Controller API
+//--------------------------------------------------------------------+
+
+void dcd_init(uint8_t rhport)
+{
+  _vbus.dcd_rhport = rhport;
+  device_bus_reset();
+  dcd_connect(rhport);
+}
+
+void dcd_int_handler(uint8_t rhport)
+{
+  (void) rhport;
+}
+
+void dcd_int_enable(uint8_t rhport)
+{
+  (void) rhport;
+}
+
+void dcd_int_disable(uint8_t rhport)
+{
+  (void) rhport;
+}
+
+void dcd_set_address(uint8_t rhport, uint8_t dev_addr)
+{
+  _vbus.new_addr     = dev_addr;
+  _vbus.addr_pending = true;
+
+  // Respond with status
+  dcd_edpt_xfer(rhport, tu_edpt_addr(0, TUSB_DIR_IN), NULL, 0);
+}
+
+void dcd_remote_wakeup(uint8_t rhport)
+{
+  (void) rhport;
+}
+
+void dcd_connect(uint8_t rhport)
+{
+  (void) rhport;
+  _vbus.pullup = true;
+}
+
+void dcd_disconnect(uint8_t rhport)
+{
+  (void) rhport;
+  _vbus.pullup = false;
+}
+
+void dcd_sof_enable(uint8_t rhport, bool en)
+{
+  (void) rhport;
+  _vbus.sof_en = en;
+}
+
+bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * desc_ep)
+{
+  (void) rhport;
+
+  uint8_t const ep_addr = desc_ep->bEndpointAddress;
+  edpt_init(&_vbus.dev_ep[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)], tu_edpt_packet_size(desc_ep),
+            desc_ep->bmAttributes.xfer, desc_ep->bInterval);
+
+  return true;
+}
+
+void dcd_edpt_close_all(uint8_t rhport)
+{
+  (void) rhport;
+  tu_memclr(_vbus.dev_ep[1], sizeof(_vbus.dev_ep) - sizeof(_vbus.dev_ep[0]));
+}
+
+void dcd_edpt_close(uint8_t rhport, uint8_t ep_addr)
+{
+  (void) rhport;
+  tu_memclr(&_vbus.dev_ep[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)], sizeof(vbus_edpt_t));
+}
+
+bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes)
+{
+  (void) rhport;
+
+  vbus_edpt_t* ep = &_vbus.dev_ep[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  TU_ASSERT(ep->opened && !ep->xfer.active);
+
+  ep->xfer.buffer    = buffer;
+  ep->xfer.total_len = total_bytes;
+  ep->xfer.xferred   = 0;
+  ep->xfer.active    = true;
+
+  return true;
+}
+
+void dcd_edpt_stall(uint8_t rhport, uint8_t ep_addr)
+{
+  (void) rhport;
+
+  vbus_edpt_t* ep = &_vbus.dev_ep[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  ep->stalled     = true;
+  ep->xfer.active = false;
+}
+
+void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
+{
+  (void) rhport;
+  _vbus.dev_ep[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)].stalled = false;
+}
+
+//--------------------------------------------------------------------+
+// Host Controller API
+//--------------------------------------------------------------------+
+
+bool hcd_init(uint8_t rhport)
+{
+  _vbus.hcd_rhport = rhport;
+  _vbus.hcd_inited = true;
+  return true;
+}
+
+void hcd_int_handler(uint8_t rhport)
+{
+  (void) rhport;
+}
+
+void hcd_int_enable(uint8_t rhport)
+{
+  (void) rhport;
+}
+
+void hcd_int_disable(uint8_t rhport)
+{
+  (void) rhport;
+}
+
+uint32_t hcd_frame_number(uint8_t rhport)
+{
+  (void) rhport;
+
+  // host busy-waits on frame number in osal_task_delay(), keep bus running meanwhile
+  uint32_t const frame = _vbus.frame;
+  vbus_task();
+
+  return frame;
+}
+
+bool hcd_port_connect_status(uint8_t rhport)
+{
+  (void) rhport;
+  return _vbus.attached;
+}
+
+void hcd_port_reset(uint8_t rhport)
+{
+  (void) rhport;
+
+  device_bus_reset();
+  dcd_event_bus_reset(_vbus.dcd_rhport, TUSB_SPEED_FULL, true);
+}
+
+void hcd_port_reset_end(uint8_t rhport)
+{
+  (void) rhport;
+}
+
+tusb_speed_t hcd_port_speed_get(uint8_t rhport)
+{
+  (void) rhport;
+  return TUSB_SPEED_FULL;
+}
+
+void hcd_device_close(uint8_t rhport, uint8_t dev_addr)
+{
+  (void) rhport;
+  TU_VERIFY(dev_addr < VBUS_DEV_MAX, );
+
+  tu_memclr(_vbus.host_ep[dev_addr], sizeof(_vbus.host_ep[dev_addr]));
+  if ( _vbus.setup_addr == dev_addr ) _vbus.setup_pending = false;
+}
+
+bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const * ep_desc)
+{
+  (void) rhport;
+  TU_ASSERT(dev_addr < VBUS_DEV_MAX);
+
+  uint8_t const ep_addr = ep_desc->bEndpointAddress;
+  uint16_t const mps    = tu_edpt_packet_size(ep_desc);
+  uint8_t const type    = ep_desc->bmAttributes.xfer;
+
+  if ( type == TUSB_XFER_CONTROL )
+  {
+    edpt_init(&_vbus.host_ep[dev_addr][0][TUSB_DIR_OUT], mps, type, 0);
+    edpt_init(&_vbus.host_ep[dev_addr][0][TUSB_DIR_IN ], mps, type, 0);
+  }else
+  {
+    edpt_init(&_vbus.host_ep[dev_addr][tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)], mps, type, ep_desc->bInterval);
+  }
+
+  return true;
+}
+
+bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer, uint16_t buflen)
+{
+  (void) rhport;
+  TU_ASSERT(dev_addr < VBUS_DEV_MAX);
+
+  vbus_edpt_t* ep = &_vbus.host_ep[dev_addr][tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  TU_ASSERT(ep->opened && !ep->xfer.active);
+
+  ep->xfer.buffer    = buffer;
+  ep->xfer.total_len = buflen;
+  ep->xfer.xferred   = 0;
+  ep->xfer.active    = true;
+
+  return true;
+}
+
+bool hcd_setup_send(uint8_t rhport, uint8_t dev_addr, uint8_t const setup_packet[8])
+{
+  (void) rhport;
+
+  memcpy(_vbus.setup_packet, setup_packet, 8);
+  _vbus.setup_addr    = dev_addr;
+  _vbus.setup_pending = true;
+
+  return true;
+}
+
+bool hcd_edpt_clear_stall(uint8_t dev_addr, uint8_t ep_addr)
+{
+  (void) dev_addr;
+  (void) ep_addr;
+
+  // data toggle is not modeled
+  return true;
+}
@@ -0,0 +1,64 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2023, Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Virtual bus: software controller implementing both dcd.h and hcd.h so that host stack (usbh) enumerates and
+// drives device stack (usbd) in the same process. Full speed bus is modeled by packets of endpoint max packet size
+// and a 1 ms frame with bandwidth of VBUS_FRAME_BYTES: each packet costs its length plus protocol overhead, a NAKed
+// token or an idle bus slot costs a smaller fixed amount. Time is therefore deterministic and independent of host
+// machine speed, which makes it suitable for benchmark in CI.
+
+#ifndef _TUSB_VBUS_H_
+#define _TUSB_VBUS_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Full speed: 12 Mbit/s
+#ifndef VBUS_FRAME_BYTES
+#define VBUS_FRAME_BYTES      1500
+#endif
+
+// Bulk transaction protocol overhead (USB 2.0 spec 5.8.4), about 19 bulk packets of 64 bytes per frame
+#define VBUS_PACKET_OVERHEAD  13
+
+// Token + NAK handshake, also used as time slot when bus is idle
+#define VBUS_NAK_COST         6
+
+// Run bus for a slot: every pending host transfer can move at most one packet. Frame number advances when frame
+// bandwidth is used up. Should be called in the same loop with tud_task() and tuh_task()
+void vbus_task(void);
+
+// Current frame number (1 ms)
+uint32_t vbus_frame(void);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_VBUS_H_ */
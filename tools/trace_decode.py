@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""Decode a dump of tu_trace_ring (CFG_TUSB_TRACE) into a readable timeline.
+
+The dump is the raw memory of tu_trace_ring, e.g. from a debugger:
+    (gdb) dump binary value trace.bin tu_trace_ring
+A larger memory dump also works, the ring is located by its magic.
+
+Usage: trace_decode.py trace.bin [--tick-hz 48000000]
+"""
+import argparse
+import struct
+import sys
+
+# must be kept in sync with src/common/tusb_debug.h
+TRACE_MAGIC = 0x52545554
+HEADER_FORMAT = '<LHHL'
+RECORD_FORMAT = '<LBBBBL'
+
+DCD_EVENTS = ['Invalid', 'Bus Reset', 'Unplugged', 'SOF', 'Suspend', 'Resume', 'Setup Received', 'Xfer Complete',
+              'Func Call']
+HCD_EVENTS = ['Device Attach', 'Device Remove', 'Xfer Complete', 'Func Call']
+XFER_RESULTS = ['SUCCESS', 'FAILED', 'STALLED', 'TIMEOUT', 'INVALID']
+SPEEDS = ['Full', 'Low', 'High']
+
+TRACE_IDS = [
+    # (base, count, prefix, event names)
+    (0x00, len(DCD_EVENTS), 'DCD ', DCD_EVENTS),
+    (0x10, len(DCD_EVENTS), 'USBD', DCD_EVENTS),
+    (0x20, 1, 'USBD', ['Xfer Submit']),
+    (0x21, 1, 'USBD', ['Stall']),
+    (0x40, len(HCD_EVENTS), 'HCD ', HCD_EVENTS),
+    (0x50, len(HCD_EVENTS), 'USBH', HCD_EVENTS),
+    (0x60, 1, 'USBH', ['Xfer Submit']),
+]
+
+
+def trace_name(tid):
+    for base, count, prefix, names in TRACE_IDS:
+        if base <= tid < base + count:
+            return prefix, names[tid - base]
+    return '????', 'ID 0x{:02X}'.format(tid)
+
+
+def record_detail(name, ep_addr, result, length):
+    if name == 'Bus Reset':
+        return '{} Speed'.format(SPEEDS[result] if result < len(SPEEDS) else result)
+    if name == 'Setup Received':
+        bm_request_type, b_request, w_value = struct.unpack('<BBH', struct.pack('<L', length))
+        return 'bmRequestType {:02X} bRequest {:02X} wValue {:04X}'.format(bm_request_type, b_request, w_value)
+    if name == 'Xfer Complete':
+        res = XFER_RESULTS[result] if result < len(XFER_RESULTS) else str(result)
+        return 'EP {:02X} {} bytes {}'.format(ep_addr, length, res)
+    if name == 'Xfer Submit':
+        return 'EP {:02X} {} bytes'.format(ep_addr, length)
+    if name == 'Stall':
+        return 'EP {:02X}'.format(ep_addr)
+    return ''
+
+
+def decode(data, tick_hz):
+    offset = data.find(struct.pack('<L', TRACE_MAGIC))
+    if offset < 0:
+        sys.exit('trace ring magic not found')
+
+    _, depth, record_size, wr_count = struct.unpack_from(HEADER_FORMAT, data, offset)
+    if record_size != struct.calcsize(RECORD_FORMAT):
+        sys.exit('unsupported record size {}'.format(record_size))
+
+    rec_offset = offset + struct.calcsize(HEADER_FORMAT)
+    if len(data) < rec_offset + depth * record_size:
+        sys.exit('dump is truncated')
+
+    # oldest record first, records before the ring wrapped are lost
+    count = min(wr_count, depth)
+    first = wr_count - count
+    if first:
+        print('{} older records overwritten'.format(first))
+
+    t0 = None
+    prev = None
+    for n in range(first, wr_count):
+        ts, tid, port, ep_addr, result, length = struct.unpack_from(RECORD_FORMAT, data,
+                                                                    rec_offset + (n % depth) * record_size)
+        if t0 is None:
+            t0 = prev = ts
+
+        # timestamp is 32-bit and may wrap
+        elapsed = (ts - t0) & 0xFFFFFFFF
+        delta = (ts - prev) & 0xFFFFFFFF
+        prev = ts
+
+        if tick_hz:
+            time_str = '{:12.1f}us (+{:9.1f})'.format(elapsed * 1e6 / tick_hz, delta * 1e6 / tick_hz)
+        else:
+            time_str = '{:10} (+{:8})'.format(elapsed, delta)
+
+        prefix, name = trace_name(tid)
+        print('{:6} {} {} [{}] {:15} {}'.format(n, time_str, prefix, port, name,
+                                               record_detail(name, ep_addr, result, length)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode TinyUSB binary trace dump')
+    parser.add_argument('dump', help='binary dump of tu_trace_ring')
+    parser.add_argument('--tick-hz', type=float, default=0,
+                        help='frequency of tusb_timestamp_cb() to print time in microseconds')
+    args = parser.parse_args()
+
+    with open(args.dump, 'rb') as f:
+        decode(f.read(), args.tick_hz)
+
+
+if __name__ == '__main__':
+    main()